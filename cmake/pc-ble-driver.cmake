@@ -54,6 +54,9 @@ set(Boost_USE_STATIC_LIBS   ON)
 # Minimum version required is 1.54.0
 find_package ( Boost 1.54.0 REQUIRED COMPONENTS thread system regex date_time chrono )
 
+# zlib is optional, the event bridge compresses batches when it is found
+find_package(ZLIB)
+
 # Add or remove SD API versions here
 set(SD_API_VER_NUMS 2 5)
 list(LENGTH SD_API_VER_NUMS SD_API_VER_COUNT)
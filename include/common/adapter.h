@@ -62,6 +62,21 @@ typedef struct
     void *internal;
 } physical_layer_t;
 
+typedef struct
+{
+    void *internal;
+} provisioner_t;
+
+typedef struct
+{
+    void *internal;
+} dfu_engine_t;
+
+typedef struct
+{
+    void *internal;
+} gatt_cache_t;
+
 #ifdef __cplusplus
 }
 #endif
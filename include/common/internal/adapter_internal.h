@@ -40,32 +40,93 @@
 
 #include "sd_rpc_types.h"
 #include "serialization_transport.h"
+#include "adv_restarter.h"
+#include "conn_state_tracker.h"
+#include "conn_timeline.h"
+#include "device_counter.h"
+#include "event_bridge.h"
+#include "notification_sink.h"
+#include "peer_stats.h"
+#include "prefetcher.h"
+#include "presence_table.h"
+#include "state_journal.h"
+#include "subscription_tracker.h"
+#include "user_mem_pool.h"
+#include "failover_group.h"
+#include "event_observer.h"
 
 #include "nrf_error.h"
 #include "ble.h"
 
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 class AdapterInternal {
     public:
         explicit AdapterInternal(SerializationTransport *transport);
         ~AdapterInternal();
         uint32_t open(const sd_rpc_status_handler_t status_callback, const sd_rpc_evt_handler_t event_callback, const sd_rpc_log_handler_t log_callback);
-        uint32_t close() const;
+        uint32_t close();
         uint32_t logSeverityFilterSet(sd_rpc_log_severity_t severity_filter);
         static bool isInternalError(const uint32_t error_code);
 
         void statusHandler(sd_rpc_app_status_t code, const char * error);
         void eventHandler(ble_evt_t *event);
         void logHandler(sd_rpc_log_severity_t severity, std::string log_message);
+        void commandHandler(const uint8_t *command, const uint32_t length);
+
+        uint32_t stateReplayEnable(const bool enable);
+        uint32_t failoverStandbySet(AdapterInternal *standby);
+        uint32_t failoverInfoGet(sd_rpc_failover_info_t *info) const;
+
+        void observerAdd(std::shared_ptr<EventObserver> observer);
+        void observerRemove(const EventObserver *observer);
+
+        /**@brief Returns true if commands can be sent, with the number of link resets so far in generation. */
+        bool linkReadyGet(uint32_t *generation);
+
+        /**@brief Waits until the link is ready again if it has been reset since generation.
+         * @return false if the link has not been reset or is not ready within the resync timeout. */
+        bool linkResyncWait(uint32_t *generation);
 
         SerializationTransport *transport;
+        ConnStateTracker connStateTracker;
+        ConnTimeline connTimeline;
+        DeviceCounter deviceCounter;
+        EventBridge eventBridge;
+        NotificationSink notificationSink;
+        PeerStats peerStats;
+        std::shared_ptr<Prefetcher> prefetcher;
+        std::shared_ptr<PresenceTable> presenceTable;
+        SubscriptionTracker subscriptionTracker;
+        std::shared_ptr<StateJournal> stateJournal;
+        std::shared_ptr<AdvRestarter> advRestarter;
+        std::shared_ptr<UserMemPool> userMemPool;
 
     private:
         sd_rpc_evt_handler_t eventCallback;
         sd_rpc_status_handler_t statusCallback;
         sd_rpc_log_handler_t logCallback;
         sd_rpc_log_severity_t logSeverityFilter;
+
+        void failoverGroupRemove();
+        std::shared_ptr<FailoverGroup> failoverGroup;
+
+        // Sizes the codec context tables when the SoftDevice has been enabled
+        void connCountSet(const uint8_t *command, const uint32_t length);
+
+        std::mutex observerMutex;
+        std::vector<std::shared_ptr<EventObserver>> observers;
+
+        // Link readiness, the link is ready when it is active and the configuration is restored
+        std::mutex linkMutex;
+        std::condition_variable linkWaitCondition;
+        uint32_t linkGeneration;
+        bool linkReady;
+        bool linkClosed;
 };
 
 #endif // ADAPTER_INTERNAL_H__
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ADV_RESTARTER_H__
+#define ADV_RESTARTER_H__
+
+#include "sd_rpc_types.h"
+#include "transport.h"
+#include "worker_thread.h"
+
+#include "ble.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <stdint.h>
+
+class SerializationTransport;
+
+/**
+ * @brief The AdvRestarter class keeps the last advertising start command and sends it again when the
+ * connection a central established to the advertising is disconnected. Connections and disconnections
+ * are detected on the read thread, before the event is queued for decoding, and the command is sent
+ * from a separate thread since commands can not be sent from the transport threads.
+ */
+class AdvRestarter : public std::enable_shared_from_this<AdvRestarter>
+{
+public:
+    AdvRestarter(SerializationTransport *transport, log_cb_t log_callback);
+    ~AdvRestarter();
+
+    /**@brief Records advertising start and stop commands the connectivity chip has executed successfully. */
+    void commandProcess(const uint8_t *command, const uint32_t length);
+
+    /**@brief Restarts advertising if the encoded event is the disconnection of the connection established
+     * to the advertising. Called on the read thread. */
+    void eventPeek(const uint8_t *event, const uint32_t length);
+
+    /**@brief Forgets the advertising start command when advertising times out. Called before the event is dispatched. */
+    void process(const ble_evt_t *event);
+
+    /**@brief Forgets the advertising state when the connectivity chip has been reset. */
+    void clear();
+
+    /**@brief Stops the restart thread. */
+    void stop();
+
+    uint32_t enable(const bool enable);
+    uint32_t infoGet(sd_rpc_adv_restart_info_t *info) const;
+
+private:
+    void restartRunner();
+    void restart(const std::vector<uint8_t> &command, const std::chrono::steady_clock::time_point &disconnected);
+
+    SerializationTransport *transport;
+    log_cb_t logCallback;
+
+    mutable std::mutex restartMutex;
+    std::vector<uint8_t> advStartCommand;
+    bool restartEnabled;
+
+    // Advertising is running, and the connection established to it in the peripheral role
+    bool advertising;
+    uint16_t advConnHandle;
+
+    // Variables used by the restart thread
+    std::condition_variable restartWaitCondition;
+    WorkerThread restartThread;
+    bool runRestartThread;
+    bool restartPending;
+    std::chrono::steady_clock::time_point disconnectTime;
+
+    sd_rpc_adv_restart_info_t info;
+    uint64_t totalGapUs;
+};
+
+#endif // ADV_RESTARTER_H__
@@ -47,6 +47,13 @@ typedef std::function<uint32_t(uint8_t*, uint32_t, uint32_t*)> decode_function_t
 
 uint32_t encode_decode(adapter_t *adapter, encode_function_t encode_function, decode_function_t decode_function);
 
+/**
+ * Returns true if the command with the given op code has no side effects on the connectivity chip or
+ * its peers, so it can be sent again if the link is resynchronized before the response is received.
+ * Commands on a connection are not, the connection and its keys may be lost with the reset of the chip.
+ */
+bool ble_command_idempotent(const uint8_t opcode);
+
 /*
  * We do not want to change the codecs provided by the SDK too much. The BLESecurityContext provides a way to set the root
  * security context before calling the codecs. Typically the root context is the SerializationTransport object.
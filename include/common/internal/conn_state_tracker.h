@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONN_STATE_TRACKER_H__
+#define CONN_STATE_TRACKER_H__
+
+#include "sd_rpc_types.h"
+
+#include "ble.h"
+
+#include <atomic>
+#include <mutex>
+
+#include <stdint.h>
+
+// Maximum number of concurrent connections tracked per adapter
+const uint32_t CONN_STATE_MAX_CONNECTIONS = 20;
+
+/**
+ * @brief The ConnStateTracker class keeps the state of each connection up to date from received
+ * events. Updates are serialized by a mutex, reads are lock-free using a sequence counter per
+ * connection so they can be done from any thread without blocking the event thread.
+ */
+class ConnStateTracker
+{
+public:
+    ConnStateTracker();
+
+    /**@brief Updates the connection state from an event. Called before the event is dispatched. */
+    void process(const ble_evt_t *event);
+
+    /**@brief Records the ATT MTU this device has offered on a connection. */
+    void ownMtuSet(const uint16_t conn_handle, const uint16_t rx_mtu);
+
+    /**@brief Forgets all connections, i.e. when the connectivity chip has been reset. */
+    void clear();
+
+    uint32_t get(const uint16_t conn_handle, sd_rpc_conn_state_t *state) const;
+    uint32_t list(sd_rpc_conn_state_t states[], uint32_t *size) const;
+
+private:
+    struct Slot
+    {
+        std::atomic<uint32_t> sequence;
+        std::atomic<bool> active;
+        sd_rpc_conn_state_t state;
+        uint16_t ownRxMtu;
+        uint16_t peerRxMtu;
+    };
+
+    Slot *find(const uint16_t conn_handle);
+    Slot *allocate(const uint16_t conn_handle);
+
+    static void beginWrite(Slot *slot);
+    static void endWrite(Slot *slot);
+    static bool read(const Slot &slot, sd_rpc_conn_state_t *state);
+
+    std::mutex writeMutex;
+    Slot slots[CONN_STATE_MAX_CONNECTIONS];
+};
+
+#endif // CONN_STATE_TRACKER_H__
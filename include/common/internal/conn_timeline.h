@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONN_TIMELINE_H__
+#define CONN_TIMELINE_H__
+
+#include "sd_rpc_types.h"
+
+#include "ble.h"
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+#include <stdint.h>
+
+/**
+ * @brief The ConnTimeline class timestamps the phases of each connection attempt, from the advertising
+ * report of the peer to the first attribute value on the connection. Finished timelines are kept in a
+ * bounded history, and the durations of their phases in a histogram per phase over all connections.
+ */
+class ConnTimeline
+{
+public:
+    ConnTimeline();
+
+    /**@brief Timestamps the phases reached by an event. Called before the event is dispatched. */
+    void process(const ble_evt_t *event);
+
+    /**@brief Records that sd_ble_gap_connect is sent, and the result of the command when it has returned. */
+    void connectProcess(const ble_gap_addr_t *peerAddr);
+    void connectResultProcess(const uint32_t result);
+
+    /**@brief Records that sd_ble_gap_connect_cancel has returned. */
+    void connectCancelProcess(const uint32_t result);
+
+    /**@brief Records an attribute value sent on a connection. */
+    void txProcess(const uint16_t connHandle);
+
+    /**@brief Finishes all attempts, i.e. when the connectivity chip has been reset. */
+    void clear();
+
+    uint32_t start(const sd_rpc_conn_timeline_params_t *params);
+    uint32_t stop();
+    uint32_t get(const uint16_t connHandle, sd_rpc_conn_timeline_t *timeline) const;
+    uint32_t list(sd_rpc_conn_timeline_t *timelines, uint32_t *count) const;
+    uint32_t statsGet(sd_rpc_conn_timeline_stats_t *stats) const;
+
+private:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    // Durations in microseconds are kept in 8 buckets per power of two
+    static const uint32_t HISTOGRAM_SUB_BUCKETS = 8;
+    static const uint32_t HISTOGRAM_BUCKETS = 2 * HISTOGRAM_SUB_BUCKETS + (32 - 4) * HISTOGRAM_SUB_BUCKETS;
+
+    struct Histogram
+    {
+        uint32_t buckets[HISTOGRAM_BUCKETS];
+        uint32_t count;
+        uint32_t min;
+        uint32_t max;
+    };
+
+    struct Attempt
+    {
+        sd_rpc_conn_timeline_t timeline;
+        TimePoint times[SD_RPC_CONN_PHASE_COUNT];
+        bool reached[SD_RPC_CONN_PHASE_COUNT];
+    };
+
+    static uint64_t keyGet(const ble_gap_addr_t &addr);
+    static uint32_t bucketGet(const uint32_t value);
+    static uint32_t bucketValueGet(const uint32_t bucket);
+    static void histogramAdd(Histogram &histogram, const uint32_t value);
+    static void histogramGet(const Histogram &histogram, sd_rpc_conn_phase_stats_t *stats);
+
+    static void attemptInit(Attempt &attempt);
+    static void phaseSet(Attempt &attempt, const sd_rpc_conn_phase_t phase, const TimePoint time);
+    static void timelineUpdate(Attempt &attempt);
+
+    Attempt *connectionGet(const uint16_t connHandle);
+    void advReportSet(Attempt &attempt, const ble_gap_addr_t &peerAddr);
+    void finish(Attempt &attempt, const sd_rpc_conn_outcome_t outcome);
+    void connectedProcess(const ble_gap_evt_t &gapEvent);
+
+    mutable std::mutex timelineMutex;
+    bool started;
+    uint32_t maxTimelines;
+
+    std::unordered_map<uint64_t, TimePoint> advReports;     // Time of the last advertising report per peer key
+    bool pending;                                           // An attempt by sd_ble_gap_connect is not connected yet
+    Attempt pendingAttempt;
+    bool commandTracked;                                    // The sd_ble_gap_connect being sent started pendingAttempt
+    uint16_t commandConnHandle;                             // Connection of pendingAttempt if connected before the command returned
+    std::map<uint16_t, Attempt> connections;
+    std::deque<sd_rpc_conn_timeline_t> history;
+
+    uint32_t attemptCount;
+    uint32_t connectedCount;
+    Histogram phaseHistograms[SD_RPC_CONN_PHASE_COUNT];
+    Histogram elapsedHistograms[SD_RPC_CONN_PHASE_COUNT];
+};
+
+#endif // CONN_TIMELINE_H__
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DEVICE_COUNTER_H__
+#define DEVICE_COUNTER_H__
+
+#include "sd_rpc_types.h"
+
+#include "ble.h"
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <stdint.h>
+
+/**
+ * @brief The DeviceCounter class estimates the number of distinct devices in advertising reports per
+ * time window, with a HyperLogLog sketch per window. Sketches of the same window from several adapters
+ * are merged by taking the maximum of each register.
+ */
+class DeviceCounter
+{
+public:
+    DeviceCounter();
+
+    /**@brief Counts advertising reports. Returns true if the event is not to be passed on. */
+    bool process(const ble_evt_t *event);
+
+    uint32_t start(const sd_rpc_device_counter_params_t *params);
+    uint32_t stop();
+
+    /**@brief Estimates the distinct devices in a window over the merged sketches of the counters. */
+    static uint32_t countGet(const std::vector<DeviceCounter *> &counters, const uint32_t window, sd_rpc_device_count_t *count);
+
+private:
+    struct Window
+    {
+        uint64_t start;
+        uint32_t reportCount;
+        std::vector<uint8_t> registers;
+    };
+
+    static uint64_t hash(const ble_gap_addr_t &addr);
+    static uint64_t timeGet();
+    static uint32_t estimate(const std::vector<uint8_t> &registers);
+
+    void rotate(const uint64_t now);
+    const Window *windowFind(const uint64_t start) const;
+
+    std::mutex counterMutex;
+    bool started;
+    sd_rpc_device_counter_params_t params;
+    Window current;
+    std::deque<Window> history;
+};
+
+#endif // DEVICE_COUNTER_H__
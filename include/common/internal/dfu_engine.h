@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DFU_ENGINE_H__
+#define DFU_ENGINE_H__
+
+#include "sd_rpc_types.h"
+#include "event_observer.h"
+#include "worker_thread.h"
+
+#include "ble.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+
+/**
+ * @brief The DfuEngine class transfers firmware to devices running the Nordic Secure DFU bootloader.
+ * Each transfer is a state machine driven by events from the DFU target. Events are copied from the
+ * event threads of the adapters and processed on the engine thread, which sends the commands.
+ */
+class DfuEngine : public EventObserver, public std::enable_shared_from_this<DfuEngine>
+{
+public:
+    DfuEngine(dfu_engine_t *handle, adapter_t *adapters[], const uint8_t adapterCount, sd_rpc_dfu_result_handler_t resultHandler);
+    ~DfuEngine();
+
+    /**@brief Adds the vendor specific UUID of the DFU service to the adapters and starts the engine thread. */
+    uint32_t open();
+    void close();
+
+    uint32_t start(adapter_t *adapter, const uint16_t connHandle, const sd_rpc_dfu_image_t *image, void *context);
+    uint32_t abort(adapter_t *adapter, const uint16_t connHandle);
+    uint32_t progressGet(adapter_t *adapter, const uint16_t connHandle, sd_rpc_dfu_progress_t *progress) const;
+    uint32_t statsGet(sd_rpc_dfu_stats_t *stats) const;
+
+    /**@brief Copies events of DFU targets to the engine thread. */
+    void eventProcess(AdapterInternal *adapter, const ble_evt_t *event) override;
+
+    std::vector<AdapterInternal *> adaptersGet() const;
+
+private:
+    typedef std::chrono::steady_clock::time_point time_point_t;
+
+    enum State
+    {
+        STATE_DISCOVER_SERVICE,
+        STATE_DISCOVER_CHARACTERISTICS,
+        STATE_DISCOVER_CCCD,
+        STATE_ENABLE_NOTIFICATIONS,
+        STATE_SET_PRN,
+        STATE_SELECT,
+        STATE_CREATE,
+        STATE_STREAM,
+        STATE_CALCULATE_CRC,
+        STATE_EXECUTE
+    };
+
+    struct Lane
+    {
+        adapter_t *adapter;
+        AdapterInternal *adapterInternal;
+        uint8_t uuidType;
+    };
+
+    struct Session
+    {
+        size_t lane;
+        uint16_t connHandle;
+        void *context;
+        std::vector<uint8_t> initPacket;
+        std::vector<uint8_t> firmware;
+
+        State state;
+        bool dataPhase;
+        bool recovering;
+        uint16_t serviceEnd;
+        uint16_t controlPointHandle;
+        uint16_t cccdHandle;
+        uint16_t packetHandle;
+
+        // Object transfer
+        uint32_t maxObjectSize;
+        uint32_t objectSize;
+        uint32_t objectStart;
+        uint32_t objectEnd;
+        uint32_t offset;
+        uint16_t prn;
+        uint16_t prnConfigured;
+        uint16_t packetsSinceReceipt;
+        bool waitingReceipt;
+        bool waitingTx;
+        uint32_t crcErrors;
+        uint32_t successCount;
+        uint32_t crcOffset;
+        uint32_t crcValue;
+
+        // Statistics
+        uint32_t resumedOffset;
+        time_point_t dataStarted;
+        uint32_t result;
+        uint8_t dfuResult;
+        bool aborted;
+    };
+
+    struct Event
+    {
+        size_t lane;
+        uint16_t id;
+        uint16_t connHandle;
+        uint16_t gattStatus;
+        uint16_t handle;
+        uint16_t count;
+        uint16_t rangeEnd;
+        std::vector<uint8_t> data;
+        std::vector<ble_gattc_char_t> chars;
+        std::vector<ble_gattc_desc_t> descs;
+    };
+
+    void workerRunner();
+    void eventHandle(const Event &event);
+    void sessionStart(Session *session);
+
+    void serviceDiscoverRspHandle(Session *session, const Event &event);
+    void characteristicDiscoverRspHandle(Session *session, const Event &event);
+    void descriptorDiscoverRspHandle(Session *session, const Event &event);
+    void writeRspHandle(Session *session, const Event &event);
+    void controlPointHandle(Session *session, const std::vector<uint8_t> &response);
+
+    void prnSet(Session *session);
+    void select(Session *session);
+    void selectRspHandle(Session *session, const uint32_t maxSize, const uint32_t offset, const uint32_t crc);
+    void objectCreate(Session *session, const uint32_t start);
+    void stream(Session *session);
+    void crcRspHandle(Session *session, const uint32_t offset, const uint32_t crc);
+    void objectFailed(Session *session);
+    void executeRspHandle(Session *session);
+
+    void controlPointWrite(Session *session, const State state, const std::vector<uint8_t> &request);
+    const std::vector<uint8_t> &objectData(const Session *session) const;
+    uint32_t crcGet(Session *session, const uint32_t length) const;
+    void fail(Session *session, const uint32_t result, const uint8_t dfuResult = 0);
+    void finish(Session *session);
+    uint32_t bytesPerSecond(const Session *session) const;
+
+    Session *sessionFind(const size_t lane, const uint16_t connHandle);
+    const Session *sessionFind(const size_t lane, const uint16_t connHandle) const;
+    size_t laneFind(const adapter_t *adapter) const;
+
+    dfu_engine_t *handle;
+    sd_rpc_dfu_result_handler_t resultHandler;
+    std::vector<Lane> lanes;
+
+    // Sessions are owned by the engine thread, other threads lock sessionMutex to read them
+    mutable std::mutex sessionMutex;
+    std::list<Session> sessions;
+    uint32_t completedCount;
+    uint32_t failedCount;
+
+    std::mutex queueMutex;
+    std::queue<Event> eventQueue;
+    std::condition_variable workerWaitCondition;
+    WorkerThread workerThread;
+    bool runWorkerThread;
+
+    // Results collected while processing an event, reported without holding sessionMutex
+    std::vector<std::pair<adapter_t *, sd_rpc_dfu_result_t>> results;
+};
+
+#endif // DFU_ENGINE_H__
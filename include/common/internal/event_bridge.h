@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EVENT_BRIDGE_H__
+#define EVENT_BRIDGE_H__
+
+#include "sd_rpc_types.h"
+
+#include "ble.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+struct EventBridgeIo;
+class EventBridgeSubscriber;
+
+/**
+ * @brief The EventBridge class streams the events of an adapter to subscribers on a TCP or Unix domain
+ * socket. Events are collected on the transport threads and sent in batches from an IO service thread,
+ * each batch is encoded once for all subscribers with the same filter. Subscribers grant credit for the
+ * batches they can take, batches are queued while they have none and the oldest are dropped when the
+ * queue is full, so a slow subscriber never holds back the adapter or the other subscribers.
+ */
+class EventBridge
+{
+public:
+    EventBridge();
+    ~EventBridge();
+
+    uint32_t start(const sd_rpc_event_bridge_params_t *params);
+    uint32_t stop();
+    uint32_t infoGet(sd_rpc_event_bridge_info_t *info) const;
+
+    /**@brief Queues a serialized event frame for subscribers of frames. Called on the read thread. */
+    void framePeek(const uint8_t *event, const uint32_t length);
+
+    /**@brief Queues a decoded event for subscribers of decoded events. Called before the event is dispatched. */
+    void process(const ble_evt_t *event);
+
+private:
+    friend class EventBridgeSubscriber;
+
+    struct Entry
+    {
+        uint8_t content;
+        uint16_t eventId;
+        std::vector<uint8_t> encoded;
+    };
+
+    void entryAdd(const uint8_t content, const uint16_t eventId, const uint8_t *data, const uint32_t length);
+
+    // Called on the IO service thread
+    template<typename Acceptor, typename Socket> void acceptNext(Acceptor &acceptor);
+    void subscriberAdd(const std::shared_ptr<EventBridgeSubscriber> &subscriber);
+    void subscriberRemove(const EventBridgeSubscriber *subscriber);
+    void contentUpdate();
+    void flush();
+    void flushSchedule();
+
+    // Serializes start and stop
+    std::mutex controlMutex;
+
+    std::mutex bridgeMutex;
+    std::unique_ptr<EventBridgeIo> io;
+    sd_rpc_event_bridge_params_t params;
+    std::string unixPath;
+
+    // Events collected for the next batch, guarded by bridgeMutex
+    std::vector<Entry> pending;
+    bool running;
+    bool flushPosted;
+
+    // Content selected by any subscriber, checked before an event is copied
+    std::atomic<uint8_t> wantedContent;
+
+    // Owned by the IO service thread
+    std::vector<std::shared_ptr<EventBridgeSubscriber>> subscribers;
+
+    std::atomic<uint16_t> port;
+    std::atomic<uint16_t> subscriberCount;
+    std::atomic<uint64_t> eventsSent;
+    std::atomic<uint64_t> eventsDropped;
+    std::atomic<uint64_t> batchesSent;
+    std::atomic<uint64_t> bytesSent;
+};
+
+#endif // EVENT_BRIDGE_H__
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FAILOVER_GROUP_H__
+#define FAILOVER_GROUP_H__
+
+#include "sd_rpc_types.h"
+#include "worker_thread.h"
+
+#include "ble.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include <stdint.h>
+
+class AdapterInternal;
+
+/**
+ * @brief The FailoverGroup class keeps a standby adapter configured like a primary adapter.
+ * Configuration commands recorded on the primary are sent to the standby as they succeed. When the
+ * primary fails, advertising and scanning are started on the standby and the peers the primary
+ * was connected to as central are connected again from the standby. When the primary is active
+ * again with its configuration restored, advertising and scanning are moved back to it.
+ */
+class FailoverGroup : public std::enable_shared_from_this<FailoverGroup>
+{
+public:
+    FailoverGroup(AdapterInternal *primary, AdapterInternal *standby);
+    ~FailoverGroup();
+
+    /**@brief Sends the configuration recorded on the primary to the standby and starts monitoring. */
+    void start();
+    void stop();
+
+    /**@brief Processes a command the connectivity chip of an adapter in the group has executed successfully. */
+    void commandProcess(AdapterInternal *adapter, const uint8_t *command, const uint32_t length, const bool configuration);
+
+    /**@brief Processes an event from an adapter in the group. Called before the event is dispatched. */
+    void eventProcess(AdapterInternal *adapter, const ble_evt_t *event);
+
+    /**@brief Processes a status from an adapter in the group. Called before the status is dispatched. */
+    void statusProcess(AdapterInternal *adapter, sd_rpc_app_status_t code);
+
+    uint32_t infoGet(sd_rpc_failover_info_t *info) const;
+
+    AdapterInternal *primaryGet() const;
+    AdapterInternal *standbyGet() const;
+
+private:
+    struct Peer
+    {
+        ble_gap_addr_t address;
+        std::vector<uint8_t> connectCommand;
+    };
+
+    void workerRunner();
+    void failover();
+    void failback();
+    uint32_t send(AdapterInternal *adapter, const std::vector<uint8_t> &command);
+    std::vector<Peer>::iterator peerFind(const ble_gap_addr_t &address);
+
+    AdapterInternal *primary;
+    AdapterInternal *standby;
+
+    mutable std::mutex groupMutex;
+
+    // Commands to send to the standby, in order
+    std::queue<std::vector<uint8_t>> mirrorQueue;
+
+    // Procedures running on the primary, moved to the standby on failover
+    std::vector<uint8_t> advStartCommand;
+    std::vector<uint8_t> scanStartCommand;
+    std::vector<uint8_t> connectCommand;
+    std::vector<Peer> peers;
+    std::vector<std::vector<uint8_t>> reconnectCommands;
+
+    // Variables used by the worker thread
+    std::condition_variable workerWaitCondition;
+    WorkerThread workerThread;
+    bool runWorkerThread;
+    bool failedOver;
+    bool failoverPending;
+    bool failbackPending;
+    uint32_t sendFailureCount;
+    bool reconnectDone;
+    bool reconnected;
+    std::chrono::steady_clock::time_point failureTime;
+
+    sd_rpc_failover_info_t info;
+};
+
+#endif // FAILOVER_GROUP_H__
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GATT_CACHE_H__
+#define GATT_CACHE_H__
+
+#include "sd_rpc_types.h"
+#include "event_observer.h"
+#include "worker_thread.h"
+
+#include "ble.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include <stdint.h>
+
+/**
+ * @brief Immutable GATT table shared by all connections to peers of the same product model.
+ */
+class GattTable
+{
+public:
+    GattTable(const sd_rpc_gatt_fingerprint_type_t fingerprintType, const uint8_t *fingerprint,
+        std::vector<sd_rpc_gatt_service_t> &&services, std::vector<sd_rpc_gatt_char_t> &&chars,
+        std::vector<ble_gattc_desc_t> &&descs);
+
+    const sd_rpc_gatt_table_t *viewGet() const;
+    size_t sizeGet() const;
+
+private:
+    GattTable(const GattTable &) = delete;
+    GattTable &operator=(const GattTable &) = delete;
+
+    const std::vector<sd_rpc_gatt_service_t> services;
+    const std::vector<sd_rpc_gatt_char_t> chars;
+    const std::vector<ble_gattc_desc_t> descs;
+    sd_rpc_gatt_table_t view;
+};
+
+/**
+ * @brief The GattCache class resolves the GATT table of each central connection of its adapters.
+ * After connecting, the peer is fingerprinted with the Database Hash characteristic or, when it has
+ * none, with the first response of a primary service discovery. A table already discovered for the
+ * fingerprint is shared with the connection, otherwise a full discovery is run and its table kept.
+ * Tables are reference counted, a table stays alive while a connection or the application uses it.
+ */
+class GattCache : public EventObserver, public std::enable_shared_from_this<GattCache>
+{
+public:
+    GattCache(gatt_cache_t *handle, adapter_t *adapters[], const uint8_t adapterCount,
+        const sd_rpc_gatt_cache_params_t *params, sd_rpc_gatt_table_handler_t tableHandler);
+    ~GattCache();
+
+    uint32_t open();
+    void close();
+
+    /**@brief Takes a reference to the table of a connection, released with tableRelease. */
+    uint32_t tableGet(adapter_t *adapter, const uint16_t connHandle, const sd_rpc_gatt_table_t **table);
+    uint32_t tableRelease(const sd_rpc_gatt_table_t *table);
+    uint32_t statsGet(sd_rpc_gatt_cache_stats_t *stats) const;
+
+    /**@brief Copies the connection and GATT client events of central connections to the cache thread. */
+    void eventProcess(AdapterInternal *adapter, const ble_evt_t *event) override;
+
+    std::vector<AdapterInternal *> adaptersGet() const;
+
+private:
+    typedef std::chrono::steady_clock::time_point time_point_t;
+    typedef std::shared_ptr<const GattTable> table_ptr_t;
+
+    enum State
+    {
+        STATE_READ_HASH,
+        STATE_PROBE,
+        STATE_DISCOVER_SERVICES,
+        STATE_DISCOVER_CHARACTERISTICS,
+        STATE_DISCOVER_DESCRIPTORS,
+        STATE_RESOLVED,
+        STATE_FAILED
+    };
+
+    struct Fingerprint
+    {
+        sd_rpc_gatt_fingerprint_type_t type;
+        std::array<uint8_t, SD_RPC_GATT_FINGERPRINT_LEN> value;
+
+        bool operator<(const Fingerprint &other) const;
+    };
+
+    struct Entry
+    {
+        table_ptr_t table;
+        time_point_t lastUsed;
+    };
+
+    struct Lane
+    {
+        adapter_t *adapter;
+        AdapterInternal *adapterInternal;
+    };
+
+    struct Session
+    {
+        size_t lane;
+        uint16_t connHandle;
+        State state;
+        Fingerprint fingerprint;
+        time_point_t started;
+
+        // Discovery in progress
+        std::vector<sd_rpc_gatt_service_t> services;
+        std::vector<sd_rpc_gatt_char_t> chars;
+        std::vector<uint16_t> charEnds;
+        std::vector<ble_gattc_desc_t> descs;
+        size_t index;
+        uint32_t nextHandle;
+
+        table_ptr_t table;
+    };
+
+    struct Event
+    {
+        size_t lane;
+        uint16_t id;
+        uint16_t connHandle;
+        uint16_t gattStatus;
+        std::vector<uint8_t> value;
+        std::vector<ble_gattc_service_t> services;
+        std::vector<ble_gattc_char_t> chars;
+        std::vector<ble_gattc_desc_t> descs;
+    };
+
+    struct Result
+    {
+        adapter_t *adapter;
+        uint16_t connHandle;
+        table_ptr_t table;
+        uint32_t result;
+    };
+
+    void workerRunner();
+    void eventHandle(const Event &event);
+
+    void hashRead(Session *session);
+    void hashReadRspHandle(Session *session, const Event &event);
+    void probeRspHandle(Session *session, const Event &event);
+    void serviceDiscoverRspHandle(Session *session, const Event &event);
+    void characteristicDiscoverRspHandle(Session *session, const Event &event);
+    void descriptorDiscoverRspHandle(Session *session, const Event &event);
+
+    void servicesDiscover(Session *session);
+    void characteristicsDiscover(Session *session);
+    void descriptorsDiscover(Session *session);
+
+    bool lookup(Session *session);
+    void intern(Session *session);
+    void evict();
+    void resolve(Session *session, const bool hit);
+    void fail(Session *session, const uint32_t result);
+
+    Session *sessionFind(const size_t lane, const uint16_t connHandle);
+    size_t laneFind(const adapter_t *adapter) const;
+
+    gatt_cache_t *handle;
+    sd_rpc_gatt_table_handler_t tableHandler;
+    sd_rpc_gatt_cache_params_t params;
+    std::vector<Lane> lanes;
+
+    // Sessions, tables and statistics are owned by the cache thread, other threads lock stateMutex to use them
+    mutable std::mutex stateMutex;
+    std::list<Session> sessions;
+    std::map<Fingerprint, Entry> tables;
+    std::multimap<const sd_rpc_gatt_table_t *, table_ptr_t> retained;
+    uint32_t hitCount;
+    uint32_t missCount;
+    uint32_t failedCount;
+    uint64_t hitTimeMs;
+    uint64_t missTimeMs;
+
+    std::mutex queueMutex;
+    std::queue<Event> eventQueue;
+    std::condition_variable workerWaitCondition;
+    WorkerThread workerThread;
+    bool runWorkerThread;
+
+    // Results collected while processing an event, reported without holding stateMutex
+    std::vector<Result> results;
+};
+
+#endif // GATT_CACHE_H__
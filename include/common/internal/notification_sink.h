@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NOTIFICATION_SINK_H__
+#define NOTIFICATION_SINK_H__
+
+#include "sd_rpc_types.h"
+
+#include "ble.h"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+
+/**
+ * @brief The NotificationSink class appends notified values of registered characteristics to chunked
+ * buffers on the event thread. The application swaps out the filled chunks in bulk, and gives them
+ * back to be reused, instead of copying each value out of its event.
+ */
+class NotificationSink
+{
+public:
+    NotificationSink();
+    ~NotificationSink();
+
+    /**@brief Appends notifications of registered values. Returns true if the event is not to be passed on. */
+    bool process(const ble_evt_t *event);
+
+    /**@brief Stops appending to all sinks, i.e. when the connectivity chip has been reset. */
+    void connectionsLost();
+
+    uint32_t add(const sd_rpc_notification_sink_params_t *params);
+    uint32_t remove(const uint16_t connHandle, const uint16_t valueHandle);
+    uint32_t swap(const uint16_t connHandle, const uint16_t valueHandle, sd_rpc_notification_chunk_t *chunks, uint32_t *count, uint32_t *dropped);
+    uint32_t release(sd_rpc_notification_chunk_t *chunks, const uint32_t count);
+
+private:
+    struct Sink
+    {
+        sd_rpc_notification_sink_params_t params;
+        bool active;
+        std::deque<sd_rpc_notification_chunk_t> chunks;
+        uint32_t dropped;
+    };
+
+    static uint32_t key(const uint16_t connHandle, const uint16_t valueHandle);
+
+    void append(Sink &sink, const ble_gattc_evt_hvx_t &hvx);
+    bool chunkAllocate(const uint32_t size, sd_rpc_notification_chunk_t &chunk);
+    void chunkFree(sd_rpc_notification_chunk_t &chunk);
+
+    std::mutex sinkMutex;
+    std::unordered_map<uint32_t, Sink> sinks;
+    std::vector<sd_rpc_notification_chunk_t> freeChunks;
+};
+
+#endif // NOTIFICATION_SINK_H__
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PEER_STATS_H__
+#define PEER_STATS_H__
+
+#include "sd_rpc_types.h"
+
+#include "ble.h"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+
+/**
+ * @brief The PeerStats class keeps statistics per peer over its connections, in a bounded table of
+ * fixed size records. The records are kept in a memory mapped file when a file is given, so that the
+ * statistics outlive the process without a separate save step.
+ */
+class PeerStats
+{
+public:
+    PeerStats();
+    ~PeerStats();
+
+    /**@brief Updates the statistics from an event. Called before the event is dispatched. */
+    void process(const ble_evt_t *event);
+
+    /**@brief Records attribute value bytes sent on a connection. */
+    void txProcess(const uint16_t connHandle, const uint16_t length);
+
+    /**@brief Forgets all connections, i.e. when the connectivity chip has been reset. The records are kept. */
+    void clear();
+
+    uint32_t open(const sd_rpc_peer_stats_params_t *params);
+    uint32_t close();
+    uint32_t get(const ble_gap_addr_t *peerAddr, sd_rpc_peer_stats_t *stats) const;
+    uint32_t list(sd_rpc_peer_stats_t *stats, uint32_t *count) const;
+
+private:
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t capacity;
+        uint32_t count;
+        uint32_t reserved;
+    };
+
+    struct Record
+    {
+        sd_rpc_peer_stats_t stats;
+        int64_t rssiSum;
+        uint32_t rssiCount;
+        uint32_t discoveryCount;
+        uint64_t discoverySum;
+    };
+
+    struct Connection
+    {
+        uint64_t key;
+        std::chrono::steady_clock::time_point connected;
+        uint32_t discoveryTime;                 // Time from connecting to the last discovery response, 0 if none
+    };
+
+    static uint64_t keyGet(const ble_gap_addr_t &addr);
+    static uint64_t timeGet();
+    static size_t sizeGet(const uint32_t capacity);
+
+    Record *find(const uint64_t key);
+    Record *insert(const ble_gap_addr_t &addr, const uint64_t key);
+    Record *connectionRecordGet(const uint16_t connHandle);
+    void rssiAdd(Record *record, const int8_t rssi);
+    uint32_t fileMap(const char *path, const uint32_t capacity);
+    void unmap();
+
+    mutable std::mutex statsMutex;
+    Header *header;
+    Record *records;
+
+    std::vector<uint8_t> memory;
+    std::unique_ptr<boost::interprocess::file_mapping> fileMapping;
+    std::unique_ptr<boost::interprocess::mapped_region> mappedRegion;
+
+    std::unordered_map<uint64_t, uint32_t> index;    // Record index per peer key
+    std::map<uint16_t, Connection> connections;
+};
+
+#endif // PEER_STATS_H__
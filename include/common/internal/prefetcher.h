@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PREFETCHER_H__
+#define PREFETCHER_H__
+
+#include "sd_rpc_types.h"
+#include "transport.h"
+#include "worker_thread.h"
+
+#include "ble.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include <stdint.h>
+
+class SerializationTransport;
+
+/**
+ * @brief The Prefetcher class sends the reads and CCCD writes a peer is known to get right after
+ * connecting, and answers the same requests of the application with the responses received. The
+ * operations are sent from a separate thread since commands can not be sent from the event thread,
+ * each one when the response to the previous one has been seen by the event thread.
+ */
+class Prefetcher : public std::enable_shared_from_this<Prefetcher>
+{
+public:
+    Prefetcher(SerializationTransport *transport, log_cb_t log_callback);
+    ~Prefetcher();
+
+    uint32_t policySet(const ble_gap_addr_t *peerAddr, const sd_rpc_prefetch_op_t *ops, const uint8_t opCount);
+    uint32_t learnEnable(const bool enable, const uint8_t maxOps);
+    uint32_t valueGet(const uint16_t connHandle, const uint16_t handle, uint8_t *value, uint16_t *length);
+    uint32_t statsGet(sd_rpc_prefetch_stats_t *stats) const;
+
+    /**@brief Starts the prefetch of new connections and takes the responses to prefetch operations.
+     * @return true if the event is a response the application has not asked for. */
+    bool process(const ble_evt_t *event);
+
+    /**@brief Answers a read of the application with a prefetched value.
+     * @return true if the read is answered by the prefetch and must not be sent. */
+    bool readServe(const uint16_t connHandle, const uint16_t handle, const uint16_t offset);
+    bool writeServe(const uint16_t connHandle, const ble_gattc_write_params_t *params);
+
+    /**@brief Records a read or write the application has sent, for learning. */
+    void readProcess(const uint16_t connHandle, const uint16_t handle, const uint16_t offset);
+    void writeProcess(const uint16_t connHandle, const ble_gattc_write_params_t *params);
+
+    /**@brief Forgets the connections, called when the connectivity chip is reset. */
+    void clear();
+
+    /**@brief Stops the prefetch thread. */
+    void stop();
+
+private:
+    typedef std::chrono::steady_clock::time_point time_point_t;
+
+    struct Policy
+    {
+        std::vector<sd_rpc_prefetch_op_t> ops;
+        bool learned;
+    };
+
+    struct Response
+    {
+        std::vector<uint8_t> data;
+        time_point_t sent;
+        time_point_t received;
+        bool served;
+    };
+
+    struct Connection
+    {
+        uint16_t connHandle;
+        uint64_t peer;
+        std::vector<sd_rpc_prefetch_op_t> ops;
+        size_t next;
+        sd_rpc_prefetch_op_t current;
+        bool inFlight;
+        bool accepted;
+        bool applicationWaiting;
+        time_point_t sent;
+
+        std::map<uint16_t, Response> values;
+        std::map<uint16_t, Response> cccds;
+
+        // Learning
+        bool learning;
+        std::vector<sd_rpc_prefetch_op_t> recorded;
+        std::set<uint16_t> cccdHandles;
+    };
+
+    static uint64_t keyGet(const ble_gap_addr_t &addr);
+
+    void prefetchRunner();
+    uint32_t opSend(const uint16_t connHandle, const sd_rpc_prefetch_op_t &op);
+
+    void connected(const ble_evt_t *event);
+    void disconnected(const uint16_t connHandle);
+    bool responseProcess(Connection *connection, const uint16_t gattStatus, const uint8_t *data, const uint16_t length);
+    const sd_rpc_prefetch_op_t *inFlightGet(const Connection *connection) const;
+    bool covered(const Connection *connection, const sd_rpc_prefetch_op_type_t type, const uint16_t handle) const;
+    void miss(Connection *connection, const sd_rpc_prefetch_op_type_t type, const uint16_t handle);
+    Connection *acceptedWait(std::unique_lock<std::mutex> &lock, const uint16_t connHandle);
+    void cancel(Connection *connection);
+    void hit(const time_point_t &sent, const time_point_t &answered);
+    void record(Connection *connection, const sd_rpc_prefetch_op_type_t type, const uint16_t handle, const uint16_t value);
+
+    Connection *connectionFind(const uint16_t connHandle);
+
+    SerializationTransport *transport;
+    log_cb_t logCallback;
+
+    mutable std::mutex prefetchMutex;
+    std::map<uint64_t, Policy> policies;
+    Policy defaultPolicy;
+    std::list<Connection> connections;
+    bool learnEnabled;
+    uint8_t learnMaxOps;
+
+    // Variables used by the prefetch thread
+    std::condition_variable prefetchWaitCondition;
+    WorkerThread prefetchThread;
+    bool runPrefetchThread;
+
+    sd_rpc_prefetch_stats_t stats;
+    uint64_t totalSavedUs;
+};
+
+#endif // PREFETCHER_H__
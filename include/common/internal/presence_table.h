@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PRESENCE_TABLE_H__
+#define PRESENCE_TABLE_H__
+
+#include "sd_rpc_types.h"
+#include "worker_thread.h"
+
+#include "ble.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <stdint.h>
+
+/**
+ * @brief The PresenceTable class keeps the devices in range from advertising reports, in an open
+ * addressing hash table with linear probing keyed by address. Devices that have not advertised within
+ * the timeout are removed a few slots at a time while reports are processed, and the whole table is
+ * swept periodically from the presence thread so that devices leave when no reports are received.
+ * Snapshots of the table are published as immutable copies, so that the application reads them
+ * without taking the table lock. Publishing on every change of presence is coalesced to bound the
+ * copying. Changes are notified from the presence thread, in the order they were found.
+ */
+class PresenceTable : public std::enable_shared_from_this<PresenceTable>
+{
+public:
+    PresenceTable();
+    ~PresenceTable();
+
+    /**@brief Updates the table from advertising reports. Returns true if the event is not to be passed on. */
+    bool process(adapter_t *adapter, const ble_evt_t *event);
+
+    uint32_t start(adapter_t *adapter, const sd_rpc_presence_params_t *params, sd_rpc_presence_handler_t handler);
+    uint32_t stop();
+    uint32_t snapshotGet(sd_rpc_presence_entry_t *entries, uint32_t *count, uint64_t *time) const;
+
+private:
+    struct Slot
+    {
+        uint64_t key;               // 0 if the slot is free
+        uint64_t lastSeen;
+        int32_t rssi;               // Smoothed RSSI, in 1/256 dBm
+        uint32_t reportCount;
+        uint32_t payloadHash;
+    };
+
+    struct Snapshot
+    {
+        uint64_t time;
+        std::vector<sd_rpc_presence_entry_t> entries;
+    };
+
+    struct Change
+    {
+        sd_rpc_presence_entry_t entry;
+        bool present;
+    };
+
+    void presenceRunner();
+    uint64_t waitTimeGet(const uint64_t now) const;
+
+    static uint64_t keyGet(const ble_gap_addr_t &addr);
+    static uint64_t timeGet();
+    static sd_rpc_presence_entry_t entryGet(const Slot &slot);
+
+    size_t home(const uint64_t key) const;
+    void update(const ble_gap_evt_adv_report_t &report, const uint64_t now);
+    void remove(size_t index);
+    void expire(const uint64_t now, size_t slotCount);
+    void resize(const size_t capacity);
+    void publish(const uint64_t now);
+
+    std::mutex tableMutex;
+    bool started;
+    adapter_t *presenceAdapter;
+    sd_rpc_presence_params_t params;
+    sd_rpc_presence_handler_t presenceHandler;
+
+    std::vector<Slot> slots;
+    size_t mask;
+    size_t size;
+    size_t expiryCursor;
+    uint64_t lastSnapshot;
+    uint64_t lastSweep;
+    bool publishPending;
+    std::vector<Change> changes;
+
+    // Variables used by the presence thread, which sweeps the table, publishes and notifies changes
+    std::condition_variable presenceWaitCondition;
+    WorkerThread presenceThread;
+
+    std::shared_ptr<const Snapshot> snapshot;
+};
+
+#endif // PRESENCE_TABLE_H__
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PROVISIONER_H__
+#define PROVISIONER_H__
+
+#include "sd_rpc_types.h"
+#include "event_observer.h"
+#include "worker_thread.h"
+
+#include "ble.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include <stdint.h>
+
+/**
+ * @brief The Provisioner class provisions devices in a pipeline of stages: scan, connect, discover,
+ * write, verify and disconnect. Each adapter scans for the next device while the devices it is
+ * connected to are configured. Events are copied from the event threads of the adapters and the
+ * stages are driven from a separate thread, so commands are never sent from an event callback.
+ */
+class Provisioner : public EventObserver, public std::enable_shared_from_this<Provisioner>
+{
+public:
+    Provisioner(provisioner_t *handle, adapter_t *adapters[], const uint8_t adapterCount,
+                const sd_rpc_provision_params_t *params, sd_rpc_provision_result_handler_t resultHandler);
+    ~Provisioner();
+
+    uint32_t jobAdd(const sd_rpc_provision_job_t *job);
+    uint32_t start();
+    uint32_t stop();
+    uint32_t statsGet(sd_rpc_provision_stats_t *stats) const;
+
+    /**@brief Processes an event from an adapter. Called before the event is dispatched. */
+    void eventProcess(AdapterInternal *adapter, const ble_evt_t *event) override;
+
+    std::vector<AdapterInternal *> adaptersGet() const;
+
+private:
+    typedef std::chrono::steady_clock::time_point time_point_t;
+
+    struct Write
+    {
+        ble_uuid_t uuid;
+        std::vector<uint8_t> value;
+        uint16_t handle;
+    };
+
+    struct Job
+    {
+        ble_gap_addr_t peerAddr;
+        std::vector<Write> writes;
+        bool verify;
+        void *context;
+        time_point_t queued;
+    };
+
+    struct Device
+    {
+        Job job;
+        size_t lane;
+        uint16_t connHandle;
+        bool connected;
+        sd_rpc_provision_stage_t stage;
+        sd_rpc_provision_stage_t failedStage;
+        size_t index;
+        uint32_t result;
+        uint16_t gattStatus;
+        time_point_t stageStart;
+        uint32_t stageTime[SD_RPC_PROVISION_STAGE_COUNT];
+    };
+
+    struct Lane
+    {
+        adapter_t *adapter;
+        AdapterInternal *adapterInternal;
+        bool scanning;
+        Device *connecting;
+        uint32_t activeCount;
+        time_point_t scanStart;
+    };
+
+    struct Event
+    {
+        size_t lane;
+        uint16_t id;
+        uint16_t connHandle;
+        ble_gap_addr_t address;
+        uint8_t role;
+        uint8_t timeoutSource;
+        uint16_t gattStatus;
+        std::vector<ble_gattc_char_t> chars;
+        std::vector<uint8_t> data;
+    };
+
+    void workerRunner();
+    void release();
+    void eventHandle(const Event &event);
+    void schedule();
+
+    void advReportHandle(const Event &event);
+    void connectedHandle(const Event &event);
+    void charDiscRspHandle(Device *device, const Event &event);
+    void writeRspHandle(Device *device, const Event &event);
+    void readRspHandle(Device *device, const Event &event);
+
+    void stageEnter(Device *device, const sd_rpc_provision_stage_t stage);
+    void discover(Device *device, const uint16_t startHandle);
+    void write(Device *device);
+    void read(Device *device);
+    void fail(Device *device, const uint32_t result, const uint16_t gattStatus = BLE_GATT_STATUS_SUCCESS);
+    void disconnect(Device *device);
+    void finish(Device *device);
+
+    Device *deviceFind(const size_t lane, const uint16_t connHandle);
+    static bool addressEqual(const ble_gap_addr_t &a, const ble_gap_addr_t &b);
+
+    provisioner_t *handle;
+    sd_rpc_provision_params_t params;
+    sd_rpc_provision_result_handler_t resultHandler;
+
+    std::vector<Lane> lanes;
+    std::list<Device> devices;
+
+    mutable std::mutex provisionerMutex;
+    std::deque<Job> pendingJobs;
+    std::queue<Event> eventQueue;
+
+    // Variables used by the worker thread
+    std::condition_variable workerWaitCondition;
+    WorkerThread workerThread;
+    bool runWorkerThread;
+
+    // Statistics
+    time_point_t startTime;
+    uint32_t completedCount;
+    uint32_t failedCount;
+    uint64_t stageTotalMs[SD_RPC_PROVISION_STAGE_COUNT];
+    uint32_t stageCount[SD_RPC_PROVISION_STAGE_COUNT];
+    uint32_t stageMaxMs[SD_RPC_PROVISION_STAGE_COUNT];
+};
+
+#endif // PROVISIONER_H__
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STATE_JOURNAL_H__
+#define STATE_JOURNAL_H__
+
+#include "sd_rpc_types.h"
+#include "transport.h"
+#include "worker_thread.h"
+
+#include "ble.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <stdint.h>
+
+class SerializationTransport;
+
+/**
+ * @brief The StateJournal class records configuration commands (BLE enable and configuration,
+ * vendor specific UUIDs, GATT server table, GAP settings, advertising data and scanning) as they
+ * succeed. When replay is enabled the journal is sent to the connectivity chip after it has been
+ * reset, restoring the configuration the application had before the reset.
+ */
+class StateJournal : public std::enable_shared_from_this<StateJournal>
+{
+public:
+    StateJournal(SerializationTransport *transport, status_cb_t status_callback);
+    ~StateJournal();
+
+    /**@brief Records an encoded command that the connectivity chip has executed successfully.
+     * @return true if the command is a configuration command and has been recorded. */
+    bool record(const uint8_t *command, const uint32_t length);
+
+    /**@brief Returns the recorded commands in the order they are replayed. */
+    std::vector<std::vector<uint8_t>> commandsGet() const;
+
+    /**@brief Drops journal entries for procedures ended by an event. Called before the event is dispatched. */
+    void process(const ble_evt_t *event);
+
+    /**@brief Starts replay when the link is active again after a reset. Called before the status is dispatched. */
+    void statusProcess(sd_rpc_app_status_t code);
+
+    /**@brief Forgets all recorded commands, i.e. when the adapter is closed. */
+    void clear();
+
+    /**@brief Stops the replay thread. */
+    void stop();
+
+    /**@brief Returns true from a reset until the recorded commands have been replayed. */
+    bool restorePendingGet() const;
+
+    uint32_t replayEnable(const bool enable);
+    bool replayEnabledGet() const;
+    uint32_t infoGet(sd_rpc_state_replay_info_t *info) const;
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        bool replace;
+        std::vector<uint8_t> command;
+    };
+
+    void replayRunner();
+    uint32_t replay(const std::vector<Entry> &journal, const uint32_t generation, uint32_t *failedCount);
+    void scanEntryRemove();
+
+    SerializationTransport *transport;
+    status_cb_t statusCallback;
+
+    mutable std::mutex journalMutex;
+    std::vector<Entry> entries;
+
+    // Variables used by the replay thread
+    std::condition_variable replayWaitCondition;
+    WorkerThread replayThread;
+    bool replayEnabled;
+    bool replayPending;
+    bool resetPending;
+    bool runReplayThread;
+    uint32_t resetGeneration;
+    std::chrono::steady_clock::time_point resetTime;
+
+    sd_rpc_state_replay_info_t info;
+};
+
+#endif // STATE_JOURNAL_H__
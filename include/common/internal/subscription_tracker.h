@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SUBSCRIPTION_TRACKER_H__
+#define SUBSCRIPTION_TRACKER_H__
+
+#include "sd_rpc_types.h"
+
+#include "ble.h"
+
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+
+class UserMemPool;
+
+/**
+ * @brief The SubscriptionTracker class keeps the CCCD value of each connection for the characteristics
+ * of the local GATT server, and the notifications queued per connection. CCCD writes are followed as
+ * write requests, as writes authorized by the application, and as prepared writes once executed.
+ * Values are broadcast to the subscribed connections, skipping connections whose TX queue is known
+ * to be full.
+ */
+class SubscriptionTracker
+{
+public:
+    SubscriptionTracker();
+
+    /**@brief Updates subscriptions and queued notifications from an event. Called before the event is
+     * dispatched. Queued writes executed by the SoftDevice are read from the block the pool lent. */
+    void process(const ble_evt_t *event, UserMemPool &userMemPool);
+
+    /**@brief Applies the write a reply authorized, if it was to a CCCD. */
+    void authorizeReplyProcess(const uint16_t connHandle, const ble_gatts_rw_authorize_reply_params_t *params,
+                               const uint32_t errCode, UserMemPool &userMemPool);
+
+    /**@brief Records the CCCD of a characteristic added to the local GATT server. */
+    void characteristicAdd(const uint16_t valueHandle, const uint16_t cccdHandle);
+
+    /**@brief Restores the subscriptions of a connection from system attributes. */
+    void sysAttrSet(const uint16_t connHandle, const uint8_t *data, const uint16_t length, const uint32_t flags);
+
+    /**@brief Records the result of sending a notification or indication on a connection. */
+    void hvxProcess(const uint16_t connHandle, const uint8_t type, const uint32_t errCode);
+
+    /**@brief Forgets all connections, i.e. when the connectivity chip has been reset. */
+    void clear();
+
+    uint32_t broadcast(adapter_t *adapter, const sd_rpc_hvx_broadcast_params_t *params, sd_rpc_hvx_delivery_t *deliveries, uint32_t *count);
+
+private:
+    struct Connection
+    {
+        Connection() : queued(0), queueSize(0), authorizeOp(BLE_GATTS_OP_INVALID), authorizeHandle(0), authorizeOffset(0) {}
+
+        std::map<uint16_t, uint16_t> cccds;     // CCCD value per characteristic value handle
+        uint32_t queued;                        // Notifications queued and not yet transmitted
+        uint32_t queueSize;                     // Size of the TX queue when it has been full, 0 until then
+
+        std::map<uint16_t, std::vector<uint8_t>> prepared;  // Authorized prepared writes per CCCD handle
+
+        // Write waiting for the authorization of the application, BLE_GATTS_OP_INVALID if none
+        uint8_t authorizeOp;
+        uint16_t authorizeHandle;
+        uint16_t authorizeOffset;
+        std::vector<uint8_t> authorizeData;
+    };
+
+    void cccdWrite(const uint16_t connHandle, const uint16_t cccdHandle, const uint16_t value);
+    void authorizeRequest(const uint16_t connHandle, const ble_gatts_evt_write_t &write);
+    void prepare(Connection &connection, const uint16_t handle, const uint16_t offset, const uint8_t *data, const uint16_t length);
+    void execute(const uint16_t connHandle, UserMemPool &userMemPool);
+    void cancel(const uint16_t connHandle);
+    void txComplete(const uint16_t connHandle, const uint32_t count);
+
+    mutable std::mutex trackerMutex;
+    std::unordered_map<uint16_t, uint16_t> valueHandles;   // Characteristic value handle per CCCD handle
+    std::map<uint16_t, Connection> connections;
+};
+
+#endif // SUBSCRIPTION_TRACKER_H__
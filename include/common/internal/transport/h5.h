@@ -38,10 +38,13 @@
 #ifndef H5_H
 #define H5_H
 
+#include "tx_frame.h"
+
 #include <stdint.h>
 #include <vector>
 
 const uint32_t H5_HEADER_LENGTH = 4;
+const uint32_t H5_CRC_LENGTH = 2;
 
 typedef enum
 {
@@ -73,6 +76,14 @@ void h5_encode(std::vector<uint8_t> &in_packet,
                bool reliable_packet,
                h5_pkt_type_t packet_type);
 
+/**@brief Encodes the payload of the frame in place, adding the header in front and the CRC behind. */
+void h5_encode(TxFrame &frame,
+               uint8_t seq_num,
+               uint8_t ack_num,
+               bool crc_present,
+               bool reliable_packet,
+               h5_pkt_type_t packet_type);
+
 uint32_t h5_decode(std::vector<uint8_t> &slip_dec_packet,
 	std::vector<uint8_t> &h5_dec_packet,
 	uint8_t *seq_num,
@@ -40,6 +40,7 @@
 
 #include "transport.h"
 
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 
@@ -201,6 +202,15 @@ public:
     uint32_t open(status_cb_t status_callback, data_cb_t data_callback, log_cb_t log_callback) override;
     uint32_t close() override;
     uint32_t send(std::vector<uint8_t> &data) override;
+    uint32_t send(TxFrame &frame) override;
+    TimerWheel *timerWheelGet() override;
+    void logSeverityFilterSet(sd_rpc_log_severity_t severity_filter) override;
+
+    uint32_t unreliableLaneEnable(const bool enable);
+    uint32_t unreliableLaneInfoGet(sd_rpc_unreliable_lane_info_t *info) const;
+
+    uint32_t baudRateDetectEnable(const bool enable, const uint32_t *baudRates, const uint8_t baudRateCount);
+    uint32_t baudRateDetectInfoGet(sd_rpc_baud_rate_detect_info_t *info) const;
 
 private:
     void dataHandler(uint8_t *data, size_t length);
@@ -209,41 +219,84 @@ private:
 
     void sendControlPacket(control_pkt_type type);
 
+    /**@brief SLIP encodes the packet directly into the output buffer of the next transport layer. */
+    void sendSlip(const uint8_t *packet, const size_t length);
+
+    // Timers, expired on the I/O thread of the next transport layer
+    void retransmissionTimeout(timer_id_t id);
+    void retransmissionAbort();
+    void syncWait(std::unique_lock<std::mutex> &syncGuard, std::chrono::milliseconds timeout);
+    void syncTimeout(timer_id_t id);
+
+    // Out-of-frame software flow control
+    uint8_t syncConfigFieldOwn() const;
+    void outOfFrameFlowControlNegotiate(const std::vector<uint8_t> &syncConfigResponse);
+    void outOfFrameFlowControlStop();
+
+    // Baud rate detection, done after the next transport layer is opened and before the link is reset
+    void baudRateDetect();
+
+    // Unreliable lane for loss tolerant vendor specific packets
+    void unreliableLaneNegotiate(const std::vector<uint8_t> &syncConfigResponse);
+    void unreliablePacketProcess(const uint8_t seq_num, std::vector<uint8_t> &payload);
+
     void incrementSeqNum();
     void incrementAckNum();
 
     Transport *nextTransportLayer;
-    std::vector<uint8_t> lastPacket;
+    TimerWheel *timerWheel;
+
+    // H5 encoded frame waiting for acknowledgement, kept for retransmission
+    TxFrame *lastFrame;
 
     // Variables used for reliable packets
     uint8_t seqNum;
     uint8_t ackNum;
 
     bool c0Found;
+    std::atomic<bool> outOfFrameFlowControl; // Read on the sending threads, changed on the state machine and I/O threads
     std::vector<uint8_t> unprocessedData;
 
+    // Variables used for unreliable packets
+    std::atomic<bool> unreliableLaneRequested;
+    std::atomic<bool> unreliableLane;
+    std::atomic<uint32_t> unreliableReceived;
+    std::atomic<uint32_t> unreliableDropped;
+    uint8_t unreliableSeqNum;
+    bool unreliableSeqNumValid;
+
+    // Variables used for baud rate detection
+    std::vector<uint32_t> detectBaudRates;
+    std::atomic<bool> baudRateProbing;
+    std::atomic<bool> baudRateProbeAnswered;
+    sd_rpc_baud_rate_detect_info_t baudRateDetectInfo;
+
     // Variables used in state RESET/UNINITIALIZED/INITIALIZED
     std::mutex syncMutex; // TODO: evaluate a new name for syncMutex
     std::condition_variable syncWaitCondition; // TODO: evaluate a new name for syncWaitCondition
+    timer_id_t syncTimer;
 
     // Variables used in state ACTIVE
     std::chrono::milliseconds retransmissionInterval;
     std::mutex ackMutex;
     std::condition_variable ackWaitCondition;
+    timer_id_t retransmissionTimer;
+    uint8_t remainingRetransmissions;
+    bool retransmissionAborted;
 
     // Debugging related
     uint32_t incomingPacketCount;
     uint32_t outgoingPacketCount;
     uint32_t errorPacketCount;
 
-    void logPacket(bool outgoing, std::vector<uint8_t> &packet);
+    void logPacket(bool outgoing, const uint8_t *packet, const size_t length);
     void log(std::string &logLine) const;
     void log(char const *logLine) const;
     void logStateTransition(h5_state_t from, h5_state_t to) const;
     static std::string stateToString(h5_state_t state);
     std::string asHex(std::vector<uint8_t> &packet) const;
     std::string hciPacketLinkControlToString(std::vector<uint8_t> payload) const;
-    std::string h5PktToString(bool out, std::vector<uint8_t> &h5Packet) const;
+    std::string h5PktToString(bool out, const uint8_t *packet, const size_t length) const;
     static std::string pktTypeToString(h5_pkt_type_t pktType);
 
     // State machine related
@@ -277,6 +330,10 @@ private:
     static const uint8_t syncConfigRspFirstByte = 0x04;
     static const uint8_t syncConfigRspSecondByte = 0x7B;
     static const uint8_t syncConfigField = 0x11;
+    static const uint8_t syncConfigFieldOutOfFrame = 0x08;
+    static const uint8_t syncConfigCapabilityUnreliable = 0x01;  // Vendor capability byte following the configuration field
+    static const uint8_t xonCharacter = 0x11;
+    static const uint8_t xoffCharacter = 0x13;
 };
 
 #endif //H5_TRANSPORT_H
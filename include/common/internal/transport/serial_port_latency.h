@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SERIAL_PORT_LATENCY_H
+#define SERIAL_PORT_LATENCY_H
+
+#include "sd_rpc_types.h"
+
+#include <boost/asio/serial_port.hpp>
+
+#include <string>
+#include <stdint.h>
+
+// Root of the sysfs tree the USB bridge of a serial port is looked up in
+const std::string SERIAL_PORT_SYSFS_ROOT = "/sys";
+
+/**@brief Identifies the USB to UART bridge of a serial port from the tty device in sysfsRoot. */
+uint32_t SerialPortBridgeGet(const std::string &portName, const std::string &sysfsRoot, sd_rpc_usb_bridge_t *bridge);
+
+/**@brief Reads the latency timer in milliseconds of a serial port with an FTDI bridge. */
+uint32_t SerialPortLatencyTimerGet(const std::string &portName, const std::string &sysfsRoot, uint8_t *latencyTimer);
+
+/**@brief Sets the latency timer in milliseconds of a serial port with an FTDI bridge. */
+uint32_t SerialPortLatencyTimerSet(const std::string &portName, const std::string &sysfsRoot, const uint8_t latencyTimer);
+
+/**@brief Reads the low latency flag of an open serial port. */
+uint32_t SerialPortLowLatencyGet(boost::asio::serial_port::native_handle_type handle, bool *enabled);
+
+/**@brief Sets or clears the low latency flag of an open serial port. */
+uint32_t SerialPortLowLatencySet(boost::asio::serial_port::native_handle_type handle, const bool enable);
+
+/**@brief Makes reads of an open serial port return at once when no bytes are available. */
+uint32_t SerialPortPollPrepare(boost::asio::serial_port::native_handle_type handle);
+
+/**@brief Reads the bytes available on a serial port prepared for polling, length is 0 if there are none. */
+uint32_t SerialPortPollRead(boost::asio::serial_port::native_handle_type handle, uint8_t *buffer, const size_t size, size_t *length);
+
+/**@brief Pins the calling thread to a CPU. */
+uint32_t ThreadCpuPin(const int cpu);
+
+#endif // SERIAL_PORT_LATENCY_H
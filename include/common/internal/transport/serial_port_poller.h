@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SERIAL_PORT_POLLER_H
+#define SERIAL_PORT_POLLER_H
+
+#include "sd_rpc_types.h"
+#include "transport.h"
+#include "uart_defines.h"
+#include "worker_thread.h"
+
+#include <boost/asio/serial_port.hpp>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include <stdint.h>
+
+/**
+ * @brief The SerialPortPoller class reads a serial port prepared for polling from a busy polling thread
+ * instead of the IO service thread. The thread holds a reference to the poller, so the poller stays
+ * alive when the port is closed from a callback of the thread and the UartBoost is deleted there.
+ */
+class SerialPortPoller : public std::enable_shared_from_this<SerialPortPoller>
+{
+public:
+    SerialPortPoller(boost::asio::serial_port::native_handle_type handle, const sd_rpc_busy_poll_params_t &params,
+        const std::string &portName, data_cb_t dataCallback, status_cb_t statusCallback, log_cb_t logCallback);
+    ~SerialPortPoller();
+
+    /**@brief Starts the polling thread. */
+    void start();
+
+    /**@brief Stops the polling thread, it is detached when stopped from one of its own callbacks. */
+    void stop();
+
+    sd_rpc_busy_poll_stats_t statsGet() const;
+
+private:
+    /**@brief Polls the port until stopped and decodes the received bytes on the polling thread. */
+    void pollRunner();
+
+    const boost::asio::serial_port::native_handle_type handle;
+    const sd_rpc_busy_poll_params_t params;
+    const std::string portName;
+    const data_cb_t dataCallback;
+    const status_cb_t statusCallback;
+    const log_cb_t logCallback;
+
+    std::array<uint8_t, BUFFER_SIZE> readBuffer;
+
+    WorkerThread pollThread;
+    std::atomic<bool> runPollThread;
+    std::atomic<bool> active;
+    std::atomic<bool> pinned;
+    std::atomic<uint64_t> pollCount;
+    std::atomic<uint64_t> readCount;
+    std::atomic<uint64_t> byteCount;
+    std::atomic<uint64_t> sleepCount;
+};
+
+#endif // SERIAL_PORT_POLLER_H
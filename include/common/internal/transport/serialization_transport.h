@@ -51,11 +51,13 @@
 
 typedef uint32_t(*transport_rsp_handler_t)(const uint8_t *p_buffer, uint16_t length);
 typedef std::function<void(ble_evt_t * p_ble_evt)> evt_cb_t;
+typedef std::function<void(const uint8_t *data, const uint32_t length)> evt_peek_cb_t;
 
 struct eventData_t
 {
     uint8_t *data;
     uint32_t dataLength;
+    bool decoded;   // data holds a ble_evt_t generated by the driver
 };
 
 typedef enum
@@ -69,27 +71,46 @@ class SerializationTransport {
 public:
     SerializationTransport(Transport *dataLinkLayer, uint32_t response_timeout);
     ~SerializationTransport();
-    uint32_t open(status_cb_t status_callback, evt_cb_t event_callback, log_cb_t log_callback);
+    uint32_t open(status_cb_t status_callback, evt_cb_t event_callback, log_cb_t log_callback, evt_peek_cb_t event_peek_callback = nullptr);
     uint32_t close();
     uint32_t send(uint8_t *cmdBuffer, uint32_t cmdLength, uint8_t *rspBuffer, uint32_t *rspLength);
 
+    /**@brief Returns a frame to encode a command into, for sending it without copying. */
+    tx_frame_ptr_t frameAcquire();
+
+    /**@brief Sends the command in the payload of the frame. The frame holds the command again on return. */
+    uint32_t send(TxFrame &frame, uint8_t *rspBuffer, uint32_t *rspLength);
+
+    /**@brief Passes the log severity filter of the application on to the data link layer. */
+    void logSeverityFilterSet(sd_rpc_log_severity_t severity_filter);
+
+    /**@brief Queues an event generated by the driver, dispatched on the event thread after the events received before it. */
+    void eventInject(const ble_evt_t *event, const uint32_t length);
+
 private:
     SerializationTransport();
     void readHandler(uint8_t *data, size_t length);
+    void statusHandler(sd_rpc_app_status_t code, const char *message);
     void eventHandlingRunner();
+    void responseTimeoutHandler(timer_id_t id);
 
     status_cb_t statusCallback;
     evt_cb_t eventCallback;
     log_cb_t logCallback;
+    evt_peek_cb_t eventPeekCallback;
 
     Transport *nextTransportLayer;
+    TimerWheel *timerWheel;
     uint32_t responseTimeout;
+    timer_id_t responseTimer;
 
     bool rspReceived;
+    uint32_t linkResetCount;
     uint8_t *responseBuffer;
     uint32_t *responseLength;
 
     std::mutex sendMutex;
+    TxFramePool framePool;
 
     std::mutex responseMutex;
     std::condition_variable responseWaitCondition;
@@ -38,10 +38,16 @@
 #ifndef SLIP_H
 #define SLIP_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <vector>
 
-void slip_encode(std::vector<uint8_t> &in_packet, std::vector<uint8_t> &out_packet);
+void slip_encode(std::vector<uint8_t> &in_packet, std::vector<uint8_t> &out_packet, bool escape_flow_control = false);
+
+/**@brief Encodes length bytes from in_packet to out_packet, which must hold slip_encoded_length_max(length) bytes.
+ * Returns the number of bytes written. */
+size_t slip_encode(const uint8_t *in_packet, const size_t length, uint8_t *out_packet, bool escape_flow_control = false);
+size_t slip_encoded_length_max(const size_t length);
 uint32_t slip_decode(std::vector<uint8_t> &packet, std::vector<uint8_t> &out_packet);
 
 #endif
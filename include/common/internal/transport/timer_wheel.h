@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+
+typedef uint64_t timer_id_t;
+typedef std::function<void(timer_id_t id)> timer_cb_t;
+typedef std::function<void()> timer_wakeup_cb_t;
+
+/**
+ * @brief The TimerWheel class keeps the timers of a transport in a hierarchical timing wheel with
+ * millisecond ticks. Arming and cancelling a timer is O(1). The wheel has no thread of its own, it is
+ * advanced by the I/O executor of the transport which is asked to wake up when the next timer expires.
+ * Timer callbacks get the id of the expired timer and are called on the thread calling advance() and
+ * stop(), without any lock held.
+ */
+class TimerWheel
+{
+public:
+    TimerWheel();
+    ~TimerWheel();
+
+    /**@brief Lets timers be armed. The wakeup callback is called when the next expiry moves earlier. */
+    void start(timer_wakeup_cb_t wakeup_callback);
+
+    /**@brief Stops the wheel and expires all pending timers so that no waiter is left behind. */
+    void stop();
+
+    /**@brief Arms a timer, returns TIMER_ID_INVALID if the wheel is stopped. */
+    timer_id_t arm(std::chrono::milliseconds timeout, timer_cb_t callback);
+
+    /**@brief Cancels a timer, returns false if it has expired or is not armed. */
+    bool cancel(timer_id_t id);
+
+    /**@brief Expires the timers that are due. */
+    void advance();
+
+    /**@brief Returns false if no timer is armed, otherwise the time advance() shall be called next. */
+    bool nextExpiryGet(std::chrono::steady_clock::time_point &expiry);
+
+    size_t size() const;
+
+    static const timer_id_t TIMER_ID_INVALID = 0;
+
+private:
+    static const uint32_t LEVEL_BITS = 6;
+    static const uint32_t LEVEL_SLOTS = 1 << LEVEL_BITS;
+    static const uint32_t LEVEL_COUNT = 4;
+
+    struct Timer
+    {
+        timer_id_t id;
+        uint64_t expiry;
+        uint32_t level;
+        uint32_t slot;
+        timer_cb_t callback;
+    };
+
+    typedef std::list<Timer> slot_t;
+
+    uint64_t tickGet(const std::chrono::steady_clock::time_point &time) const;
+    void insert(slot_t &from, slot_t::iterator timer);
+    void cascade(const uint32_t level);
+
+    mutable std::mutex wheelMutex;
+    std::array<std::array<slot_t, LEVEL_SLOTS>, LEVEL_COUNT> levels;
+    std::array<size_t, LEVEL_COUNT> levelSizes;
+    std::unordered_map<timer_id_t, slot_t::iterator> timers;
+
+    std::chrono::steady_clock::time_point epoch;
+    uint64_t currentTick;
+    uint64_t scheduledTick;
+    timer_id_t nextId;
+    bool running;
+    timer_wakeup_cb_t wakeupCallback;
+};
+
+#endif // TIMER_WHEEL_H
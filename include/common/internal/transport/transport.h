@@ -39,7 +39,10 @@
 #define TRANSPORT_H
 
 #include "sd_rpc_types.h"
+#include "timer_wheel.h"
+#include "tx_frame.h"
 
+#include <atomic>
 #include <functional>
 #include <string>
 #include <vector>
@@ -49,6 +52,7 @@
 typedef std::function<void(sd_rpc_app_status_t code, const char *message)> status_cb_t;
 typedef std::function<void(uint8_t *data, size_t length)> data_cb_t;
 typedef std::function<void(sd_rpc_log_severity_t severity, std::string message)> log_cb_t;
+typedef std::function<size_t(uint8_t *out)> tx_encoder_t;
 
 class Transport {
 public:
@@ -57,12 +61,42 @@ public:
     virtual uint32_t close();
     virtual uint32_t send(std::vector<uint8_t> &data) = 0;
 
+    /**@brief Sends a frame, layers that support it add their headers in place instead of copying it. */
+    virtual uint32_t send(TxFrame &frame);
+
+    /**@brief Lets encoder write at most maxLength bytes directly to the output buffer of the transport.
+     * The encoder returns the number of bytes written. */
+    virtual uint32_t sendEncoded(const size_t maxLength, const tx_encoder_t &encoder);
+
+    /**@brief Returns true if the transport is configured for out-of-frame (XON/XOFF) software flow control. */
+    virtual bool softwareFlowControlSupported() const;
+
+    /**@brief Starts or stops handling XON/XOFF characters on the link. */
+    virtual uint32_t softwareFlowControlSet(bool enable);
+
+    /**@brief Changes the baud rate of the open link. */
+    virtual uint32_t baudRateSet(const uint32_t baudRate);
+
+    /**@brief Returns the baud rate of the link, 0 if it has none. */
+    virtual uint32_t baudRateGet() const;
+
+    /**@brief Returns the timer wheel driven by the I/O executor of the transport, nullptr if it has none. */
+    virtual TimerWheel *timerWheelGet();
+
+    /**@brief Sets the lowest severity of the log messages the application wants, layers that support it
+     * pass it on to the next layer. */
+    virtual void logSeverityFilterSet(sd_rpc_log_severity_t severity_filter);
+
 protected:
     Transport();
 
+    /**@brief Returns false if a log message of the severity would be filtered out, it need not be formatted. */
+    bool logEnabled(sd_rpc_log_severity_t severity) const;
+
     status_cb_t statusCallback;
     data_cb_t dataCallback;
     log_cb_t logCallback;
+    std::atomic<sd_rpc_log_severity_t> logSeverityFilter; // Changed by the application, read on the transport threads
 };
 
 #endif //TRANSPORT_H
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TX_FRAME_H
+#define TX_FRAME_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <stdint.h>
+
+/**
+ * @brief The TxFrame class holds a command on its way to the UART. The command is encoded after room
+ * reserved for the headers of the transport layers, which add their headers and trailers in place
+ * instead of copying the command into a new buffer.
+ */
+class TxFrame
+{
+public:
+    // Room for the serialization packet type and the H5 header in front, the H5 CRC behind
+    static const size_t HEADROOM = 8;
+    static const size_t TAILROOM = 8;
+
+    explicit TxFrame(const size_t payloadCapacity);
+
+    /**@brief Returns the start of the frame. */
+    uint8_t *data();
+    const uint8_t *data() const;
+    size_t size() const;
+
+    /**@brief Returns where the payload is encoded, after the headroom. */
+    uint8_t *payload();
+    size_t payloadCapacity() const;
+
+    /**@brief Makes the frame hold length bytes of payload and nothing else. */
+    void reset(const size_t length);
+
+    /**@brief Grows the frame in front, returns the start of the frame. */
+    uint8_t *prepend(const size_t length);
+
+    /**@brief Grows the frame behind, returns the start of the added bytes. */
+    uint8_t *append(const size_t length);
+
+    /**@brief Removes bytes added by prepend() and append(). */
+    void trimFront(const size_t length);
+    void trimBack(const size_t length);
+
+private:
+    std::vector<uint8_t> buffer;
+    size_t begin;
+    size_t end;
+};
+
+class TxFramePool;
+
+struct TxFrameRelease
+{
+    TxFramePool *pool;
+    void operator()(TxFrame *frame) const;
+};
+
+typedef std::unique_ptr<TxFrame, TxFrameRelease> tx_frame_ptr_t;
+
+/**
+ * @brief The TxFramePool class keeps frames for reuse so that no buffer is allocated per command.
+ */
+class TxFramePool
+{
+public:
+    TxFramePool(const size_t payloadCapacity, const size_t maxFree);
+
+    /**@brief Returns an empty frame, returned to the pool when it is released. */
+    tx_frame_ptr_t acquire();
+
+private:
+    friend struct TxFrameRelease;
+    void release(TxFrame *frame);
+
+    const size_t payloadCapacity;
+    const size_t maxFree;
+
+    std::mutex poolMutex;
+    std::vector<std::unique_ptr<TxFrame>> freeFrames;
+};
+
+#endif // TX_FRAME_H
@@ -41,11 +41,15 @@
 #include "transport.h"
 #include "uart_settings_boost.h"
 #include "uart_defines.h"
+#include "serial_port_latency.h"
+#include "serial_port_poller.h"
 
 #include <boost/array.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/thread.hpp>
 
-#include <deque>
+#include <atomic>
+#include <memory>
 #include <mutex>
 
 #include <stdint.h>
@@ -81,8 +85,64 @@ public:
      */
     uint32_t send(std::vector<uint8_t> &data);
 
+    /**@brief Lets the encoder write directly to the queue of bytes to be written to the serial port.
+     */
+    uint32_t sendEncoded(const size_t maxLength, const tx_encoder_t &encoder) override;
+
+    /**@brief Returns true if the port is configured for software flow control.
+     */
+    bool softwareFlowControlSupported() const override;
+
+    /**@brief Lets the serial port driver handle XON/XOFF characters or stops doing so.
+     */
+    uint32_t softwareFlowControlSet(bool enable) override;
+
+    /**@brief Changes the baud rate of the open serial port.
+     */
+    uint32_t baudRateSet(const uint32_t baudRate) override;
+
+    /**@brief Returns the baud rate of the serial port.
+     */
+    uint32_t baudRateGet() const override;
+
+    /**@brief Returns the timer wheel advanced by the IO service thread.
+     */
+    TimerWheel *timerWheelGet() override;
+
+    /**@brief Tunes the USB serial bridge of the port for low latency when it is opened.
+     */
+    uint32_t lowLatencySet(const bool enable);
+
+    /**@brief Returns the latency settings applied when the port was opened.
+     */
+    sd_rpc_serial_latency_info_t latencyInfoGet() const;
+
+    /**@brief Sets the root of the sysfs tree the USB bridge is looked up in, defaults to /sys.
+     */
+    void sysfsRootSet(const std::string &root);
+
+    /**@brief Reads the port from a busy polling thread when it is opened, NULL reads it from the IO service thread.
+     */
+    uint32_t busyPollSet(const sd_rpc_busy_poll_params_t *params);
+
+    /**@brief Returns the statistics of the busy polling thread.
+     */
+    sd_rpc_busy_poll_stats_t busyPollStatsGet() const;
+
 private:
 
+    /**@brief Applies the low latency settings to the opened port.
+     */
+    void latencyApply();
+
+    /**@brief Restores the settings changed by latencyApply() before the port is closed.
+     */
+    void latencyRestore();
+
+    /**@brief Stops the busy polling thread.
+     */
+    void busyPollStop();
+
     /**@brief Called when background thread receives bytes from uart.
      */
     void readHandler(const boost::system::error_code &errorCode, const size_t bytesTransferred);
@@ -103,21 +163,39 @@ private:
      */
     void asyncWrite();
 
+    /**@brief Waits on the IO service thread for the next timer of the timer wheel to expire.
+     */
+    void timerWheelSchedule();
+
     asio_io_context ioService;
     boost::asio::serial_port serialPort;
     asio_io_context::work workNotifier;
     boost::thread ioWorkThread;
 
     boost::array<uint8_t, BUFFER_SIZE> readBuffer;
+    // Bytes being written and bytes queued for the next write, swapped when a write is started
     std::vector<uint8_t> writeBufferVector;
-    std::deque<uint8_t> writeQueue;
+    std::vector<uint8_t> writeQueue;
     std::mutex queueMutex;
 
     boost::function<void(const boost::system::error_code, const size_t)> callbackReadHandle;
     boost::function<void(const boost::system::error_code, const size_t)> callbackWriteHandle;
 
     bool asyncWriteInProgress;
+
+    TimerWheel timerWheel;
+    boost::asio::steady_timer timerWheelTimer;
     UartSettingsBoost uartSettingsBoost;
+    std::atomic<uint32_t> currentBaudRate;
+
+    bool lowLatencyRequested;
+    bool lowLatencyPrevious;
+    sd_rpc_serial_latency_info_t latencyInfo;
+    std::string sysfsRoot;
+
+    bool busyPollRequested;
+    sd_rpc_busy_poll_params_t busyPollParams;
+    std::shared_ptr<SerialPortPoller> poller;   // Read and replaced with std::atomic_load and std::atomic_store
 };
 
 #endif //UART_BOOST_H
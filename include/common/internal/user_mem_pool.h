@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef USER_MEM_POOL_H__
+#define USER_MEM_POOL_H__
+
+#include "sd_rpc_types.h"
+#include "transport.h"
+#include "worker_thread.h"
+
+#include "ble.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <stdint.h>
+
+class SerializationTransport;
+
+/**
+ * @brief The UserMemPool class owns a pool of memory blocks that are lent to the SoftDevice for the
+ * queued writes of a connection. User memory requests are detected on the read thread, where a block is
+ * taken from the pool, and the reply is sent from a separate thread since commands can not be sent from
+ * the transport threads. The requests and releases of blocks from the pool are kept from the application,
+ * which reads the queued writes in the block lent to a connection with leasedBlockGet().
+ */
+class UserMemPool : public std::enable_shared_from_this<UserMemPool>
+{
+public:
+    UserMemPool(SerializationTransport *transport, log_cb_t log_callback);
+    ~UserMemPool();
+
+    /**@brief Lends a block if the encoded event is a user memory request. Called on the read thread. */
+    void eventPeek(const uint8_t *event, const uint32_t length);
+
+    /**@brief Returns released blocks to the pool. Called before the event is dispatched.
+     * @return true if the event concerns a block of the pool and is not passed to the application. */
+    bool process(const ble_evt_t *event);
+
+    /**@brief Copies the queued writes the SoftDevice stored in the block lent to a connection.
+     * @return false if no block is held by the SoftDevice for the connection. */
+    bool queuedWritesGet(const uint16_t connHandle, std::vector<uint8_t> &data);
+
+    /**@brief Takes back all blocks, i.e. when the connectivity chip has been reset. */
+    void clear();
+
+    /**@brief Stops the reply thread. */
+    void stop();
+
+    uint32_t open(const sd_rpc_user_mem_pool_params_t *params);
+    uint32_t close();
+    uint32_t statsGet(sd_rpc_user_mem_pool_stats_t *stats) const;
+    uint32_t leasedBlockGet(const uint16_t connHandle, uint8_t *data, uint16_t *length);
+
+private:
+    enum LeaseState
+    {
+        LEASE_PENDING,                          // The reply is being sent
+        LEASE_ANSWERED,                         // The SoftDevice holds the block
+        LEASE_FAILED                            // The reply failed, the request is left to the application
+    };
+
+    struct Lease
+    {
+        uint16_t block;
+        LeaseState state;
+        bool dispatched;                        // The request event has been handled by the event thread
+        std::chrono::steady_clock::time_point requested;
+    };
+
+    void replyRunner();
+    uint32_t reply(const uint16_t connHandle, const ble_user_mem_block_t &block);
+    void contextDestroy(const uint16_t connHandle);
+    void blockFree(const uint16_t block);
+    uint8_t *blockGet(const uint16_t block);
+
+    SerializationTransport *transport;
+    log_cb_t logCallback;
+
+    mutable std::mutex poolMutex;
+    std::condition_variable replyCondition;     // Signalled when a reply is queued or has completed
+    bool opened;
+
+    uint16_t blockSize;
+    uint16_t blockCount;
+    std::vector<uint8_t> storage;
+    std::vector<uint16_t> freeBlocks;
+    std::map<uint16_t, Lease> leases;           // Block lent per connection handle
+    std::deque<uint16_t> replyQueue;            // Connections waiting for their reply
+
+    WorkerThread replyThread;
+    bool runReplyThread;
+
+    sd_rpc_user_mem_pool_stats_t stats;
+    uint64_t totalReplyUs;
+};
+
+#endif // USER_MEM_POOL_H__
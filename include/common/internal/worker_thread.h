@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WORKER_THREAD_H__
+#define WORKER_THREAD_H__
+
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief The WorkerThread class runs a member function of an object owned by a std::shared_ptr. The
+ * thread holds a reference to the object until the function returns, so the object stays alive when
+ * the thread is stopped from one of its own callbacks and the application deletes the handle there.
+ * Stopping the thread from itself detaches it, the function is expected to return soon after.
+ */
+class WorkerThread
+{
+public:
+    WorkerThread();
+    ~WorkerThread();
+
+    /**@brief Starts the thread unless it is running. Returns false if it was running. */
+    template<typename T>
+    bool start(const std::shared_ptr<T> &owner, void (T::*runner)())
+    {
+        std::lock_guard<std::mutex> lock(threadMutex);
+
+        if (thread.joinable())
+        {
+            return false;
+        }
+
+        thread = std::thread([owner, runner] { ((*owner).*runner)(); });
+        return true;
+    }
+
+    /**@brief Waits for the thread to end, or detaches it when called from the thread itself. */
+    void stop();
+
+    /**@brief Returns true if the thread is started and not stopped. */
+    bool runningGet() const;
+
+    /**@brief Returns true if called from the thread while it is started and not stopped. A thread
+     * stopped from itself uses this to end, it may have been started again in the meantime. */
+    bool isCurrent() const;
+
+private:
+    mutable std::mutex threadMutex;
+    std::thread thread;
+};
+
+#endif // WORKER_THREAD_H__
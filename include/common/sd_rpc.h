@@ -74,6 +74,61 @@ SD_RPC_API uint32_t sd_rpc_serial_port_enum(sd_rpc_serial_port_desc_t serial_por
  */
 SD_RPC_API physical_layer_t *sd_rpc_physical_layer_create_uart(const char * port_name, uint32_t baud_rate, sd_rpc_flow_control_t flow_control, sd_rpc_parity_t parity);
 
+/**@brief Tune the serial port for low latency when it is opened.
+ *
+ * @details The USB to UART bridge of the port is identified from sysfs. The latency timer of FTDI bridges
+ *          is set to 1 ms instead of the default 16 ms, and the low latency flag of the serial driver is
+ *          set. The previous settings are restored when the port is closed. Only supported on Linux, and
+ *          setting the latency timer requires write access to it in sysfs.
+ *
+ * @param[in]  physical_layer  The physical layer.
+ * @param[in]  enable  true to tune the port when it is opened.
+ *
+ * @retval NRF_SUCCESS  The setting was changed.
+ * @retval NRF_ERROR_NOT_SUPPORTED  Latency tuning is not supported on the platform.
+ */
+SD_RPC_API uint32_t sd_rpc_physical_layer_low_latency_enable(physical_layer_t *physical_layer, bool enable);
+
+/**@brief Get the latency settings applied to the serial port when it was opened.
+ *
+ * @param[in]  physical_layer  The physical layer.
+ * @param[out] p_info  The bridge type and the settings applied.
+ *
+ * @retval NRF_SUCCESS  The settings were copied to p_info.
+ * @retval NRF_ERROR_NULL  p_info is NULL.
+ */
+SD_RPC_API uint32_t sd_rpc_physical_layer_latency_info_get(physical_layer_t *physical_layer, sd_rpc_serial_latency_info_t *p_info);
+
+/**@brief Read the serial port from a busy polling thread when it is opened.
+ *
+ * @details Instead of waiting for the IO service to be woken up by the operating system, a dedicated
+ *          thread polls the serial port with non-blocking reads and decodes the received bytes inline.
+ *          The thread spins for spin_us after the last received byte and then sleeps for sleep_us
+ *          between polls, so an idle link does not keep a CPU busy. Writes and timers are still
+ *          handled by the IO service thread. Pinning the thread to a CPU is only supported on Linux,
+ *          a thread that cannot be pinned is run unpinned.
+ *
+ * @param[in]  physical_layer  The physical layer.
+ * @param[in]  p_params  The busy poll parameters, or NULL to read the port from the IO service thread.
+ *
+ * @retval NRF_SUCCESS  The setting was changed.
+ * @retval NRF_ERROR_NOT_SUPPORTED  Busy polling is not supported on the platform.
+ */
+SD_RPC_API uint32_t sd_rpc_physical_layer_busy_poll_enable(physical_layer_t *physical_layer, const sd_rpc_busy_poll_params_t *p_params);
+
+/**@brief Get the statistics of the busy poll receive mode.
+ *
+ * @details The counters are reset when the port is opened. Comparing read_count with poll_count shows
+ *          how much of the polling was useful.
+ *
+ * @param[in]  physical_layer  The physical layer.
+ * @param[out] p_stats  The statistics.
+ *
+ * @retval NRF_SUCCESS  The statistics were copied to p_stats.
+ * @retval NRF_ERROR_NULL  p_stats is NULL.
+ */
+SD_RPC_API uint32_t sd_rpc_physical_layer_busy_poll_stats_get(physical_layer_t *physical_layer, sd_rpc_busy_poll_stats_t *p_stats);
+
 /**@brief Create a new data link layer.
  *
  * @param[in]  physical_layer  The physical layer to use with this data link layer.
@@ -83,6 +138,58 @@ SD_RPC_API physical_layer_t *sd_rpc_physical_layer_create_uart(const char * port
  */
 SD_RPC_API data_link_layer_t *sd_rpc_data_link_layer_create_bt_three_wire(physical_layer_t *physical_layer, uint32_t retransmission_interval);
 
+/**@brief Request an unreliable lane for loss tolerant packets from the connectivity chip.
+ *
+ * @details The lane is offered in the SYNC CONFIG message when the link is established, and used if the
+ *          connectivity chip accepts it in its CONFIG RESPONSE. The connectivity chip may then send packets
+ *          that are not acknowledged or retransmitted, i.e. advertising reports. The sequence number of
+ *          unreliable packets is incremented for each packet, gaps are counted as dropped packets.
+ *          Takes effect the next time the link is established.
+ *
+ * @param[in]  data_link_layer  The data link layer.
+ * @param[in]  enable  true to request the unreliable lane.
+ *
+ * @retval NRF_SUCCESS  The request was changed.
+ */
+SD_RPC_API uint32_t sd_rpc_data_link_layer_unreliable_lane_enable(data_link_layer_t *data_link_layer, bool enable);
+
+/**@brief Get the statistics of the unreliable lane.
+ *
+ * @param[in]  data_link_layer  The data link layer.
+ * @param[out] p_info  The statistics.
+ *
+ * @retval NRF_SUCCESS  The statistics were copied to p_info.
+ * @retval NRF_ERROR_NULL  p_info is NULL.
+ */
+SD_RPC_API uint32_t sd_rpc_data_link_layer_unreliable_lane_info_get(data_link_layer_t *data_link_layer, sd_rpc_unreliable_lane_info_t *p_info);
+
+/**@brief Detect the baud rate of the connectivity chip when the link is opened.
+ *
+ * @details The baud rates are probed from the fastest to the slowest with the SYNC message of the
+ *          three wire handshake, each with a short timeout, and the fastest that responds is used.
+ *          When none responds the baud rate of the physical layer is kept.
+ *
+ * @param[in]  data_link_layer  The data link layer.
+ * @param[in]  enable  true to detect the baud rate when the link is opened.
+ * @param[in]  p_baud_rates  The baud rates to probe, NULL for the baud rates of the connectivity firmware
+ *                           in this package, 1000000 and 115200.
+ * @param[in]  baud_rate_count  The number of baud rates in p_baud_rates.
+ *
+ * @retval NRF_SUCCESS  The setting was changed.
+ * @retval NRF_ERROR_INVALID_PARAM  p_baud_rates is not NULL and baud_rate_count is 0.
+ */
+SD_RPC_API uint32_t sd_rpc_data_link_layer_baud_rate_detect_enable(data_link_layer_t *data_link_layer, bool enable, const uint32_t *p_baud_rates, uint8_t baud_rate_count);
+
+/**@brief Get the result of the baud rate detection when the link was last opened.
+ *
+ * @param[in]  data_link_layer  The data link layer.
+ * @param[out] p_info  The baud rate in use and the probing done.
+ *
+ * @retval NRF_SUCCESS  The result was copied to p_info.
+ * @retval NRF_ERROR_NULL  p_info is NULL.
+ */
+SD_RPC_API uint32_t sd_rpc_data_link_layer_baud_rate_detect_info_get(data_link_layer_t *data_link_layer, sd_rpc_baud_rate_detect_info_t *p_info);
+
 /**@brief Create a new transport layer.
  *
  * @param[in]  data_link_layer  The data linkk layer to use with this transport.
@@ -154,6 +261,807 @@ SD_RPC_API uint32_t sd_rpc_log_handler_severity_filter_set(adapter_t *adapter, s
  */
 SD_RPC_API uint32_t sd_rpc_conn_reset(adapter_t *adapter);
 
+/**@brief Get the state of a connection as tracked by the driver.
+ *
+ * @note The state is updated from received events before they are passed to the event handler.
+ *       This function does not communicate with the connectivity chip and does not block.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  conn_handle  The connection handle.
+ * @param[out] p_conn_state  The connection state.
+ *
+ * @retval NRF_SUCCESS  The connection state was copied to p_conn_state.
+ * @retval NRF_ERROR_NULL  p_conn_state is NULL.
+ * @retval NRF_ERROR_NOT_FOUND  There is no connection with the given handle.
+ */
+SD_RPC_API uint32_t sd_rpc_conn_state_get(adapter_t *adapter, uint16_t conn_handle, sd_rpc_conn_state_t *p_conn_state);
+
+/**@brief Get the state of all connections tracked by the driver.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[out] conn_states  The array of connection states to be filled in.
+ * @param[in,out]  size  The size of the array. The number of connections is stored here.
+ *
+ * @retval NRF_SUCCESS  The connection states were copied to conn_states.
+ * @retval NRF_ERROR_NULL  size is NULL.
+ * @retval NRF_ERROR_DATA_SIZE  The array is too small, the number of connections is stored in size.
+ */
+SD_RPC_API uint32_t sd_rpc_conn_state_list(adapter_t *adapter, sd_rpc_conn_state_t conn_states[], uint32_t *size);
+
+/**@brief Enable or disable replay of the configuration after a connectivity chip reset.
+ *
+ * @details The driver records configuration commands as they succeed: BLE configuration and enable,
+ *          options, vendor specific UUIDs, the GATT server table, GAP settings, advertising data and
+ *          scanning. With replay enabled the recorded commands are sent to the connectivity chip when
+ *          the link is active again after a reset. The status handler is called with
+ *          STATE_REPLAY_COMPLETED or STATE_REPLAY_FAILED when the replay has finished. With replay
+ *          disabled the recorded commands are discarded on reset. Replay can not be disabled while
+ *          the adapter has a standby adapter (see @ref sd_rpc_failover_standby_set).
+ *
+ * @note Commands sent by the application before STATE_REPLAY_COMPLETED may be interleaved with the replay.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  enable  true to replay the configuration after a reset.
+ *
+ * @retval NRF_SUCCESS  The replay setting was changed.
+ * @retval NRF_ERROR_INVALID_STATE  Replay is disabled while the adapter has a standby adapter.
+ */
+SD_RPC_API uint32_t sd_rpc_state_replay_enable(adapter_t *adapter, bool enable);
+
+/**@brief Get the statistics of configuration replay.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[out] p_info  The replay statistics, including the recovery time of the last replay.
+ *
+ * @retval NRF_SUCCESS  The statistics were copied to p_info.
+ * @retval NRF_ERROR_NULL  p_info is NULL.
+ */
+SD_RPC_API uint32_t sd_rpc_state_replay_info_get(adapter_t *adapter, sd_rpc_state_replay_info_t *p_info);
+
+/**@brief Enable or disable restarting advertising when a connection is lost.
+ *
+ * @details The driver keeps the last advertising start command that succeeded. With restart enabled
+ *          the command is sent again as soon as the connection a central established to the advertising
+ *          is disconnected, before the event is passed to the event handler. Disconnections of other
+ *          connections, such as connections as central, do not restart advertising. Advertising is not
+ *          restarted after @ref sd_ble_gap_adv_stop, an advertising timeout or a reset of the
+ *          connectivity chip, until advertising is started again.
+ *
+ * @note The application does not have to start advertising again itself. If it does, the call returns
+ *       NRF_ERROR_INVALID_STATE since the connectivity chip is already advertising.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  enable  true to restart advertising when a connection is lost.
+ *
+ * @retval NRF_SUCCESS  The restart setting was changed.
+ */
+SD_RPC_API uint32_t sd_rpc_adv_restart_enable(adapter_t *adapter, bool enable);
+
+/**@brief Get the statistics of restarting advertising.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[out] p_info  The statistics, including the time from disconnection until advertising again.
+ *
+ * @retval NRF_SUCCESS  The statistics were copied to p_info.
+ * @retval NRF_ERROR_NULL  p_info is NULL.
+ */
+SD_RPC_API uint32_t sd_rpc_adv_restart_info_get(adapter_t *adapter, sd_rpc_adv_restart_info_t *p_info);
+
+/**@brief Set a hot-standby adapter for an adapter.
+ *
+ * @details The standby adapter must be opened and replay must be enabled on the primary adapter
+ *          (see @ref sd_rpc_state_replay_enable). The configuration recorded on the primary adapter
+ *          is sent to the standby adapter, and configuration commands are sent to it as they
+ *          succeed on the primary adapter. When the primary adapter
+ *          reports LINK_FAILED or IO_RESOURCES_UNAVAILABLE, or PKT_SEND_MAX_RETRIES_REACHED three
+ *          times without a packet delivered in between, advertising and scanning are started on the
+ *          standby adapter and the peers the primary adapter was connected to as central are
+ *          connected again, one at a time. The status handler of the standby adapter is called with
+ *          FAILOVER_COMPLETED when this has finished.
+ *
+ *          When the primary adapter reports STATE_REPLAY_COMPLETED after a reset, advertising and
+ *          scanning are stopped on the standby adapter and advertising is started again on the
+ *          primary adapter. The status handler of the primary adapter is called with
+ *          FAILBACK_COMPLETED. Connections established from the standby adapter are kept. After
+ *          STATE_REPLAY_FAILED the standby adapter stays in use.
+ *
+ * @param[in]  adapter  The primary transport adapter.
+ * @param[in]  standby  The standby transport adapter, or NULL to remove the standby adapter.
+ *
+ * @retval NRF_SUCCESS  The standby adapter was set.
+ * @retval NRF_ERROR_INVALID_PARAM  The standby adapter is the primary adapter.
+ * @retval NRF_ERROR_INVALID_STATE  One of the adapters is already the standby adapter of another adapter,
+ *                                  or replay is not enabled on the primary adapter.
+ */
+SD_RPC_API uint32_t sd_rpc_failover_standby_set(adapter_t *adapter, adapter_t *standby);
+
+/**@brief Get the statistics of the failover group of a primary adapter.
+ *
+ * @param[in]  adapter  The primary transport adapter.
+ * @param[out] p_info  The failover statistics, including the failover time.
+ *
+ * @retval NRF_SUCCESS  The statistics were copied to p_info.
+ * @retval NRF_ERROR_NULL  p_info is NULL.
+ * @retval NRF_ERROR_NOT_FOUND  The adapter has no standby adapter.
+ */
+SD_RPC_API uint32_t sd_rpc_failover_info_get(adapter_t *adapter, sd_rpc_failover_info_t *p_info);
+
+/**@brief Create a provisioner.
+ *
+ * @details The provisioner scans for the devices of the added jobs, connects, discovers the
+ *          characteristics to write, writes and optionally reads back the values, and disconnects.
+ *          Devices are handled in a pipeline: each adapter scans for the next device while the
+ *          devices it is connected to are configured, and all adapters work in parallel. The result
+ *          handler is called from the provisioner thread when a device has been provisioned or has failed.
+ *
+ * @note The adapters must be opened, and the BLE stack enabled as central with room for
+ *       max_connections connections. Events of the adapters are still passed to their event handlers.
+ *
+ * @param[in]  adapters  The transport adapters to provision devices with.
+ * @param[in]  adapter_count  The number of adapters.
+ * @param[in]  p_params  The scan and connection parameters.
+ * @param[in]  result_handler  The result handler callback.
+ *
+ * @retval The provisioner or NULL.
+ */
+SD_RPC_API provisioner_t *sd_rpc_provisioner_create(adapter_t *adapters[], uint8_t adapter_count, const sd_rpc_provision_params_t *p_params, sd_rpc_provision_result_handler_t result_handler);
+
+/**@brief Stop and delete a provisioner.
+ *
+ * @param[in]  provisioner  The provisioner.
+ */
+SD_RPC_API void sd_rpc_provisioner_delete(provisioner_t *provisioner);
+
+/**@brief Add a device to provision.
+ *
+ * @param[in]  provisioner  The provisioner.
+ * @param[in]  p_job  The device and the values to write. The values are copied.
+ *
+ * @retval NRF_SUCCESS  The job was added.
+ * @retval NRF_ERROR_NULL  p_job or a value is NULL.
+ * @retval NRF_ERROR_INVALID_LENGTH  A value is longer than @ref SD_RPC_PROVISION_VALUE_MAX_LEN.
+ */
+SD_RPC_API uint32_t sd_rpc_provisioner_job_add(provisioner_t *provisioner, const sd_rpc_provision_job_t *p_job);
+
+/**@brief Start provisioning the added devices.
+ *
+ * @param[in]  provisioner  The provisioner.
+ *
+ * @retval NRF_SUCCESS  The provisioner was started.
+ * @retval NRF_ERROR_INVALID_STATE  The provisioner is already started.
+ */
+SD_RPC_API uint32_t sd_rpc_provisioner_start(provisioner_t *provisioner);
+
+/**@brief Stop provisioning. Devices being provisioned are disconnected, pending jobs are kept.
+ *
+ * @param[in]  provisioner  The provisioner.
+ *
+ * @retval NRF_SUCCESS  The provisioner was stopped.
+ */
+SD_RPC_API uint32_t sd_rpc_provisioner_stop(provisioner_t *provisioner);
+
+/**@brief Get the throughput and per stage latency of a provisioner.
+ *
+ * @param[in]  provisioner  The provisioner.
+ * @param[out] p_stats  The statistics.
+ *
+ * @retval NRF_SUCCESS  The statistics were copied to p_stats.
+ * @retval NRF_ERROR_NULL  p_stats is NULL.
+ */
+SD_RPC_API uint32_t sd_rpc_provisioner_stats_get(provisioner_t *provisioner, sd_rpc_provision_stats_t *p_stats);
+
+/**@brief Create a Secure DFU engine.
+ *
+ * @details The engine transfers firmware to devices running the Nordic Secure DFU bootloader. The
+ *          data is streamed with write commands, as many as the connection can buffer, and the
+ *          packet receipt notification interval and object size are adapted to the CRC errors seen.
+ *          Interrupted transfers are resumed from the offset reported by the target when its CRC
+ *          matches. Transfers run in parallel on all connections of all adapters of the engine. The
+ *          result handler is called from the engine thread when a transfer has finished.
+ *
+ * @note The adapters must be opened and the BLE stack enabled. The vendor specific UUID of the DFU
+ *       service is added to each adapter.
+ *
+ * @param[in]  adapters  The transport adapters to transfer firmware with.
+ * @param[in]  adapter_count  The number of adapters.
+ * @param[in]  result_handler  The result handler callback.
+ *
+ * @retval The DFU engine or NULL.
+ */
+SD_RPC_API dfu_engine_t *sd_rpc_dfu_engine_create(adapter_t *adapters[], uint8_t adapter_count, sd_rpc_dfu_result_handler_t result_handler);
+
+/**@brief Abort all transfers and delete a DFU engine.
+ *
+ * @param[in]  engine  The DFU engine.
+ */
+SD_RPC_API void sd_rpc_dfu_engine_delete(dfu_engine_t *engine);
+
+/**@brief Start a firmware transfer to a connected DFU target.
+ *
+ * @param[in]  engine  The DFU engine.
+ * @param[in]  adapter  The transport adapter the target is connected to.
+ * @param[in]  conn_handle  The connection handle of the target.
+ * @param[in]  p_image  The init packet and firmware. Both are copied.
+ * @param[in]  p_context  Application context, passed back in the result.
+ *
+ * @retval NRF_SUCCESS  The transfer was started.
+ * @retval NRF_ERROR_NULL  p_image or its data is NULL.
+ * @retval NRF_ERROR_INVALID_PARAM  The adapter does not belong to the engine.
+ * @retval NRF_ERROR_INVALID_STATE  A transfer to the connection is already in progress.
+ */
+SD_RPC_API uint32_t sd_rpc_dfu_start(dfu_engine_t *engine, adapter_t *adapter, uint16_t conn_handle, const sd_rpc_dfu_image_t *p_image, void *p_context);
+
+/**@brief Abort a firmware transfer. The result handler is called with NRF_ERROR_INVALID_STATE.
+ *
+ * @param[in]  engine  The DFU engine.
+ * @param[in]  adapter  The transport adapter the target is connected to.
+ * @param[in]  conn_handle  The connection handle of the target.
+ *
+ * @retval NRF_SUCCESS  The transfer will be aborted.
+ * @retval NRF_ERROR_NOT_FOUND  There is no transfer to the connection.
+ */
+SD_RPC_API uint32_t sd_rpc_dfu_abort(dfu_engine_t *engine, adapter_t *adapter, uint16_t conn_handle);
+
+/**@brief Get the progress of a firmware transfer.
+ *
+ * @param[in]  engine  The DFU engine.
+ * @param[in]  adapter  The transport adapter the target is connected to.
+ * @param[in]  conn_handle  The connection handle of the target.
+ * @param[out] p_progress  The progress, including the current transfer rate.
+ *
+ * @retval NRF_SUCCESS  The progress was copied to p_progress.
+ * @retval NRF_ERROR_NULL  p_progress is NULL.
+ * @retval NRF_ERROR_NOT_FOUND  There is no transfer to the connection.
+ */
+SD_RPC_API uint32_t sd_rpc_dfu_progress_get(dfu_engine_t *engine, adapter_t *adapter, uint16_t conn_handle, sd_rpc_dfu_progress_t *p_progress);
+
+/**@brief Get the statistics of a DFU engine, including the aggregate transfer rate.
+ *
+ * @param[in]  engine  The DFU engine.
+ * @param[out] p_stats  The statistics.
+ *
+ * @retval NRF_SUCCESS  The statistics were copied to p_stats.
+ * @retval NRF_ERROR_NULL  p_stats is NULL.
+ */
+SD_RPC_API uint32_t sd_rpc_dfu_stats_get(dfu_engine_t *engine, sd_rpc_dfu_stats_t *p_stats);
+
+/**@brief Create a GATT cache.
+ *
+ * @details The cache resolves the GATT table of each central connection of its adapters. After the
+ *          connection is established the peer is fingerprinted by reading its Database Hash
+ *          characteristic or, for peers without one, by the services returned for the first primary
+ *          service discovery request. When a table has been discovered for the fingerprint before it
+ *          is shared with the connection, otherwise the services, characteristics and descriptors are
+ *          discovered and the table is kept for the next peer of the same model. Tables are immutable
+ *          and reference counted, one table is kept per product model however many peers are
+ *          connected. The table handler is called from the cache thread when the table of a
+ *          connection is resolved.
+ *
+ * @note The cache runs GATT client procedures on each new central connection, the application must
+ *       not start its own until the table handler has been called. Peers that share their first
+ *       services but differ after them must have a Database Hash characteristic, or the probe fallback
+ *       must be disabled. Vendor specific UUID types must be the same on all adapters.
+ *
+ * @param[in]  adapters  The transport adapters to resolve connections of.
+ * @param[in]  adapter_count  The number of adapters.
+ * @param[in]  p_params  The cache parameters, NULL for no table limit and the probe fallback enabled.
+ * @param[in]  table_handler  The table handler callback. p_table is valid until the connection is
+ *             disconnected, and is NULL if the table could not be resolved.
+ *
+ * @retval The GATT cache or NULL.
+ */
+SD_RPC_API gatt_cache_t *sd_rpc_gatt_cache_create(adapter_t *adapters[], uint8_t adapter_count, const sd_rpc_gatt_cache_params_t *p_params, sd_rpc_gatt_table_handler_t table_handler);
+
+/**@brief Stop and delete a GATT cache, with the tables it keeps.
+ *
+ * @param[in]  cache  The GATT cache.
+ */
+SD_RPC_API void sd_rpc_gatt_cache_delete(gatt_cache_t *cache);
+
+/**@brief Get the GATT table of a connection, to be released with @ref sd_rpc_gatt_cache_table_release.
+ *
+ * @param[in]  cache  The GATT cache.
+ * @param[in]  adapter  The transport adapter the peer is connected to.
+ * @param[in]  conn_handle  The connection handle of the peer.
+ * @param[out] pp_table  The GATT table, valid until released.
+ *
+ * @retval NRF_SUCCESS  A reference to the table was taken.
+ * @retval NRF_ERROR_NULL  pp_table is NULL.
+ * @retval NRF_ERROR_NOT_FOUND  The table of the connection is not resolved.
+ */
+SD_RPC_API uint32_t sd_rpc_gatt_cache_table_get(gatt_cache_t *cache, adapter_t *adapter, uint16_t conn_handle, const sd_rpc_gatt_table_t **pp_table);
+
+/**@brief Release a GATT table taken with @ref sd_rpc_gatt_cache_table_get.
+ *
+ * @param[in]  cache  The GATT cache.
+ * @param[in]  p_table  The GATT table.
+ *
+ * @retval NRF_SUCCESS  The reference was released.
+ * @retval NRF_ERROR_NULL  p_table is NULL.
+ * @retval NRF_ERROR_NOT_FOUND  No reference to the table is held.
+ */
+SD_RPC_API uint32_t sd_rpc_gatt_cache_table_release(gatt_cache_t *cache, const sd_rpc_gatt_table_t *p_table);
+
+/**@brief Get the statistics of a GATT cache, including the hit rate and the memory used by tables.
+ *
+ * @param[in]  cache  The GATT cache.
+ * @param[out] p_stats  The statistics.
+ *
+ * @retval NRF_SUCCESS  The statistics were copied to p_stats.
+ * @retval NRF_ERROR_NULL  p_stats is NULL.
+ */
+SD_RPC_API uint32_t sd_rpc_gatt_cache_stats_get(gatt_cache_t *cache, sd_rpc_gatt_cache_stats_t *p_stats);
+
+/**@brief Set the operations the driver sends right after a peer connects.
+ *
+ * @details When a connection is established the reads and CCCD writes of the policy of the peer
+ *          are sent by the driver, each as soon as the response to the previous one is received,
+ *          while the connected event is still on its way to the application. Their responses are
+ *          kept from the application. The first read of each prefetched value, and each matching
+ *          CCCD write, issued by the application on the connection is then answered by the driver
+ *          with the response the prefetch received, without a round trip to the peer. If the
+ *          application asks while the operation is in flight it gets the response when it arrives.
+ *          A read or CCCD write not covered by the policy cancels the rest of the prefetch.
+ *
+ * @note A GATT client procedure started by the application while a prefetch operation is in flight
+ *       fails with NRF_ERROR_BUSY, as it does while any other procedure is in progress.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  p_peer_addr  The peer the policy is for, NULL for the policy of peers without their
+ *             own. Peers of the same product model have the same handles and share this policy.
+ * @param[in]  p_ops  The operations, in order.
+ * @param[in]  op_count  The number of operations, 0 to remove the policy.
+ *
+ * @retval NRF_SUCCESS  The policy was set.
+ * @retval NRF_ERROR_NULL  p_ops is NULL and op_count is not 0.
+ * @retval NRF_ERROR_INVALID_PARAM  More than @ref SD_RPC_PREFETCH_OPS_MAX operations.
+ */
+SD_RPC_API uint32_t sd_rpc_prefetch_policy_set(adapter_t *adapter, const ble_gap_addr_t *p_peer_addr, const sd_rpc_prefetch_op_t *p_ops, uint8_t op_count);
+
+/**@brief Learn the prefetch policy of peers from the application.
+ *
+ * @details The first reads, and the writes to CCCDs found by descriptor discovery or by an earlier
+ *          policy, the application sends on a connection are recorded and become the policy of the
+ *          peer when it disconnects. Peers with a policy set by @ref sd_rpc_prefetch_policy_set are
+ *          not learned.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  enable  true to learn policies, false to stop. Learned policies are kept.
+ * @param[in]  max_ops  The number of operations recorded per connection, at most @ref SD_RPC_PREFETCH_OPS_MAX.
+ *
+ * @retval NRF_SUCCESS  Learning was enabled or disabled.
+ * @retval NRF_ERROR_INVALID_PARAM  max_ops is 0 or too large.
+ */
+SD_RPC_API uint32_t sd_rpc_prefetch_learn_enable(adapter_t *adapter, bool enable, uint8_t max_ops);
+
+/**@brief Get a value prefetched on a connection.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  conn_handle  The connection handle.
+ * @param[in]  handle  The handle of the characteristic value.
+ * @param[out] p_value  The value.
+ * @param[in,out] p_len  In the size of p_value, out the length of the value.
+ *
+ * @retval NRF_SUCCESS  The value was copied to p_value.
+ * @retval NRF_ERROR_NULL  p_value or p_len is NULL.
+ * @retval NRF_ERROR_NOT_FOUND  The value has not been prefetched on the connection.
+ * @retval NRF_ERROR_DATA_SIZE  p_value is too small, p_len is set to the length of the value.
+ */
+SD_RPC_API uint32_t sd_rpc_prefetch_value_get(adapter_t *adapter, uint16_t conn_handle, uint16_t handle, uint8_t *p_value, uint16_t *p_len);
+
+/**@brief Get the prefetch statistics of an adapter, including the hit rate and the time saved.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[out] p_stats  The statistics.
+ *
+ * @retval NRF_SUCCESS  The statistics were copied to p_stats.
+ * @retval NRF_ERROR_NULL  p_stats is NULL.
+ */
+SD_RPC_API uint32_t sd_rpc_prefetch_stats_get(adapter_t *adapter, sd_rpc_prefetch_stats_t *p_stats);
+
+/**@brief Add a notification sink for a characteristic value of a connection.
+ *
+ * @details Notifications and indications of the value are appended to chunks of memory as they are
+ *          received: a @ref sd_rpc_notification_sample_t header with the receive time, followed by the
+ *          value. The application takes the filled chunks in bulk with @ref sd_rpc_notification_sink_swap
+ *          instead of handling each event. When the connection is lost the sink stops appending and keeps
+ *          its chunks, it is used again if it is added again for a new connection.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  p_params  The connection, value handle and buffer sizes.
+ *
+ * @retval NRF_SUCCESS  The sink was added.
+ * @retval NRF_ERROR_NULL  p_params is NULL.
+ * @retval NRF_ERROR_INVALID_PARAM  The chunk size cannot hold a sample with a value of the maximum length.
+ * @retval NRF_ERROR_INVALID_STATE  There is already a sink for the value on the connection.
+ */
+SD_RPC_API uint32_t sd_rpc_notification_sink_add(adapter_t *adapter, const sd_rpc_notification_sink_params_t *p_params);
+
+/**@brief Remove a notification sink and free its chunks.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  conn_handle  The connection handle.
+ * @param[in]  value_handle  The handle of the characteristic value.
+ *
+ * @retval NRF_SUCCESS  The sink was removed.
+ * @retval NRF_ERROR_NOT_FOUND  There is no sink for the value on the connection.
+ */
+SD_RPC_API uint32_t sd_rpc_notification_sink_remove(adapter_t *adapter, uint16_t conn_handle, uint16_t value_handle);
+
+/**@brief Take the chunks filled by a notification sink.
+ *
+ * @details The oldest chunks are returned first, including the chunk currently appended to if it holds
+ *          any samples. The chunks are owned by the application until they are given back with
+ *          @ref sd_rpc_notification_sink_release.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  conn_handle  The connection handle.
+ * @param[in]  value_handle  The handle of the characteristic value.
+ * @param[out] p_chunks  The array of chunks to be filled in.
+ * @param[in,out]  p_count  The size of the array. The number of chunks returned is stored here.
+ * @param[out] p_dropped  Number of samples dropped because max_chunks was reached since the last swap, may be NULL.
+ *
+ * @retval NRF_SUCCESS  The chunks were stored in p_chunks.
+ * @retval NRF_ERROR_NULL  p_chunks or p_count is NULL.
+ * @retval NRF_ERROR_NOT_FOUND  There is no sink for the value on the connection.
+ */
+SD_RPC_API uint32_t sd_rpc_notification_sink_swap(adapter_t *adapter, uint16_t conn_handle, uint16_t value_handle, sd_rpc_notification_chunk_t *p_chunks, uint32_t *p_count, uint32_t *p_dropped);
+
+/**@brief Give chunks taken with @ref sd_rpc_notification_sink_swap back to the driver for reuse.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  p_chunks  The chunks.
+ * @param[in]  count  The number of chunks.
+ *
+ * @retval NRF_SUCCESS  The chunks were released.
+ * @retval NRF_ERROR_NULL  p_chunks is NULL.
+ */
+SD_RPC_API uint32_t sd_rpc_notification_sink_release(adapter_t *adapter, sd_rpc_notification_chunk_t *p_chunks, uint32_t count);
+
+/**@brief Start counting distinct devices seen in advertising reports.
+ *
+ * @details Each advertising report is added to a HyperLogLog sketch of the current window, keyed by
+ *          the peer address and address type. The address is the identity address when the connectivity
+ *          chip has resolved it. A sketch uses 2^precision bytes regardless of the number of devices.
+ *          Starting again with new parameters discards the windows counted so far.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  p_params  The window length, precision and history.
+ *
+ * @retval NRF_SUCCESS  Counting was started.
+ * @retval NRF_ERROR_NULL  p_params is NULL.
+ * @retval NRF_ERROR_INVALID_PARAM  The window length is 0 or the precision is out of range.
+ */
+SD_RPC_API uint32_t sd_rpc_device_counter_start(adapter_t *adapter, const sd_rpc_device_counter_params_t *p_params);
+
+/**@brief Stop counting distinct devices and discard the windows.
+ *
+ * @param[in]  adapter  The transport adapter.
+ *
+ * @retval NRF_SUCCESS  Counting was stopped.
+ */
+SD_RPC_API uint32_t sd_rpc_device_counter_stop(adapter_t *adapter);
+
+/**@brief Get the estimated number of distinct devices in a window, seen by one or more adapters.
+ *
+ * @details The sketches of the adapters are merged before estimating, so a device seen by several
+ *          adapters is counted once. All adapters must count with the same window length and precision.
+ *
+ * @param[in]  adapters  The transport adapters.
+ * @param[in]  adapter_count  The number of adapters.
+ * @param[in]  window  0 for the current window, 1 for the previous window and so on.
+ * @param[out] p_count  The estimate.
+ *
+ * @retval NRF_SUCCESS  The estimate was stored in p_count.
+ * @retval NRF_ERROR_NULL  adapters or p_count is NULL.
+ * @retval NRF_ERROR_INVALID_PARAM  adapter_count is 0, the window is not kept or the adapters count with different parameters.
+ * @retval NRF_ERROR_INVALID_STATE  Counting is not started on an adapter.
+ */
+SD_RPC_API uint32_t sd_rpc_device_count_get(adapter_t *adapters[], uint8_t adapter_count, uint32_t window, sd_rpc_device_count_t *p_count);
+
+/**@brief Start keeping a table of the devices in range from advertising reports.
+ *
+ * @details Each device is kept with its last seen time, smoothed RSSI, report count and a hash of its
+ *          advertising data. The presence handler is called when a device enters the table and when it
+ *          leaves after the timeout, instead of once per advertising report. It is called from a thread
+ *          of the table, in the order the changes were found. Devices are expired incrementally while
+ *          advertising reports are received, and the whole table is checked at least every second, so
+ *          devices leave when scanning has stopped too.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  p_params  The timeout, snapshot interval and table size.
+ * @param[in]  presence_handler  Called when a device enters or leaves, may be NULL.
+ *
+ * @retval NRF_SUCCESS  The table was started.
+ * @retval NRF_ERROR_NULL  p_params is NULL.
+ * @retval NRF_ERROR_INVALID_PARAM  The timeout is 0 or rssi_smoothing is larger than 15.
+ */
+SD_RPC_API uint32_t sd_rpc_presence_table_start(adapter_t *adapter, const sd_rpc_presence_params_t *p_params, sd_rpc_presence_handler_t presence_handler);
+
+/**@brief Stop keeping the presence table and discard it.
+ *
+ * @param[in]  adapter  The transport adapter.
+ *
+ * @retval NRF_SUCCESS  The table was stopped.
+ */
+SD_RPC_API uint32_t sd_rpc_presence_table_stop(adapter_t *adapter);
+
+/**@brief Copy the last snapshot of the presence table.
+ *
+ * @details Snapshots are published by the event thread and read without locking, reading a snapshot
+ *          never delays the handling of advertising reports.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[out] p_entries  The array of entries to be filled in.
+ * @param[in,out]  p_count  The size of the array. The number of entries in the snapshot is stored here.
+ * @param[out] p_time_ms  Time the snapshot was taken in milliseconds since 1970-01-01 UTC, may be NULL.
+ *
+ * @retval NRF_SUCCESS  The snapshot was stored in p_entries.
+ * @retval NRF_ERROR_NULL  p_entries or p_count is NULL.
+ * @retval NRF_ERROR_DATA_SIZE  The array is too small for the snapshot, nothing is copied.
+ * @retval NRF_ERROR_INVALID_STATE  The table is not started.
+ */
+SD_RPC_API uint32_t sd_rpc_presence_table_snapshot(adapter_t *adapter, sd_rpc_presence_entry_t *p_entries, uint32_t *p_count, uint64_t *p_time_ms);
+
+/**@brief Notify or indicate a value to every connection that has enabled it in the CCCD.
+ *
+ * @details The driver tracks the CCCDs of characteristics added with @ref sd_ble_gatts_characteristic_add,
+ *          from writes by the peers and from system attributes set with @ref sd_ble_gatts_sys_attr_set.
+ *          The value is sent to the subscribed connections back to back. Notifications are not sent to a
+ *          connection that has as many notifications queued as its TX queue has held before, the delivery
+ *          of that connection is NRF_ERROR_RESOURCES, or BLE_ERROR_NO_TX_PACKETS for SoftDevice API version 2.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  p_params  The value handle, type and value.
+ * @param[out] p_deliveries  The array of deliveries to be filled in, one per subscribed connection.
+ * @param[in,out]  p_count  The size of the array. The number of subscribed connections is stored here.
+ *
+ * @retval NRF_SUCCESS  The value was sent, the result for each connection is stored in p_deliveries.
+ * @retval NRF_ERROR_NULL  p_params, p_deliveries or p_count is NULL.
+ * @retval NRF_ERROR_INVALID_PARAM  The type is not a notification or an indication.
+ * @retval NRF_ERROR_DATA_SIZE  The array is too small for the subscribed connections, nothing is sent.
+ */
+SD_RPC_API uint32_t sd_rpc_gatts_hvx_broadcast(adapter_t *adapter, const sd_rpc_hvx_broadcast_params_t *p_params, sd_rpc_hvx_delivery_t *p_deliveries, uint32_t *p_count);
+
+/**@brief Start keeping statistics per peer, optionally persisted in a memory mapped file.
+ *
+ * @details The statistics are updated from the events of the adapter before they are passed to the
+ *          event handler, keyed by the address of the peer in the connected event. When a file is given
+ *          the table is kept in the file mapping, the statistics of earlier runs are kept and updates are
+ *          written back by the operating system.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  p_params  The size of the table and the file.
+ *
+ * @retval NRF_SUCCESS  The table was opened.
+ * @retval NRF_ERROR_NULL  p_params is NULL.
+ * @retval NRF_ERROR_INVALID_PARAM  max_peers is 0.
+ * @retval NRF_ERROR_INVALID_STATE  The table is already open.
+ * @retval NRF_ERROR_INVALID_DATA  The file is not a statistics table of the same size.
+ * @retval NRF_ERROR_INTERNAL  The file could not be created or mapped.
+ */
+SD_RPC_API uint32_t sd_rpc_peer_stats_open(adapter_t *adapter, const sd_rpc_peer_stats_params_t *p_params);
+
+/**@brief Stop keeping statistics per peer, flushing and unmapping the file.
+ *
+ * @param[in]  adapter  The transport adapter.
+ *
+ * @retval NRF_SUCCESS  The table was closed.
+ */
+SD_RPC_API uint32_t sd_rpc_peer_stats_close(adapter_t *adapter);
+
+/**@brief Get the statistics of a peer.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  p_peer_addr  The address of the peer.
+ * @param[out] p_stats  The statistics.
+ *
+ * @retval NRF_SUCCESS  The statistics were copied to p_stats.
+ * @retval NRF_ERROR_NULL  p_peer_addr or p_stats is NULL.
+ * @retval NRF_ERROR_NOT_FOUND  There are no statistics for the peer.
+ * @retval NRF_ERROR_INVALID_STATE  The table is not open.
+ */
+SD_RPC_API uint32_t sd_rpc_peer_stats_get(adapter_t *adapter, const ble_gap_addr_t *p_peer_addr, sd_rpc_peer_stats_t *p_stats);
+
+/**@brief Get the statistics of all peers in the table.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[out] p_stats  The array of statistics to be filled in.
+ * @param[in,out]  p_count  The size of the array. The number of peers in the table is stored here.
+ *
+ * @retval NRF_SUCCESS  The statistics were stored in p_stats.
+ * @retval NRF_ERROR_NULL  p_stats or p_count is NULL.
+ * @retval NRF_ERROR_DATA_SIZE  The array is too small for the peers in the table, nothing is copied.
+ * @retval NRF_ERROR_INVALID_STATE  The table is not open.
+ */
+SD_RPC_API uint32_t sd_rpc_peer_stats_list(adapter_t *adapter, sd_rpc_peer_stats_t *p_stats, uint32_t *p_count);
+
+/**@brief Start timestamping the phases of each connection attempt.
+ *
+ * @details An attempt starts with @ref sd_ble_gap_connect, or with the connected event when connected as
+ *          a peripheral. Its phases are timestamped from the commands and events of the adapter, see
+ *          @ref sd_rpc_conn_phase_t, the first time they happen on the connection. Discovery is the last
+ *          discovery response on the connection. Security is reached when pairing completes, or when the
+ *          link is encrypted with the keys of a bond.
+ *
+ *          When an attempt finishes, by a disconnection, an error, a timeout, cancelling or a reset of
+ *          the connectivity chip, its timeline is kept in the history and the durations of its phases are
+ *          added to the statistics. The first phase of an attempt has no duration and is not counted.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  p_params  The size of the history.
+ *
+ * @retval NRF_SUCCESS  Timestamping was started.
+ * @retval NRF_ERROR_NULL  p_params is NULL.
+ * @retval NRF_ERROR_INVALID_PARAM  max_timelines is 0.
+ * @retval NRF_ERROR_INVALID_STATE  Timestamping is already started.
+ */
+SD_RPC_API uint32_t sd_rpc_conn_timeline_start(adapter_t *adapter, const sd_rpc_conn_timeline_params_t *p_params);
+
+/**@brief Stop timestamping connection attempts and discard the timelines and the statistics.
+ *
+ * @param[in]  adapter  The transport adapter.
+ *
+ * @retval NRF_SUCCESS  Timestamping was stopped.
+ */
+SD_RPC_API uint32_t sd_rpc_conn_timeline_stop(adapter_t *adapter);
+
+/**@brief Get the timeline of a connection.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  conn_handle  The connection handle, the last finished timeline of the handle if it is not
+ *                          connected. @ref BLE_CONN_HANDLE_INVALID for the attempt of @ref sd_ble_gap_connect
+ *                          that is not connected yet.
+ * @param[out] p_timeline  The timeline.
+ *
+ * @retval NRF_SUCCESS  The timeline was copied to p_timeline.
+ * @retval NRF_ERROR_NULL  p_timeline is NULL.
+ * @retval NRF_ERROR_NOT_FOUND  There is no timeline for the connection handle.
+ * @retval NRF_ERROR_INVALID_STATE  Timestamping is not started.
+ */
+SD_RPC_API uint32_t sd_rpc_conn_timeline_get(adapter_t *adapter, uint16_t conn_handle, sd_rpc_conn_timeline_t *p_timeline);
+
+/**@brief Get the finished timelines in the history, oldest first.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[out] p_timelines  The array of timelines to be filled in.
+ * @param[in,out]  p_count  The size of the array. The number of timelines in the history is stored here.
+ *
+ * @retval NRF_SUCCESS  The timelines were stored in p_timelines.
+ * @retval NRF_ERROR_NULL  p_timelines or p_count is NULL.
+ * @retval NRF_ERROR_DATA_SIZE  The array is too small for the history, nothing is copied.
+ * @retval NRF_ERROR_INVALID_STATE  Timestamping is not started.
+ */
+SD_RPC_API uint32_t sd_rpc_conn_timeline_list(adapter_t *adapter, sd_rpc_conn_timeline_t *p_timelines, uint32_t *p_count);
+
+/**@brief Get the percentiles of the duration of each phase over all finished attempts.
+ *
+ * @details The durations are kept in histograms with 8 buckets per power of two, the percentiles are
+ *          the middle of their bucket. Minimum and maximum are exact.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[out] p_stats  The statistics.
+ *
+ * @retval NRF_SUCCESS  The statistics were copied to p_stats.
+ * @retval NRF_ERROR_NULL  p_stats is NULL.
+ * @retval NRF_ERROR_INVALID_STATE  Timestamping is not started.
+ */
+SD_RPC_API uint32_t sd_rpc_conn_timeline_stats_get(adapter_t *adapter, sd_rpc_conn_timeline_stats_t *p_stats);
+
+/**@brief Open a pool of user memory blocks the driver lends to the SoftDevice for GATTS queued writes.
+ *
+ * @details A user memory request for queued writes is answered with a free block of the pool as soon as
+ *          it is read from the connectivity chip, it is not passed to the event handler. The queued writes
+ *          are copied to the block when the write and authorize request events of the connection are
+ *          decoded, and the block is returned to the pool on @ref BLE_EVT_USER_MEM_RELEASE, which is not
+ *          passed to the event handler either. Requests are passed to the event handler as before when
+ *          no block is free or the reply fails. The queued writes of a connection are read with
+ *          @ref sd_rpc_user_mem_pool_block_get, i.e. to authorize @ref BLE_GATTS_OP_EXEC_WRITE_REQ_NOW.
+ *
+ * @note    The blocks are not cleared between connections.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  p_params  The size and number of blocks.
+ *
+ * @retval NRF_SUCCESS  The pool was opened.
+ * @retval NRF_ERROR_NULL  p_params is NULL.
+ * @retval NRF_ERROR_INVALID_PARAM  block_size or block_count is 0.
+ * @retval NRF_ERROR_INVALID_STATE  The pool is already open.
+ * @retval NRF_ERROR_BUSY  The SoftDevice still holds blocks of a pool that was closed.
+ */
+SD_RPC_API uint32_t sd_rpc_user_mem_pool_open(adapter_t *adapter, const sd_rpc_user_mem_pool_params_t *p_params);
+
+/**@brief Stop answering user memory requests from the pool.
+ *
+ * @details Blocks the SoftDevice holds stay valid until they are released, the memory of the pool is
+ *          freed with the last block.
+ *
+ * @param[in]  adapter  The transport adapter.
+ *
+ * @retval NRF_SUCCESS  The pool was closed.
+ */
+SD_RPC_API uint32_t sd_rpc_user_mem_pool_close(adapter_t *adapter);
+
+/**@brief Get the size, use and exhaustion statistics of the user memory pool.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[out] p_stats  The statistics.
+ *
+ * @retval NRF_SUCCESS  The statistics were copied to p_stats.
+ * @retval NRF_ERROR_NULL  p_stats is NULL.
+ */
+SD_RPC_API uint32_t sd_rpc_user_mem_pool_stats_get(adapter_t *adapter, sd_rpc_user_mem_pool_stats_t *p_stats);
+
+/**@brief Copy the block of the user memory pool lent to a connection.
+ *
+ * @details The block holds the queued writes of the connection in the layout the SoftDevice uses for
+ *          user memory, see @ref BLE_USER_MEM_TYPE_GATTS_QUEUED_WRITES. It is lent from the user memory
+ *          request until @ref BLE_EVT_USER_MEM_RELEASE, which the SoftDevice sends after the queued
+ *          writes have been executed or cancelled. The release is handled before the following events
+ *          are dispatched, the block is valid in the event handler for
+ *          @ref BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST with @ref BLE_GATTS_OP_EXEC_WRITE_REQ_NOW.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  conn_handle  The connection handle.
+ * @param[out] p_data  The buffer the block is copied to.
+ * @param[in,out]  p_len  The size of the buffer. The size of the block is stored here.
+ *
+ * @retval NRF_SUCCESS  The block was copied to p_data.
+ * @retval NRF_ERROR_NULL  p_data or p_len is NULL.
+ * @retval NRF_ERROR_NOT_FOUND  The SoftDevice holds no block of the pool for the connection.
+ * @retval NRF_ERROR_DATA_SIZE  The buffer is too small for the block, nothing is copied.
+ */
+SD_RPC_API uint32_t sd_rpc_user_mem_pool_block_get(adapter_t *adapter, uint16_t conn_handle, uint8_t *p_data, uint16_t *p_len);
+
+/**@brief Start streaming the events of the adapter to subscribers on a TCP or Unix domain socket.
+ *
+ * @details All messages start with their length in a uint32, not including the length itself,
+ *          followed by the message type in a uint8. Integers are little endian.
+ *
+ *          On connect the bridge sends HELLO (0x00): uint8 protocol version 1, uint8 flags where bit 0
+ *          tells that compression is supported. Nothing else is sent until the subscriber has sent
+ *          SUBSCRIBE (0x01): uint8 content where bit 0 selects serialized event frames and bit 1 decoded
+ *          ble_evt_t structures, uint8 flags where bit 0 requests compression, uint32 initial credit,
+ *          uint16 number of filters, and per filter the first and last event id of a range as uint16.
+ *          Without filters all events are sent. CREDIT (0x02): uint32 allows that many more batches.
+ *
+ *          Events are sent in BATCH (0x10) messages: uint32 sequence number, uint32 events dropped
+ *          since the previous batch, uint16 number of events, and per event uint8 content, uint16
+ *          event id, uint64 time in microseconds since 1970-01-01 UTC, uint16 length and the event.
+ *          In COMPRESSED BATCH (0x11) messages the events are deflated with zlib, preceded by their
+ *          uncompressed length in a uint32. Each batch uses one credit, batches are queued while a
+ *          subscriber has none.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[in]  p_params  The socket to listen on, batching and queueing.
+ *
+ * @retval NRF_SUCCESS  The bridge is listening.
+ * @retval NRF_ERROR_NULL  p_params or its address is NULL.
+ * @retval NRF_ERROR_INVALID_PARAM  A size is 0 or the address is invalid.
+ * @retval NRF_ERROR_INVALID_STATE  The bridge is already started.
+ * @retval NRF_ERROR_NOT_SUPPORTED  Unix domain sockets are not supported on the platform.
+ * @retval NRF_ERROR_INTERNAL  The socket could not be opened.
+ */
+SD_RPC_API uint32_t sd_rpc_event_bridge_start(adapter_t *adapter, const sd_rpc_event_bridge_params_t *p_params);
+
+/**@brief Stop the event bridge and disconnect all subscribers.
+ *
+ * @param[in]  adapter  The transport adapter.
+ *
+ * @retval NRF_SUCCESS  The bridge was stopped.
+ */
+SD_RPC_API uint32_t sd_rpc_event_bridge_stop(adapter_t *adapter);
+
+/**@brief Get the statistics of the event bridge.
+ *
+ * @param[in]  adapter  The transport adapter.
+ * @param[out] p_info  The statistics.
+ *
+ * @retval NRF_SUCCESS  The statistics were copied to p_info.
+ * @retval NRF_ERROR_NULL  p_info is NULL.
+ */
+SD_RPC_API uint32_t sd_rpc_event_bridge_info_get(adapter_t *adapter, sd_rpc_event_bridge_info_t *p_info);
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
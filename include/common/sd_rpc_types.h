@@ -71,7 +71,12 @@ typedef enum
     PKT_SEND_ERROR,
     IO_RESOURCES_UNAVAILABLE,
     RESET_PERFORMED,
-    CONNECTION_ACTIVE
+    CONNECTION_ACTIVE,
+    STATE_REPLAY_COMPLETED,
+    STATE_REPLAY_FAILED,
+    FAILOVER_COMPLETED,
+    LINK_FAILED,
+    FAILBACK_COMPLETED
 } sd_rpc_app_status_t;
 
 /**@brief Levels of severity that a log message can be associated with. */
@@ -89,9 +94,64 @@ typedef enum
 typedef enum
 {
     SD_RPC_FLOW_CONTROL_NONE,
-    SD_RPC_FLOW_CONTROL_HARDWARE
+    SD_RPC_FLOW_CONTROL_HARDWARE,
+    SD_RPC_FLOW_CONTROL_SOFTWARE    /**< Out-of-frame XON/XOFF flow control, negotiated with the connectivity chip. */
 } sd_rpc_flow_control_t;
 
+/**@brief USB to UART bridges recognized when tuning a serial port for latency. */
+typedef enum
+{
+    SD_RPC_USB_BRIDGE_UNKNOWN,      /**< Not a USB serial port, or the bridge is not recognized. */
+    SD_RPC_USB_BRIDGE_FTDI,         /**< FTDI bridge with the ftdi_sio driver. */
+    SD_RPC_USB_BRIDGE_CP210X,       /**< Silicon Labs CP210x bridge. */
+    SD_RPC_USB_BRIDGE_CDC_ACM       /**< USB CDC ACM device, i.e. the J-Link OB of development kits. */
+} sd_rpc_usb_bridge_t;
+
+/**@brief Latency settings applied to a serial port when it was opened. */
+typedef struct
+{
+    sd_rpc_usb_bridge_t bridge;     /**< The bridge of the serial port. */
+    uint8_t  latency_timer_ms;      /**< Latency timer of an FTDI bridge in effect, 0 if the bridge has none. */
+    uint8_t  previous_latency_timer_ms; /**< Latency timer before the port was opened, restored when it is closed. */
+    bool     low_latency;           /**< The low latency flag of the serial driver is set. */
+} sd_rpc_serial_latency_info_t;
+
+/**@brief Parameters of the busy poll receive mode of a serial port. */
+typedef struct
+{
+    int16_t  cpu;                   /**< CPU the poll thread is pinned to, -1 to leave it unpinned. */
+    uint32_t spin_us;               /**< Time in microseconds the poll thread spins after the last received byte. */
+    uint32_t sleep_us;              /**< Time in microseconds the poll thread sleeps between polls once it is done spinning, 0 to only yield. */
+} sd_rpc_busy_poll_params_t;
+
+/**@brief Statistics of the busy poll receive mode of a serial port. */
+typedef struct
+{
+    bool     active;                /**< true if the port is read by the poll thread. */
+    bool     pinned;                /**< true if the poll thread is pinned to the requested CPU. */
+    uint64_t poll_count;            /**< Number of reads polled. */
+    uint64_t read_count;            /**< Number of polled reads that returned bytes. */
+    uint64_t byte_count;            /**< Number of bytes received. */
+    uint64_t sleep_count;           /**< Number of times the poll thread slept or yielded. */
+} sd_rpc_busy_poll_stats_t;
+
+/**@brief Statistics of the unreliable lane of a data link layer. */
+typedef struct
+{
+    bool     active;                /**< The connectivity chip has agreed to send unreliable packets. */
+    uint32_t received_count;        /**< Unreliable packets passed on to the transport layer. */
+    uint32_t dropped_count;         /**< Unreliable packets lost, or received while the lane was not agreed. */
+} sd_rpc_unreliable_lane_info_t;
+
+/**@brief Result of the baud rate detection of a data link layer. */
+typedef struct
+{
+    bool     detected;              /**< A baud rate responded, false if the configured baud rate was kept. */
+    uint32_t baud_rate;             /**< Baud rate in use after the link was opened. */
+    uint8_t  probed_count;          /**< Number of baud rates probed. */
+    uint32_t detect_time_ms;        /**< Time spent probing. */
+} sd_rpc_baud_rate_detect_info_t;
+
 /**@brief Parity modes */
 typedef enum
 {
@@ -99,11 +159,497 @@ typedef enum
     SD_RPC_PARITY_EVEN
 } sd_rpc_parity_t;
 
+/**@brief Connection state as tracked by the driver from received events. */
+typedef struct
+{
+    uint16_t              conn_handle;      /**< Connection handle. */
+    uint8_t               role;             /**< BLE role of this device on the connection, see @ref BLE_GAP_ROLES. */
+    ble_gap_addr_t        peer_addr;        /**< Bluetooth address of the peer device. */
+    ble_gap_conn_params_t conn_params;      /**< Current connection parameters. */
+    ble_gap_conn_sec_t    conn_sec;         /**< Current connection security mode and level. */
+    uint16_t              att_mtu;          /**< Effective ATT MTU. */
+    uint16_t              max_tx_octets;    /**< Effective maximum link layer TX payload in octets. */
+    uint16_t              max_rx_octets;    /**< Effective maximum link layer RX payload in octets. */
+    uint8_t               tx_phy;           /**< Current TX PHY. */
+    uint8_t               rx_phy;           /**< Current RX PHY. */
+    uint32_t              update_count;     /**< Number of updates applied since the connection was established. */
+} sd_rpc_conn_state_t;
+
+/**@brief Statistics of the replay of recorded configuration commands after a connectivity chip reset. */
+typedef struct
+{
+    uint32_t command_count;             /**< Number of commands currently recorded. */
+    uint32_t replay_count;              /**< Number of replays performed. */
+    uint32_t last_command_count;        /**< Number of commands sent in the last replay. */
+    uint32_t last_failed_count;         /**< Number of commands not restored in the last replay. */
+    uint32_t last_recovery_time_ms;     /**< Time from the last reset until the last replay completed. */
+    uint32_t last_error;                /**< First error code of the last replay, NRF_SUCCESS if all commands were restored. */
+} sd_rpc_state_replay_info_t;
+
+/**@brief Statistics of restarting advertising after a disconnection. */
+typedef struct
+{
+    uint32_t restart_count;             /**< Number of times advertising was restarted. */
+    uint32_t failed_count;              /**< Number of restarts rejected by the connectivity chip, i.e. when still advertising. */
+    uint32_t last_gap_us;               /**< Time from receiving the last disconnection until advertising was restarted. */
+    uint32_t max_gap_us;                /**< Longest time from receiving a disconnection until advertising was restarted. */
+    uint32_t mean_gap_us;               /**< Mean time from receiving a disconnection until advertising was restarted. */
+} sd_rpc_adv_restart_info_t;
+
+/**@brief Statistics of a failover group. */
+typedef struct
+{
+    uint8_t  failed_over;                   /**< 1 if the group has failed over to the standby adapter. */
+    uint32_t mirrored_command_count;        /**< Number of configuration commands sent to the standby adapter. */
+    uint32_t mirror_failed_count;           /**< Number of configuration commands the standby adapter rejected. */
+    uint32_t failover_count;                /**< Number of failovers performed. */
+    uint32_t last_failover_time_ms;         /**< Time from primary failure until advertising and scanning were started on the standby. */
+    uint32_t last_reconnect_time_ms;        /**< Time from primary failure until all peers were handled. */
+    uint32_t last_reconnect_count;          /**< Number of peers connected again from the standby. */
+    uint32_t last_reconnect_failed_count;   /**< Number of peers not connected again from the standby. */
+    uint32_t failback_count;                /**< Number of times advertising and scanning were moved back to the primary adapter. */
+} sd_rpc_failover_info_t;
+
+/**@brief Maximum length of a value written by the provisioner, the default ATT MTU minus the write request header. */
+#define SD_RPC_PROVISION_VALUE_MAX_LEN 20
+
+/**@brief Stages a device passes through when it is provisioned. */
+typedef enum
+{
+    SD_RPC_PROVISION_STAGE_SCAN,        /**< Scanning for the device. */
+    SD_RPC_PROVISION_STAGE_CONNECT,     /**< Connecting to the device. */
+    SD_RPC_PROVISION_STAGE_DISCOVER,    /**< Discovering the characteristics to write. */
+    SD_RPC_PROVISION_STAGE_WRITE,       /**< Writing the configuration. */
+    SD_RPC_PROVISION_STAGE_VERIFY,      /**< Reading back the configuration. */
+    SD_RPC_PROVISION_STAGE_DISCONNECT,  /**< Disconnecting from the device. */
+    SD_RPC_PROVISION_STAGE_COUNT
+} sd_rpc_provision_stage_t;
+
+/**@brief Parameters of a provisioner, shared by all adapters. */
+typedef struct
+{
+    ble_gap_scan_params_t scan_params;      /**< Parameters used when scanning for devices and connecting. */
+    ble_gap_conn_params_t conn_params;      /**< Connection parameters. */
+    uint8_t               max_connections;  /**< Maximum number of devices provisioned at the same time per adapter. */
+} sd_rpc_provision_params_t;
+
+/**@brief A characteristic value written to a device. */
+typedef struct
+{
+    ble_uuid_t     uuid;                    /**< UUID of the characteristic. Vendor specific UUID types must be the same on all adapters. */
+    uint8_t const *p_value;                 /**< Value to write, copied when the job is added. */
+    uint16_t       len;                     /**< Length of the value, at most @ref SD_RPC_PROVISION_VALUE_MAX_LEN. */
+} sd_rpc_provision_write_t;
+
+/**@brief A device to provision. */
+typedef struct
+{
+    ble_gap_addr_t                  peer_addr;      /**< Address of the device. */
+    sd_rpc_provision_write_t const *p_writes;       /**< Values to write, in order. */
+    uint8_t                         write_count;    /**< Number of values to write. */
+    uint8_t                         verify;         /**< 1 to read back and compare the values after they have been written. */
+    void                           *p_context;      /**< Application context, passed back in the result. */
+} sd_rpc_provision_job_t;
+
+/**@brief Result of a provisioning job. */
+typedef struct
+{
+    ble_gap_addr_t           peer_addr;                                 /**< Address of the device. */
+    void                    *p_context;                                 /**< Application context of the job. */
+    uint32_t                 result;                                    /**< NRF_SUCCESS if the device was provisioned. */
+    uint16_t                 gatt_status;                               /**< GATT status of the failed operation, see @ref BLE_GATT_STATUS_CODES. */
+    sd_rpc_provision_stage_t stage;                                     /**< Last stage the device was in. */
+    uint32_t                 stage_time_ms[SD_RPC_PROVISION_STAGE_COUNT]; /**< Time spent in each stage. */
+} sd_rpc_provision_result_t;
+
+/**@brief Latency statistics of a provisioning stage. */
+typedef struct
+{
+    uint32_t count;         /**< Number of devices that have completed the stage. */
+    uint32_t average_ms;    /**< Average time spent in the stage. */
+    uint32_t max_ms;        /**< Maximum time spent in the stage. */
+} sd_rpc_provision_stage_stats_t;
+
+/**@brief Statistics of a provisioner. */
+typedef struct
+{
+    uint32_t                       jobs_pending;        /**< Number of devices not found yet. */
+    uint32_t                       jobs_active;         /**< Number of devices being provisioned. */
+    uint32_t                       devices_completed;   /**< Number of devices provisioned. */
+    uint32_t                       devices_failed;      /**< Number of devices that failed. */
+    uint32_t                       devices_per_hour;    /**< Devices provisioned per hour since the provisioner was started. */
+    sd_rpc_provision_stage_stats_t stages[SD_RPC_PROVISION_STAGE_COUNT]; /**< Latency of each stage. */
+} sd_rpc_provision_stats_t;
+
+/**@brief Firmware image transferred with Secure DFU. */
+typedef struct
+{
+    uint8_t const *p_init_packet;       /**< Init packet (the .dat file of the DFU package), copied when the transfer is started. */
+    uint32_t       init_packet_len;     /**< Length of the init packet. */
+    uint8_t const *p_firmware;          /**< Firmware (the .bin file of the DFU package), copied when the transfer is started. */
+    uint32_t       firmware_len;        /**< Length of the firmware. */
+} sd_rpc_dfu_image_t;
+
+/**@brief Result of a Secure DFU transfer. */
+typedef struct
+{
+    uint16_t conn_handle;           /**< Connection handle of the DFU target. */
+    void    *p_context;             /**< Application context of the transfer. */
+    uint32_t result;                /**< NRF_SUCCESS if the firmware was transferred and activated. */
+    uint8_t  dfu_result;            /**< Result code reported by the DFU target for the failed operation, 0 if none. */
+    uint32_t resumed_offset;        /**< Firmware offset the transfer was resumed from. */
+    uint32_t bytes;                 /**< Number of firmware bytes transferred. */
+    uint32_t duration_ms;           /**< Duration of the firmware transfer. */
+    uint32_t bytes_per_second;      /**< Achieved firmware transfer rate. */
+    uint32_t crc_errors;            /**< Number of objects that had to be sent again. */
+} sd_rpc_dfu_result_t;
+
+/**@brief Progress of a Secure DFU transfer. */
+typedef struct
+{
+    uint32_t offset;                /**< Firmware bytes sent. */
+    uint32_t size;                  /**< Firmware size. */
+    uint32_t bytes_per_second;      /**< Current transfer rate. */
+    uint16_t prn;                   /**< Current packet receipt notification interval, 0 if disabled. */
+    uint32_t object_size;           /**< Current data object size. */
+    uint32_t crc_errors;            /**< Number of objects that had to be sent again. */
+} sd_rpc_dfu_progress_t;
+
+/**@brief Statistics of a DFU engine. */
+typedef struct
+{
+    uint32_t active_count;          /**< Number of transfers in progress. */
+    uint32_t completed_count;       /**< Number of transfers completed. */
+    uint32_t failed_count;          /**< Number of transfers failed. */
+    uint32_t bytes_per_second;      /**< Aggregate transfer rate of the transfers in progress. */
+} sd_rpc_dfu_stats_t;
+
+/**@brief Length of the fingerprint a GATT table is identified by. */
+#define SD_RPC_GATT_FINGERPRINT_LEN 16
+
+/**@brief Source of the fingerprint of a GATT table. */
+typedef enum
+{
+    SD_RPC_GATT_FINGERPRINT_NONE,           /**< The peer could not be fingerprinted, the table is not shared. */
+    SD_RPC_GATT_FINGERPRINT_DATABASE_HASH,  /**< Value of the Database Hash characteristic of the peer. */
+    SD_RPC_GATT_FINGERPRINT_PROBE           /**< Digest of the services returned by the first primary service discovery request. */
+} sd_rpc_gatt_fingerprint_type_t;
+
+/**@brief Parameters of a GATT cache. */
+typedef struct
+{
+    uint16_t max_tables;        /**< Tables kept when no connection uses them, least recently used are removed first. 0 for no limit. */
+    bool     probe_fallback;    /**< Fingerprint peers without a Database Hash characteristic by their first services. */
+} sd_rpc_gatt_cache_params_t;
+
+/**@brief Service of a GATT table. */
+typedef struct
+{
+    ble_gattc_service_t service;        /**< Service UUID and handle range. */
+    uint16_t            char_index;     /**< Index of the first characteristic of the service in @ref sd_rpc_gatt_table_t::p_chars. */
+    uint16_t            char_count;     /**< Number of characteristics of the service. */
+} sd_rpc_gatt_service_t;
+
+/**@brief Characteristic of a GATT table. */
+typedef struct
+{
+    ble_gattc_char_t characteristic;    /**< Characteristic UUID, properties and handles. */
+    uint16_t         desc_index;        /**< Index of the first descriptor of the characteristic in @ref sd_rpc_gatt_table_t::p_descs. */
+    uint16_t         desc_count;        /**< Number of descriptors of the characteristic. */
+} sd_rpc_gatt_char_t;
+
+/**@brief Discovered GATT table. Tables are immutable and shared by all connections to peers with the same fingerprint. */
+typedef struct
+{
+    sd_rpc_gatt_fingerprint_type_t fingerprint_type;                        /**< Source of the fingerprint. */
+    uint8_t                        fingerprint[SD_RPC_GATT_FINGERPRINT_LEN];  /**< Fingerprint the table is shared by. */
+    sd_rpc_gatt_service_t const   *p_services;                              /**< Primary services, in handle order. */
+    uint16_t                       service_count;                           /**< Number of services. */
+    sd_rpc_gatt_char_t const      *p_chars;                                 /**< Characteristics of all services, in handle order. */
+    uint16_t                       char_count;                              /**< Number of characteristics. */
+    ble_gattc_desc_t const        *p_descs;                                 /**< Descriptors of all characteristics, in handle order. */
+    uint16_t                       desc_count;                              /**< Number of descriptors. */
+} sd_rpc_gatt_table_t;
+
+/**@brief Statistics of a GATT cache. */
+typedef struct
+{
+    uint32_t table_count;           /**< Number of tables kept. */
+    uint32_t table_bytes;           /**< Memory used by the tables kept. */
+    uint32_t connection_count;      /**< Number of connections using a table. */
+    uint32_t hit_count;             /**< Connections resolved to a kept table by their fingerprint. */
+    uint32_t miss_count;            /**< Connections that needed a full discovery. */
+    uint32_t failed_count;          /**< Connections that could not be resolved. */
+    uint32_t mean_hit_time_ms;      /**< Mean time from connection until a kept table was found. */
+    uint32_t mean_miss_time_ms;     /**< Mean time from connection until the full discovery completed. */
+} sd_rpc_gatt_cache_stats_t;
+
+/**@brief Maximum number of operations in a prefetch policy. */
+#define SD_RPC_PREFETCH_OPS_MAX 16
+
+/**@brief Operations sent by the driver after a connection is established. */
+typedef enum
+{
+    SD_RPC_PREFETCH_OP_READ,        /**< Read a characteristic value. */
+    SD_RPC_PREFETCH_OP_CCCD_WRITE   /**< Write a Client Characteristic Configuration Descriptor with a write request. */
+} sd_rpc_prefetch_op_type_t;
+
+/**@brief Operation of a prefetch policy. */
+typedef struct
+{
+    sd_rpc_prefetch_op_type_t type;         /**< Operation type. */
+    uint16_t                  handle;       /**< Handle of the characteristic value or of the CCCD. */
+    uint16_t                  cccd_value;   /**< Value written to the CCCD, see @ref BLE_GATT_HVX_TYPES. */
+} sd_rpc_prefetch_op_t;
+
+/**@brief Statistics of the prefetch of an adapter. */
+typedef struct
+{
+    uint32_t connection_count;      /**< Connections a prefetch was started on. */
+    uint32_t op_count;              /**< Prefetch operations sent. */
+    uint32_t hit_count;             /**< Reads and CCCD writes of the application answered by a prefetch. */
+    uint32_t miss_count;            /**< Reads and CCCD writes of the application on prefetched connections not covered by the prefetch. */
+    uint32_t unused_count;          /**< Values prefetched but not asked for before the disconnection. */
+    uint32_t cancelled_count;       /**< Prefetch operations not sent because of a miss, an error or a disconnection. */
+    uint32_t learned_policy_count;  /**< Number of peers with a learned policy. */
+    uint32_t mean_saved_us;         /**< Mean time per hit from sending the prefetch until the application asked or the response arrived, whichever came first. */
+} sd_rpc_prefetch_stats_t;
+
+/**@brief Phases of a connection timeline, in the order they usually happen. */
+typedef enum
+{
+    SD_RPC_CONN_PHASE_ADV_REPORT,   /**< Last advertising report from the peer before connecting. */
+    SD_RPC_CONN_PHASE_CONNECT_CMD,  /**< @ref sd_ble_gap_connect sent. */
+    SD_RPC_CONN_PHASE_CONNECT_RSP,  /**< Response to @ref sd_ble_gap_connect received. */
+    SD_RPC_CONN_PHASE_CONNECTED,    /**< @ref BLE_GAP_EVT_CONNECTED received. */
+    SD_RPC_CONN_PHASE_SECURITY,     /**< Pairing completed, or the link encrypted with existing keys. */
+    SD_RPC_CONN_PHASE_MTU,          /**< ATT MTU exchanged. */
+    SD_RPC_CONN_PHASE_DATA_LENGTH,  /**< Data length updated. */
+    SD_RPC_CONN_PHASE_PHY,          /**< PHY updated. */
+    SD_RPC_CONN_PHASE_DISCOVERY,    /**< Last GATT discovery response. */
+    SD_RPC_CONN_PHASE_FIRST_DATA,   /**< First attribute value sent or received. */
+    SD_RPC_CONN_PHASE_COUNT         /**< Number of phases. */
+} sd_rpc_conn_phase_t;
+
+/**@brief Time of a phase that has not been reached. */
+#define SD_RPC_CONN_PHASE_NOT_REACHED 0xFFFFFFFF
+
+/**@brief Outcome of a connection attempt. */
+typedef enum
+{
+    SD_RPC_CONN_OUTCOME_ACTIVE,         /**< Connecting or connected. */
+    SD_RPC_CONN_OUTCOME_DISCONNECTED,   /**< Connected and disconnected later. */
+    SD_RPC_CONN_OUTCOME_FAILED,         /**< @ref sd_ble_gap_connect returned an error. */
+    SD_RPC_CONN_OUTCOME_TIMEOUT,        /**< The connection was not established in time. */
+    SD_RPC_CONN_OUTCOME_CANCELLED,      /**< The attempt was cancelled by @ref sd_ble_gap_connect_cancel. */
+    SD_RPC_CONN_OUTCOME_RESET           /**< The connectivity chip was reset. */
+} sd_rpc_conn_outcome_t;
+
+/**@brief Configuration of the connection timelines. */
+typedef struct
+{
+    uint32_t max_timelines;         /**< Number of finished timelines kept, the oldest is dropped when full. */
+} sd_rpc_conn_timeline_params_t;
+
+/**@brief Timeline of a connection attempt. */
+typedef struct
+{
+    ble_gap_addr_t peer_addr;       /**< Address of the peer, all zero if connecting to the whitelist and not connected yet. */
+    uint16_t conn_handle;           /**< Connection handle, @ref BLE_CONN_HANDLE_INVALID if not connected. */
+    uint8_t  role;                  /**< BLE role of this device on the connection, see @ref BLE_GAP_ROLES. */
+    uint8_t  outcome;               /**< @ref sd_rpc_conn_outcome_t of the attempt. */
+    uint64_t start_ms;              /**< Time of the first phase, in milliseconds since 1970-01-01 UTC. */
+    uint32_t phase_us[SD_RPC_CONN_PHASE_COUNT]; /**< Time of each phase from the first phase in microseconds, @ref SD_RPC_CONN_PHASE_NOT_REACHED if not reached. */
+} sd_rpc_conn_timeline_t;
+
+/**@brief Distribution of the durations of a phase over all connections. */
+typedef struct
+{
+    uint32_t count;                 /**< Number of connections that reached the phase. */
+    uint32_t min_us;                /**< Shortest duration. */
+    uint32_t p50_us;                /**< Median duration. */
+    uint32_t p90_us;                /**< 90th percentile. */
+    uint32_t p99_us;                /**< 99th percentile. */
+    uint32_t max_us;                /**< Longest duration. */
+} sd_rpc_conn_phase_stats_t;
+
+/**@brief Statistics of the connection timelines, percentiles are within 7 %. */
+typedef struct
+{
+    uint32_t attempt_count;         /**< Number of finished attempts. */
+    uint32_t connected_count;       /**< Number of finished attempts that connected. */
+    sd_rpc_conn_phase_stats_t phase[SD_RPC_CONN_PHASE_COUNT];   /**< Time from the phase reached before to each phase. */
+    sd_rpc_conn_phase_stats_t elapsed[SD_RPC_CONN_PHASE_COUNT]; /**< Time from the first phase to each phase. */
+} sd_rpc_conn_timeline_stats_t;
+
+/**@brief Configuration of the pool of user memory blocks lent to the SoftDevice for queued writes. */
+typedef struct
+{
+    uint16_t block_size;            /**< Size of each block in bytes, it must hold the queued writes of a connection. */
+    uint16_t block_count;           /**< Number of blocks, a connection holds at most one block at a time. */
+} sd_rpc_user_mem_pool_params_t;
+
+/**@brief Statistics of the user memory pool. */
+typedef struct
+{
+    uint16_t block_size;            /**< Size of each block in bytes. */
+    uint16_t block_count;           /**< Number of blocks. */
+    uint16_t in_use_count;          /**< Blocks lent to the SoftDevice now. */
+    uint16_t peak_in_use_count;     /**< Most blocks lent at the same time. */
+    uint32_t request_count;         /**< User memory requests for queued writes received. */
+    uint32_t answered_count;        /**< Requests answered with a block of the pool. */
+    uint32_t exhausted_count;       /**< Requests passed to the event handler because no block was free. */
+    uint32_t failed_count;          /**< Requests passed to the event handler because the reply failed. */
+    uint32_t release_count;         /**< Blocks returned by the SoftDevice. */
+    uint32_t mean_reply_us;         /**< Mean time from receiving a request until the reply was accepted. */
+} sd_rpc_user_mem_pool_stats_t;
+
+/**@brief Registration of a notification sink for a characteristic value of a connection. */
+typedef struct
+{
+    uint16_t conn_handle;           /**< Connection handle. */
+    uint16_t value_handle;          /**< Handle of the characteristic value notified or indicated. */
+    uint32_t chunk_size;            /**< Size of each buffer chunk in bytes. */
+    uint32_t max_chunks;            /**< Chunks buffered before samples are dropped, 0 for no limit. */
+    bool     forward_events;        /**< Also pass the notifications to the event handler. */
+} sd_rpc_notification_sink_params_t;
+
+/**@brief Header of a sample in a notification sink chunk, followed by the value and padding to 8 bytes. */
+typedef struct
+{
+    uint64_t timestamp_us;          /**< Time the notification was received, in microseconds since 1970-01-01 UTC. */
+    uint16_t len;                   /**< Length of the value. */
+    uint8_t  type;                  /**< BLE_GATT_HVX_NOTIFICATION or BLE_GATT_HVX_INDICATION. */
+    uint8_t  reserved[5];
+} sd_rpc_notification_sample_t;
+
+/**@brief Size of a sample in a notification sink chunk, including header and padding. */
+#define SD_RPC_NOTIFICATION_SAMPLE_SIZE(len) (sizeof(sd_rpc_notification_sample_t) + (((len) + 7) & ~7u))
+
+/**@brief Chunk of samples appended by a notification sink. */
+typedef struct
+{
+    uint8_t *p_data;                /**< Samples, one after another. */
+    uint32_t len;                   /**< Number of bytes used by samples. */
+    uint32_t size;                  /**< Size of the chunk. */
+    uint32_t sample_count;          /**< Number of samples in the chunk. */
+} sd_rpc_notification_chunk_t;
+
+/**@brief Configuration of counting distinct advertising devices. */
+typedef struct
+{
+    uint32_t window_ms;             /**< Length of a counting window, windows are aligned to the system clock. */
+    uint8_t  precision;             /**< Base two logarithm of the registers per window, from 4 to 16. The standard error is 1.04 / sqrt(2^precision). */
+    uint8_t  window_history;        /**< Number of completed windows kept. */
+    bool     suppress_adv_reports;  /**< Do not pass advertising reports to the event handler. */
+} sd_rpc_device_counter_params_t;
+
+/**@brief Estimated number of distinct advertising devices in a window. */
+typedef struct
+{
+    uint64_t window_start_ms;       /**< Start of the window, in milliseconds since 1970-01-01 UTC. */
+    uint32_t report_count;          /**< Number of advertising reports in the window. */
+    uint32_t device_count;          /**< Estimated number of distinct devices in the window. */
+} sd_rpc_device_count_t;
+
+/**@brief Configuration of the presence table of advertising devices. */
+typedef struct
+{
+    uint32_t timeout_ms;            /**< Time without advertising reports before a device has left. */
+    uint32_t snapshot_interval_ms;  /**< Interval between snapshots of the table, 0 to publish a snapshot when the presence changes, at most every 10 ms. */
+    uint32_t initial_capacity;      /**< Number of devices the table is sized for initially, it grows as needed. */
+    uint8_t  rssi_smoothing;        /**< Weight of a new RSSI value is 1 / 2^rssi_smoothing, 0 for no smoothing, at most 15. */
+    bool     suppress_adv_reports;  /**< Do not pass advertising reports to the event handler. */
+} sd_rpc_presence_params_t;
+
+/**@brief A device in the presence table. */
+typedef struct
+{
+    ble_gap_addr_t peer_addr;       /**< Address of the device, the identity address if resolved. */
+    int8_t   rssi;                  /**< Smoothed RSSI in dBm. */
+    uint64_t last_seen_ms;          /**< Time of the last advertising report, in milliseconds since 1970-01-01 UTC. */
+    uint32_t report_count;          /**< Number of advertising reports since the device entered. */
+    uint32_t payload_hash;          /**< Hash of the last advertising data, scan responses excluded. */
+} sd_rpc_presence_entry_t;
+
+/**@brief Value to notify or indicate to all connections that have enabled it. */
+typedef struct
+{
+    uint16_t handle;                /**< Characteristic value handle. */
+    uint8_t  type;                  /**< BLE_GATT_HVX_NOTIFICATION or BLE_GATT_HVX_INDICATION. */
+    uint16_t len;                   /**< Length of the value. */
+    uint8_t const *p_data;          /**< The value. */
+} sd_rpc_hvx_broadcast_params_t;
+
+/**@brief Result of a broadcast value for one connection. */
+typedef struct
+{
+    uint16_t conn_handle;           /**< Connection handle. */
+    uint32_t err_code;              /**< Result of @ref sd_ble_gatts_hvx for the connection. */
+} sd_rpc_hvx_delivery_t;
+
+/**@brief Configuration of the per peer statistics table. */
+typedef struct
+{
+    uint32_t max_peers;             /**< Number of peers kept, the peer connected least recently is replaced when full. */
+    const char *file_path;          /**< File the table is mapped to, created if it does not exist. NULL to keep the table in memory only. */
+} sd_rpc_peer_stats_params_t;
+
+/**@brief Statistics of a peer over all its connections. */
+typedef struct
+{
+    ble_gap_addr_t peer_addr;       /**< Address of the peer, the identity address if resolved. */
+    uint64_t first_connected_ms;    /**< Time of the first connection, in milliseconds since 1970-01-01 UTC. */
+    uint64_t last_connected_ms;     /**< Time of the last connection, in milliseconds since 1970-01-01 UTC. */
+    uint64_t bytes_rx;              /**< Attribute value bytes received, notifications, indications, read responses and writes. */
+    uint64_t bytes_tx;              /**< Attribute value bytes sent, notifications, indications and writes. */
+    uint32_t connection_count;      /**< Number of connections. */
+    uint32_t link_loss_count;       /**< Number of disconnections by supervision timeout. */
+    uint32_t pairing_count;         /**< Number of successful pairings. */
+    uint32_t pairing_failed_count;  /**< Number of failed pairings. */
+    uint32_t discovery_time_ms;     /**< Mean time from connecting until the last GATT discovery response of a connection. */
+    int8_t   rssi;                  /**< Mean RSSI of RSSI changed events and advertising reports, 0 if none. */
+} sd_rpc_peer_stats_t;
+
+/**@brief Sockets the event bridge accepts subscribers on. */
+typedef enum
+{
+    SD_RPC_EVENT_BRIDGE_TCP,        /**< TCP socket. */
+    SD_RPC_EVENT_BRIDGE_UNIX        /**< Unix domain socket, not supported on Windows. */
+} sd_rpc_event_bridge_socket_t;
+
+/**@brief Configuration of the event bridge. */
+typedef struct
+{
+    sd_rpc_event_bridge_socket_t socket; /**< Socket type to listen on. */
+    const char *address;            /**< IP address to listen on for TCP, path of the socket for Unix domain sockets. */
+    uint16_t port;                  /**< TCP port to listen on, 0 to let the operating system pick a free port. */
+    uint16_t max_subscribers;       /**< Number of subscribers accepted at the same time. */
+    uint16_t batch_size;            /**< Number of events after which a batch is sent. */
+    uint16_t batch_delay_ms;        /**< Time an event is held at most before its batch is sent. */
+    uint16_t queue_size;            /**< Batches queued per subscriber without credit, the oldest batch is dropped when full. */
+} sd_rpc_event_bridge_params_t;
+
+/**@brief Statistics of the event bridge. */
+typedef struct
+{
+    uint16_t port;                  /**< TCP port the bridge listens on. */
+    uint16_t subscriber_count;      /**< Number of connected subscribers. */
+    uint64_t events_sent;           /**< Events sent, counted once per subscriber. */
+    uint64_t events_dropped;        /**< Events dropped because a subscriber had no credit, counted once per subscriber. */
+    uint64_t batches_sent;          /**< Batches sent to all subscribers. */
+    uint64_t bytes_sent;            /**< Bytes sent to all subscribers. */
+} sd_rpc_event_bridge_info_t;
+
 /**@brief Function pointer type for event callbacks.
 */
 typedef void(*sd_rpc_status_handler_t)(adapter_t *adapter, sd_rpc_app_status_t code, const char * message);
 typedef void(*sd_rpc_evt_handler_t)(adapter_t *adapter, ble_evt_t * p_ble_evt);
 typedef void(*sd_rpc_log_handler_t)(adapter_t *adapter, sd_rpc_log_severity_t severity, const char * log_message);
+typedef void(*sd_rpc_dfu_result_handler_t)(dfu_engine_t *engine, adapter_t *adapter, const sd_rpc_dfu_result_t *p_result);
+typedef void(*sd_rpc_presence_handler_t)(adapter_t *adapter, const sd_rpc_presence_entry_t *p_entry, bool present);
+typedef void(*sd_rpc_provision_result_handler_t)(provisioner_t *provisioner, adapter_t *adapter, const sd_rpc_provision_result_t *p_result);
+typedef void(*sd_rpc_gatt_table_handler_t)(gatt_cache_t *cache, adapter_t *adapter, uint16_t conn_handle, const sd_rpc_gatt_table_t *p_table, uint32_t result);
 
 #ifdef __cplusplus
 }
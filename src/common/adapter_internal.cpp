@@ -41,19 +41,45 @@
 #include "nrf_error.h"
 #include "serialization_transport.h"
 
+#if NRF_SD_BLE_API_VERSION < 4
+#include "ble_common.h"
+#include "ble_serialization.h"
+#include "ble_struct_serialization.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <string>
 
+// Time to wait for the link to be ready again after a reset before an interrupted command is given up
+const auto LINK_RESYNC_TIMEOUT = std::chrono::milliseconds(10000);
+
 AdapterInternal::AdapterInternal(SerializationTransport *_transport): 
+    prefetcher(std::make_shared<Prefetcher>(_transport, std::bind(&AdapterInternal::logHandler, this, std::placeholders::_1, std::placeholders::_2))),
+    presenceTable(std::make_shared<PresenceTable>()),
+    stateJournal(std::make_shared<StateJournal>(_transport, std::bind(&AdapterInternal::statusHandler, this, std::placeholders::_1, std::placeholders::_2))),
+    advRestarter(std::make_shared<AdvRestarter>(_transport, std::bind(&AdapterInternal::logHandler, this, std::placeholders::_1, std::placeholders::_2))),
+    userMemPool(std::make_shared<UserMemPool>(_transport, std::bind(&AdapterInternal::logHandler, this, std::placeholders::_1, std::placeholders::_2))),
     eventCallback(nullptr),
     statusCallback(nullptr),
     logCallback(nullptr),
-    logSeverityFilter(SD_RPC_LOG_TRACE)
+    logSeverityFilter(SD_RPC_LOG_TRACE),
+    linkGeneration(0),
+    linkReady(false),
+    linkClosed(false)
 {
     this->transport = _transport;
 }
                         
 AdapterInternal::~AdapterInternal()
 {
+    failoverGroupRemove();
+    stateJournal->stop();
+    advRestarter->stop();
+    prefetcher->stop();
+    userMemPool->stop();
+    presenceTable->stop();
     delete transport;
 }
 
@@ -63,19 +89,84 @@ uint32_t AdapterInternal::open(const sd_rpc_status_handler_t status_callback, co
     eventCallback = event_callback;
     logCallback = log_callback;
 
+    {
+        std::lock_guard<std::mutex> lock(linkMutex);
+        linkClosed = false;
+    }
+
     auto boundStatusHandler = std::bind(&AdapterInternal::statusHandler, this, std::placeholders::_1, std::placeholders::_2);
     auto boundEventHandler = std::bind(&AdapterInternal::eventHandler, this, std::placeholders::_1);
     auto boundLogHandler = std::bind(&AdapterInternal::logHandler, this, std::placeholders::_1, std::placeholders::_2);
-    return transport->open(boundStatusHandler, boundEventHandler, boundLogHandler);
+    auto eventPeekHandler = [this](const uint8_t *event, const uint32_t length) {
+        advRestarter->eventPeek(event, length);
+        userMemPool->eventPeek(event, length);
+        eventBridge.framePeek(event, length);
+    };
+    return transport->open(boundStatusHandler, boundEventHandler, boundLogHandler, eventPeekHandler);
 }
 
-uint32_t AdapterInternal::close() const
+uint32_t AdapterInternal::close()
 {
+    {
+        std::lock_guard<std::mutex> lock(linkMutex);
+        linkReady = false;
+        linkClosed = true;
+        linkWaitCondition.notify_all();
+    }
+
+    stateJournal->stop();
+    stateJournal->clear();
+    advRestarter->stop();
+    prefetcher->stop();
+    prefetcher->clear();
+    userMemPool->stop();
+    userMemPool->clear();
     return transport->close();
 }
 
 void AdapterInternal::statusHandler(sd_rpc_app_status_t code, const char * message)
 {
+    if (code == RESET_PERFORMED)
+    {
+        connStateTracker.clear();
+        connTimeline.clear();
+        peerStats.clear();
+        subscriptionTracker.clear();
+        notificationSink.connectionsLost();
+        prefetcher->clear();
+        userMemPool->clear();
+        advRestarter->clear();
+    }
+
+    stateJournal->statusProcess(code);
+
+    {
+        std::lock_guard<std::mutex> lock(linkMutex);
+
+        if (code == RESET_PERFORMED)
+        {
+            if (linkReady)
+            {
+                linkGeneration++;
+            }
+
+            linkReady = false;
+        }
+        else if ((code == CONNECTION_ACTIVE && !stateJournal->restorePendingGet())
+            || code == STATE_REPLAY_COMPLETED || code == STATE_REPLAY_FAILED)
+        {
+            linkReady = true;
+            linkWaitCondition.notify_all();
+        }
+    }
+
+    auto group = std::atomic_load(&failoverGroup);
+
+    if (group)
+    {
+        group->statusProcess(this, code);
+    }
+
     adapter_t adapter;
     adapter.internal = static_cast<void *>(this);
     statusCallback(&adapter, code, message);
@@ -84,8 +175,58 @@ void AdapterInternal::statusHandler(sd_rpc_app_status_t code, const char * messa
 void AdapterInternal::eventHandler(ble_evt_t *event)
 {
     // Event Thread
+    connStateTracker.process(event);
+    subscriptionTracker.process(event, *userMemPool);
+
+    // Started first so that the prefetch is sent while the other consumers handle the connection
+    const auto prefetched = prefetcher->process(event);
+
+    // Requests answered and blocks released by the pool are not the application's to handle
+    const auto pooled = userMemPool->process(event);
+
+    peerStats.process(event);
+    connTimeline.process(event);
+    stateJournal->process(event);
+    advRestarter->process(event);
+
+    auto group = std::atomic_load(&failoverGroup);
+
+    if (group)
+    {
+        group->eventProcess(this, event);
+    }
+
+    std::vector<std::shared_ptr<EventObserver>> currentObservers;
+
+    {
+        std::lock_guard<std::mutex> lock(observerMutex);
+        currentObservers = observers;
+    }
+
+    for (auto &observer : currentObservers)
+    {
+        observer->eventProcess(this, event);
+    }
+
+    eventBridge.process(event);
+
     adapter_t adapter;
     adapter.internal = static_cast<void *>(this);
+
+    // Advertising reports are passed to all scan consumers, any of them may keep the report from the application
+    auto suppress = deviceCounter.process(event);
+    suppress = presenceTable->process(&adapter, event) || suppress;
+
+    if (suppress || prefetched || pooled)
+    {
+        return;
+    }
+
+    if (notificationSink.process(event))
+    {
+        return;
+    }
+
     eventCallback(&adapter, event);
 }
 
@@ -100,6 +241,140 @@ void AdapterInternal::logHandler(sd_rpc_log_severity_t severity, std::string log
     }
 }
 
+void AdapterInternal::commandHandler(const uint8_t *command, const uint32_t length)
+{
+    connCountSet(command, length);
+
+    const auto configuration = stateJournal->record(command, length);
+    advRestarter->commandProcess(command, length);
+
+    auto group = std::atomic_load(&failoverGroup);
+
+    if (group)
+    {
+        group->commandProcess(this, command, length, configuration);
+    }
+}
+
+uint32_t AdapterInternal::stateReplayEnable(const bool enable)
+{
+    auto group = std::atomic_load(&failoverGroup);
+
+    // The failover group fails back when the replay of the primary has completed
+    if (!enable && group && group->primaryGet() == this)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    return stateJournal->replayEnable(enable);
+}
+
+uint32_t AdapterInternal::failoverStandbySet(AdapterInternal *standby)
+{
+    if (standby == this)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    auto current = std::atomic_load(&failoverGroup);
+
+    if (current && current->primaryGet() != this)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (standby != nullptr && (std::atomic_load(&standby->failoverGroup) || !stateJournal->replayEnabledGet()))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    failoverGroupRemove();
+
+    if (standby == nullptr)
+    {
+        return NRF_SUCCESS;
+    }
+
+    auto group = std::make_shared<FailoverGroup>(this, standby);
+    std::atomic_store(&failoverGroup, group);
+    std::atomic_store(&standby->failoverGroup, group);
+    group->start();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t AdapterInternal::failoverInfoGet(sd_rpc_failover_info_t *info) const
+{
+    auto group = std::atomic_load(&failoverGroup);
+
+    if (!group || group->primaryGet() != this)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    return group->infoGet(info);
+}
+
+void AdapterInternal::observerAdd(std::shared_ptr<EventObserver> observer)
+{
+    std::lock_guard<std::mutex> lock(observerMutex);
+    observers.push_back(observer);
+}
+
+void AdapterInternal::observerRemove(const EventObserver *observer)
+{
+    std::lock_guard<std::mutex> lock(observerMutex);
+
+    observers.erase(std::remove_if(observers.begin(), observers.end(), [observer](const std::shared_ptr<EventObserver> &other) {
+        return other.get() == observer;
+    }), observers.end());
+}
+
+void AdapterInternal::failoverGroupRemove()
+{
+    auto group = std::atomic_load(&failoverGroup);
+
+    if (!group)
+    {
+        return;
+    }
+
+    group->stop();
+    std::atomic_store(&group->primaryGet()->failoverGroup, std::shared_ptr<FailoverGroup>());
+    std::atomic_store(&group->standbyGet()->failoverGroup, std::shared_ptr<FailoverGroup>());
+}
+
+void AdapterInternal::connCountSet(const uint8_t *command, const uint32_t length)
+{
+#if NRF_SD_BLE_API_VERSION < 4
+    // Taken from the encoded command so that it is done for commands sent on behalf of the
+    // application as well, i.e. the configuration mirrored to a standby adapter
+    if (length < 2 || command[0] != SD_BLE_ENABLE || command[1] != SER_FIELD_PRESENT)
+    {
+        return;
+    }
+
+    ble_enable_params_t params;
+    ble_conn_bw_counts_t connBwCounts;
+    std::memset(&params, 0, sizeof(params));
+    params.common_enable_params.p_conn_bw_counts = &connBwCounts;
+
+    uint32_t index = 2;
+
+    if (ble_enable_params_t_dec(command, length, &index, &params) != NRF_SUCCESS)
+    {
+        return;
+    }
+
+    BLESecurityContext context(transport);
+    app_ble_gap_sec_context_conn_count_set(
+        params.gap_enable_params.periph_conn_count + params.gap_enable_params.central_conn_count);
+#else
+    (void)command;
+    (void)length;
+#endif
+}
+
 bool AdapterInternal::isInternalError(const uint32_t error_code) {
     if (error_code != NRF_SUCCESS) {
         return true;
@@ -113,6 +388,29 @@ bool AdapterInternal::isInternalError(const uint32_t error_code) {
 uint32_t AdapterInternal::logSeverityFilterSet(sd_rpc_log_severity_t severity_filter)
 {
     logSeverityFilter = severity_filter;
+    transport->logSeverityFilterSet(severity_filter);
     return NRF_SUCCESS;
 }
 
+bool AdapterInternal::linkReadyGet(uint32_t *generation)
+{
+    std::lock_guard<std::mutex> lock(linkMutex);
+    *generation = linkGeneration;
+    return linkReady;
+}
+
+bool AdapterInternal::linkResyncWait(uint32_t *generation)
+{
+    std::unique_lock<std::mutex> lock(linkMutex);
+
+    // The command failed for another reason than a reset of the link
+    if (linkGeneration == *generation && linkReady)
+    {
+        return false;
+    }
+
+    linkWaitCondition.wait_for(lock, LINK_RESYNC_TIMEOUT, [&] { return linkReady || linkClosed; });
+    *generation = linkGeneration;
+
+    return linkReady;
+}
@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "adv_restarter.h"
+
+#include "serialization_transport.h"
+
+#include "ble_serialization.h"
+#include "nrf_error.h"
+#include "ser_config.h"
+
+#include <sstream>
+
+namespace {
+    // Offset of the role in an encoded connected event, after the peer address and, in v2, the own address
+#if NRF_SD_BLE_API_VERSION < 4
+    const uint32_t CONNECTED_ROLE_POS = SER_EVT_HEADER_SIZE + SER_EVT_CONN_HANDLE_SIZE + 7 + 7;
+#else
+    const uint32_t CONNECTED_ROLE_POS = SER_EVT_HEADER_SIZE + SER_EVT_CONN_HANDLE_SIZE + 7;
+#endif
+}
+
+AdvRestarter::AdvRestarter(SerializationTransport *_transport, log_cb_t log_callback)
+    : transport(_transport), logCallback(log_callback), restartEnabled(false),
+    advertising(false), advConnHandle(BLE_CONN_HANDLE_INVALID), runRestartThread(false),
+    restartPending(false), totalGapUs(0)
+{
+    info.restart_count = 0;
+    info.failed_count = 0;
+    info.last_gap_us = 0;
+    info.max_gap_us = 0;
+    info.mean_gap_us = 0;
+}
+
+AdvRestarter::~AdvRestarter()
+{
+    stop();
+}
+
+void AdvRestarter::commandProcess(const uint8_t *command, const uint32_t length)
+{
+    if (command == nullptr || length == 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(restartMutex);
+
+    if (command[0] == SD_BLE_GAP_ADV_START)
+    {
+        advStartCommand.assign(command, command + length);
+        advertising = true;
+    }
+    else if (command[0] == SD_BLE_GAP_ADV_STOP)
+    {
+        advStartCommand.clear();
+        advertising = false;
+    }
+}
+
+void AdvRestarter::eventPeek(const uint8_t *event, const uint32_t length)
+{
+    // Read Thread
+    if (length < SER_EVT_HEADER_SIZE)
+    {
+        return;
+    }
+
+    const auto eventId = static_cast<uint16_t>(event[SER_EVT_ID_POS] | (event[SER_EVT_ID_POS + 1] << 8));
+
+    if ((eventId != BLE_GAP_EVT_CONNECTED && eventId != BLE_GAP_EVT_DISCONNECTED)
+        || length < SER_EVT_HEADER_SIZE + SER_EVT_CONN_HANDLE_SIZE)
+    {
+        return;
+    }
+
+    const auto connHandle = static_cast<uint16_t>(event[SER_EVT_HEADER_SIZE] | (event[SER_EVT_HEADER_SIZE + 1] << 8));
+
+    std::lock_guard<std::mutex> lock(restartMutex);
+
+    if (eventId == BLE_GAP_EVT_CONNECTED)
+    {
+        // Only a central connecting to the advertising stops it, connections as central do not
+        if (length > CONNECTED_ROLE_POS && event[CONNECTED_ROLE_POS] == BLE_GAP_ROLE_PERIPH && advertising)
+        {
+            advertising = false;
+            advConnHandle = connHandle;
+        }
+
+        return;
+    }
+
+    if (connHandle != advConnHandle)
+    {
+        return;
+    }
+
+    advConnHandle = BLE_CONN_HANDLE_INVALID;
+
+    if (!restartEnabled || advStartCommand.empty() || advertising)
+    {
+        return;
+    }
+
+    // Commands can not be sent from the transport threads, restart from a separate thread
+    if (!restartThread.runningGet())
+    {
+        runRestartThread = true;
+        restartThread.start(shared_from_this(), &AdvRestarter::restartRunner);
+    }
+
+    if (!restartPending)
+    {
+        restartPending = true;
+        disconnectTime = std::chrono::steady_clock::now();
+    }
+
+    restartWaitCondition.notify_one();
+}
+
+void AdvRestarter::process(const ble_evt_t *event)
+{
+    if (event->header.evt_id == BLE_GAP_EVT_TIMEOUT
+        && event->evt.gap_evt.params.timeout.src == BLE_GAP_TIMEOUT_SRC_ADVERTISING)
+    {
+        std::lock_guard<std::mutex> lock(restartMutex);
+        advStartCommand.clear();
+        advertising = false;
+    }
+}
+
+void AdvRestarter::clear()
+{
+    std::lock_guard<std::mutex> lock(restartMutex);
+    advertising = false;
+    advConnHandle = BLE_CONN_HANDLE_INVALID;
+    restartPending = false;
+}
+
+void AdvRestarter::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(restartMutex);
+        runRestartThread = false;
+        restartPending = false;
+        advStartCommand.clear();
+        advertising = false;
+        advConnHandle = BLE_CONN_HANDLE_INVALID;
+        restartWaitCondition.notify_one();
+    }
+
+    // Stopped from a log callback issued by the restart thread itself the thread is detached,
+    // it keeps the restarter alive until it has returned
+    restartThread.stop();
+}
+
+uint32_t AdvRestarter::enable(const bool enable)
+{
+    std::lock_guard<std::mutex> lock(restartMutex);
+    restartEnabled = enable;
+
+    if (!enable)
+    {
+        restartPending = false;
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t AdvRestarter::infoGet(sd_rpc_adv_restart_info_t *_info) const
+{
+    if (_info == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(restartMutex);
+    *_info = info;
+    return NRF_SUCCESS;
+}
+
+// Restart Thread
+void AdvRestarter::restartRunner()
+{
+    std::unique_lock<std::mutex> lock(restartMutex);
+
+    while (runRestartThread && restartThread.isCurrent())
+    {
+        if (!restartPending)
+        {
+            restartWaitCondition.wait(lock);
+            continue;
+        }
+
+        restartPending = false;
+
+        // Stopped, or started again by the application in the meantime
+        if (advStartCommand.empty() || advertising)
+        {
+            continue;
+        }
+
+        const auto command = advStartCommand;
+        const auto disconnected = disconnectTime;
+        lock.unlock();
+
+        restart(command, disconnected);
+
+        lock.lock();
+    }
+}
+
+void AdvRestarter::restart(const std::vector<uint8_t> &command, const std::chrono::steady_clock::time_point &disconnected)
+{
+    auto buffer = command;
+    std::vector<uint8_t> response(SER_HAL_TRANSPORT_MAX_PKT_SIZE);
+    uint32_t responseLength = 0;
+
+    auto errCode = transport->send(buffer.data(), static_cast<uint32_t>(buffer.size()), response.data(), &responseLength);
+    const auto restarted = std::chrono::steady_clock::now();
+
+    uint32_t resultCode = NRF_ERROR_INTERNAL;
+
+    if (errCode == NRF_SUCCESS)
+    {
+        uint32_t index = 0;
+        errCode = ser_ble_cmd_rsp_result_code_dec(response.data(), &index, responseLength, command[0], &resultCode);
+
+        if (errCode != NRF_SUCCESS)
+        {
+            resultCode = NRF_ERROR_INTERNAL;
+        }
+    }
+
+    std::stringstream message;
+
+    {
+        std::lock_guard<std::mutex> lock(restartMutex);
+
+        if (resultCode != NRF_SUCCESS)
+        {
+            info.failed_count++;
+            message << "Advertising not restarted after disconnect, error code " << resultCode;
+        }
+        else
+        {
+            const auto gap = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                restarted - disconnected).count());
+
+            info.restart_count++;
+            info.last_gap_us = gap;
+
+            if (gap > info.max_gap_us)
+            {
+                info.max_gap_us = gap;
+            }
+
+            totalGapUs += gap;
+            info.mean_gap_us = static_cast<uint32_t>(totalGapUs / info.restart_count);
+            advertising = true;
+
+            message << "Advertising restarted " << gap << " us after disconnect";
+        }
+    }
+
+    logCallback(resultCode == NRF_SUCCESS ? SD_RPC_LOG_INFO : SD_RPC_LOG_WARNING, message.str());
+}
@@ -44,19 +44,25 @@
 #include "nrf_error.h"
 #include "ser_config.h"
 
+// Number of times an idempotent command is sent again after the link has been resynchronized
+const uint32_t COMMAND_RESUBMISSIONS = 2;
+
 uint32_t encode_decode(adapter_t *adapter, encode_function_t encode_function, decode_function_t decode_function)
 {
-    uint32_t tx_buffer_length = SER_HAL_TRANSPORT_MAX_PKT_SIZE;
     uint32_t rx_buffer_length = 0;
 
-    std::unique_ptr<uint8_t> tx_buffer(static_cast<uint8_t*>(std::malloc(SER_HAL_TRANSPORT_MAX_PKT_SIZE)));
     std::unique_ptr<uint8_t> rx_buffer(static_cast<uint8_t*>(std::malloc(SER_HAL_TRANSPORT_MAX_PKT_SIZE)));
 
     std::stringstream error_message;
 
     auto _adapter = static_cast<AdapterInternal*>(adapter->internal);
 
-    uint32_t err_code = encode_function(tx_buffer.get(), &tx_buffer_length);
+    // The command is encoded into a frame with room for the transport headers, so that it is not
+    // copied again until it is SLIP encoded into the output buffer of the UART
+    auto tx_frame = _adapter->transport->frameAcquire();
+    auto tx_buffer_length = static_cast<uint32_t>(tx_frame->payloadCapacity());
+
+    uint32_t err_code = encode_function(tx_frame->payload(), &tx_buffer_length);
 
     if (_adapter->isInternalError(err_code))
     {
@@ -65,21 +71,25 @@ uint32_t encode_decode(adapter_t *adapter, encode_function_t encode_function, de
         return NRF_ERROR_INTERNAL;
     }
 
-    if (decode_function != nullptr)
-    {
-        err_code = _adapter->transport->send(
-            tx_buffer.get(),
-            tx_buffer_length,
-            rx_buffer.get(),
-            &rx_buffer_length);
-    }
-    else
+    // Commands without side effects are sent again when the link is resynchronized while they are in
+    // flight, other commands fail as soon as the link is reset.
+    uint32_t link_generation = 0;
+    tx_frame->reset(tx_buffer_length);
+    auto resubmissions = ble_command_idempotent(tx_frame->payload()[0]) && _adapter->linkReadyGet(&link_generation) ? COMMAND_RESUBMISSIONS : 0;
+
+    while (true)
     {
         err_code = _adapter->transport->send(
-            tx_buffer.get(),
-            tx_buffer_length,
-            nullptr,
+            *tx_frame,
+            decode_function != nullptr ? rx_buffer.get() : nullptr,
             &rx_buffer_length);
+
+        if (err_code == NRF_SUCCESS || resubmissions == 0 || !_adapter->linkResyncWait(&link_generation))
+        {
+            break;
+        }
+
+        resubmissions--;
     }
 
     if (_adapter->isInternalError(err_code))
@@ -103,5 +113,37 @@ uint32_t encode_decode(adapter_t *adapter, encode_function_t encode_function, de
         return NRF_ERROR_INTERNAL;
     }
 
+    if (result_code == NRF_SUCCESS)
+    {
+        _adapter->commandHandler(tx_frame->payload(), tx_buffer_length);
+    }
+
     return result_code;
 }
+
+bool ble_command_idempotent(const uint8_t opcode)
+{
+    switch (opcode)
+    {
+        case SD_BLE_UUID_DECODE:
+        case SD_BLE_UUID_ENCODE:
+        case SD_BLE_VERSION_GET:
+        case SD_BLE_OPT_GET:
+#if NRF_SD_BLE_API_VERSION < 4
+        case SD_BLE_TX_PACKET_COUNT_GET:
+        case SD_BLE_GAP_ADDRESS_GET:
+#else
+        case SD_BLE_GAP_ADDR_GET:
+        case SD_BLE_GAP_PRIVACY_GET:
+#endif
+        case SD_BLE_GAP_DEVICE_NAME_GET:
+        case SD_BLE_GAP_APPEARANCE_GET:
+        case SD_BLE_GAP_PPCP_GET:
+        case SD_BLE_GATTS_VALUE_GET:
+        case SD_BLE_GATTS_ATTR_GET:
+        case SD_BLE_GATTS_INITIAL_USER_HANDLE_GET:
+            return true;
+        default:
+            return false;
+    }
+}
@@ -633,7 +633,12 @@ uint32_t sd_ble_gap_connect(adapter_t *adapter,
             result);
     };
 
-    return encode_decode(adapter, encode_function, decode_function);
+    auto adapterInternal = static_cast<AdapterInternal*>(adapter->internal);
+    adapterInternal->connTimeline.connectProcess(p_addr);
+
+    auto err_code = encode_decode(adapter, encode_function, decode_function);
+    adapterInternal->connTimeline.connectResultProcess(err_code);
+    return err_code;
 }
 
 
@@ -652,7 +657,11 @@ uint32_t sd_ble_gap_connect_cancel(adapter_t *adapter)
             result);
     };
 
-    return encode_decode(adapter, encode_function, decode_function);
+    auto err_code = encode_decode(adapter, encode_function, decode_function);
+
+    auto adapterInternal = static_cast<AdapterInternal*>(adapter->internal);
+    adapterInternal->connTimeline.connectCancelProcess(err_code);
+    return err_code;
 }
 
 
@@ -116,6 +116,13 @@ uint32_t sd_ble_gattc_char_value_by_uuid_read(adapter_t *adapter, uint16_t conn_
 
 uint32_t sd_ble_gattc_read(adapter_t *adapter, uint16_t conn_handle, uint16_t handle, uint16_t offset)
 {
+    auto adapterInternal = static_cast<AdapterInternal*>(adapter->internal);
+
+    if (adapterInternal->prefetcher->readServe(conn_handle, handle, offset))
+    {
+        return NRF_SUCCESS;
+    }
+
     encode_function_t encode_function = [&] (uint8_t *buffer, uint32_t *length) -> uint32_t {
         return ble_gattc_read_req_enc(conn_handle, handle, offset, buffer, length);
     };
@@ -124,7 +131,14 @@ uint32_t sd_ble_gattc_read(adapter_t *adapter, uint16_t conn_handle, uint16_t ha
         return ble_gattc_read_rsp_dec(buffer, length, result);
     };
 
-    return encode_decode(adapter, encode_function, decode_function);
+    auto err_code = encode_decode(adapter, encode_function, decode_function);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        adapterInternal->prefetcher->readProcess(conn_handle, handle, offset);
+    }
+
+    return err_code;
 }
 
 uint32_t sd_ble_gattc_char_values_read(adapter_t *adapter, uint16_t conn_handle, uint16_t const *p_handles, uint16_t handle_count)
@@ -142,6 +156,13 @@ uint32_t sd_ble_gattc_char_values_read(adapter_t *adapter, uint16_t conn_handle,
 
 uint32_t sd_ble_gattc_write(adapter_t *adapter, uint16_t conn_handle, ble_gattc_write_params_t const *p_write_params)
 {
+    auto adapterInternal = static_cast<AdapterInternal*>(adapter->internal);
+
+    if (adapterInternal->prefetcher->writeServe(conn_handle, p_write_params))
+    {
+        return NRF_SUCCESS;
+    }
+
     encode_function_t encode_function = [&] (uint8_t *buffer, uint32_t *length) -> uint32_t {
         return ble_gattc_write_req_enc(conn_handle, p_write_params, buffer, length);
     };
@@ -150,7 +171,16 @@ uint32_t sd_ble_gattc_write(adapter_t *adapter, uint16_t conn_handle, ble_gattc_
         return ble_gattc_write_rsp_dec(buffer, length, result);
     };
 
-    return encode_decode(adapter, encode_function, decode_function);
+    auto err_code = encode_decode(adapter, encode_function, decode_function);
+
+    if (err_code == NRF_SUCCESS && p_write_params != nullptr)
+    {
+        adapterInternal->peerStats.txProcess(conn_handle, p_write_params->len);
+        adapterInternal->connTimeline.txProcess(conn_handle);
+        adapterInternal->prefetcher->writeProcess(conn_handle, p_write_params);
+    }
+
+    return err_code;
 }
 
 uint32_t sd_ble_gattc_hv_confirm(adapter_t *adapter, uint16_t conn_handle, uint16_t handle)
@@ -190,6 +220,14 @@ uint32_t sd_ble_gattc_exchange_mtu_request(adapter_t *adapter, uint16_t conn_han
         return ble_gattc_exchange_mtu_request_rsp_dec(buffer, length, result);
     };
 
-    return encode_decode(adapter, encode_function, decode_function);
+    auto err_code = encode_decode(adapter, encode_function, decode_function);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        auto adapterInternal = static_cast<AdapterInternal*>(adapter->internal);
+        adapterInternal->connStateTracker.ownMtuSet(conn_handle, client_rx_mtu);
+    }
+
+    return err_code;
 }
 #endif
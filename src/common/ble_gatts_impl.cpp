@@ -86,7 +86,15 @@ uint32_t sd_ble_gatts_characteristic_add(adapter_t *adapter, uint16_t service_ha
         return ble_gatts_characteristic_add_rsp_dec(buffer, length, &handles, result);
     };
 
-    return encode_decode(adapter, encode_function, decode_function);
+    auto err_code = encode_decode(adapter, encode_function, decode_function);
+
+    if (err_code == NRF_SUCCESS && p_handles != nullptr)
+    {
+        auto adapterInternal = static_cast<AdapterInternal*>(adapter->internal);
+        adapterInternal->subscriptionTracker.characteristicAdd(p_handles->value_handle, p_handles->cccd_handle);
+    }
+
+    return err_code;
 }
 
 uint32_t sd_ble_gatts_descriptor_add(adapter_t *adapter, uint16_t char_handle, ble_gatts_attr_t const *p_attr, uint16_t *p_handle)
@@ -139,7 +147,23 @@ uint32_t sd_ble_gatts_hvx(adapter_t *adapter, uint16_t conn_handle, ble_gatts_hv
         return ble_gatts_hvx_rsp_dec(buffer, length, result, &out_length);
     };
 
-    return encode_decode(adapter, encode_function, decode_function);
+    auto err_code = encode_decode(adapter, encode_function, decode_function);
+
+    // NRF_ERROR_INTERNAL is returned when the command was not encoded, sent or answered, the SoftDevice
+    // did not queue the packet and the result tells nothing of its TX queue
+    if (p_hvx_params != nullptr && err_code != NRF_ERROR_INTERNAL)
+    {
+        auto adapterInternal = static_cast<AdapterInternal*>(adapter->internal);
+        adapterInternal->subscriptionTracker.hvxProcess(conn_handle, p_hvx_params->type, err_code);
+
+        if (err_code == NRF_SUCCESS && p_hvx_params->p_len != nullptr)
+        {
+            adapterInternal->peerStats.txProcess(conn_handle, *p_hvx_params->p_len);
+            adapterInternal->connTimeline.txProcess(conn_handle);
+        }
+    }
+
+    return err_code;
 }
 
 uint32_t sd_ble_gatts_service_changed(adapter_t *adapter, uint16_t conn_handle, uint16_t start_handle, uint16_t end_handle)
@@ -165,7 +189,12 @@ uint32_t sd_ble_gatts_rw_authorize_reply(adapter_t *adapter, uint16_t conn_handl
         return ble_gatts_rw_authorize_reply_rsp_dec(buffer, length, result);
     };
 
-    return encode_decode(adapter, encode_function, decode_function);
+    const auto err_code = encode_decode(adapter, encode_function, decode_function);
+
+    auto adapterInternal = static_cast<AdapterInternal*>(adapter->internal);
+    adapterInternal->subscriptionTracker.authorizeReplyProcess(conn_handle, p_rw_authorize_reply_params, err_code, *adapterInternal->userMemPool);
+
+    return err_code;
 }
 
 uint32_t sd_ble_gatts_sys_attr_set(adapter_t *adapter, uint16_t conn_handle, uint8_t const *p_sys_attr_data, uint16_t len, uint32_t flags)
@@ -178,7 +207,15 @@ uint32_t sd_ble_gatts_sys_attr_set(adapter_t *adapter, uint16_t conn_handle, uin
         return ble_gatts_sys_attr_set_rsp_dec(buffer, length, result);
     };
 
-    return encode_decode(adapter, encode_function, decode_function);
+    auto err_code = encode_decode(adapter, encode_function, decode_function);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        auto adapterInternal = static_cast<AdapterInternal*>(adapter->internal);
+        adapterInternal->subscriptionTracker.sysAttrSet(conn_handle, p_sys_attr_data, len, flags);
+    }
+
+    return err_code;
 }
 
 uint32_t sd_ble_gatts_sys_attr_get(adapter_t *adapter, uint16_t conn_handle, uint8_t *p_sys_attr_data, uint16_t *p_len, uint32_t flags)
@@ -235,6 +272,14 @@ uint32_t sd_ble_gatts_exchange_mtu_reply(adapter_t *adapter, uint16_t conn_handl
         return ble_gatts_exchange_mtu_reply_rsp_dec(buffer, length, result);
     };
 
-    return encode_decode(adapter, encode_function, decode_function);
+    auto err_code = encode_decode(adapter, encode_function, decode_function);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        auto adapterInternal = static_cast<AdapterInternal*>(adapter->internal);
+        adapterInternal->connStateTracker.ownMtuSet(conn_handle, server_rx_mtu);
+    }
+
+    return err_code;
 }
 #endif
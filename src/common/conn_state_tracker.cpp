@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "conn_state_tracker.h"
+
+#include "nrf_error.h"
+#include "ble_hci.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    const uint16_t ATT_MTU_DEFAULT = 23;           // Minimum ATT MTU, used until an MTU exchange completes
+    const uint16_t DATA_LENGTH_DEFAULT = 27;       // Link layer payload size before a data length update
+    const uint8_t PHY_DEFAULT = 0x01;              // 1 Mbps PHY
+}
+
+ConnStateTracker::ConnStateTracker()
+{
+    for (auto &slot : slots)
+    {
+        slot.sequence = 0;
+        slot.active = false;
+        std::memset(&slot.state, 0, sizeof(slot.state));
+        slot.ownRxMtu = ATT_MTU_DEFAULT;
+        slot.peerRxMtu = ATT_MTU_DEFAULT;
+    }
+}
+
+void ConnStateTracker::process(const ble_evt_t *event)
+{
+    const auto conn_handle = event->evt.gap_evt.conn_handle;
+
+    std::lock_guard<std::mutex> writeGuard(writeMutex);
+
+    switch (event->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+        {
+            auto slot = allocate(conn_handle);
+
+            if (slot == nullptr)
+            {
+                return;
+            }
+
+            const auto &connected = event->evt.gap_evt.params.connected;
+
+            beginWrite(slot);
+            std::memset(&slot->state, 0, sizeof(slot->state));
+            slot->state.conn_handle = conn_handle;
+            slot->state.role = connected.role;
+            slot->state.peer_addr = connected.peer_addr;
+            slot->state.conn_params = connected.conn_params;
+            slot->state.conn_sec.sec_mode.sm = 1;
+            slot->state.conn_sec.sec_mode.lv = 1;
+            slot->state.att_mtu = ATT_MTU_DEFAULT;
+            slot->state.max_tx_octets = DATA_LENGTH_DEFAULT;
+            slot->state.max_rx_octets = DATA_LENGTH_DEFAULT;
+            slot->state.tx_phy = PHY_DEFAULT;
+            slot->state.rx_phy = PHY_DEFAULT;
+            slot->ownRxMtu = ATT_MTU_DEFAULT;
+            slot->peerRxMtu = ATT_MTU_DEFAULT;
+            slot->active = true;
+            endWrite(slot);
+            break;
+        }
+        case BLE_GAP_EVT_DISCONNECTED:
+        {
+            auto slot = find(conn_handle);
+
+            if (slot != nullptr)
+            {
+                beginWrite(slot);
+                slot->active = false;
+                endWrite(slot);
+            }
+
+            break;
+        }
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+        {
+            auto slot = find(conn_handle);
+
+            if (slot != nullptr)
+            {
+                beginWrite(slot);
+                slot->state.conn_params = event->evt.gap_evt.params.conn_param_update.conn_params;
+                endWrite(slot);
+            }
+
+            break;
+        }
+        case BLE_GAP_EVT_CONN_SEC_UPDATE:
+        {
+            auto slot = find(conn_handle);
+
+            if (slot != nullptr)
+            {
+                beginWrite(slot);
+                slot->state.conn_sec = event->evt.gap_evt.params.conn_sec_update.conn_sec;
+                endWrite(slot);
+            }
+
+            break;
+        }
+#if NRF_SD_BLE_API_VERSION >= 5
+        case BLE_GAP_EVT_PHY_UPDATE:
+        {
+            auto slot = find(conn_handle);
+            const auto &phyUpdate = event->evt.gap_evt.params.phy_update;
+
+            if (slot != nullptr && phyUpdate.status == BLE_HCI_STATUS_CODE_SUCCESS)
+            {
+                beginWrite(slot);
+                slot->state.tx_phy = phyUpdate.tx_phy;
+                slot->state.rx_phy = phyUpdate.rx_phy;
+                endWrite(slot);
+            }
+
+            break;
+        }
+#endif
+#if NRF_SD_BLE_API_VERSION >= 4
+        case BLE_GAP_EVT_DATA_LENGTH_UPDATE:
+        {
+            auto slot = find(conn_handle);
+
+            if (slot != nullptr)
+            {
+                const auto &effective = event->evt.gap_evt.params.data_length_update.effective_params;
+                beginWrite(slot);
+                slot->state.max_tx_octets = effective.max_tx_octets;
+                slot->state.max_rx_octets = effective.max_rx_octets;
+                endWrite(slot);
+            }
+
+            break;
+        }
+#endif
+#if NRF_SD_BLE_API_VERSION >= 3
+        case BLE_GATTC_EVT_EXCHANGE_MTU_RSP:
+        {
+            auto slot = find(event->evt.gattc_evt.conn_handle);
+
+            if (slot != nullptr)
+            {
+                beginWrite(slot);
+                slot->peerRxMtu = event->evt.gattc_evt.params.exchange_mtu_rsp.server_rx_mtu;
+                slot->state.att_mtu = std::max(ATT_MTU_DEFAULT, std::min(slot->ownRxMtu, slot->peerRxMtu));
+                endWrite(slot);
+            }
+
+            break;
+        }
+        case BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST:
+        {
+            // The effective MTU is set when the application replies, see ownMtuSet
+            auto slot = find(event->evt.gatts_evt.conn_handle);
+
+            if (slot != nullptr)
+            {
+                slot->peerRxMtu = event->evt.gatts_evt.params.exchange_mtu_request.client_rx_mtu;
+            }
+
+            break;
+        }
+#endif
+        default:
+            break;
+    }
+}
+
+void ConnStateTracker::ownMtuSet(const uint16_t conn_handle, const uint16_t rx_mtu)
+{
+    std::lock_guard<std::mutex> writeGuard(writeMutex);
+
+    auto slot = find(conn_handle);
+
+    if (slot == nullptr)
+    {
+        return;
+    }
+
+    slot->ownRxMtu = rx_mtu;
+
+    // Server side, the peer MTU is known when the reply is sent. Client side,
+    // the MTU is updated when the response is received.
+    if (slot->peerRxMtu != ATT_MTU_DEFAULT)
+    {
+        beginWrite(slot);
+        slot->state.att_mtu = std::max(ATT_MTU_DEFAULT, std::min(slot->ownRxMtu, slot->peerRxMtu));
+        endWrite(slot);
+    }
+}
+
+void ConnStateTracker::clear()
+{
+    std::lock_guard<std::mutex> writeGuard(writeMutex);
+
+    for (auto &slot : slots)
+    {
+        if (slot.active)
+        {
+            beginWrite(&slot);
+            slot.active = false;
+            endWrite(&slot);
+        }
+    }
+}
+
+uint32_t ConnStateTracker::get(const uint16_t conn_handle, sd_rpc_conn_state_t *state) const
+{
+    if (state == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    for (const auto &slot : slots)
+    {
+        sd_rpc_conn_state_t slotState;
+
+        if (read(slot, &slotState) && slotState.conn_handle == conn_handle)
+        {
+            *state = slotState;
+            return NRF_SUCCESS;
+        }
+    }
+
+    return NRF_ERROR_NOT_FOUND;
+}
+
+uint32_t ConnStateTracker::list(sd_rpc_conn_state_t states[], uint32_t *size) const
+{
+    if (size == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    uint32_t count = 0;
+    auto errCode = NRF_SUCCESS;
+
+    for (const auto &slot : slots)
+    {
+        sd_rpc_conn_state_t state;
+
+        if (!read(slot, &state))
+        {
+            continue;
+        }
+
+        if (count < *size && states != nullptr)
+        {
+            states[count] = state;
+        }
+        else
+        {
+            errCode = NRF_ERROR_DATA_SIZE;
+        }
+
+        count++;
+    }
+
+    *size = count;
+    return errCode;
+}
+
+ConnStateTracker::Slot *ConnStateTracker::find(const uint16_t conn_handle)
+{
+    for (auto &slot : slots)
+    {
+        if (slot.active && slot.state.conn_handle == conn_handle)
+        {
+            return &slot;
+        }
+    }
+
+    return nullptr;
+}
+
+ConnStateTracker::Slot *ConnStateTracker::allocate(const uint16_t conn_handle)
+{
+    auto slot = find(conn_handle);
+
+    if (slot != nullptr)
+    {
+        return slot;
+    }
+
+    for (auto &candidate : slots)
+    {
+        if (!candidate.active)
+        {
+            return &candidate;
+        }
+    }
+
+    return nullptr;
+}
+
+void ConnStateTracker::beginWrite(Slot *slot)
+{
+    slot->sequence.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void ConnStateTracker::endWrite(Slot *slot)
+{
+    slot->state.update_count++;
+    slot->sequence.fetch_add(1, std::memory_order_release);
+}
+
+bool ConnStateTracker::read(const Slot &slot, sd_rpc_conn_state_t *state)
+{
+    while (true)
+    {
+        const auto before = slot.sequence.load(std::memory_order_acquire);
+
+        // Writer in progress
+        if (before & 1)
+        {
+            continue;
+        }
+
+        const auto active = slot.active.load(std::memory_order_relaxed);
+        std::memcpy(state, &slot.state, sizeof(sd_rpc_conn_state_t));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot.sequence.load(std::memory_order_relaxed) == before)
+        {
+            return active;
+        }
+    }
+}
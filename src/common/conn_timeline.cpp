@@ -0,0 +1,695 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "conn_timeline.h"
+
+#include "ble_hci.h"
+#include "nrf_error.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    // Peers whose last advertising report is kept, the reports are forgotten when there are more
+    const size_t ADV_REPORTS_MAX = 1024;
+
+    // Encryption with security mode 1 level 2 or higher completes the security phase
+    const uint8_t SECURITY_LEVEL_ENCRYPTED = 2;
+}
+
+const uint32_t ConnTimeline::HISTOGRAM_SUB_BUCKETS;
+const uint32_t ConnTimeline::HISTOGRAM_BUCKETS;
+
+ConnTimeline::ConnTimeline()
+    : started(false), maxTimelines(0), pending(false), commandTracked(false),
+      commandConnHandle(BLE_CONN_HANDLE_INVALID), attemptCount(0), connectedCount(0)
+{
+    attemptInit(pendingAttempt);
+    std::memset(phaseHistograms, 0, sizeof(phaseHistograms));
+    std::memset(elapsedHistograms, 0, sizeof(elapsedHistograms));
+}
+
+void ConnTimeline::process(const ble_evt_t *event)
+{
+    std::lock_guard<std::mutex> lock(timelineMutex);
+
+    if (!started)
+    {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+
+    switch (event->header.evt_id)
+    {
+        case BLE_GAP_EVT_ADV_REPORT:
+        {
+            if (advReports.size() >= ADV_REPORTS_MAX)
+            {
+                advReports.clear();
+            }
+
+            advReports[keyGet(event->evt.gap_evt.params.adv_report.peer_addr)] = now;
+            break;
+        }
+        case BLE_GAP_EVT_CONNECTED:
+            connectedProcess(event->evt.gap_evt);
+            break;
+        case BLE_GAP_EVT_DISCONNECTED:
+        {
+            const auto connection = connections.find(event->evt.gap_evt.conn_handle);
+
+            if (connection != connections.end())
+            {
+                finish(connection->second, SD_RPC_CONN_OUTCOME_DISCONNECTED);
+                connections.erase(connection);
+            }
+
+            break;
+        }
+        case BLE_GAP_EVT_TIMEOUT:
+        {
+            if (event->evt.gap_evt.params.timeout.src == BLE_GAP_TIMEOUT_SRC_CONN && pending)
+            {
+                finish(pendingAttempt, SD_RPC_CONN_OUTCOME_TIMEOUT);
+                pending = false;
+            }
+
+            break;
+        }
+        case BLE_GAP_EVT_CONN_SEC_UPDATE:
+        {
+            // Encryption with the keys of a bond, pairing completes the phase with its status event
+            auto attempt = connectionGet(event->evt.gap_evt.conn_handle);
+            const auto &secMode = event->evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode;
+
+            if (attempt != nullptr && !attempt->reached[SD_RPC_CONN_PHASE_SECURITY] && secMode.lv >= SECURITY_LEVEL_ENCRYPTED)
+            {
+                phaseSet(*attempt, SD_RPC_CONN_PHASE_SECURITY, now);
+            }
+
+            break;
+        }
+        case BLE_GAP_EVT_AUTH_STATUS:
+        {
+            auto attempt = connectionGet(event->evt.gap_evt.conn_handle);
+
+            if (attempt != nullptr && event->evt.gap_evt.params.auth_status.auth_status == BLE_GAP_SEC_STATUS_SUCCESS)
+            {
+                phaseSet(*attempt, SD_RPC_CONN_PHASE_SECURITY, now);
+            }
+
+            break;
+        }
+#if NRF_SD_BLE_API_VERSION >= 5
+        case BLE_GAP_EVT_PHY_UPDATE:
+        {
+            auto attempt = connectionGet(event->evt.gap_evt.conn_handle);
+
+            if (attempt != nullptr && !attempt->reached[SD_RPC_CONN_PHASE_PHY]
+                && event->evt.gap_evt.params.phy_update.status == BLE_HCI_STATUS_CODE_SUCCESS)
+            {
+                phaseSet(*attempt, SD_RPC_CONN_PHASE_PHY, now);
+            }
+
+            break;
+        }
+#endif
+#if NRF_SD_BLE_API_VERSION >= 4
+        case BLE_GAP_EVT_DATA_LENGTH_UPDATE:
+        {
+            auto attempt = connectionGet(event->evt.gap_evt.conn_handle);
+
+            if (attempt != nullptr && !attempt->reached[SD_RPC_CONN_PHASE_DATA_LENGTH])
+            {
+                phaseSet(*attempt, SD_RPC_CONN_PHASE_DATA_LENGTH, now);
+            }
+
+            break;
+        }
+#endif
+#if NRF_SD_BLE_API_VERSION >= 3
+        case BLE_GATTC_EVT_EXCHANGE_MTU_RSP:
+        case BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST:
+        {
+            auto attempt = connectionGet(event->evt.gap_evt.conn_handle);
+
+            if (attempt != nullptr && !attempt->reached[SD_RPC_CONN_PHASE_MTU])
+            {
+                phaseSet(*attempt, SD_RPC_CONN_PHASE_MTU, now);
+            }
+
+            break;
+        }
+#endif
+        case BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP:
+        case BLE_GATTC_EVT_REL_DISC_RSP:
+        case BLE_GATTC_EVT_CHAR_DISC_RSP:
+        case BLE_GATTC_EVT_DESC_DISC_RSP:
+        case BLE_GATTC_EVT_ATTR_INFO_DISC_RSP:
+        {
+            // Discovery has no end of its own, the phase moves with every discovery response
+            auto attempt = connectionGet(event->evt.gattc_evt.conn_handle);
+
+            if (attempt != nullptr)
+            {
+                phaseSet(*attempt, SD_RPC_CONN_PHASE_DISCOVERY, now);
+            }
+
+            break;
+        }
+        case BLE_GATTC_EVT_READ_RSP:
+        case BLE_GATTC_EVT_CHAR_VALS_READ_RSP:
+        case BLE_GATTC_EVT_CHAR_VAL_BY_UUID_READ_RSP:
+        case BLE_GATTC_EVT_WRITE_RSP:
+        case BLE_GATTC_EVT_HVX:
+        case BLE_GATTS_EVT_WRITE:
+        {
+            // The connection handle is the first member of the GATTC and GATTS events alike
+            auto attempt = connectionGet(event->evt.gattc_evt.conn_handle);
+
+            if (attempt != nullptr && !attempt->reached[SD_RPC_CONN_PHASE_FIRST_DATA])
+            {
+                phaseSet(*attempt, SD_RPC_CONN_PHASE_FIRST_DATA, now);
+            }
+
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void ConnTimeline::connectProcess(const ble_gap_addr_t *peerAddr)
+{
+    std::lock_guard<std::mutex> lock(timelineMutex);
+
+    // A command sent while an attempt is pending is rejected by the SoftDevice
+    commandTracked = started && !pending;
+
+    if (!commandTracked)
+    {
+        return;
+    }
+
+    attemptInit(pendingAttempt);
+    pendingAttempt.timeline.role = BLE_GAP_ROLE_CENTRAL;
+    phaseSet(pendingAttempt, SD_RPC_CONN_PHASE_CONNECT_CMD, std::chrono::steady_clock::now());
+
+    if (peerAddr != nullptr)
+    {
+        pendingAttempt.timeline.peer_addr = *peerAddr;
+        advReportSet(pendingAttempt, *peerAddr);
+    }
+
+    pending = true;
+    commandConnHandle = BLE_CONN_HANDLE_INVALID;
+}
+
+void ConnTimeline::connectResultProcess(const uint32_t result)
+{
+    std::lock_guard<std::mutex> lock(timelineMutex);
+
+    if (!commandTracked)
+    {
+        return;
+    }
+
+    commandTracked = false;
+    const auto now = std::chrono::steady_clock::now();
+
+    // The connected event may have been handled before the command returned
+    if (!pending)
+    {
+        auto attempt = connectionGet(commandConnHandle);
+
+        if (attempt != nullptr)
+        {
+            phaseSet(*attempt, SD_RPC_CONN_PHASE_CONNECT_RSP, now);
+        }
+
+        return;
+    }
+
+    phaseSet(pendingAttempt, SD_RPC_CONN_PHASE_CONNECT_RSP, now);
+
+    if (result != NRF_SUCCESS)
+    {
+        finish(pendingAttempt, SD_RPC_CONN_OUTCOME_FAILED);
+        pending = false;
+    }
+}
+
+void ConnTimeline::connectCancelProcess(const uint32_t result)
+{
+    std::lock_guard<std::mutex> lock(timelineMutex);
+
+    if (result == NRF_SUCCESS && pending)
+    {
+        finish(pendingAttempt, SD_RPC_CONN_OUTCOME_CANCELLED);
+        pending = false;
+    }
+}
+
+void ConnTimeline::txProcess(const uint16_t connHandle)
+{
+    std::lock_guard<std::mutex> lock(timelineMutex);
+    auto attempt = connectionGet(connHandle);
+
+    if (attempt != nullptr && !attempt->reached[SD_RPC_CONN_PHASE_FIRST_DATA])
+    {
+        phaseSet(*attempt, SD_RPC_CONN_PHASE_FIRST_DATA, std::chrono::steady_clock::now());
+    }
+}
+
+void ConnTimeline::clear()
+{
+    std::lock_guard<std::mutex> lock(timelineMutex);
+
+    if (pending)
+    {
+        finish(pendingAttempt, SD_RPC_CONN_OUTCOME_RESET);
+        pending = false;
+    }
+
+    for (auto &connection : connections)
+    {
+        finish(connection.second, SD_RPC_CONN_OUTCOME_RESET);
+    }
+
+    connections.clear();
+    advReports.clear();
+}
+
+uint32_t ConnTimeline::start(const sd_rpc_conn_timeline_params_t *params)
+{
+    if (params == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (params->max_timelines == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    std::lock_guard<std::mutex> lock(timelineMutex);
+
+    if (started)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    started = true;
+    maxTimelines = params->max_timelines;
+    return NRF_SUCCESS;
+}
+
+uint32_t ConnTimeline::stop()
+{
+    std::lock_guard<std::mutex> lock(timelineMutex);
+
+    started = false;
+    pending = false;
+    commandTracked = false;
+    advReports.clear();
+    connections.clear();
+    history.clear();
+
+    attemptCount = 0;
+    connectedCount = 0;
+    std::memset(phaseHistograms, 0, sizeof(phaseHistograms));
+    std::memset(elapsedHistograms, 0, sizeof(elapsedHistograms));
+    return NRF_SUCCESS;
+}
+
+uint32_t ConnTimeline::get(const uint16_t connHandle, sd_rpc_conn_timeline_t *timeline) const
+{
+    if (timeline == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(timelineMutex);
+
+    if (!started)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (connHandle == BLE_CONN_HANDLE_INVALID)
+    {
+        if (!pending)
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+
+        *timeline = pendingAttempt.timeline;
+        return NRF_SUCCESS;
+    }
+
+    const auto connection = connections.find(connHandle);
+
+    if (connection != connections.end())
+    {
+        *timeline = connection->second.timeline;
+        return NRF_SUCCESS;
+    }
+
+    // The connection has been lost, the last finished timeline of the handle is returned
+    const auto finished = std::find_if(history.rbegin(), history.rend(), [connHandle](const sd_rpc_conn_timeline_t &entry) {
+        return entry.conn_handle == connHandle;
+    });
+
+    if (finished == history.rend())
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    *timeline = *finished;
+    return NRF_SUCCESS;
+}
+
+uint32_t ConnTimeline::list(sd_rpc_conn_timeline_t *timelines, uint32_t *count) const
+{
+    if (timelines == nullptr || count == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(timelineMutex);
+
+    if (!started)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    const auto size = static_cast<uint32_t>(history.size());
+
+    if (size > *count)
+    {
+        *count = size;
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    std::copy(history.begin(), history.end(), timelines);
+    *count = size;
+    return NRF_SUCCESS;
+}
+
+uint32_t ConnTimeline::statsGet(sd_rpc_conn_timeline_stats_t *stats) const
+{
+    if (stats == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(timelineMutex);
+
+    if (!started)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    stats->attempt_count = attemptCount;
+    stats->connected_count = connectedCount;
+
+    for (auto phase = 0; phase < SD_RPC_CONN_PHASE_COUNT; phase++)
+    {
+        histogramGet(phaseHistograms[phase], &stats->phase[phase]);
+        histogramGet(elapsedHistograms[phase], &stats->elapsed[phase]);
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint64_t ConnTimeline::keyGet(const ble_gap_addr_t &addr)
+{
+    auto key = static_cast<uint64_t>(addr.addr_type) << 48;
+
+    for (auto i = 0; i < BLE_GAP_ADDR_LEN; i++)
+    {
+        key |= static_cast<uint64_t>(addr.addr[i]) << (8 * i);
+    }
+
+    return key;
+}
+
+uint32_t ConnTimeline::bucketGet(const uint32_t value)
+{
+    // Values below 16 have a bucket each, larger values 8 buckets per power of two
+    if (value < 2 * HISTOGRAM_SUB_BUCKETS)
+    {
+        return value;
+    }
+
+    uint32_t exponent = 0;
+
+    while ((value >> (exponent + 1)) != 0)
+    {
+        exponent++;
+    }
+
+    const auto subBucket = (value >> (exponent - 3)) & (HISTOGRAM_SUB_BUCKETS - 1);
+    return 2 * HISTOGRAM_SUB_BUCKETS + (exponent - 4) * HISTOGRAM_SUB_BUCKETS + subBucket;
+}
+
+uint32_t ConnTimeline::bucketValueGet(const uint32_t bucket)
+{
+    if (bucket < 2 * HISTOGRAM_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    // The middle of the bucket
+    const auto exponent = 4 + (bucket - 2 * HISTOGRAM_SUB_BUCKETS) / HISTOGRAM_SUB_BUCKETS;
+    const auto subBucket = (bucket - 2 * HISTOGRAM_SUB_BUCKETS) % HISTOGRAM_SUB_BUCKETS;
+    const auto width = 1U << (exponent - 3);
+    return (HISTOGRAM_SUB_BUCKETS + subBucket) * width + width / 2;
+}
+
+void ConnTimeline::histogramAdd(Histogram &histogram, const uint32_t value)
+{
+    histogram.buckets[bucketGet(value)]++;
+    histogram.min = histogram.count == 0 ? value : std::min(histogram.min, value);
+    histogram.max = histogram.count == 0 ? value : std::max(histogram.max, value);
+    histogram.count++;
+}
+
+void ConnTimeline::histogramGet(const Histogram &histogram, sd_rpc_conn_phase_stats_t *stats)
+{
+    std::memset(stats, 0, sizeof(sd_rpc_conn_phase_stats_t));
+
+    if (histogram.count == 0)
+    {
+        return;
+    }
+
+    stats->count = histogram.count;
+    stats->min_us = histogram.min;
+    stats->max_us = histogram.max;
+
+    const auto percentileGet = [&histogram](const uint32_t percent) -> uint32_t {
+        const auto rank = std::max<uint64_t>(1, (static_cast<uint64_t>(histogram.count) * percent + 99) / 100);
+        uint64_t total = 0;
+
+        for (uint32_t bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+        {
+            total += histogram.buckets[bucket];
+
+            if (total >= rank)
+            {
+                return std::min(std::max(bucketValueGet(bucket), histogram.min), histogram.max);
+            }
+        }
+
+        return histogram.max;
+    };
+
+    stats->p50_us = percentileGet(50);
+    stats->p90_us = percentileGet(90);
+    stats->p99_us = percentileGet(99);
+}
+
+void ConnTimeline::attemptInit(Attempt &attempt)
+{
+    std::memset(&attempt.timeline, 0, sizeof(attempt.timeline));
+    attempt.timeline.conn_handle = BLE_CONN_HANDLE_INVALID;
+    attempt.timeline.outcome = SD_RPC_CONN_OUTCOME_ACTIVE;
+
+    for (auto phase = 0; phase < SD_RPC_CONN_PHASE_COUNT; phase++)
+    {
+        attempt.timeline.phase_us[phase] = SD_RPC_CONN_PHASE_NOT_REACHED;
+        attempt.reached[phase] = false;
+    }
+}
+
+void ConnTimeline::phaseSet(Attempt &attempt, const sd_rpc_conn_phase_t phase, const TimePoint time)
+{
+    attempt.times[phase] = time;
+    attempt.reached[phase] = true;
+    timelineUpdate(attempt);
+}
+
+void ConnTimeline::timelineUpdate(Attempt &attempt)
+{
+    TimePoint first = TimePoint::max();
+
+    for (auto phase = 0; phase < SD_RPC_CONN_PHASE_COUNT; phase++)
+    {
+        if (attempt.reached[phase])
+        {
+            first = std::min(first, attempt.times[phase]);
+        }
+    }
+
+    for (auto phase = 0; phase < SD_RPC_CONN_PHASE_COUNT; phase++)
+    {
+        if (attempt.reached[phase])
+        {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(attempt.times[phase] - first).count();
+            attempt.timeline.phase_us[phase] = static_cast<uint32_t>(std::min<int64_t>(elapsed, SD_RPC_CONN_PHASE_NOT_REACHED - 1));
+        }
+    }
+
+    const auto age = std::chrono::steady_clock::now() - first;
+    attempt.timeline.start_ms = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        (std::chrono::system_clock::now() - age).time_since_epoch()).count());
+}
+
+ConnTimeline::Attempt *ConnTimeline::connectionGet(const uint16_t connHandle)
+{
+    const auto connection = connections.find(connHandle);
+    return connection != connections.end() ? &connection->second : nullptr;
+}
+
+void ConnTimeline::advReportSet(Attempt &attempt, const ble_gap_addr_t &peerAddr)
+{
+    const auto report = advReports.find(keyGet(peerAddr));
+
+    // Only a report received before the connect command triggered the attempt
+    if (report != advReports.end() && attempt.reached[SD_RPC_CONN_PHASE_CONNECT_CMD]
+        && report->second <= attempt.times[SD_RPC_CONN_PHASE_CONNECT_CMD])
+    {
+        phaseSet(attempt, SD_RPC_CONN_PHASE_ADV_REPORT, report->second);
+    }
+}
+
+void ConnTimeline::finish(Attempt &attempt, const sd_rpc_conn_outcome_t outcome)
+{
+    attempt.timeline.outcome = static_cast<uint8_t>(outcome);
+
+    history.push_back(attempt.timeline);
+
+    while (history.size() > maxTimelines)
+    {
+        history.pop_front();
+    }
+
+    attemptCount++;
+
+    if (attempt.reached[SD_RPC_CONN_PHASE_CONNECTED])
+    {
+        connectedCount++;
+    }
+
+    // Each phase is measured from the phase reached before it, whatever order the phases were reached in
+    int order[SD_RPC_CONN_PHASE_COUNT];
+    auto reachedCount = 0;
+
+    for (auto phase = 0; phase < SD_RPC_CONN_PHASE_COUNT; phase++)
+    {
+        if (attempt.reached[phase])
+        {
+            order[reachedCount++] = phase;
+        }
+    }
+
+    std::stable_sort(order, order + reachedCount, [&attempt](const int a, const int b) {
+        return attempt.times[a] < attempt.times[b];
+    });
+
+    for (auto i = 1; i < reachedCount; i++)
+    {
+        const auto phase = order[i];
+        const auto &timeline = attempt.timeline;
+        histogramAdd(phaseHistograms[phase], timeline.phase_us[phase] - timeline.phase_us[order[i - 1]]);
+        histogramAdd(elapsedHistograms[phase], timeline.phase_us[phase]);
+    }
+}
+
+void ConnTimeline::connectedProcess(const ble_gap_evt_t &gapEvent)
+{
+    const auto &connected = gapEvent.params.connected;
+    Attempt attempt;
+
+    if (connected.role == BLE_GAP_ROLE_CENTRAL && pending)
+    {
+        attempt = pendingAttempt;
+        pending = false;
+
+        if (commandTracked)
+        {
+            commandConnHandle = gapEvent.conn_handle;
+        }
+    }
+    else
+    {
+        attemptInit(attempt);
+    }
+
+    attempt.timeline.peer_addr = connected.peer_addr;
+    attempt.timeline.conn_handle = gapEvent.conn_handle;
+    attempt.timeline.role = connected.role;
+    phaseSet(attempt, SD_RPC_CONN_PHASE_CONNECTED, std::chrono::steady_clock::now());
+
+    // Connecting to the whitelist, the peer is known from the connected event
+    if (!attempt.reached[SD_RPC_CONN_PHASE_ADV_REPORT])
+    {
+        advReportSet(attempt, connected.peer_addr);
+    }
+
+    const auto stale = connections.find(gapEvent.conn_handle);
+
+    if (stale != connections.end())
+    {
+        finish(stale->second, SD_RPC_CONN_OUTCOME_DISCONNECTED);
+        connections.erase(stale);
+    }
+
+    connections[gapEvent.conn_handle] = attempt;
+}
@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "device_counter.h"
+
+#include "nrf_error.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+    const uint8_t PRECISION_MIN = 4;
+    const uint8_t PRECISION_MAX = 16;
+}
+
+DeviceCounter::DeviceCounter()
+    : started(false)
+{
+    params = {};
+    current.start = 0;
+    current.reportCount = 0;
+}
+
+bool DeviceCounter::process(const ble_evt_t *event)
+{
+    if (event->header.evt_id != BLE_GAP_EVT_ADV_REPORT)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(counterMutex);
+
+    if (!started)
+    {
+        return false;
+    }
+
+    rotate(timeGet());
+
+    const auto h = hash(event->evt.gap_evt.params.adv_report.peer_addr);
+    const auto precision = params.precision;
+    const auto index = static_cast<size_t>(h >> (64 - precision));
+
+    // The register keeps the highest position of the first set bit seen in the rest of the hash
+    auto rest = h << precision;
+    uint8_t rank = 1;
+
+    while (rank <= 64 - precision && (rest & 0x8000000000000000ULL) == 0)
+    {
+        rank++;
+        rest <<= 1;
+    }
+
+    if (rank > current.registers[index])
+    {
+        current.registers[index] = rank;
+    }
+
+    current.reportCount++;
+    return params.suppress_adv_reports;
+}
+
+uint32_t DeviceCounter::start(const sd_rpc_device_counter_params_t *_params)
+{
+    if (_params == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (_params->window_ms == 0
+        || _params->precision < PRECISION_MIN
+        || _params->precision > PRECISION_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    std::lock_guard<std::mutex> lock(counterMutex);
+    params = *_params;
+    started = true;
+    history.clear();
+    current.start = 0;
+    current.reportCount = 0;
+    current.registers.clear();
+    rotate(timeGet());
+    return NRF_SUCCESS;
+}
+
+uint32_t DeviceCounter::stop()
+{
+    std::lock_guard<std::mutex> lock(counterMutex);
+    started = false;
+    history.clear();
+    current.registers.clear();
+    current.reportCount = 0;
+    return NRF_SUCCESS;
+}
+
+uint32_t DeviceCounter::countGet(const std::vector<DeviceCounter *> &counters, const uint32_t window, sd_rpc_device_count_t *count)
+{
+    if (count == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (counters.empty())
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    const auto now = timeGet();
+    sd_rpc_device_counter_params_t first;
+    uint64_t start;
+
+    {
+        std::lock_guard<std::mutex> lock(counters[0]->counterMutex);
+
+        if (!counters[0]->started)
+        {
+            return NRF_ERROR_INVALID_STATE;
+        }
+
+        first = counters[0]->params;
+
+        if (window > first.window_history)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+
+        counters[0]->rotate(now);
+        start = counters[0]->current.start - static_cast<uint64_t>(window) * first.window_ms;
+    }
+
+    std::vector<uint8_t> merged(static_cast<size_t>(1) << first.precision, 0);
+    uint32_t reportCount = 0;
+
+    for (auto counter : counters)
+    {
+        std::lock_guard<std::mutex> lock(counter->counterMutex);
+
+        if (!counter->started)
+        {
+            return NRF_ERROR_INVALID_STATE;
+        }
+
+        if (counter->params.window_ms != first.window_ms || counter->params.precision != first.precision)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+
+        counter->rotate(now);
+        const auto found = counter->windowFind(start);
+
+        if (found == nullptr)
+        {
+            // Nothing was seen by the adapter in the window
+            continue;
+        }
+
+        std::transform(merged.begin(), merged.end(), found->registers.begin(), merged.begin(),
+            [](const uint8_t a, const uint8_t b) { return std::max(a, b); });
+        reportCount += found->reportCount;
+    }
+
+    count->window_start_ms = start;
+    count->report_count = reportCount;
+    count->device_count = estimate(merged);
+    return NRF_SUCCESS;
+}
+
+uint64_t DeviceCounter::hash(const ble_gap_addr_t &addr)
+{
+    uint64_t key = addr.addr_type;
+
+    for (auto i = 0; i < BLE_GAP_ADDR_LEN; i++)
+    {
+        key = (key << 8) | addr.addr[i];
+    }
+
+    // splitmix64 finalizer, spreads the address bits over the whole hash
+    key += 0x9e3779b97f4a7c15ULL;
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+    return key ^ (key >> 31);
+}
+
+uint64_t DeviceCounter::timeGet()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+uint32_t DeviceCounter::estimate(const std::vector<uint8_t> &registers)
+{
+    const auto m = static_cast<double>(registers.size());
+    double alpha;
+
+    switch (registers.size())
+    {
+        case 16: alpha = 0.673; break;
+        case 32: alpha = 0.697; break;
+        case 64: alpha = 0.709; break;
+        default: alpha = 0.7213 / (1.0 + 1.079 / m); break;
+    }
+
+    double sum = 0;
+    uint32_t zeros = 0;
+
+    for (const auto value : registers)
+    {
+        sum += std::ldexp(1.0, -static_cast<int>(value));
+
+        if (value == 0)
+        {
+            zeros++;
+        }
+    }
+
+    auto e = alpha * m * m / sum;
+
+    // Linear counting is more accurate while many registers are still empty
+    if (e <= 2.5 * m && zeros > 0)
+    {
+        e = m * std::log(m / zeros);
+    }
+
+    return static_cast<uint32_t>(e + 0.5);
+}
+
+void DeviceCounter::rotate(const uint64_t now)
+{
+    const auto start = now - now % params.window_ms;
+
+    if (start == current.start && !current.registers.empty())
+    {
+        return;
+    }
+
+    if (current.reportCount > 0)
+    {
+        history.push_back(current);
+    }
+
+    const auto oldest = static_cast<uint64_t>(params.window_history) * params.window_ms;
+
+    while (!history.empty() && history.front().start + oldest < start)
+    {
+        history.pop_front();
+    }
+
+    current.start = start;
+    current.reportCount = 0;
+    current.registers.assign(static_cast<size_t>(1) << params.precision, 0);
+}
+
+const DeviceCounter::Window *DeviceCounter::windowFind(const uint64_t start) const
+{
+    if (current.start == start)
+    {
+        return &current;
+    }
+
+    for (const auto &window : history)
+    {
+        if (window.start == start)
+        {
+            return &window;
+        }
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,1175 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "dfu_engine.h"
+
+#include "adapter_internal.h"
+
+#include "ble_gap.h"
+#include "ble_gattc.h"
+#include "nrf_error.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    // Secure DFU service and characteristics
+    const uint16_t DFU_SERVICE_UUID = 0xFE59;
+    const uint16_t DFU_CONTROL_POINT_UUID = 0x0001;
+    const uint16_t DFU_PACKET_UUID = 0x0002;
+    const ble_uuid128_t DFU_BASE_UUID = {{ 0x50, 0xEA, 0xDA, 0x30, 0x88, 0x83, 0xB8, 0x9F, 0x60, 0x4F, 0x15, 0xF3, 0x00, 0x00, 0xC9, 0x8E }};
+
+    // Control point op codes and result codes
+    const uint8_t DFU_OP_CREATE = 0x01;
+    const uint8_t DFU_OP_PRN_SET = 0x02;
+    const uint8_t DFU_OP_CRC_GET = 0x03;
+    const uint8_t DFU_OP_EXECUTE = 0x04;
+    const uint8_t DFU_OP_SELECT = 0x06;
+    const uint8_t DFU_OP_RESPONSE = 0x60;
+    const uint8_t DFU_RES_SUCCESS = 0x01;
+    const uint8_t DFU_OBJ_TYPE_COMMAND = 0x01;
+    const uint8_t DFU_OBJ_TYPE_DATA = 0x02;
+
+    // Adaptation of packet receipt notifications and object size
+    const uint16_t PRN_INITIAL_ON_ERROR = 16;       // PRN interval used after the first CRC error
+    const uint16_t PRN_MAX = 64;                    // Above this PRN is disabled again
+    const uint32_t OBJECT_SIZE_MIN = 1024;          // Smallest data object created after CRC errors
+    const uint32_t SUCCESS_COUNT_RELAX = 4;         // Objects without errors before PRN and object size are relaxed
+    const uint32_t CRC_ERRORS_MAX = 10;             // CRC errors before the transfer is given up
+
+    const uint16_t ATT_MTU_DEFAULT = 23;
+    const uint16_t ATT_HEADER_SIZE = 3;
+
+    // Events generated by the engine itself
+    const uint16_t EVENT_START = 0xFFFE;
+    const uint16_t EVENT_ABORT = 0xFFFF;
+
+    uint32_t crc32Compute(const uint8_t *data, const uint32_t size, const uint32_t *previousCrc)
+    {
+        uint32_t crc = (previousCrc == nullptr) ? 0xFFFFFFFF : ~(*previousCrc);
+
+        for (uint32_t i = 0; i < size; i++)
+        {
+            crc = crc ^ data[i];
+
+            for (uint32_t j = 8; j > 0; j--)
+            {
+                crc = (crc >> 1) ^ (0xEDB88320U & ((crc & 1) ? 0xFFFFFFFF : 0));
+            }
+        }
+
+        return ~crc;
+    }
+
+    void uint32Push(std::vector<uint8_t> &data, const uint32_t value)
+    {
+        data.push_back(static_cast<uint8_t>(value));
+        data.push_back(static_cast<uint8_t>(value >> 8));
+        data.push_back(static_cast<uint8_t>(value >> 16));
+        data.push_back(static_cast<uint8_t>(value >> 24));
+    }
+
+    uint32_t uint32Get(const std::vector<uint8_t> &data, const size_t index)
+    {
+        return static_cast<uint32_t>(data[index])
+            | (static_cast<uint32_t>(data[index + 1]) << 8)
+            | (static_cast<uint32_t>(data[index + 2]) << 16)
+            | (static_cast<uint32_t>(data[index + 3]) << 24);
+    }
+
+    uint32_t elapsedMs(const std::chrono::steady_clock::time_point &since)
+    {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - since).count());
+    }
+}
+
+DfuEngine::DfuEngine(dfu_engine_t *_handle, adapter_t *adapters[], const uint8_t adapterCount, sd_rpc_dfu_result_handler_t _resultHandler)
+    : handle(_handle), resultHandler(_resultHandler), completedCount(0), failedCount(0),
+    runWorkerThread(false)
+{
+    for (uint8_t i = 0; i < adapterCount; i++)
+    {
+        Lane lane;
+        lane.adapter = adapters[i];
+        lane.adapterInternal = static_cast<AdapterInternal *>(adapters[i]->internal);
+        lane.uuidType = BLE_UUID_TYPE_UNKNOWN;
+        lanes.push_back(lane);
+    }
+}
+
+DfuEngine::~DfuEngine()
+{
+    close();
+}
+
+uint32_t DfuEngine::open()
+{
+    for (auto &lane : lanes)
+    {
+        auto errCode = sd_ble_uuid_vs_add(lane.adapter, &DFU_BASE_UUID, &lane.uuidType);
+
+        if (errCode != NRF_SUCCESS)
+        {
+            return errCode;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+    runWorkerThread = true;
+    workerThread.start(shared_from_this(), &DfuEngine::workerRunner);
+
+    return NRF_SUCCESS;
+}
+
+void DfuEngine::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        runWorkerThread = false;
+        workerWaitCondition.notify_all();
+    }
+
+    // Closed from the result handler the thread is detached, it keeps the engine alive until it has returned
+    workerThread.stop();
+}
+
+uint32_t DfuEngine::start(adapter_t *adapter, const uint16_t connHandle, const sd_rpc_dfu_image_t *image, void *context)
+{
+    if (image == nullptr || image->p_init_packet == nullptr || image->p_firmware == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    const auto lane = laneFind(adapter);
+
+    if (lane == lanes.size())
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+
+        if (sessionFind(lane, connHandle) != nullptr)
+        {
+            return NRF_ERROR_INVALID_STATE;
+        }
+
+        Session session;
+        session.lane = lane;
+        session.connHandle = connHandle;
+        session.context = context;
+        session.initPacket.assign(image->p_init_packet, image->p_init_packet + image->init_packet_len);
+        session.firmware.assign(image->p_firmware, image->p_firmware + image->firmware_len);
+        session.state = STATE_DISCOVER_SERVICE;
+        session.dataPhase = false;
+        session.recovering = false;
+        session.serviceEnd = 0;
+        session.controlPointHandle = BLE_GATT_HANDLE_INVALID;
+        session.cccdHandle = BLE_GATT_HANDLE_INVALID;
+        session.packetHandle = BLE_GATT_HANDLE_INVALID;
+        session.maxObjectSize = 0;
+        session.objectSize = 0;
+        session.objectStart = 0;
+        session.objectEnd = 0;
+        session.offset = 0;
+        session.prn = 0;
+        session.prnConfigured = 0;
+        session.packetsSinceReceipt = 0;
+        session.waitingReceipt = false;
+        session.waitingTx = false;
+        session.crcErrors = 0;
+        session.successCount = 0;
+        session.crcOffset = 0;
+        session.crcValue = 0;
+        session.resumedOffset = 0;
+        session.dataStarted = std::chrono::steady_clock::now();
+        session.result = NRF_SUCCESS;
+        session.dfuResult = 0;
+        session.aborted = false;
+        sessions.push_back(session);
+    }
+
+    Event event;
+    event.lane = lane;
+    event.id = EVENT_START;
+    event.connHandle = connHandle;
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+    eventQueue.push(event);
+    workerWaitCondition.notify_all();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t DfuEngine::abort(adapter_t *adapter, const uint16_t connHandle)
+{
+    const auto lane = laneFind(adapter);
+
+    {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+
+        if (lane == lanes.size() || sessionFind(lane, connHandle) == nullptr)
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+    }
+
+    Event event;
+    event.lane = lane;
+    event.id = EVENT_ABORT;
+    event.connHandle = connHandle;
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+    eventQueue.push(event);
+    workerWaitCondition.notify_all();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t DfuEngine::progressGet(adapter_t *adapter, const uint16_t connHandle, sd_rpc_dfu_progress_t *progress) const
+{
+    if (progress == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    const auto lane = laneFind(adapter);
+
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    auto session = lane < lanes.size() ? sessionFind(lane, connHandle) : nullptr;
+
+    if (session == nullptr)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    progress->offset = session->dataPhase ? session->offset : 0;
+    progress->size = static_cast<uint32_t>(session->firmware.size());
+    progress->bytes_per_second = bytesPerSecond(session);
+    progress->prn = session->prn;
+    progress->object_size = session->objectSize;
+    progress->crc_errors = session->crcErrors;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t DfuEngine::statsGet(sd_rpc_dfu_stats_t *stats) const
+{
+    if (stats == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(sessionMutex);
+
+    stats->active_count = static_cast<uint32_t>(sessions.size());
+    stats->completed_count = completedCount;
+    stats->failed_count = failedCount;
+    stats->bytes_per_second = 0;
+
+    for (const auto &session : sessions)
+    {
+        stats->bytes_per_second += bytesPerSecond(&session);
+    }
+
+    return NRF_SUCCESS;
+}
+
+// Event Thread
+void DfuEngine::eventProcess(AdapterInternal *adapter, const ble_evt_t *event)
+{
+    Event copy;
+    copy.lane = lanes.size();
+
+    for (size_t i = 0; i < lanes.size(); i++)
+    {
+        if (lanes[i].adapterInternal == adapter)
+        {
+            copy.lane = i;
+        }
+    }
+
+    if (copy.lane == lanes.size())
+    {
+        return;
+    }
+
+    copy.id = event->header.evt_id;
+    copy.gattStatus = event->evt.gattc_evt.gatt_status;
+    copy.handle = BLE_GATT_HANDLE_INVALID;
+    copy.count = 0;
+    copy.rangeEnd = 0;
+
+    switch (event->header.evt_id)
+    {
+        case BLE_GAP_EVT_DISCONNECTED:
+            copy.connHandle = event->evt.gap_evt.conn_handle;
+            break;
+#if NRF_SD_BLE_API_VERSION >= 4
+        case BLE_GATTC_EVT_WRITE_CMD_TX_COMPLETE:
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+            copy.count = event->evt.gattc_evt.params.write_cmd_tx_complete.count;
+            break;
+#else
+        case BLE_EVT_TX_COMPLETE:
+            copy.connHandle = event->evt.common_evt.conn_handle;
+            copy.count = event->evt.common_evt.params.tx_complete.count;
+            break;
+#endif
+        case BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP:
+        {
+            const auto &rsp = event->evt.gattc_evt.params.prim_srvc_disc_rsp;
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+
+            if (rsp.count > 0)
+            {
+                copy.handle = rsp.services[0].handle_range.start_handle;
+                copy.rangeEnd = rsp.services[0].handle_range.end_handle;
+                copy.count = rsp.count;
+            }
+            break;
+        }
+        case BLE_GATTC_EVT_CHAR_DISC_RSP:
+        {
+            const auto &rsp = event->evt.gattc_evt.params.char_disc_rsp;
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+            copy.chars.assign(rsp.chars, rsp.chars + rsp.count);
+            break;
+        }
+        case BLE_GATTC_EVT_DESC_DISC_RSP:
+        {
+            const auto &rsp = event->evt.gattc_evt.params.desc_disc_rsp;
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+            copy.descs.assign(rsp.descs, rsp.descs + rsp.count);
+            break;
+        }
+        case BLE_GATTC_EVT_WRITE_RSP:
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+            copy.handle = event->evt.gattc_evt.params.write_rsp.handle;
+            break;
+        case BLE_GATTC_EVT_HVX:
+        {
+            const auto &hvx = event->evt.gattc_evt.params.hvx;
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+            copy.handle = hvx.handle;
+            copy.data.assign(hvx.data, hvx.data + hvx.len);
+            break;
+        }
+        case BLE_GATTC_EVT_TIMEOUT:
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+            break;
+        default:
+            return;
+    }
+
+    {
+        // Events of connections without a transfer are not queued
+        std::lock_guard<std::mutex> lock(sessionMutex);
+
+        if (sessionFind(copy.lane, copy.connHandle) == nullptr)
+        {
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+    eventQueue.push(copy);
+    workerWaitCondition.notify_all();
+}
+
+std::vector<AdapterInternal *> DfuEngine::adaptersGet() const
+{
+    std::vector<AdapterInternal *> adapters;
+
+    for (const auto &lane : lanes)
+    {
+        adapters.push_back(lane.adapterInternal);
+    }
+
+    return adapters;
+}
+
+// Worker Thread
+void DfuEngine::workerRunner()
+{
+    std::unique_lock<std::mutex> queueLock(queueMutex);
+
+    while (runWorkerThread && workerThread.isCurrent())
+    {
+        if (eventQueue.empty())
+        {
+            workerWaitCondition.wait(queueLock);
+            continue;
+        }
+
+        const auto event = eventQueue.front();
+        eventQueue.pop();
+        queueLock.unlock();
+
+        {
+            std::lock_guard<std::mutex> sessionLock(sessionMutex);
+            eventHandle(event);
+        }
+
+        std::vector<std::pair<adapter_t *, sd_rpc_dfu_result_t>> finished;
+        finished.swap(results);
+
+        for (auto &result : finished)
+        {
+            // The handle is not valid any more when the engine was deleted from the result handler
+            if (resultHandler == nullptr || !workerThread.isCurrent())
+            {
+                break;
+            }
+
+            resultHandler(handle, result.first, &result.second);
+        }
+
+        queueLock.lock();
+    }
+}
+
+void DfuEngine::eventHandle(const Event &event)
+{
+    auto session = sessionFind(event.lane, event.connHandle);
+
+    if (session == nullptr)
+    {
+        return;
+    }
+
+    switch (event.id)
+    {
+        case EVENT_START:
+            sessionStart(session);
+            break;
+        case EVENT_ABORT:
+            session->aborted = true;
+            fail(session, NRF_ERROR_INVALID_STATE);
+            break;
+        case BLE_GAP_EVT_DISCONNECTED:
+            fail(session, NRF_ERROR_INVALID_STATE);
+            break;
+        case BLE_GATTC_EVT_TIMEOUT:
+            fail(session, NRF_ERROR_TIMEOUT);
+            break;
+#if NRF_SD_BLE_API_VERSION >= 4
+        case BLE_GATTC_EVT_WRITE_CMD_TX_COMPLETE:
+#else
+        case BLE_EVT_TX_COMPLETE:
+#endif
+            if (session->state == STATE_STREAM && session->waitingTx)
+            {
+                session->waitingTx = false;
+                stream(session);
+            }
+            break;
+        case BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP:
+            serviceDiscoverRspHandle(session, event);
+            break;
+        case BLE_GATTC_EVT_CHAR_DISC_RSP:
+            characteristicDiscoverRspHandle(session, event);
+            break;
+        case BLE_GATTC_EVT_DESC_DISC_RSP:
+            descriptorDiscoverRspHandle(session, event);
+            break;
+        case BLE_GATTC_EVT_WRITE_RSP:
+            writeRspHandle(session, event);
+            break;
+        case BLE_GATTC_EVT_HVX:
+            if (event.handle == session->controlPointHandle)
+            {
+                controlPointHandle(session, event.data);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void DfuEngine::sessionStart(Session *session)
+{
+    ble_uuid_t serviceUuid;
+    serviceUuid.type = BLE_UUID_TYPE_BLE;
+    serviceUuid.uuid = DFU_SERVICE_UUID;
+
+    session->state = STATE_DISCOVER_SERVICE;
+    auto errCode = sd_ble_gattc_primary_services_discover(lanes[session->lane].adapter, session->connHandle, 1, &serviceUuid);
+
+    if (errCode != NRF_SUCCESS)
+    {
+        fail(session, errCode);
+    }
+}
+
+void DfuEngine::serviceDiscoverRspHandle(Session *session, const Event &event)
+{
+    if (session->state != STATE_DISCOVER_SERVICE)
+    {
+        return;
+    }
+
+    if (event.gattStatus != BLE_GATT_STATUS_SUCCESS || event.count == 0)
+    {
+        fail(session, NRF_ERROR_NOT_FOUND);
+        return;
+    }
+
+    session->state = STATE_DISCOVER_CHARACTERISTICS;
+    session->serviceEnd = event.rangeEnd;
+
+    ble_gattc_handle_range_t range;
+    range.start_handle = event.handle;
+    range.end_handle = event.rangeEnd;
+
+    auto errCode = sd_ble_gattc_characteristics_discover(lanes[session->lane].adapter, session->connHandle, &range);
+
+    if (errCode != NRF_SUCCESS)
+    {
+        fail(session, errCode);
+    }
+}
+
+void DfuEngine::characteristicDiscoverRspHandle(Session *session, const Event &event)
+{
+    if (session->state != STATE_DISCOVER_CHARACTERISTICS)
+    {
+        return;
+    }
+
+    const auto uuidType = lanes[session->lane].uuidType;
+    uint16_t lastHandle = session->serviceEnd;
+
+    if (event.gattStatus == BLE_GATT_STATUS_SUCCESS)
+    {
+        for (const auto &characteristic : event.chars)
+        {
+            if (characteristic.uuid.type == uuidType && characteristic.uuid.uuid == DFU_CONTROL_POINT_UUID)
+            {
+                session->controlPointHandle = characteristic.handle_value;
+            }
+            else if (characteristic.uuid.type == uuidType && characteristic.uuid.uuid == DFU_PACKET_UUID)
+            {
+                session->packetHandle = characteristic.handle_value;
+            }
+
+            lastHandle = characteristic.handle_value;
+        }
+    }
+
+    ble_gattc_handle_range_t range;
+    range.end_handle = session->serviceEnd;
+
+    if (session->controlPointHandle != BLE_GATT_HANDLE_INVALID && session->packetHandle != BLE_GATT_HANDLE_INVALID)
+    {
+        session->state = STATE_DISCOVER_CCCD;
+        range.start_handle = session->controlPointHandle + 1;
+        auto errCode = sd_ble_gattc_descriptors_discover(lanes[session->lane].adapter, session->connHandle, &range);
+
+        if (errCode != NRF_SUCCESS)
+        {
+            fail(session, errCode);
+        }
+    }
+    else if (event.gattStatus == BLE_GATT_STATUS_SUCCESS && !event.chars.empty() && lastHandle < session->serviceEnd)
+    {
+        range.start_handle = lastHandle + 1;
+        auto errCode = sd_ble_gattc_characteristics_discover(lanes[session->lane].adapter, session->connHandle, &range);
+
+        if (errCode != NRF_SUCCESS)
+        {
+            fail(session, errCode);
+        }
+    }
+    else
+    {
+        fail(session, NRF_ERROR_NOT_FOUND);
+    }
+}
+
+void DfuEngine::descriptorDiscoverRspHandle(Session *session, const Event &event)
+{
+    if (session->state != STATE_DISCOVER_CCCD)
+    {
+        return;
+    }
+
+    for (const auto &descriptor : event.descs)
+    {
+        // The descriptors of the control point end at the next characteristic declaration
+        if (descriptor.uuid.type == BLE_UUID_TYPE_BLE && descriptor.uuid.uuid == BLE_UUID_CHARACTERISTIC)
+        {
+            break;
+        }
+
+        if (descriptor.uuid.type == BLE_UUID_TYPE_BLE && descriptor.uuid.uuid == BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG)
+        {
+            session->cccdHandle = descriptor.handle;
+            break;
+        }
+    }
+
+    if (event.gattStatus != BLE_GATT_STATUS_SUCCESS || session->cccdHandle == BLE_GATT_HANDLE_INVALID)
+    {
+        fail(session, NRF_ERROR_NOT_FOUND);
+        return;
+    }
+
+    session->state = STATE_ENABLE_NOTIFICATIONS;
+
+    uint8_t value[] = { BLE_GATT_HVX_NOTIFICATION, 0x00 };
+    ble_gattc_write_params_t writeParams;
+    std::memset(&writeParams, 0, sizeof(writeParams));
+    writeParams.write_op = BLE_GATT_OP_WRITE_REQ;
+    writeParams.handle = session->cccdHandle;
+    writeParams.len = sizeof(value);
+    writeParams.p_value = value;
+
+    auto errCode = sd_ble_gattc_write(lanes[session->lane].adapter, session->connHandle, &writeParams);
+
+    if (errCode != NRF_SUCCESS)
+    {
+        fail(session, errCode);
+    }
+}
+
+void DfuEngine::writeRspHandle(Session *session, const Event &event)
+{
+    if (event.gattStatus != BLE_GATT_STATUS_SUCCESS)
+    {
+        fail(session, NRF_ERROR_INTERNAL);
+        return;
+    }
+
+    if (session->state == STATE_ENABLE_NOTIFICATIONS && event.handle == session->cccdHandle)
+    {
+        // Start without packet receipt notifications, they are enabled on CRC errors
+        prnSet(session);
+    }
+
+    // Control point procedures continue when the response is notified
+}
+
+void DfuEngine::controlPointHandle(Session *session, const std::vector<uint8_t> &response)
+{
+    if (response.size() < 3 || response[0] != DFU_OP_RESPONSE)
+    {
+        return;
+    }
+
+    const auto opcode = response[1];
+    const auto result = response[2];
+
+    // Packet receipt notifications are CRC responses received while streaming
+    if (opcode == DFU_OP_CRC_GET && session->state == STATE_STREAM && result == DFU_RES_SUCCESS && response.size() >= 11)
+    {
+        const auto offset = uint32Get(response, 3);
+        const auto crc = uint32Get(response, 7);
+        session->waitingReceipt = false;
+        session->packetsSinceReceipt = 0;
+
+        if (offset > objectData(session).size() || crcGet(session, offset) != crc)
+        {
+            objectFailed(session);
+            return;
+        }
+
+        stream(session);
+        return;
+    }
+
+    // Responses to other requests than the outstanding one are stale receipts
+    const uint8_t expected[] = { 0, 0, 0, 0, DFU_OP_PRN_SET, DFU_OP_SELECT, DFU_OP_CREATE, 0, DFU_OP_CRC_GET, DFU_OP_EXECUTE };
+
+    if (opcode != expected[session->state])
+    {
+        return;
+    }
+
+    if (result != DFU_RES_SUCCESS)
+    {
+        if (session->state == STATE_EXECUTE && session->recovering)
+        {
+            // The recovered object may already have been executed
+            executeRspHandle(session);
+            return;
+        }
+
+        fail(session, NRF_ERROR_INTERNAL, result);
+        return;
+    }
+
+    switch (session->state)
+    {
+        case STATE_SET_PRN:
+            session->prnConfigured = session->prn;
+
+            if (session->maxObjectSize == 0 && !session->dataPhase)
+            {
+                select(session);
+            }
+            else
+            {
+                objectCreate(session, session->objectStart);
+            }
+            break;
+        case STATE_SELECT:
+            if (response.size() < 15)
+            {
+                fail(session, NRF_ERROR_INVALID_LENGTH);
+                return;
+            }
+
+            selectRspHandle(session, uint32Get(response, 3), uint32Get(response, 7), uint32Get(response, 11));
+            break;
+        case STATE_CREATE:
+            session->state = STATE_STREAM;
+            session->packetsSinceReceipt = 0;
+            session->waitingReceipt = false;
+            session->waitingTx = false;
+            stream(session);
+            break;
+        case STATE_CALCULATE_CRC:
+            if (response.size() < 11)
+            {
+                fail(session, NRF_ERROR_INVALID_LENGTH);
+                return;
+            }
+
+            crcRspHandle(session, uint32Get(response, 3), uint32Get(response, 7));
+            break;
+        case STATE_EXECUTE:
+            executeRspHandle(session);
+            break;
+        default:
+            break;
+    }
+}
+
+void DfuEngine::prnSet(Session *session)
+{
+    std::vector<uint8_t> request = { DFU_OP_PRN_SET, static_cast<uint8_t>(session->prn), static_cast<uint8_t>(session->prn >> 8) };
+    controlPointWrite(session, STATE_SET_PRN, request);
+}
+
+void DfuEngine::select(Session *session)
+{
+    std::vector<uint8_t> request = { DFU_OP_SELECT, session->dataPhase ? DFU_OBJ_TYPE_DATA : DFU_OBJ_TYPE_COMMAND };
+    session->crcOffset = 0;
+    session->crcValue = 0;
+    controlPointWrite(session, STATE_SELECT, request);
+}
+
+void DfuEngine::selectRspHandle(Session *session, const uint32_t maxSize, const uint32_t offset, const uint32_t crc)
+{
+    const auto &data = objectData(session);
+    const auto size = static_cast<uint32_t>(data.size());
+
+    if (maxSize == 0)
+    {
+        fail(session, NRF_ERROR_INVALID_DATA);
+        return;
+    }
+
+    session->maxObjectSize = maxSize;
+
+    if (!session->dataPhase)
+    {
+        // The init packet is sent as one object, unless the target already has it
+        session->objectSize = maxSize;
+
+        if (size > maxSize)
+        {
+            fail(session, NRF_ERROR_DATA_SIZE);
+            return;
+        }
+
+        if (offset == size && size > 0 && crcGet(session, size) == crc)
+        {
+            session->recovering = true;
+            session->objectEnd = size;
+            session->offset = size;
+            controlPointWrite(session, STATE_EXECUTE, { DFU_OP_EXECUTE });
+            return;
+        }
+
+        objectCreate(session, 0);
+        return;
+    }
+
+    if (session->objectSize == 0)
+    {
+        session->objectSize = maxSize;
+    }
+
+    session->dataStarted = std::chrono::steady_clock::now();
+    session->resumedOffset = 0;
+
+    if (offset == 0 || offset > size)
+    {
+        objectCreate(session, 0);
+        return;
+    }
+
+    // Resume an interrupted transfer, the target keeps the data up to offset
+    const auto remainder = offset % maxSize;
+
+    if (crcGet(session, offset) != crc)
+    {
+        // Drop the corrupted object, the target goes back to the last executed object
+        const auto start = offset - (remainder != 0 ? remainder : maxSize);
+        session->resumedOffset = start;
+        objectCreate(session, start);
+        return;
+    }
+
+    session->resumedOffset = offset;
+    session->recovering = true;
+
+    if (remainder != 0 && offset != size)
+    {
+        // Complete the partial object
+        session->objectStart = offset - remainder;
+        session->objectEnd = std::min(session->objectStart + maxSize, size);
+        session->offset = offset;
+        session->state = STATE_STREAM;
+        session->packetsSinceReceipt = 0;
+        session->waitingReceipt = false;
+        session->waitingTx = false;
+        stream(session);
+        return;
+    }
+
+    session->objectStart = offset - (remainder != 0 ? remainder : std::min(maxSize, offset));
+    session->objectEnd = offset;
+    session->offset = offset;
+    controlPointWrite(session, STATE_EXECUTE, { DFU_OP_EXECUTE });
+}
+
+void DfuEngine::objectCreate(Session *session, const uint32_t start)
+{
+    const auto &data = objectData(session);
+    const auto size = static_cast<uint32_t>(data.size());
+
+    session->objectStart = start;
+    session->objectEnd = std::min(start + session->objectSize, size);
+    session->offset = start;
+
+    if (session->prn != session->prnConfigured)
+    {
+        prnSet(session);
+        return;
+    }
+
+    std::vector<uint8_t> request = { DFU_OP_CREATE, session->dataPhase ? DFU_OBJ_TYPE_DATA : DFU_OBJ_TYPE_COMMAND };
+    uint32Push(request, session->objectEnd - session->objectStart);
+    controlPointWrite(session, STATE_CREATE, request);
+}
+
+void DfuEngine::stream(Session *session)
+{
+    const auto &data = objectData(session);
+    auto &lane = lanes[session->lane];
+
+    sd_rpc_conn_state_t connState;
+    uint16_t chunkSize = ATT_MTU_DEFAULT - ATT_HEADER_SIZE;
+
+    if (lane.adapterInternal->connStateTracker.get(session->connHandle, &connState) == NRF_SUCCESS)
+    {
+        chunkSize = connState.att_mtu - ATT_HEADER_SIZE;
+    }
+
+    // Keep as many write commands in flight as the connection can buffer
+    while (session->offset < session->objectEnd && !session->waitingReceipt && !session->waitingTx)
+    {
+        const auto length = static_cast<uint16_t>(std::min<uint32_t>(chunkSize, session->objectEnd - session->offset));
+
+        ble_gattc_write_params_t writeParams;
+        std::memset(&writeParams, 0, sizeof(writeParams));
+        writeParams.write_op = BLE_GATT_OP_WRITE_CMD;
+        writeParams.handle = session->packetHandle;
+        writeParams.len = length;
+        writeParams.p_value = const_cast<uint8_t *>(&data[session->offset]);
+
+        auto errCode = sd_ble_gattc_write(lane.adapter, session->connHandle, &writeParams);
+
+#if NRF_SD_BLE_API_VERSION >= 4
+        if (errCode == NRF_ERROR_RESOURCES)
+#else
+        if (errCode == BLE_ERROR_NO_TX_PACKETS)
+#endif
+        {
+            session->waitingTx = true;
+            return;
+        }
+
+        if (errCode != NRF_SUCCESS)
+        {
+            fail(session, errCode);
+            return;
+        }
+
+        session->offset += length;
+        session->packetsSinceReceipt++;
+
+        if (session->prn > 0 && session->packetsSinceReceipt >= session->prn && session->offset < session->objectEnd)
+        {
+            session->waitingReceipt = true;
+        }
+    }
+
+    if (session->offset == session->objectEnd)
+    {
+        controlPointWrite(session, STATE_CALCULATE_CRC, { DFU_OP_CRC_GET });
+    }
+}
+
+void DfuEngine::crcRspHandle(Session *session, const uint32_t offset, const uint32_t crc)
+{
+    if (offset != session->objectEnd || crcGet(session, offset) != crc)
+    {
+        if (session->recovering)
+        {
+            // The partial object could not be completed, send it again
+            session->recovering = false;
+            objectCreate(session, session->objectStart);
+            return;
+        }
+
+        objectFailed(session);
+        return;
+    }
+
+    controlPointWrite(session, STATE_EXECUTE, { DFU_OP_EXECUTE });
+}
+
+void DfuEngine::objectFailed(Session *session)
+{
+    session->crcErrors++;
+    session->successCount = 0;
+
+    if (session->crcErrors > CRC_ERRORS_MAX)
+    {
+        fail(session, NRF_ERROR_INVALID_DATA);
+        return;
+    }
+
+    // Ask for receipts more often and send smaller objects to lose less on the next error
+    session->prn = (session->prn == 0) ? PRN_INITIAL_ON_ERROR : std::max<uint16_t>(1, session->prn / 2);
+
+    if (session->dataPhase)
+    {
+        session->objectSize = std::max(session->objectSize / 2, std::min(OBJECT_SIZE_MIN, session->maxObjectSize));
+    }
+
+    session->waitingReceipt = false;
+    session->waitingTx = false;
+
+    // Creating the object again restarts it from the last executed object
+    objectCreate(session, session->objectStart);
+}
+
+void DfuEngine::executeRspHandle(Session *session)
+{
+    session->recovering = false;
+
+    if (!session->dataPhase)
+    {
+        session->dataPhase = true;
+        session->maxObjectSize = 0;
+        session->objectSize = 0;
+        select(session);
+        return;
+    }
+
+    // Relax the settings again after a run of objects without errors
+    if (++session->successCount >= SUCCESS_COUNT_RELAX)
+    {
+        session->successCount = 0;
+
+        if (session->prn > 0)
+        {
+            session->prn = (session->prn * 2 > PRN_MAX) ? 0 : session->prn * 2;
+        }
+
+        session->objectSize = std::min(session->objectSize * 2, session->maxObjectSize);
+    }
+
+    if (session->objectEnd >= session->firmware.size())
+    {
+        finish(session);
+        return;
+    }
+
+    objectCreate(session, session->objectEnd);
+}
+
+void DfuEngine::controlPointWrite(Session *session, const State state, const std::vector<uint8_t> &request)
+{
+    session->state = state;
+
+    ble_gattc_write_params_t writeParams;
+    std::memset(&writeParams, 0, sizeof(writeParams));
+    writeParams.write_op = BLE_GATT_OP_WRITE_REQ;
+    writeParams.handle = session->controlPointHandle;
+    writeParams.len = static_cast<uint16_t>(request.size());
+    writeParams.p_value = const_cast<uint8_t *>(request.data());
+
+    auto errCode = sd_ble_gattc_write(lanes[session->lane].adapter, session->connHandle, &writeParams);
+
+    if (errCode != NRF_SUCCESS)
+    {
+        fail(session, errCode);
+    }
+}
+
+const std::vector<uint8_t> &DfuEngine::objectData(const Session *session) const
+{
+    return session->dataPhase ? session->firmware : session->initPacket;
+}
+
+uint32_t DfuEngine::crcGet(Session *session, const uint32_t length) const
+{
+    const auto &data = objectData(session);
+
+    // The CRC is kept up to the last offset checked, most checks continue from there
+    if (length < session->crcOffset)
+    {
+        session->crcOffset = 0;
+        session->crcValue = 0;
+    }
+
+    if (length > session->crcOffset)
+    {
+        session->crcValue = crc32Compute(&data[session->crcOffset], length - session->crcOffset,
+                                         session->crcOffset == 0 ? nullptr : &session->crcValue);
+        session->crcOffset = length;
+    }
+
+    return session->crcOffset == 0 ? 0 : session->crcValue;
+}
+
+void DfuEngine::fail(Session *session, const uint32_t result, const uint8_t dfuResult)
+{
+    session->result = result;
+    session->dfuResult = dfuResult;
+    finish(session);
+}
+
+void DfuEngine::finish(Session *session)
+{
+    sd_rpc_dfu_result_t result;
+    result.conn_handle = session->connHandle;
+    result.p_context = session->context;
+    result.result = session->result;
+    result.dfu_result = session->dfuResult;
+    result.resumed_offset = session->resumedOffset;
+    result.bytes = session->dataPhase ? session->offset - session->resumedOffset : 0;
+    result.duration_ms = session->dataPhase ? elapsedMs(session->dataStarted) : 0;
+    result.bytes_per_second = bytesPerSecond(session);
+    result.crc_errors = session->crcErrors;
+
+    if (session->result == NRF_SUCCESS)
+    {
+        completedCount++;
+    }
+    else
+    {
+        failedCount++;
+    }
+
+    results.push_back(std::make_pair(lanes[session->lane].adapter, result));
+    sessions.remove_if([session](const Session &other) { return &other == session; });
+}
+
+uint32_t DfuEngine::bytesPerSecond(const Session *session) const
+{
+    if (!session->dataPhase || session->offset <= session->resumedOffset)
+    {
+        return 0;
+    }
+
+    const auto elapsed = elapsedMs(session->dataStarted);
+
+    if (elapsed == 0)
+    {
+        return 0;
+    }
+
+    return static_cast<uint32_t>(uint64_t(session->offset - session->resumedOffset) * 1000 / elapsed);
+}
+
+DfuEngine::Session *DfuEngine::sessionFind(const size_t lane, const uint16_t connHandle)
+{
+    for (auto &session : sessions)
+    {
+        if (session.lane == lane && session.connHandle == connHandle)
+        {
+            return &session;
+        }
+    }
+
+    return nullptr;
+}
+
+const DfuEngine::Session *DfuEngine::sessionFind(const size_t lane, const uint16_t connHandle) const
+{
+    for (auto &session : sessions)
+    {
+        if (session.lane == lane && session.connHandle == connHandle)
+        {
+            return &session;
+        }
+    }
+
+    return nullptr;
+}
+
+size_t DfuEngine::laneFind(const adapter_t *adapter) const
+{
+    for (size_t i = 0; i < lanes.size(); i++)
+    {
+        if (adapter != nullptr && lanes[i].adapterInternal == adapter->internal)
+        {
+            return i;
+        }
+    }
+
+    return lanes.size();
+}
@@ -0,0 +1,873 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "event_bridge.h"
+
+#include "ble_serialization.h"
+#include "nrf_error.h"
+
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <thread>
+
+#ifdef PC_BLE_DRIVER_ZLIB
+#include <zlib.h>
+#endif
+
+#if BOOST_VERSION >= 106600
+typedef boost::asio::io_context bridge_io_context;
+#else
+typedef boost::asio::io_service bridge_io_context;
+#endif
+
+namespace {
+    const uint8_t PROTOCOL_VERSION = 1;
+
+    const uint8_t MESSAGE_HELLO = 0x00;
+    const uint8_t MESSAGE_SUBSCRIBE = 0x01;
+    const uint8_t MESSAGE_CREDIT = 0x02;
+    const uint8_t MESSAGE_BATCH = 0x10;
+    const uint8_t MESSAGE_BATCH_COMPRESSED = 0x11;
+
+    const uint8_t CONTENT_FRAME = 0x01;
+    const uint8_t CONTENT_DECODED = 0x02;
+    const uint8_t FLAG_COMPRESSION = 0x01;
+
+    // Largest message accepted from a subscriber, room for about a thousand filters
+    const uint32_t MESSAGE_LENGTH_MAX = 4096;
+
+    // Length, type, sequence number, events dropped and number of events
+    const size_t BATCH_HEADER_SIZE = 15;
+
+    // Content, event id, time and length
+    const size_t ENTRY_HEADER_SIZE = 13;
+
+    // Size of the buffer events are decoded to by the serialization transport
+    const uint32_t DECODED_EVENT_LENGTH_MAX = 700;
+
+    void uint16Put(uint8_t *buffer, const uint16_t value)
+    {
+        buffer[0] = static_cast<uint8_t>(value);
+        buffer[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    void uint32Put(uint8_t *buffer, const uint32_t value)
+    {
+        uint16Put(buffer, static_cast<uint16_t>(value));
+        uint16Put(buffer + 2, static_cast<uint16_t>(value >> 16));
+    }
+
+    void uint64Put(uint8_t *buffer, const uint64_t value)
+    {
+        uint32Put(buffer, static_cast<uint32_t>(value));
+        uint32Put(buffer + 4, static_cast<uint32_t>(value >> 32));
+    }
+
+    uint16_t uint16Get(const uint8_t *buffer)
+    {
+        return static_cast<uint16_t>(buffer[0] | (buffer[1] << 8));
+    }
+
+    uint32_t uint32Get(const uint8_t *buffer)
+    {
+        return uint16Get(buffer) | (static_cast<uint32_t>(uint16Get(buffer + 2)) << 16);
+    }
+
+    bool compressionSupported()
+    {
+#ifdef PC_BLE_DRIVER_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Deflates the events of a batch, preceded by their uncompressed length. Returns false if the
+    // events can not be compressed, the batch is then sent uncompressed.
+    bool batchCompress(const std::vector<uint8_t> &events, std::vector<uint8_t> &compressed)
+    {
+#ifdef PC_BLE_DRIVER_ZLIB
+        auto compressedLength = compressBound(static_cast<uLong>(events.size()));
+        compressed.resize(sizeof(uint32_t) + compressedLength);
+        uint32Put(compressed.data(), static_cast<uint32_t>(events.size()));
+
+        if (compress2(compressed.data() + sizeof(uint32_t), &compressedLength, events.data(),
+                      static_cast<uLong>(events.size()), Z_BEST_SPEED) != Z_OK)
+        {
+            return false;
+        }
+
+        compressed.resize(sizeof(uint32_t) + compressedLength);
+        return true;
+#else
+        (void)events;
+        (void)compressed;
+        return false;
+#endif
+    }
+}
+
+struct EventBridgeIo
+{
+    EventBridgeIo() : service(), flushTimer(service) {}
+
+    bridge_io_context service;
+    boost::asio::steady_timer flushTimer;
+    std::unique_ptr<boost::asio::ip::tcp::acceptor> tcpAcceptor;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    std::unique_ptr<boost::asio::local::stream_protocol::acceptor> unixAcceptor;
+#endif
+    std::thread thread;
+};
+
+/**
+ * @brief A subscriber connected to the event bridge. All functions are called on the IO service thread.
+ */
+class EventBridgeSubscriber : public std::enable_shared_from_this<EventBridgeSubscriber>
+{
+public:
+    explicit EventBridgeSubscriber(EventBridge *bridge);
+    virtual ~EventBridgeSubscriber() {}
+
+    /**@brief Sends HELLO and starts reading messages from the subscriber. */
+    void start();
+
+    /**@brief Closes the socket and removes the subscriber from the bridge. */
+    void close();
+
+    /**@brief Queues a batch and sends it if the subscriber has credit. */
+    void batchQueue(const std::shared_ptr<const std::vector<uint8_t>> &events, const uint16_t count, const bool compressed);
+
+    /**@brief Returns true if the subscriber has selected the content and id of the event. */
+    bool accepts(const uint8_t content, const uint16_t eventId) const;
+
+    bool subscribed;
+    bool compress;
+    uint8_t content;
+
+    // Subscribers with the same key receive the same batches
+    std::string filterKey;
+
+protected:
+    typedef std::function<void(const boost::system::error_code &, const size_t)> io_handler_t;
+
+    virtual void socketRead(const boost::asio::mutable_buffer &buffer, io_handler_t handler) = 0;
+    virtual void socketWrite(const std::vector<boost::asio::const_buffer> &buffers, io_handler_t handler) = 0;
+    virtual void socketClose() = 0;
+
+private:
+    struct Batch
+    {
+        std::shared_ptr<const std::vector<uint8_t>> events;
+        uint16_t count;
+        bool compressed;
+    };
+
+    void lengthRead();
+    void messageRead(const uint32_t length);
+    bool messageProcess();
+    bool subscribe(const uint8_t *message, const uint32_t length);
+    void sendNext();
+    void writeDone(const boost::system::error_code &error, const size_t length);
+
+    EventBridge *bridge;
+
+    std::array<uint8_t, sizeof(uint32_t)> lengthBuffer;
+    std::vector<uint8_t> messageBuffer;
+    std::vector<std::pair<uint16_t, uint16_t>> filters;
+
+    std::deque<Batch> queue;
+    uint32_t credit;
+    uint32_t dropped;
+    uint32_t sequence;
+
+    std::array<uint8_t, BATCH_HEADER_SIZE> header;
+    std::shared_ptr<const std::vector<uint8_t>> sending;
+    bool writing;
+    bool closed;
+};
+
+template<typename Socket>
+class EventBridgeSession : public EventBridgeSubscriber
+{
+public:
+    EventBridgeSession(EventBridge *bridge, bridge_io_context &service)
+        : EventBridgeSubscriber(bridge), socket(service)
+    {}
+
+    Socket socket;
+
+protected:
+    void socketRead(const boost::asio::mutable_buffer &buffer, io_handler_t handler) override
+    {
+        boost::asio::async_read(socket, boost::asio::buffer(buffer), handler);
+    }
+
+    void socketWrite(const std::vector<boost::asio::const_buffer> &buffers, io_handler_t handler) override
+    {
+        boost::asio::async_write(socket, buffers, handler);
+    }
+
+    void socketClose() override
+    {
+        boost::system::error_code ignored;
+        socket.close(ignored);
+    }
+};
+
+EventBridgeSubscriber::EventBridgeSubscriber(EventBridge *_bridge)
+    : subscribed(false), compress(false), content(0), filterKey(), bridge(_bridge),
+    lengthBuffer(), messageBuffer(), filters(), queue(), credit(0), dropped(0), sequence(0),
+    header(), sending(), writing(false), closed(false)
+{}
+
+void EventBridgeSubscriber::start()
+{
+    auto hello = std::make_shared<std::vector<uint8_t>>(sizeof(uint32_t) + 3);
+    uint32Put(hello->data(), 3);
+    (*hello)[4] = MESSAGE_HELLO;
+    (*hello)[5] = PROTOCOL_VERSION;
+    (*hello)[6] = compressionSupported() ? FLAG_COMPRESSION : 0;
+
+    sending = hello;
+    writing = true;
+
+    auto self = shared_from_this();
+    socketWrite({ boost::asio::buffer(*hello) }, [self](const boost::system::error_code &error, const size_t length) {
+        self->writeDone(error, length);
+    });
+
+    lengthRead();
+}
+
+void EventBridgeSubscriber::close()
+{
+    if (closed)
+    {
+        return;
+    }
+
+    closed = true;
+    subscribed = false;
+    queue.clear();
+    socketClose();
+    bridge->subscriberRemove(this);
+}
+
+void EventBridgeSubscriber::batchQueue(const std::shared_ptr<const std::vector<uint8_t>> &events, const uint16_t count, const bool compressed)
+{
+    if (closed || !subscribed)
+    {
+        return;
+    }
+
+    // The subscriber is told how many events it missed in the next batch it receives
+    if (queue.size() >= bridge->params.queue_size)
+    {
+        dropped += queue.front().count;
+        bridge->eventsDropped += queue.front().count;
+        queue.pop_front();
+    }
+
+    Batch batch;
+    batch.events = events;
+    batch.count = count;
+    batch.compressed = compressed;
+    queue.push_back(batch);
+
+    sendNext();
+}
+
+bool EventBridgeSubscriber::accepts(const uint8_t eventContent, const uint16_t eventId) const
+{
+    if ((content & eventContent) == 0)
+    {
+        return false;
+    }
+
+    if (filters.empty())
+    {
+        return true;
+    }
+
+    return std::any_of(filters.begin(), filters.end(), [eventId](const std::pair<uint16_t, uint16_t> &filter) {
+        return eventId >= filter.first && eventId <= filter.second;
+    });
+}
+
+void EventBridgeSubscriber::lengthRead()
+{
+    auto self = shared_from_this();
+    socketRead(boost::asio::buffer(lengthBuffer), [self](const boost::system::error_code &error, const size_t) {
+        if (error)
+        {
+            self->close();
+            return;
+        }
+
+        const auto length = uint32Get(self->lengthBuffer.data());
+
+        if (length == 0 || length > MESSAGE_LENGTH_MAX)
+        {
+            self->close();
+            return;
+        }
+
+        self->messageRead(length);
+    });
+}
+
+void EventBridgeSubscriber::messageRead(const uint32_t length)
+{
+    messageBuffer.resize(length);
+
+    auto self = shared_from_this();
+    socketRead(boost::asio::buffer(messageBuffer), [self](const boost::system::error_code &error, const size_t) {
+        if (error || !self->messageProcess())
+        {
+            self->close();
+            return;
+        }
+
+        self->lengthRead();
+    });
+}
+
+bool EventBridgeSubscriber::messageProcess()
+{
+    const auto message = messageBuffer.data() + 1;
+    const auto length = static_cast<uint32_t>(messageBuffer.size() - 1);
+
+    switch (messageBuffer[0])
+    {
+        case MESSAGE_SUBSCRIBE:
+            if (!subscribe(message, length))
+            {
+                return false;
+            }
+            break;
+        case MESSAGE_CREDIT:
+            if (length != sizeof(uint32_t))
+            {
+                return false;
+            }
+
+            credit = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(credit) + uint32Get(message), UINT32_MAX));
+            break;
+        default:
+            return false;
+    }
+
+    sendNext();
+    return true;
+}
+
+bool EventBridgeSubscriber::subscribe(const uint8_t *message, const uint32_t length)
+{
+    if (length < 8)
+    {
+        return false;
+    }
+
+    const auto filterCount = uint16Get(message + 6);
+
+    if (length != 8 + filterCount * 2 * sizeof(uint16_t))
+    {
+        return false;
+    }
+
+    content = message[0] & (CONTENT_FRAME | CONTENT_DECODED);
+    compress = (message[1] & FLAG_COMPRESSION) != 0 && compressionSupported();
+    credit = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(credit) + uint32Get(message + 2), UINT32_MAX));
+
+    filters.clear();
+
+    for (uint16_t i = 0; i < filterCount; i++)
+    {
+        const auto filter = message + 8 + i * 2 * sizeof(uint16_t);
+        filters.emplace_back(uint16Get(filter), uint16Get(filter + sizeof(uint16_t)));
+    }
+
+    filterKey.assign(1, static_cast<char>(content | (compress ? 0x80 : 0)));
+    filterKey.append(reinterpret_cast<const char *>(message + 8), filterCount * 2 * sizeof(uint16_t));
+
+    subscribed = true;
+    bridge->contentUpdate();
+    return true;
+}
+
+void EventBridgeSubscriber::sendNext()
+{
+    if (writing || closed || credit == 0 || queue.empty())
+    {
+        return;
+    }
+
+    const auto batch = queue.front();
+    queue.pop_front();
+    credit--;
+
+    uint32Put(header.data(), static_cast<uint32_t>(BATCH_HEADER_SIZE - sizeof(uint32_t) + batch.events->size()));
+    header[4] = batch.compressed ? MESSAGE_BATCH_COMPRESSED : MESSAGE_BATCH;
+    uint32Put(header.data() + 5, sequence++);
+    uint32Put(header.data() + 9, dropped);
+    uint16Put(header.data() + 13, batch.count);
+    dropped = 0;
+
+    sending = batch.events;
+    writing = true;
+
+    bridge->eventsSent += batch.count;
+    bridge->batchesSent++;
+
+    auto self = shared_from_this();
+    socketWrite({ boost::asio::buffer(header), boost::asio::buffer(*sending) },
+        [self](const boost::system::error_code &error, const size_t length) {
+            self->writeDone(error, length);
+        });
+}
+
+void EventBridgeSubscriber::writeDone(const boost::system::error_code &error, const size_t length)
+{
+    writing = false;
+    sending.reset();
+
+    if (error)
+    {
+        close();
+        return;
+    }
+
+    bridge->bytesSent += length;
+    sendNext();
+}
+
+EventBridge::EventBridge()
+    : io(), params(), unixPath(), pending(), running(false), flushPosted(false), wantedContent(0),
+    subscribers(), port(0), subscriberCount(0), eventsSent(0), eventsDropped(0), batchesSent(0), bytesSent(0)
+{}
+
+EventBridge::~EventBridge()
+{
+    stop();
+}
+
+uint32_t EventBridge::start(const sd_rpc_event_bridge_params_t *_params)
+{
+    if (_params == nullptr || _params->address == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (_params->max_subscribers == 0 || _params->batch_size == 0 || _params->batch_delay_ms == 0 || _params->queue_size == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    std::lock_guard<std::mutex> controlLock(controlMutex);
+
+    if (io)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    std::unique_ptr<EventBridgeIo> newIo(new EventBridgeIo());
+    uint16_t boundPort = 0;
+
+    try
+    {
+        if (_params->socket == SD_RPC_EVENT_BRIDGE_TCP)
+        {
+            boost::system::error_code error;
+#if BOOST_VERSION >= 106600
+            const auto address = boost::asio::ip::make_address(_params->address, error);
+#else
+            const auto address = boost::asio::ip::address::from_string(_params->address, error);
+#endif
+
+            if (error)
+            {
+                return NRF_ERROR_INVALID_PARAM;
+            }
+
+            newIo->tcpAcceptor.reset(new boost::asio::ip::tcp::acceptor(newIo->service, boost::asio::ip::tcp::endpoint(address, _params->port)));
+            boundPort = newIo->tcpAcceptor->local_endpoint().port();
+        }
+        else if (_params->socket == SD_RPC_EVENT_BRIDGE_UNIX)
+        {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+            // A socket left behind by an earlier run can not be bound again
+            std::remove(_params->address);
+            newIo->unixAcceptor.reset(new boost::asio::local::stream_protocol::acceptor(newIo->service, boost::asio::local::stream_protocol::endpoint(_params->address)));
+            unixPath = _params->address;
+#else
+            return NRF_ERROR_NOT_SUPPORTED;
+#endif
+        }
+        else
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+    }
+    catch (std::exception &)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    params = *_params;
+    params.address = nullptr;
+    io = std::move(newIo);
+
+    port = boundPort;
+    subscriberCount = 0;
+    eventsSent = 0;
+    eventsDropped = 0;
+    batchesSent = 0;
+    bytesSent = 0;
+
+    if (io->tcpAcceptor)
+    {
+        acceptNext<boost::asio::ip::tcp::acceptor, boost::asio::ip::tcp::socket>(*io->tcpAcceptor);
+    }
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    if (io->unixAcceptor)
+    {
+        acceptNext<boost::asio::local::stream_protocol::acceptor, boost::asio::local::stream_protocol::socket>(*io->unixAcceptor);
+    }
+#endif
+
+    {
+        std::lock_guard<std::mutex> lock(bridgeMutex);
+        pending.clear();
+        flushPosted = false;
+        running = true;
+    }
+
+    flushSchedule();
+    io->thread = std::thread([this]() { io->service.run(); });
+
+    return NRF_SUCCESS;
+}
+
+uint32_t EventBridge::stop()
+{
+    std::lock_guard<std::mutex> controlLock(controlMutex);
+
+    if (!io)
+    {
+        return NRF_SUCCESS;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(bridgeMutex);
+        running = false;
+        pending.clear();
+    }
+
+    wantedContent = 0;
+
+    io->service.post([this]() {
+        boost::system::error_code ignored;
+        io->flushTimer.cancel(ignored);
+
+        if (io->tcpAcceptor)
+        {
+            io->tcpAcceptor->close(ignored);
+        }
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        if (io->unixAcceptor)
+        {
+            io->unixAcceptor->close(ignored);
+        }
+#endif
+
+        const auto current = subscribers;
+
+        for (auto &subscriber : current)
+        {
+            subscriber->close();
+        }
+
+        io->service.stop();
+    });
+
+    io->thread.join();
+    subscribers.clear();
+    io.reset();
+
+    if (!unixPath.empty())
+    {
+        std::remove(unixPath.c_str());
+        unixPath.clear();
+    }
+
+    port = 0;
+    subscriberCount = 0;
+    return NRF_SUCCESS;
+}
+
+uint32_t EventBridge::infoGet(sd_rpc_event_bridge_info_t *info) const
+{
+    if (info == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    info->port = port;
+    info->subscriber_count = subscriberCount;
+    info->events_sent = eventsSent;
+    info->events_dropped = eventsDropped;
+    info->batches_sent = batchesSent;
+    info->bytes_sent = bytesSent;
+    return NRF_SUCCESS;
+}
+
+void EventBridge::framePeek(const uint8_t *event, const uint32_t length)
+{
+    // Read Thread
+    if ((wantedContent & CONTENT_FRAME) == 0 || length < SER_EVT_HEADER_SIZE)
+    {
+        return;
+    }
+
+    entryAdd(CONTENT_FRAME, uint16Get(event + SER_EVT_ID_POS), event, length);
+}
+
+void EventBridge::process(const ble_evt_t *event)
+{
+    // Event Thread
+    if ((wantedContent & CONTENT_DECODED) == 0)
+    {
+        return;
+    }
+
+    const auto length = std::min<uint32_t>(sizeof(ble_evt_hdr_t) + event->header.evt_len, DECODED_EVENT_LENGTH_MAX);
+    entryAdd(CONTENT_DECODED, event->header.evt_id, reinterpret_cast<const uint8_t *>(event), length);
+}
+
+void EventBridge::entryAdd(const uint8_t content, const uint16_t eventId, const uint8_t *data, const uint32_t length)
+{
+    const auto eventLength = static_cast<uint16_t>(std::min<uint32_t>(length, UINT16_MAX));
+    const auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    Entry entry;
+    entry.content = content;
+    entry.eventId = eventId;
+    entry.encoded.resize(ENTRY_HEADER_SIZE + eventLength);
+
+    auto encoded = entry.encoded.data();
+    encoded[0] = content;
+    uint16Put(encoded + 1, eventId);
+    uint64Put(encoded + 3, static_cast<uint64_t>(now));
+    uint16Put(encoded + 11, eventLength);
+    std::memcpy(encoded + ENTRY_HEADER_SIZE, data, eventLength);
+
+    std::lock_guard<std::mutex> lock(bridgeMutex);
+
+    if (!running)
+    {
+        return;
+    }
+
+    pending.push_back(std::move(entry));
+
+    // A full batch is sent right away instead of waiting for the flush timer
+    if (pending.size() >= params.batch_size && !flushPosted)
+    {
+        flushPosted = true;
+        io->service.post(std::bind(&EventBridge::flush, this));
+    }
+}
+
+template<typename Acceptor, typename Socket>
+void EventBridge::acceptNext(Acceptor &acceptor)
+{
+    auto session = std::make_shared<EventBridgeSession<Socket>>(this, io->service);
+
+    acceptor.async_accept(session->socket, [this, &acceptor, session](const boost::system::error_code &error) {
+        if (!acceptor.is_open())
+        {
+            return;
+        }
+
+        if (!error)
+        {
+            subscriberAdd(session);
+        }
+
+        acceptNext<Acceptor, Socket>(acceptor);
+    });
+}
+
+void EventBridge::subscriberAdd(const std::shared_ptr<EventBridgeSubscriber> &subscriber)
+{
+    if (subscribers.size() >= params.max_subscribers)
+    {
+        subscriber->close();
+        return;
+    }
+
+    subscribers.push_back(subscriber);
+    subscriberCount = static_cast<uint16_t>(subscribers.size());
+    subscriber->start();
+}
+
+void EventBridge::subscriberRemove(const EventBridgeSubscriber *subscriber)
+{
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+        [subscriber](const std::shared_ptr<EventBridgeSubscriber> &current) { return current.get() == subscriber; }),
+        subscribers.end());
+
+    subscriberCount = static_cast<uint16_t>(subscribers.size());
+    contentUpdate();
+}
+
+void EventBridge::contentUpdate()
+{
+    uint8_t content = 0;
+
+    for (const auto &subscriber : subscribers)
+    {
+        if (subscriber->subscribed)
+        {
+            content |= subscriber->content;
+        }
+    }
+
+    wantedContent = content;
+}
+
+void EventBridge::flush()
+{
+    std::vector<Entry> entries;
+
+    {
+        std::lock_guard<std::mutex> lock(bridgeMutex);
+        entries.swap(pending);
+        flushPosted = false;
+    }
+
+    if (entries.empty() || subscribers.empty())
+    {
+        return;
+    }
+
+    struct EncodedBatch
+    {
+        std::shared_ptr<const std::vector<uint8_t>> events;
+        uint16_t count;
+        bool compressed;
+    };
+
+    for (size_t first = 0; first < entries.size(); first += params.batch_size)
+    {
+        const auto last = std::min<size_t>(first + params.batch_size, entries.size());
+
+        // Batches are encoded once per filter and shared by the subscribers using it
+        std::map<std::string, EncodedBatch> batches;
+
+        for (const auto &subscriber : subscribers)
+        {
+            if (!subscriber->subscribed)
+            {
+                continue;
+            }
+
+            auto batch = batches.find(subscriber->filterKey);
+
+            if (batch == batches.end())
+            {
+                EncodedBatch encodedBatch;
+                encodedBatch.count = 0;
+                encodedBatch.compressed = false;
+
+                auto events = std::make_shared<std::vector<uint8_t>>();
+
+                for (auto entry = entries.begin() + first; entry != entries.begin() + last; ++entry)
+                {
+                    if (subscriber->accepts(entry->content, entry->eventId))
+                    {
+                        events->insert(events->end(), entry->encoded.begin(), entry->encoded.end());
+                        encodedBatch.count++;
+                    }
+                }
+
+                if (encodedBatch.count > 0 && subscriber->compress)
+                {
+                    auto compressed = std::make_shared<std::vector<uint8_t>>();
+
+                    if (batchCompress(*events, *compressed))
+                    {
+                        events = compressed;
+                        encodedBatch.compressed = true;
+                    }
+                }
+
+                encodedBatch.events = events;
+                batch = batches.emplace(subscriber->filterKey, encodedBatch).first;
+            }
+
+            if (batch->second.count > 0)
+            {
+                subscriber->batchQueue(batch->second.events, batch->second.count, batch->second.compressed);
+            }
+        }
+    }
+}
+
+void EventBridge::flushSchedule()
+{
+    io->flushTimer.expires_from_now(std::chrono::milliseconds(params.batch_delay_ms));
+    io->flushTimer.async_wait([this](const boost::system::error_code &error) {
+        if (error == boost::asio::error::operation_aborted)
+        {
+            return;
+        }
+
+        flush();
+        flushSchedule();
+    });
+}
@@ -0,0 +1,523 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "failover_group.h"
+
+#include "adapter_internal.h"
+#include "ble_common.h"
+
+#include "ble_gap_app.h"
+#include "ble_serialization.h"
+#include "nrf_error.h"
+#include "ser_config.h"
+
+#include <cstring>
+#include <sstream>
+
+namespace {
+    // Duration to wait for a connection to be established again from the standby
+    const auto RECONNECT_TIMEOUT = std::chrono::seconds(30);
+
+    // Consecutive packets the primary failed to deliver before it is considered failed
+    const uint32_t FAILOVER_SEND_FAILURES = 3;
+
+    bool addressEqual(const ble_gap_addr_t &a, const ble_gap_addr_t &b)
+    {
+        return a.addr_type == b.addr_type && std::memcmp(a.addr, b.addr, BLE_GAP_ADDR_LEN) == 0;
+    }
+
+    uint32_t elapsedMs(const std::chrono::steady_clock::time_point &since)
+    {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - since).count());
+    }
+}
+
+FailoverGroup::FailoverGroup(AdapterInternal *_primary, AdapterInternal *_standby)
+    : primary(_primary), standby(_standby), runWorkerThread(false), failedOver(false),
+    failoverPending(false), failbackPending(false), sendFailureCount(0), reconnectDone(false),
+    reconnected(false)
+{
+    std::memset(&info, 0, sizeof(info));
+}
+
+FailoverGroup::~FailoverGroup()
+{
+    stop();
+}
+
+void FailoverGroup::start()
+{
+    std::lock_guard<std::mutex> lock(groupMutex);
+
+    for (auto &command : primary->stateJournal->commandsGet())
+    {
+        // Scanning is started on the standby when the primary fails
+        if (command[0] == SD_BLE_GAP_SCAN_START)
+        {
+            scanStartCommand = command;
+            continue;
+        }
+
+        mirrorQueue.push(command);
+    }
+
+    if (!workerThread.runningGet())
+    {
+        runWorkerThread = true;
+        workerThread.start(shared_from_this(), &FailoverGroup::workerRunner);
+    }
+}
+
+void FailoverGroup::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(groupMutex);
+        runWorkerThread = false;
+        workerWaitCondition.notify_all();
+    }
+
+    // Stopped from a status callback issued by the worker thread itself the thread is detached,
+    // it keeps the group alive until it has returned
+    workerThread.stop();
+}
+
+void FailoverGroup::commandProcess(AdapterInternal *adapter, const uint8_t *command, const uint32_t length, const bool configuration)
+{
+    if (adapter != primary || length == 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(groupMutex);
+
+    // A packet delivered to the primary ends a series of send failures
+    sendFailureCount = 0;
+
+    if (failedOver)
+    {
+        return;
+    }
+
+    std::vector<uint8_t> encoded(command, command + length);
+
+    switch (command[0])
+    {
+        case SD_BLE_GAP_ADV_START:
+            advStartCommand = encoded;
+            break;
+        case SD_BLE_GAP_ADV_STOP:
+            advStartCommand.clear();
+            break;
+        case SD_BLE_GAP_SCAN_START:
+            scanStartCommand = encoded;
+            break;
+        case SD_BLE_GAP_SCAN_STOP:
+            scanStartCommand.clear();
+            break;
+        case SD_BLE_GAP_CONNECT:
+            // Connecting stops an ongoing scan
+            connectCommand = encoded;
+            scanStartCommand.clear();
+            break;
+        default:
+            if (configuration)
+            {
+                mirrorQueue.push(encoded);
+                workerWaitCondition.notify_all();
+            }
+            break;
+    }
+}
+
+void FailoverGroup::eventProcess(AdapterInternal *adapter, const ble_evt_t *event)
+{
+    std::lock_guard<std::mutex> lock(groupMutex);
+
+    if (event->header.evt_id == BLE_GAP_EVT_CONNECTED)
+    {
+        const auto &connected = event->evt.gap_evt.params.connected;
+
+        if (adapter == standby && connected.role == BLE_GAP_ROLE_CENTRAL)
+        {
+            reconnectDone = true;
+            reconnected = true;
+            workerWaitCondition.notify_all();
+        }
+        else if (adapter == primary && connected.role == BLE_GAP_ROLE_CENTRAL && !connectCommand.empty())
+        {
+            auto peer = peerFind(connected.peer_addr);
+
+            if (peer == peers.end())
+            {
+                Peer newPeer;
+                newPeer.address = connected.peer_addr;
+                peers.push_back(newPeer);
+                peer = peers.end() - 1;
+            }
+
+            peer->connectCommand = connectCommand;
+        }
+        else if (adapter == primary && connected.role == BLE_GAP_ROLE_PERIPH)
+        {
+            // Advertising stops when a central connects
+            advStartCommand.clear();
+        }
+    }
+    else if (event->header.evt_id == BLE_GAP_EVT_TIMEOUT)
+    {
+        const auto source = event->evt.gap_evt.params.timeout.src;
+
+        if (adapter == standby && source == BLE_GAP_TIMEOUT_SRC_CONN)
+        {
+            reconnectDone = true;
+            reconnected = false;
+            workerWaitCondition.notify_all();
+        }
+        else if (adapter == primary && source == BLE_GAP_TIMEOUT_SRC_ADVERTISING)
+        {
+            advStartCommand.clear();
+        }
+        else if (adapter == primary && source == BLE_GAP_TIMEOUT_SRC_SCAN)
+        {
+            scanStartCommand.clear();
+        }
+    }
+}
+
+void FailoverGroup::statusProcess(AdapterInternal *adapter, sd_rpc_app_status_t code)
+{
+    if (adapter != primary)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(groupMutex);
+
+    if (failedOver)
+    {
+        // The primary is used again only when its configuration has been restored. A failed
+        // replay leaves it unconfigured, the group stays on the standby.
+        if (code == STATE_REPLAY_COMPLETED)
+        {
+            failbackPending = true;
+            workerWaitCondition.notify_all();
+        }
+
+        return;
+    }
+
+    switch (code)
+    {
+        case CONNECTION_ACTIVE:
+            sendFailureCount = 0;
+            return;
+        case PKT_SEND_MAX_RETRIES_REACHED:
+            // A single lost packet is not a failed primary
+            if (++sendFailureCount < FAILOVER_SEND_FAILURES)
+            {
+                return;
+            }
+            break;
+        case LINK_FAILED:
+        case IO_RESOURCES_UNAVAILABLE:
+            break;
+        default:
+            return;
+    }
+
+    failedOver = true;
+    failbackPending = false;
+    sendFailureCount = 0;
+    failureTime = std::chrono::steady_clock::now();
+
+    // Peers connected as central are connected again from the standby
+    sd_rpc_conn_state_t states[CONN_STATE_MAX_CONNECTIONS];
+    uint32_t size = CONN_STATE_MAX_CONNECTIONS;
+    reconnectCommands.clear();
+
+    if (primary->connStateTracker.list(states, &size) == NRF_SUCCESS)
+    {
+        for (uint32_t i = 0; i < size; i++)
+        {
+            if (states[i].role != BLE_GAP_ROLE_CENTRAL)
+            {
+                continue;
+            }
+
+            auto peer = peerFind(states[i].peer_addr);
+
+            if (peer != peers.end())
+            {
+                reconnectCommands.push_back(peer->connectCommand);
+            }
+        }
+    }
+
+    failoverPending = true;
+    workerWaitCondition.notify_all();
+}
+
+uint32_t FailoverGroup::infoGet(sd_rpc_failover_info_t *_info) const
+{
+    if (_info == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(groupMutex);
+    *_info = info;
+    _info->failed_over = failedOver ? 1 : 0;
+    return NRF_SUCCESS;
+}
+
+AdapterInternal *FailoverGroup::primaryGet() const
+{
+    return primary;
+}
+
+AdapterInternal *FailoverGroup::standbyGet() const
+{
+    return standby;
+}
+
+// Worker Thread
+void FailoverGroup::workerRunner()
+{
+    std::unique_lock<std::mutex> lock(groupMutex);
+
+    while (runWorkerThread && workerThread.isCurrent())
+    {
+        if (!mirrorQueue.empty())
+        {
+            auto command = mirrorQueue.front();
+            mirrorQueue.pop();
+            lock.unlock();
+
+            auto errCode = send(standby, command);
+
+            lock.lock();
+            info.mirrored_command_count++;
+
+            if (errCode != NRF_SUCCESS)
+            {
+                info.mirror_failed_count++;
+            }
+        }
+        else if (failoverPending)
+        {
+            failoverPending = false;
+            lock.unlock();
+            failover();
+            lock.lock();
+        }
+        else if (failbackPending)
+        {
+            failbackPending = false;
+            lock.unlock();
+            failback();
+            lock.lock();
+        }
+        else
+        {
+            workerWaitCondition.wait(lock);
+        }
+    }
+}
+
+void FailoverGroup::failover()
+{
+    std::unique_lock<std::mutex> lock(groupMutex);
+    const auto advStart = advStartCommand;
+    const auto scanStart = scanStartCommand;
+    const auto reconnects = reconnectCommands;
+    lock.unlock();
+
+    // Restore the procedures visible to other devices first
+    if (!advStart.empty())
+    {
+        send(standby, advStart);
+    }
+
+    if (!scanStart.empty())
+    {
+        send(standby, scanStart);
+    }
+
+    const auto failoverTime = elapsedMs(failureTime);
+    uint32_t reconnectCount = 0;
+
+    for (const auto &command : reconnects)
+    {
+        lock.lock();
+        reconnectDone = false;
+        reconnected = false;
+        lock.unlock();
+
+        if (send(standby, command) != NRF_SUCCESS)
+        {
+            continue;
+        }
+
+        // Only one connection can be established at a time
+        lock.lock();
+        workerWaitCondition.wait_for(lock, RECONNECT_TIMEOUT, [&] { return reconnectDone || !runWorkerThread; });
+
+        if (reconnected)
+        {
+            reconnectCount++;
+        }
+
+        const auto running = runWorkerThread;
+        lock.unlock();
+
+        if (!running)
+        {
+            return;
+        }
+    }
+
+    // Connecting stops scanning, resume it when all peers have been handled
+    if (!reconnects.empty() && !scanStart.empty())
+    {
+        send(standby, scanStart);
+    }
+
+    lock.lock();
+    info.failover_count++;
+    info.last_failover_time_ms = failoverTime;
+    info.last_reconnect_time_ms = elapsedMs(failureTime);
+    info.last_reconnect_count = reconnectCount;
+    info.last_reconnect_failed_count = static_cast<uint32_t>(reconnects.size()) - reconnectCount;
+
+    std::stringstream message;
+    message << "Failover to standby completed in " << info.last_failover_time_ms << " ms, "
+        << reconnectCount << " of " << reconnects.size() << " peers connected again in "
+        << info.last_reconnect_time_ms << " ms";
+    lock.unlock();
+
+    standby->statusHandler(FAILOVER_COMPLETED, message.str().c_str());
+}
+
+void FailoverGroup::failback()
+{
+    std::unique_lock<std::mutex> lock(groupMutex);
+
+    if (!failedOver)
+    {
+        return;
+    }
+
+    const auto advStart = advStartCommand;
+    const auto scanStart = scanStartCommand;
+    lock.unlock();
+
+    // Scanning is part of the journal replayed on the primary, advertising is started again here
+    if (!advStart.empty())
+    {
+        uint8_t buffer[SER_HAL_TRANSPORT_MAX_PKT_SIZE];
+        uint32_t length = sizeof(buffer);
+
+        if (ble_gap_adv_stop_req_enc(buffer, &length) == NRF_SUCCESS)
+        {
+            send(standby, std::vector<uint8_t>(buffer, buffer + length));
+        }
+
+        send(primary, advStart);
+    }
+
+    if (!scanStart.empty())
+    {
+        uint8_t buffer[SER_HAL_TRANSPORT_MAX_PKT_SIZE];
+        uint32_t length = sizeof(buffer);
+
+        if (ble_gap_scan_stop_req_enc(buffer, &length) == NRF_SUCCESS)
+        {
+            send(standby, std::vector<uint8_t>(buffer, buffer + length));
+        }
+    }
+
+    lock.lock();
+    failedOver = false;
+    sendFailureCount = 0;
+    info.failback_count++;
+
+    std::stringstream message;
+    message << "Failback to primary completed in " << elapsedMs(failureTime) << " ms after the failure";
+    lock.unlock();
+
+    primary->statusHandler(FAILBACK_COMPLETED, message.str().c_str());
+}
+
+uint32_t FailoverGroup::send(AdapterInternal *target, const std::vector<uint8_t> &command)
+{
+    adapter_t adapter;
+    adapter.internal = static_cast<void *>(target);
+
+    const auto opcode = command[0];
+
+    encode_function_t encode_function = [&](uint8_t *buffer, uint32_t *length) -> uint32_t {
+        if (command.size() > *length)
+        {
+            return NRF_ERROR_DATA_SIZE;
+        }
+
+        std::memcpy(buffer, command.data(), command.size());
+        *length = static_cast<uint32_t>(command.size());
+        return NRF_SUCCESS;
+    };
+
+    decode_function_t decode_function = [&](uint8_t *buffer, uint32_t length, uint32_t *result) -> uint32_t {
+        uint32_t index = 0;
+        return ser_ble_cmd_rsp_result_code_dec(buffer, &index, length, opcode, result);
+    };
+
+    return encode_decode(&adapter, encode_function, decode_function);
+}
+
+std::vector<FailoverGroup::Peer>::iterator FailoverGroup::peerFind(const ble_gap_addr_t &address)
+{
+    for (auto peer = peers.begin(); peer != peers.end(); ++peer)
+    {
+        if (addressEqual(peer->address, address))
+        {
+            return peer;
+        }
+    }
+
+    return peers.end();
+}
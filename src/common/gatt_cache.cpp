@@ -0,0 +1,909 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gatt_cache.h"
+
+#include "adapter_internal.h"
+
+#include "ble_gap.h"
+#include "ble_gattc.h"
+#include "nrf_error.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    // Database Hash characteristic of the Generic Attribute service
+    const uint16_t DATABASE_HASH_UUID = 0x2B2A;
+
+    const uint16_t HANDLE_FIRST = 0x0001;
+    const uint16_t HANDLE_LAST = 0xFFFF;
+
+    uint64_t fnv1a(uint64_t hash, const uint32_t value, const size_t length)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            hash ^= static_cast<uint8_t>(value >> (8 * i));
+            hash *= 0x100000001B3ULL;
+        }
+
+        return hash;
+    }
+
+    uint32_t elapsedMs(const std::chrono::steady_clock::time_point &since)
+    {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - since).count());
+    }
+}
+
+GattTable::GattTable(const sd_rpc_gatt_fingerprint_type_t fingerprintType, const uint8_t *fingerprint,
+    std::vector<sd_rpc_gatt_service_t> &&_services, std::vector<sd_rpc_gatt_char_t> &&_chars,
+    std::vector<ble_gattc_desc_t> &&_descs)
+    : services(std::move(_services)), chars(std::move(_chars)), descs(std::move(_descs))
+{
+    view.fingerprint_type = fingerprintType;
+    std::memcpy(view.fingerprint, fingerprint, SD_RPC_GATT_FINGERPRINT_LEN);
+    view.p_services = services.data();
+    view.service_count = static_cast<uint16_t>(services.size());
+    view.p_chars = chars.data();
+    view.char_count = static_cast<uint16_t>(chars.size());
+    view.p_descs = descs.data();
+    view.desc_count = static_cast<uint16_t>(descs.size());
+}
+
+const sd_rpc_gatt_table_t *GattTable::viewGet() const
+{
+    return &view;
+}
+
+size_t GattTable::sizeGet() const
+{
+    return sizeof(*this)
+        + services.capacity() * sizeof(sd_rpc_gatt_service_t)
+        + chars.capacity() * sizeof(sd_rpc_gatt_char_t)
+        + descs.capacity() * sizeof(ble_gattc_desc_t);
+}
+
+bool GattCache::Fingerprint::operator<(const Fingerprint &other) const
+{
+    if (type != other.type)
+    {
+        return type < other.type;
+    }
+
+    return value < other.value;
+}
+
+GattCache::GattCache(gatt_cache_t *_handle, adapter_t *adapters[], const uint8_t adapterCount,
+    const sd_rpc_gatt_cache_params_t *_params, sd_rpc_gatt_table_handler_t _tableHandler)
+    : handle(_handle), tableHandler(_tableHandler), hitCount(0), missCount(0), failedCount(0),
+    hitTimeMs(0), missTimeMs(0), runWorkerThread(false)
+{
+    if (_params != nullptr)
+    {
+        params = *_params;
+    }
+    else
+    {
+        params.max_tables = 0;
+        params.probe_fallback = true;
+    }
+
+    for (uint8_t i = 0; i < adapterCount; i++)
+    {
+        Lane lane;
+        lane.adapter = adapters[i];
+        lane.adapterInternal = static_cast<AdapterInternal *>(adapters[i]->internal);
+        lanes.push_back(lane);
+    }
+}
+
+GattCache::~GattCache()
+{
+    close();
+}
+
+uint32_t GattCache::open()
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+
+    if (workerThread.runningGet())
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    runWorkerThread = true;
+    workerThread.start(shared_from_this(), &GattCache::workerRunner);
+
+    return NRF_SUCCESS;
+}
+
+void GattCache::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        runWorkerThread = false;
+        workerWaitCondition.notify_all();
+    }
+
+    // Closed from the table handler the thread is detached, it keeps the cache alive until it has returned
+    workerThread.stop();
+}
+
+uint32_t GattCache::tableGet(adapter_t *adapter, const uint16_t connHandle, const sd_rpc_gatt_table_t **table)
+{
+    if (table == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    const auto lane = laneFind(adapter);
+
+    std::lock_guard<std::mutex> lock(stateMutex);
+    auto session = lane < lanes.size() ? sessionFind(lane, connHandle) : nullptr;
+
+    if (session == nullptr || !session->table)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    *table = session->table->viewGet();
+    retained.insert(std::make_pair(*table, session->table));
+
+    return NRF_SUCCESS;
+}
+
+uint32_t GattCache::tableRelease(const sd_rpc_gatt_table_t *table)
+{
+    if (table == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(stateMutex);
+    auto it = retained.find(table);
+
+    if (it == retained.end())
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    retained.erase(it);
+    evict();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t GattCache::statsGet(sd_rpc_gatt_cache_stats_t *stats) const
+{
+    if (stats == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(stateMutex);
+
+    stats->table_count = static_cast<uint32_t>(tables.size());
+    stats->table_bytes = 0;
+    stats->connection_count = 0;
+    stats->hit_count = hitCount;
+    stats->miss_count = missCount;
+    stats->failed_count = failedCount;
+    stats->mean_hit_time_ms = hitCount > 0 ? static_cast<uint32_t>(hitTimeMs / hitCount) : 0;
+    stats->mean_miss_time_ms = missCount > 0 ? static_cast<uint32_t>(missTimeMs / missCount) : 0;
+
+    for (const auto &entry : tables)
+    {
+        stats->table_bytes += static_cast<uint32_t>(entry.second.table->sizeGet());
+    }
+
+    for (const auto &session : sessions)
+    {
+        if (session.table)
+        {
+            stats->connection_count++;
+        }
+    }
+
+    return NRF_SUCCESS;
+}
+
+// Event Thread
+void GattCache::eventProcess(AdapterInternal *adapter, const ble_evt_t *event)
+{
+    Event copy;
+    copy.lane = lanes.size();
+
+    for (size_t i = 0; i < lanes.size(); i++)
+    {
+        if (lanes[i].adapterInternal == adapter)
+        {
+            copy.lane = i;
+        }
+    }
+
+    if (copy.lane == lanes.size())
+    {
+        return;
+    }
+
+    copy.id = event->header.evt_id;
+    copy.gattStatus = event->evt.gattc_evt.gatt_status;
+
+    switch (event->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+        {
+            if (event->evt.gap_evt.params.connected.role != BLE_GAP_ROLE_CENTRAL)
+            {
+                return;
+            }
+
+            copy.connHandle = event->evt.gap_evt.conn_handle;
+
+            Session session;
+            session.lane = copy.lane;
+            session.connHandle = copy.connHandle;
+            session.state = STATE_READ_HASH;
+            session.fingerprint.type = SD_RPC_GATT_FINGERPRINT_NONE;
+            session.fingerprint.value.fill(0);
+            session.started = std::chrono::steady_clock::now();
+            session.index = 0;
+            session.nextHandle = 0;
+
+            std::lock_guard<std::mutex> lock(stateMutex);
+
+            // A session left by a connection lost in a reset of the connectivity chip
+            sessions.remove_if([&copy](const Session &other) {
+                return other.lane == copy.lane && other.connHandle == copy.connHandle;
+            });
+
+            sessions.push_back(session);
+            break;
+        }
+        case BLE_GAP_EVT_DISCONNECTED:
+            copy.connHandle = event->evt.gap_evt.conn_handle;
+            break;
+        case BLE_GATTC_EVT_CHAR_VAL_BY_UUID_READ_RSP:
+        {
+            const auto &rsp = event->evt.gattc_evt.params.char_val_by_uuid_read_rsp;
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+
+            if (copy.gattStatus == BLE_GATT_STATUS_SUCCESS && rsp.count > 0)
+            {
+#if NRF_SD_BLE_API_VERSION >= 3
+                const uint8_t *value = rsp.handle_value + sizeof(uint16_t);
+#else
+                const uint8_t *value = rsp.handle_value[0].p_value;
+#endif
+                copy.value.assign(value, value + rsp.value_len);
+            }
+            break;
+        }
+        case BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP:
+        {
+            const auto &rsp = event->evt.gattc_evt.params.prim_srvc_disc_rsp;
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+            copy.services.assign(rsp.services, rsp.services + rsp.count);
+            break;
+        }
+        case BLE_GATTC_EVT_CHAR_DISC_RSP:
+        {
+            const auto &rsp = event->evt.gattc_evt.params.char_disc_rsp;
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+            copy.chars.assign(rsp.chars, rsp.chars + rsp.count);
+            break;
+        }
+        case BLE_GATTC_EVT_DESC_DISC_RSP:
+        {
+            const auto &rsp = event->evt.gattc_evt.params.desc_disc_rsp;
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+            copy.descs.assign(rsp.descs, rsp.descs + rsp.count);
+            break;
+        }
+        case BLE_GATTC_EVT_TIMEOUT:
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+            break;
+        default:
+            return;
+    }
+
+    {
+        // Events of connections not followed by the cache are not queued
+        std::lock_guard<std::mutex> lock(stateMutex);
+
+        if (sessionFind(copy.lane, copy.connHandle) == nullptr)
+        {
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+    eventQueue.push(copy);
+    workerWaitCondition.notify_all();
+}
+
+std::vector<AdapterInternal *> GattCache::adaptersGet() const
+{
+    std::vector<AdapterInternal *> adapters;
+
+    for (const auto &lane : lanes)
+    {
+        adapters.push_back(lane.adapterInternal);
+    }
+
+    return adapters;
+}
+
+// Worker Thread
+void GattCache::workerRunner()
+{
+    std::unique_lock<std::mutex> queueLock(queueMutex);
+
+    while (runWorkerThread && workerThread.isCurrent())
+    {
+        if (eventQueue.empty())
+        {
+            workerWaitCondition.wait(queueLock);
+            continue;
+        }
+
+        const auto event = eventQueue.front();
+        eventQueue.pop();
+        queueLock.unlock();
+
+        {
+            std::lock_guard<std::mutex> stateLock(stateMutex);
+            eventHandle(event);
+        }
+
+        std::vector<Result> finished;
+        finished.swap(results);
+
+        for (auto &result : finished)
+        {
+            // The handle is not valid any more when the cache was deleted from the table handler
+            if (tableHandler == nullptr || !workerThread.isCurrent())
+            {
+                break;
+            }
+
+            tableHandler(handle, result.adapter, result.connHandle,
+                result.table ? result.table->viewGet() : nullptr, result.result);
+        }
+
+        queueLock.lock();
+    }
+}
+
+void GattCache::eventHandle(const Event &event)
+{
+    auto session = sessionFind(event.lane, event.connHandle);
+
+    if (session == nullptr)
+    {
+        return;
+    }
+
+    const auto discovering = session->state != STATE_RESOLVED && session->state != STATE_FAILED;
+
+    switch (event.id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            hashRead(session);
+            break;
+        case BLE_GAP_EVT_DISCONNECTED:
+            if (discovering)
+            {
+                fail(session, NRF_ERROR_INVALID_STATE);
+            }
+
+            // The reference of the connection to its table is released here
+            sessions.remove_if([session](const Session &other) { return &other == session; });
+            evict();
+            break;
+        case BLE_GATTC_EVT_TIMEOUT:
+            if (discovering)
+            {
+                fail(session, NRF_ERROR_TIMEOUT);
+            }
+            break;
+        case BLE_GATTC_EVT_CHAR_VAL_BY_UUID_READ_RSP:
+            if (session->state == STATE_READ_HASH)
+            {
+                hashReadRspHandle(session, event);
+            }
+            break;
+        case BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP:
+            if (session->state == STATE_PROBE)
+            {
+                probeRspHandle(session, event);
+            }
+            else if (session->state == STATE_DISCOVER_SERVICES)
+            {
+                serviceDiscoverRspHandle(session, event);
+            }
+            break;
+        case BLE_GATTC_EVT_CHAR_DISC_RSP:
+            if (session->state == STATE_DISCOVER_CHARACTERISTICS)
+            {
+                characteristicDiscoverRspHandle(session, event);
+            }
+            break;
+        case BLE_GATTC_EVT_DESC_DISC_RSP:
+            if (session->state == STATE_DISCOVER_DESCRIPTORS)
+            {
+                descriptorDiscoverRspHandle(session, event);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void GattCache::hashRead(Session *session)
+{
+    ble_uuid_t uuid;
+    uuid.type = BLE_UUID_TYPE_BLE;
+    uuid.uuid = DATABASE_HASH_UUID;
+
+    ble_gattc_handle_range_t range;
+    range.start_handle = HANDLE_FIRST;
+    range.end_handle = HANDLE_LAST;
+
+    session->state = STATE_READ_HASH;
+    auto errCode = sd_ble_gattc_char_value_by_uuid_read(lanes[session->lane].adapter, session->connHandle, &uuid, &range);
+
+    if (errCode != NRF_SUCCESS)
+    {
+        fail(session, errCode);
+    }
+}
+
+void GattCache::hashReadRspHandle(Session *session, const Event &event)
+{
+    session->nextHandle = HANDLE_FIRST;
+
+    if (event.gattStatus == BLE_GATT_STATUS_SUCCESS && event.value.size() == SD_RPC_GATT_FINGERPRINT_LEN)
+    {
+        session->fingerprint.type = SD_RPC_GATT_FINGERPRINT_DATABASE_HASH;
+        std::copy(event.value.begin(), event.value.end(), session->fingerprint.value.begin());
+
+        if (lookup(session))
+        {
+            return;
+        }
+
+        session->state = STATE_DISCOVER_SERVICES;
+    }
+    else
+    {
+        // The peer has no Database Hash, the first services found identify it instead
+        session->state = params.probe_fallback ? STATE_PROBE : STATE_DISCOVER_SERVICES;
+    }
+
+    servicesDiscover(session);
+}
+
+void GattCache::probeRspHandle(Session *session, const Event &event)
+{
+    if (event.gattStatus == BLE_GATT_STATUS_SUCCESS && !event.services.empty())
+    {
+        uint64_t hash = 0xCBF29CE484222325ULL;
+
+        for (const auto &service : event.services)
+        {
+            hash = fnv1a(hash, service.handle_range.start_handle, 2);
+            hash = fnv1a(hash, service.handle_range.end_handle, 2);
+            hash = fnv1a(hash, service.uuid.uuid, 2);
+            hash = fnv1a(hash, service.uuid.type, 1);
+        }
+
+        const auto count = static_cast<uint16_t>(event.services.size());
+        const auto lastHandle = event.services.back().handle_range.end_handle;
+        auto &value = session->fingerprint.value;
+
+        for (size_t i = 0; i < sizeof(hash); i++)
+        {
+            value[i] = static_cast<uint8_t>(hash >> (8 * i));
+        }
+
+        value[8] = static_cast<uint8_t>(count);
+        value[9] = static_cast<uint8_t>(count >> 8);
+        value[10] = static_cast<uint8_t>(lastHandle);
+        value[11] = static_cast<uint8_t>(lastHandle >> 8);
+        session->fingerprint.type = SD_RPC_GATT_FINGERPRINT_PROBE;
+
+        if (lookup(session))
+        {
+            return;
+        }
+    }
+
+    // The probe is the first response of the full discovery
+    session->state = STATE_DISCOVER_SERVICES;
+    serviceDiscoverRspHandle(session, event);
+}
+
+void GattCache::serviceDiscoverRspHandle(Session *session, const Event &event)
+{
+    if (event.gattStatus == BLE_GATT_STATUS_SUCCESS && !event.services.empty())
+    {
+        for (const auto &service : event.services)
+        {
+            sd_rpc_gatt_service_t entry;
+            entry.service = service;
+            entry.char_index = 0;
+            entry.char_count = 0;
+            session->services.push_back(entry);
+        }
+
+        const uint32_t lastHandle = event.services.back().handle_range.end_handle;
+
+        if (lastHandle < HANDLE_LAST && lastHandle >= session->nextHandle)
+        {
+            session->nextHandle = lastHandle + 1;
+            servicesDiscover(session);
+            return;
+        }
+    }
+    else if (event.gattStatus != BLE_GATT_STATUS_SUCCESS && event.gattStatus != BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND)
+    {
+        fail(session, NRF_ERROR_INTERNAL);
+        return;
+    }
+
+    session->state = STATE_DISCOVER_CHARACTERISTICS;
+    session->index = 0;
+    session->nextHandle = 0;
+    characteristicsDiscover(session);
+}
+
+void GattCache::characteristicDiscoverRspHandle(Session *session, const Event &event)
+{
+    auto &service = session->services[session->index];
+
+    if (event.gattStatus == BLE_GATT_STATUS_SUCCESS && !event.chars.empty())
+    {
+        for (const auto &characteristic : event.chars)
+        {
+            sd_rpc_gatt_char_t entry;
+            entry.characteristic = characteristic;
+            entry.desc_index = 0;
+            entry.desc_count = 0;
+            session->chars.push_back(entry);
+            service.char_count++;
+        }
+
+        const uint32_t lastHandle = event.chars.back().handle_value;
+
+        if (lastHandle < service.service.handle_range.end_handle)
+        {
+            session->nextHandle = lastHandle + 1;
+            characteristicsDiscover(session);
+            return;
+        }
+    }
+    else if (event.gattStatus != BLE_GATT_STATUS_SUCCESS && event.gattStatus != BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND)
+    {
+        fail(session, NRF_ERROR_INTERNAL);
+        return;
+    }
+
+    session->index++;
+    session->nextHandle = 0;
+    characteristicsDiscover(session);
+}
+
+void GattCache::descriptorDiscoverRspHandle(Session *session, const Event &event)
+{
+    auto &characteristic = session->chars[session->index];
+
+    if (event.gattStatus == BLE_GATT_STATUS_SUCCESS && !event.descs.empty())
+    {
+        for (const auto &descriptor : event.descs)
+        {
+            session->descs.push_back(descriptor);
+            characteristic.desc_count++;
+        }
+
+        const uint32_t lastHandle = event.descs.back().handle;
+
+        if (lastHandle < session->charEnds[session->index])
+        {
+            session->nextHandle = lastHandle + 1;
+            descriptorsDiscover(session);
+            return;
+        }
+    }
+    else if (event.gattStatus != BLE_GATT_STATUS_SUCCESS && event.gattStatus != BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND)
+    {
+        fail(session, NRF_ERROR_INTERNAL);
+        return;
+    }
+
+    session->index++;
+    session->nextHandle = 0;
+    descriptorsDiscover(session);
+}
+
+void GattCache::servicesDiscover(Session *session)
+{
+    auto errCode = sd_ble_gattc_primary_services_discover(lanes[session->lane].adapter, session->connHandle,
+        static_cast<uint16_t>(session->nextHandle), nullptr);
+
+    if (errCode != NRF_SUCCESS)
+    {
+        fail(session, errCode);
+    }
+}
+
+void GattCache::characteristicsDiscover(Session *session)
+{
+    while (session->index < session->services.size())
+    {
+        auto &service = session->services[session->index];
+
+        if (session->nextHandle == 0)
+        {
+            service.char_index = static_cast<uint16_t>(session->chars.size());
+            session->nextHandle = service.service.handle_range.start_handle;
+        }
+
+        if (session->nextHandle <= service.service.handle_range.end_handle)
+        {
+            ble_gattc_handle_range_t range;
+            range.start_handle = static_cast<uint16_t>(session->nextHandle);
+            range.end_handle = service.service.handle_range.end_handle;
+
+            auto errCode = sd_ble_gattc_characteristics_discover(lanes[session->lane].adapter, session->connHandle, &range);
+
+            if (errCode != NRF_SUCCESS)
+            {
+                fail(session, errCode);
+            }
+
+            return;
+        }
+
+        session->index++;
+        session->nextHandle = 0;
+    }
+
+    // The descriptors of a characteristic end before the next characteristic or at the end of the service
+    session->charEnds.resize(session->chars.size());
+
+    for (const auto &service : session->services)
+    {
+        const size_t end = service.char_index + service.char_count;
+
+        for (size_t i = service.char_index; i < end; i++)
+        {
+            session->charEnds[i] = (i + 1 < end)
+                ? static_cast<uint16_t>(session->chars[i + 1].characteristic.handle_decl - 1)
+                : service.service.handle_range.end_handle;
+        }
+    }
+
+    session->state = STATE_DISCOVER_DESCRIPTORS;
+    session->index = 0;
+    session->nextHandle = 0;
+    descriptorsDiscover(session);
+}
+
+void GattCache::descriptorsDiscover(Session *session)
+{
+    while (session->index < session->chars.size())
+    {
+        auto &characteristic = session->chars[session->index];
+
+        if (session->nextHandle == 0)
+        {
+            characteristic.desc_index = static_cast<uint16_t>(session->descs.size());
+            session->nextHandle = static_cast<uint32_t>(characteristic.characteristic.handle_value) + 1;
+        }
+
+        if (session->nextHandle <= session->charEnds[session->index])
+        {
+            ble_gattc_handle_range_t range;
+            range.start_handle = static_cast<uint16_t>(session->nextHandle);
+            range.end_handle = session->charEnds[session->index];
+
+            auto errCode = sd_ble_gattc_descriptors_discover(lanes[session->lane].adapter, session->connHandle, &range);
+
+            if (errCode != NRF_SUCCESS)
+            {
+                fail(session, errCode);
+            }
+
+            return;
+        }
+
+        session->index++;
+        session->nextHandle = 0;
+    }
+
+    intern(session);
+}
+
+bool GattCache::lookup(Session *session)
+{
+    auto it = tables.find(session->fingerprint);
+
+    if (it == tables.end())
+    {
+        return false;
+    }
+
+    it->second.lastUsed = std::chrono::steady_clock::now();
+    session->table = it->second.table;
+    resolve(session, true);
+
+    return true;
+}
+
+void GattCache::intern(Session *session)
+{
+    table_ptr_t table = std::make_shared<const GattTable>(session->fingerprint.type, session->fingerprint.value.data(),
+        std::move(session->services), std::move(session->chars), std::move(session->descs));
+
+    if (session->fingerprint.type != SD_RPC_GATT_FINGERPRINT_NONE)
+    {
+        auto it = tables.find(session->fingerprint);
+
+        if (it != tables.end())
+        {
+            // Another connection of the same model completed its discovery first
+            table = it->second.table;
+            it->second.lastUsed = std::chrono::steady_clock::now();
+        }
+        else
+        {
+            Entry entry;
+            entry.table = table;
+            entry.lastUsed = std::chrono::steady_clock::now();
+            tables.insert(std::make_pair(session->fingerprint, entry));
+            evict();
+        }
+    }
+
+    session->table = table;
+    resolve(session, false);
+}
+
+void GattCache::evict()
+{
+    if (params.max_tables == 0)
+    {
+        return;
+    }
+
+    while (tables.size() > params.max_tables)
+    {
+        auto victim = tables.end();
+
+        for (auto it = tables.begin(); it != tables.end(); ++it)
+        {
+            // Only tables referenced by the cache alone can be removed
+            if (it->second.table.use_count() == 1
+                && (victim == tables.end() || it->second.lastUsed < victim->second.lastUsed))
+            {
+                victim = it;
+            }
+        }
+
+        if (victim == tables.end())
+        {
+            return;
+        }
+
+        tables.erase(victim);
+    }
+}
+
+void GattCache::resolve(Session *session, const bool hit)
+{
+    const auto elapsed = elapsedMs(session->started);
+
+    if (hit)
+    {
+        hitCount++;
+        hitTimeMs += elapsed;
+    }
+    else
+    {
+        missCount++;
+        missTimeMs += elapsed;
+    }
+
+    session->state = STATE_RESOLVED;
+    session->services.clear();
+    session->chars.clear();
+    session->charEnds.clear();
+    session->descs.clear();
+
+    Result result;
+    result.adapter = lanes[session->lane].adapter;
+    result.connHandle = session->connHandle;
+    result.table = session->table;
+    result.result = NRF_SUCCESS;
+    results.push_back(result);
+}
+
+void GattCache::fail(Session *session, const uint32_t errCode)
+{
+    failedCount++;
+
+    session->state = STATE_FAILED;
+    session->services.clear();
+    session->chars.clear();
+    session->charEnds.clear();
+    session->descs.clear();
+
+    Result result;
+    result.adapter = lanes[session->lane].adapter;
+    result.connHandle = session->connHandle;
+    result.result = errCode;
+    results.push_back(result);
+}
+
+GattCache::Session *GattCache::sessionFind(const size_t lane, const uint16_t connHandle)
+{
+    for (auto &session : sessions)
+    {
+        if (session.lane == lane && session.connHandle == connHandle)
+        {
+            return &session;
+        }
+    }
+
+    return nullptr;
+}
+
+size_t GattCache::laneFind(const adapter_t *adapter) const
+{
+    for (size_t i = 0; i < lanes.size(); i++)
+    {
+        if (adapter != nullptr && lanes[i].adapterInternal == adapter->internal)
+        {
+            return i;
+        }
+    }
+
+    return lanes.size();
+}
@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "notification_sink.h"
+
+#include "nrf_error.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    // Chunks kept for reuse after they have been released or their sink removed
+    const size_t FREE_CHUNKS_MAX = 64;
+
+    // Longest value a notification can carry
+    const uint16_t VALUE_LEN_MAX = BLE_GATTS_VAR_ATTR_LEN_MAX;
+}
+
+NotificationSink::NotificationSink()
+{}
+
+NotificationSink::~NotificationSink()
+{
+    for (auto &entry : sinks)
+    {
+        for (auto &chunk : entry.second.chunks)
+        {
+            std::free(chunk.p_data);
+        }
+    }
+
+    for (auto &chunk : freeChunks)
+    {
+        std::free(chunk.p_data);
+    }
+}
+
+// Event Thread
+bool NotificationSink::process(const ble_evt_t *event)
+{
+    if (event->header.evt_id == BLE_GATTC_EVT_HVX)
+    {
+        const auto &hvx = event->evt.gattc_evt.params.hvx;
+
+        std::lock_guard<std::mutex> lock(sinkMutex);
+
+        if (sinks.empty())
+        {
+            return false;
+        }
+
+        auto found = sinks.find(key(event->evt.gattc_evt.conn_handle, hvx.handle));
+
+        if (found == sinks.end() || !found->second.active)
+        {
+            return false;
+        }
+
+        append(found->second, hvx);
+
+        // Indications are passed on since the application has to confirm them
+        return !found->second.params.forward_events && hvx.type != BLE_GATT_HVX_INDICATION;
+    }
+
+    if (event->header.evt_id == BLE_GAP_EVT_DISCONNECTED)
+    {
+        std::lock_guard<std::mutex> lock(sinkMutex);
+
+        for (auto &entry : sinks)
+        {
+            if (entry.second.params.conn_handle == event->evt.gap_evt.conn_handle)
+            {
+                entry.second.active = false;
+            }
+        }
+    }
+
+    return false;
+}
+
+void NotificationSink::connectionsLost()
+{
+    std::lock_guard<std::mutex> lock(sinkMutex);
+
+    for (auto &entry : sinks)
+    {
+        entry.second.active = false;
+    }
+}
+
+uint32_t NotificationSink::add(const sd_rpc_notification_sink_params_t *params)
+{
+    if (params == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (params->chunk_size < SD_RPC_NOTIFICATION_SAMPLE_SIZE(VALUE_LEN_MAX))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    std::lock_guard<std::mutex> lock(sinkMutex);
+
+    auto &sink = sinks[key(params->conn_handle, params->value_handle)];
+
+    if (sink.active)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    // A sink left from a lost connection keeps its chunks
+    if (sink.chunks.empty())
+    {
+        sink.dropped = 0;
+    }
+
+    sink.params = *params;
+    sink.active = true;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t NotificationSink::remove(const uint16_t connHandle, const uint16_t valueHandle)
+{
+    std::lock_guard<std::mutex> lock(sinkMutex);
+
+    auto found = sinks.find(key(connHandle, valueHandle));
+
+    if (found == sinks.end())
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    for (auto &chunk : found->second.chunks)
+    {
+        chunkFree(chunk);
+    }
+
+    sinks.erase(found);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t NotificationSink::swap(const uint16_t connHandle, const uint16_t valueHandle, sd_rpc_notification_chunk_t *chunks, uint32_t *count, uint32_t *dropped)
+{
+    if (chunks == nullptr || count == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(sinkMutex);
+
+    auto found = sinks.find(key(connHandle, valueHandle));
+
+    if (found == sinks.end())
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    auto &sink = found->second;
+    uint32_t swapped = 0;
+
+    while (swapped < *count && !sink.chunks.empty())
+    {
+        chunks[swapped++] = sink.chunks.front();
+        sink.chunks.pop_front();
+    }
+
+    *count = swapped;
+
+    if (dropped != nullptr)
+    {
+        *dropped = sink.dropped;
+    }
+
+    sink.dropped = 0;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t NotificationSink::release(sd_rpc_notification_chunk_t *chunks, const uint32_t count)
+{
+    if (chunks == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(sinkMutex);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        chunkFree(chunks[i]);
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t NotificationSink::key(const uint16_t connHandle, const uint16_t valueHandle)
+{
+    return (static_cast<uint32_t>(connHandle) << 16) | valueHandle;
+}
+
+void NotificationSink::append(Sink &sink, const ble_gattc_evt_hvx_t &hvx)
+{
+    const auto sampleSize = static_cast<uint32_t>(SD_RPC_NOTIFICATION_SAMPLE_SIZE(hvx.len));
+
+    if (sink.chunks.empty() || sink.chunks.back().size - sink.chunks.back().len < sampleSize)
+    {
+        sd_rpc_notification_chunk_t chunk;
+
+        if ((sink.params.max_chunks != 0 && sink.chunks.size() >= sink.params.max_chunks)
+            || !chunkAllocate(sink.params.chunk_size, chunk))
+        {
+            sink.dropped++;
+            return;
+        }
+
+        sink.chunks.push_back(chunk);
+    }
+
+    auto &chunk = sink.chunks.back();
+    auto sample = chunk.p_data + chunk.len;
+
+    sd_rpc_notification_sample_t header;
+    std::memset(&header, 0, sizeof(header));
+    header.timestamp_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    header.len = hvx.len;
+    header.type = hvx.type;
+
+    std::memcpy(sample, &header, sizeof(header));
+    std::memcpy(sample + sizeof(header), hvx.data, hvx.len);
+    std::memset(sample + sizeof(header) + hvx.len, 0, sampleSize - sizeof(header) - hvx.len);
+
+    chunk.len += sampleSize;
+    chunk.sample_count++;
+}
+
+bool NotificationSink::chunkAllocate(const uint32_t size, sd_rpc_notification_chunk_t &chunk)
+{
+    for (auto it = freeChunks.begin(); it != freeChunks.end(); ++it)
+    {
+        if (it->size == size)
+        {
+            chunk = *it;
+            freeChunks.erase(it);
+            chunk.len = 0;
+            chunk.sample_count = 0;
+            return true;
+        }
+    }
+
+    chunk.p_data = static_cast<uint8_t *>(std::malloc(size));
+
+    if (chunk.p_data == nullptr)
+    {
+        return false;
+    }
+
+    chunk.len = 0;
+    chunk.size = size;
+    chunk.sample_count = 0;
+
+    return true;
+}
+
+void NotificationSink::chunkFree(sd_rpc_notification_chunk_t &chunk)
+{
+    if (chunk.p_data == nullptr)
+    {
+        return;
+    }
+
+    if (freeChunks.size() < FREE_CHUNKS_MAX)
+    {
+        freeChunks.push_back(chunk);
+    }
+    else
+    {
+        std::free(chunk.p_data);
+    }
+
+    chunk.p_data = nullptr;
+}
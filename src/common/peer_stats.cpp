@@ -0,0 +1,499 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "peer_stats.h"
+
+#include "ble_hci.h"
+#include "nrf_error.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    const char FILE_MAGIC[8] = { 'S', 'D', 'R', 'P', 'C', 'P', 'S', 'T' };
+    const uint32_t FILE_VERSION = 1;
+}
+
+PeerStats::PeerStats()
+    : header(nullptr), records(nullptr)
+{}
+
+PeerStats::~PeerStats()
+{
+    close();
+}
+
+void PeerStats::process(const ble_evt_t *event)
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+
+    if (header == nullptr)
+    {
+        return;
+    }
+
+    switch (event->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+        {
+            const auto &peerAddr = event->evt.gap_evt.params.connected.peer_addr;
+            const auto key = keyGet(peerAddr);
+            auto record = find(key);
+
+            if (record == nullptr)
+            {
+                record = insert(peerAddr, key);
+            }
+
+            const auto now = timeGet();
+
+            if (record->stats.first_connected_ms == 0)
+            {
+                record->stats.first_connected_ms = now;
+            }
+
+            record->stats.last_connected_ms = now;
+            record->stats.connection_count++;
+
+            Connection connection;
+            connection.key = key;
+            connection.connected = std::chrono::steady_clock::now();
+            connection.discoveryTime = 0;
+            connections[event->evt.gap_evt.conn_handle] = connection;
+            break;
+        }
+        case BLE_GAP_EVT_DISCONNECTED:
+        {
+            const auto connHandle = event->evt.gap_evt.conn_handle;
+            auto record = connectionRecordGet(connHandle);
+
+            if (record != nullptr)
+            {
+                if (event->evt.gap_evt.params.disconnected.reason == BLE_HCI_CONNECTION_TIMEOUT)
+                {
+                    record->stats.link_loss_count++;
+                }
+
+                const auto discoveryTime = connections[connHandle].discoveryTime;
+
+                if (discoveryTime > 0)
+                {
+                    record->discoverySum += discoveryTime;
+                    record->discoveryCount++;
+                    record->stats.discovery_time_ms = static_cast<uint32_t>(record->discoverySum / record->discoveryCount);
+                }
+            }
+
+            connections.erase(connHandle);
+            break;
+        }
+        case BLE_GAP_EVT_AUTH_STATUS:
+        {
+            auto record = connectionRecordGet(event->evt.gap_evt.conn_handle);
+
+            if (record != nullptr)
+            {
+                if (event->evt.gap_evt.params.auth_status.auth_status == BLE_GAP_SEC_STATUS_SUCCESS)
+                {
+                    record->stats.pairing_count++;
+                }
+                else
+                {
+                    record->stats.pairing_failed_count++;
+                }
+            }
+
+            break;
+        }
+        case BLE_GAP_EVT_RSSI_CHANGED:
+            rssiAdd(connectionRecordGet(event->evt.gap_evt.conn_handle), event->evt.gap_evt.params.rssi_changed.rssi);
+            break;
+        case BLE_GAP_EVT_ADV_REPORT:
+        {
+            // Only peers that have connected before are kept
+            const auto &report = event->evt.gap_evt.params.adv_report;
+            rssiAdd(find(keyGet(report.peer_addr)), report.rssi);
+            break;
+        }
+        case BLE_GATTS_EVT_WRITE:
+        {
+            auto record = connectionRecordGet(event->evt.gatts_evt.conn_handle);
+
+            if (record != nullptr)
+            {
+                record->stats.bytes_rx += event->evt.gatts_evt.params.write.len;
+            }
+
+            break;
+        }
+        case BLE_GATTC_EVT_HVX:
+        case BLE_GATTC_EVT_READ_RSP:
+        {
+            auto record = connectionRecordGet(event->evt.gattc_evt.conn_handle);
+
+            if (record != nullptr)
+            {
+                record->stats.bytes_rx += event->header.evt_id == BLE_GATTC_EVT_HVX
+                    ? event->evt.gattc_evt.params.hvx.len
+                    : event->evt.gattc_evt.params.read_rsp.len;
+            }
+
+            break;
+        }
+        case BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP:
+        case BLE_GATTC_EVT_CHAR_DISC_RSP:
+        case BLE_GATTC_EVT_DESC_DISC_RSP:
+        {
+            auto connection = connections.find(event->evt.gattc_evt.conn_handle);
+
+            if (connection != connections.end())
+            {
+                const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - connection->second.connected).count();
+                connection->second.discoveryTime = static_cast<uint32_t>(elapsed > 0 ? elapsed : 1);
+            }
+
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void PeerStats::txProcess(const uint16_t connHandle, const uint16_t length)
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+
+    if (header == nullptr)
+    {
+        return;
+    }
+
+    auto record = connectionRecordGet(connHandle);
+
+    if (record != nullptr)
+    {
+        record->stats.bytes_tx += length;
+    }
+}
+
+void PeerStats::clear()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    connections.clear();
+}
+
+uint32_t PeerStats::open(const sd_rpc_peer_stats_params_t *params)
+{
+    if (params == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (params->max_peers == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+
+    if (header != nullptr)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (params->file_path != nullptr)
+    {
+        const auto errCode = fileMap(params->file_path, params->max_peers);
+
+        if (errCode != NRF_SUCCESS)
+        {
+            return errCode;
+        }
+    }
+    else
+    {
+        memory.assign(sizeGet(params->max_peers), 0);
+        header = reinterpret_cast<Header *>(memory.data());
+        std::memcpy(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+        header->version = FILE_VERSION;
+        header->capacity = params->max_peers;
+    }
+
+    records = reinterpret_cast<Record *>(reinterpret_cast<uint8_t *>(header) + sizeof(Header));
+
+    for (uint32_t i = 0; i < header->count; i++)
+    {
+        index[keyGet(records[i].stats.peer_addr)] = i;
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t PeerStats::close()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    unmap();
+    return NRF_SUCCESS;
+}
+
+uint32_t PeerStats::get(const ble_gap_addr_t *peerAddr, sd_rpc_peer_stats_t *stats) const
+{
+    if (peerAddr == nullptr || stats == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+
+    if (header == nullptr)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    const auto found = index.find(keyGet(*peerAddr));
+
+    if (found == index.end())
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    *stats = records[found->second].stats;
+    return NRF_SUCCESS;
+}
+
+uint32_t PeerStats::list(sd_rpc_peer_stats_t *stats, uint32_t *count) const
+{
+    if (stats == nullptr || count == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+
+    if (header == nullptr)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (header->count > *count)
+    {
+        *count = header->count;
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    for (uint32_t i = 0; i < header->count; i++)
+    {
+        stats[i] = records[i].stats;
+    }
+
+    *count = header->count;
+    return NRF_SUCCESS;
+}
+
+uint64_t PeerStats::keyGet(const ble_gap_addr_t &addr)
+{
+    auto key = static_cast<uint64_t>(addr.addr_type) << 48;
+
+#if NRF_SD_BLE_API_VERSION >= 5
+    if (addr.addr_id_peer)
+    {
+        key |= 1ULL << 56;
+    }
+#endif
+
+    for (auto i = 0; i < BLE_GAP_ADDR_LEN; i++)
+    {
+        key |= static_cast<uint64_t>(addr.addr[i]) << (8 * i);
+    }
+
+    return key;
+}
+
+uint64_t PeerStats::timeGet()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+size_t PeerStats::sizeGet(const uint32_t capacity)
+{
+    return sizeof(Header) + static_cast<size_t>(capacity) * sizeof(Record);
+}
+
+PeerStats::Record *PeerStats::find(const uint64_t key)
+{
+    const auto found = index.find(key);
+    return found != index.end() ? &records[found->second] : nullptr;
+}
+
+PeerStats::Record *PeerStats::insert(const ble_gap_addr_t &addr, const uint64_t key)
+{
+    uint32_t slot;
+
+    if (header->count < header->capacity)
+    {
+        slot = header->count++;
+    }
+    else
+    {
+        // Replace the peer connected least recently
+        slot = 0;
+
+        for (uint32_t i = 1; i < header->count; i++)
+        {
+            if (records[i].stats.last_connected_ms < records[slot].stats.last_connected_ms)
+            {
+                slot = i;
+            }
+        }
+
+        index.erase(keyGet(records[slot].stats.peer_addr));
+    }
+
+    auto record = &records[slot];
+    std::memset(record, 0, sizeof(Record));
+    record->stats.peer_addr = addr;
+    index[key] = slot;
+    return record;
+}
+
+PeerStats::Record *PeerStats::connectionRecordGet(const uint16_t connHandle)
+{
+    const auto connection = connections.find(connHandle);
+
+    if (connection == connections.end())
+    {
+        return nullptr;
+    }
+
+    // The record is gone if the peer has been replaced while connected
+    return find(connection->second.key);
+}
+
+void PeerStats::rssiAdd(Record *record, const int8_t rssi)
+{
+    if (record == nullptr)
+    {
+        return;
+    }
+
+    record->rssiSum += rssi;
+    record->rssiCount++;
+    record->stats.rssi = static_cast<int8_t>(std::lround(static_cast<double>(record->rssiSum) / record->rssiCount));
+}
+
+uint32_t PeerStats::fileMap(const char *path, const uint32_t capacity)
+{
+    const auto size = sizeGet(capacity);
+
+    {
+        std::ifstream existing(path, std::ios::binary);
+
+        if (existing.is_open())
+        {
+            Header fileHeader;
+            existing.read(reinterpret_cast<char *>(&fileHeader), sizeof(Header));
+
+            if (!existing
+                || std::memcmp(fileHeader.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0
+                || fileHeader.version != FILE_VERSION
+                || fileHeader.capacity != capacity
+                || fileHeader.count > capacity)
+            {
+                return NRF_ERROR_INVALID_DATA;
+            }
+
+            existing.seekg(0, std::ios::end);
+
+            if (static_cast<size_t>(existing.tellg()) < size)
+            {
+                return NRF_ERROR_INVALID_DATA;
+            }
+        }
+        else
+        {
+            Header fileHeader = {};
+            std::memcpy(fileHeader.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+            fileHeader.version = FILE_VERSION;
+            fileHeader.capacity = capacity;
+
+            std::ofstream created(path, std::ios::binary);
+            std::vector<char> emptyRecords(size - sizeof(Header), 0);
+            created.write(reinterpret_cast<const char *>(&fileHeader), sizeof(Header));
+            created.write(emptyRecords.data(), emptyRecords.size());
+
+            if (!created)
+            {
+                return NRF_ERROR_INTERNAL;
+            }
+        }
+    }
+
+    try
+    {
+        fileMapping.reset(new boost::interprocess::file_mapping(path, boost::interprocess::read_write));
+        mappedRegion.reset(new boost::interprocess::mapped_region(*fileMapping, boost::interprocess::read_write, 0, size));
+    }
+    catch (boost::interprocess::interprocess_exception &)
+    {
+        mappedRegion.reset();
+        fileMapping.reset();
+        return NRF_ERROR_INTERNAL;
+    }
+
+    header = static_cast<Header *>(mappedRegion->get_address());
+    return NRF_SUCCESS;
+}
+
+void PeerStats::unmap()
+{
+    if (mappedRegion)
+    {
+        mappedRegion->flush();
+    }
+
+    mappedRegion.reset();
+    fileMapping.reset();
+    memory.clear();
+    memory.shrink_to_fit();
+    header = nullptr;
+    records = nullptr;
+    index.clear();
+    connections.clear();
+}
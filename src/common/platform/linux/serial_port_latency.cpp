@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "serial_port_latency.h"
+
+#include "nrf_error.h"
+
+#include <fstream>
+#include <string>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/serial.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace {
+    // Directory of the tty device in sysfs, i.e. /sys/class/tty/ttyUSB0/device for /dev/ttyUSB0
+    std::string deviceDirGet(const std::string &portName, const std::string &sysfsRoot)
+    {
+        const auto separator = portName.find_last_of('/');
+        const auto ttyName = separator == std::string::npos ? portName : portName.substr(separator + 1);
+        return sysfsRoot + "/class/tty/" + ttyName + "/device";
+    }
+
+    std::string driverGet(const std::string &deviceDir)
+    {
+        char resolved[PATH_MAX];
+
+        if (realpath((deviceDir + "/driver").c_str(), resolved) == nullptr)
+        {
+            return std::string();
+        }
+
+        const std::string driverPath(resolved);
+        return driverPath.substr(driverPath.find_last_of('/') + 1);
+    }
+}
+
+uint32_t SerialPortBridgeGet(const std::string &portName, const std::string &sysfsRoot, sd_rpc_usb_bridge_t *bridge)
+{
+    if (bridge == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    const auto driver = driverGet(deviceDirGet(portName, sysfsRoot));
+
+    if (driver.empty())
+    {
+        *bridge = SD_RPC_USB_BRIDGE_UNKNOWN;
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    if (driver == "ftdi_sio")
+    {
+        *bridge = SD_RPC_USB_BRIDGE_FTDI;
+    }
+    else if (driver == "cp210x")
+    {
+        *bridge = SD_RPC_USB_BRIDGE_CP210X;
+    }
+    else if (driver == "cdc_acm")
+    {
+        *bridge = SD_RPC_USB_BRIDGE_CDC_ACM;
+    }
+    else
+    {
+        *bridge = SD_RPC_USB_BRIDGE_UNKNOWN;
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t SerialPortLatencyTimerGet(const std::string &portName, const std::string &sysfsRoot, uint8_t *latencyTimer)
+{
+    if (latencyTimer == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::ifstream attribute(deviceDirGet(portName, sysfsRoot) + "/latency_timer");
+    unsigned int value = 0;
+
+    if (!(attribute >> value) || value == 0 || value > UINT8_MAX)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    *latencyTimer = static_cast<uint8_t>(value);
+    return NRF_SUCCESS;
+}
+
+uint32_t SerialPortLatencyTimerSet(const std::string &portName, const std::string &sysfsRoot, const uint8_t latencyTimer)
+{
+    std::ofstream attribute(deviceDirGet(portName, sysfsRoot) + "/latency_timer");
+
+    if (!attribute.is_open())
+    {
+        return NRF_ERROR_FORBIDDEN;
+    }
+
+    attribute << static_cast<unsigned int>(latencyTimer) << std::endl;
+    return attribute ? NRF_SUCCESS : NRF_ERROR_FORBIDDEN;
+}
+
+uint32_t SerialPortLowLatencyGet(boost::asio::serial_port::native_handle_type handle, bool *enabled)
+{
+    if (enabled == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    struct serial_struct serial;
+
+    if (ioctl(handle, TIOCGSERIAL, &serial) != 0)
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+
+    *enabled = (serial.flags & ASYNC_LOW_LATENCY) != 0;
+    return NRF_SUCCESS;
+}
+
+uint32_t SerialPortLowLatencySet(boost::asio::serial_port::native_handle_type handle, const bool enable)
+{
+    struct serial_struct serial;
+
+    if (ioctl(handle, TIOCGSERIAL, &serial) != 0)
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+
+    if (enable)
+    {
+        serial.flags |= ASYNC_LOW_LATENCY;
+    }
+    else
+    {
+        serial.flags &= ~ASYNC_LOW_LATENCY;
+    }
+
+    if (ioctl(handle, TIOCSSERIAL, &serial) != 0)
+    {
+        return NRF_ERROR_FORBIDDEN;
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t SerialPortPollPrepare(boost::asio::serial_port::native_handle_type handle)
+{
+    const auto flags = fcntl(handle, F_GETFL, 0);
+
+    if (flags < 0 || fcntl(handle, F_SETFL, flags | O_NONBLOCK) != 0)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t SerialPortPollRead(boost::asio::serial_port::native_handle_type handle, uint8_t *buffer, const size_t size, size_t *length)
+{
+    const auto result = read(handle, buffer, size);
+
+    if (result < 0)
+    {
+        *length = 0;
+        return (errno == EAGAIN || errno == EINTR) ? NRF_SUCCESS : NRF_ERROR_INTERNAL;
+    }
+
+    *length = static_cast<size_t>(result);
+    return NRF_SUCCESS;
+}
+
+uint32_t ThreadCpuPin(const int cpu)
+{
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0 ? NRF_SUCCESS : NRF_ERROR_INVALID_PARAM;
+}
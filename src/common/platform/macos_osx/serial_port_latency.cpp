@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "serial_port_latency.h"
+
+#include "nrf_error.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// The latency timer and low latency flag are only tuned on Linux
+
+uint32_t SerialPortBridgeGet(const std::string &, const std::string &, sd_rpc_usb_bridge_t *bridge)
+{
+    if (bridge == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    *bridge = SD_RPC_USB_BRIDGE_UNKNOWN;
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t SerialPortLatencyTimerGet(const std::string &, const std::string &, uint8_t *)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t SerialPortLatencyTimerSet(const std::string &, const std::string &, const uint8_t)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t SerialPortLowLatencyGet(boost::asio::serial_port::native_handle_type, bool *)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t SerialPortLowLatencySet(boost::asio::serial_port::native_handle_type, const bool)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t SerialPortPollPrepare(boost::asio::serial_port::native_handle_type handle)
+{
+    const auto flags = fcntl(handle, F_GETFL, 0);
+
+    if (flags < 0 || fcntl(handle, F_SETFL, flags | O_NONBLOCK) != 0)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t SerialPortPollRead(boost::asio::serial_port::native_handle_type handle, uint8_t *buffer, const size_t size, size_t *length)
+{
+    const auto result = read(handle, buffer, size);
+
+    if (result < 0)
+    {
+        *length = 0;
+        return (errno == EAGAIN || errno == EINTR) ? NRF_SUCCESS : NRF_ERROR_INTERNAL;
+    }
+
+    *length = static_cast<size_t>(result);
+    return NRF_SUCCESS;
+}
+
+// Threads can only be given affinity hints on macOS
+uint32_t ThreadCpuPin(const int)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
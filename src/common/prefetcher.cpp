@@ -0,0 +1,719 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "prefetcher.h"
+
+#include "serialization_transport.h"
+
+#include "ble_gattc.h"
+#include "ble_gattc_app.h"
+#include "ble_serialization.h"
+#include "nrf_error.h"
+#include "ser_config.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+Prefetcher::Prefetcher(SerializationTransport *_transport, log_cb_t log_callback)
+    : transport(_transport), logCallback(log_callback), learnEnabled(false), learnMaxOps(0),
+    runPrefetchThread(false), totalSavedUs(0)
+{
+    defaultPolicy.learned = false;
+    std::memset(&stats, 0, sizeof(stats));
+}
+
+Prefetcher::~Prefetcher()
+{
+    stop();
+}
+
+uint32_t Prefetcher::policySet(const ble_gap_addr_t *peerAddr, const sd_rpc_prefetch_op_t *ops, const uint8_t opCount)
+{
+    if (ops == nullptr && opCount != 0)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (opCount > SD_RPC_PREFETCH_OPS_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+
+    if (peerAddr == nullptr)
+    {
+        defaultPolicy.ops.assign(ops, ops + opCount);
+        return NRF_SUCCESS;
+    }
+
+    if (opCount == 0)
+    {
+        policies.erase(keyGet(*peerAddr));
+        return NRF_SUCCESS;
+    }
+
+    auto &policy = policies[keyGet(*peerAddr)];
+    policy.ops.assign(ops, ops + opCount);
+    policy.learned = false;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t Prefetcher::learnEnable(const bool enable, const uint8_t maxOps)
+{
+    if (enable && (maxOps == 0 || maxOps > SD_RPC_PREFETCH_OPS_MAX))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+    learnEnabled = enable;
+    learnMaxOps = maxOps;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t Prefetcher::valueGet(const uint16_t connHandle, const uint16_t handle, uint8_t *value, uint16_t *length)
+{
+    if (value == nullptr || length == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+    auto connection = connectionFind(connHandle);
+
+    if (connection == nullptr)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    auto it = connection->values.find(handle);
+
+    if (it == connection->values.end())
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    auto &response = it->second;
+    const auto size = static_cast<uint16_t>(response.data.size());
+
+    if (*length < size)
+    {
+        *length = size;
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    std::copy(response.data.begin(), response.data.end(), value);
+    *length = size;
+
+    if (!response.served)
+    {
+        response.served = true;
+        hit(response.sent, response.received);
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t Prefetcher::statsGet(sd_rpc_prefetch_stats_t *_stats) const
+{
+    if (_stats == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+    *_stats = stats;
+    _stats->learned_policy_count = 0;
+    _stats->mean_saved_us = stats.hit_count > 0 ? static_cast<uint32_t>(totalSavedUs / stats.hit_count) : 0;
+
+    for (const auto &policy : policies)
+    {
+        if (policy.second.learned)
+        {
+            _stats->learned_policy_count++;
+        }
+    }
+
+    return NRF_SUCCESS;
+}
+
+// Event Thread
+bool Prefetcher::process(const ble_evt_t *event)
+{
+    const auto connHandle = event->evt.gattc_evt.conn_handle;
+
+    switch (event->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            connected(event);
+            return false;
+        case BLE_GAP_EVT_DISCONNECTED:
+            disconnected(event->evt.gap_evt.conn_handle);
+            return false;
+        default:
+            break;
+    }
+
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+    auto connection = connectionFind(connHandle);
+
+    if (connection == nullptr)
+    {
+        return false;
+    }
+
+    const auto op = inFlightGet(connection);
+
+    switch (event->header.evt_id)
+    {
+        case BLE_GATTC_EVT_READ_RSP:
+        {
+            const auto &rsp = event->evt.gattc_evt.params.read_rsp;
+
+            if (op == nullptr || op->type != SD_RPC_PREFETCH_OP_READ || op->handle != rsp.handle || rsp.offset != 0)
+            {
+                return false;
+            }
+
+            return responseProcess(connection, event->evt.gattc_evt.gatt_status, rsp.data, rsp.len);
+        }
+        case BLE_GATTC_EVT_WRITE_RSP:
+        {
+            const auto &rsp = event->evt.gattc_evt.params.write_rsp;
+
+            if (op == nullptr || op->type != SD_RPC_PREFETCH_OP_CCCD_WRITE || op->handle != rsp.handle || rsp.write_op != BLE_GATT_OP_WRITE_REQ)
+            {
+                return false;
+            }
+
+            const uint8_t value[] = { static_cast<uint8_t>(op->cccd_value), static_cast<uint8_t>(op->cccd_value >> 8) };
+            return responseProcess(connection, event->evt.gattc_evt.gatt_status, value, sizeof(value));
+        }
+        case BLE_GATTC_EVT_DESC_DISC_RSP:
+        {
+            // CCCDs found by the application are learned when it enables them
+            const auto &rsp = event->evt.gattc_evt.params.desc_disc_rsp;
+
+            for (uint16_t i = 0; connection->learning && i < rsp.count; i++)
+            {
+                if (rsp.descs[i].uuid.type == BLE_UUID_TYPE_BLE && rsp.descs[i].uuid.uuid == BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG)
+                {
+                    connection->cccdHandles.insert(rsp.descs[i].handle);
+                }
+            }
+
+            return false;
+        }
+        case BLE_GATTC_EVT_TIMEOUT:
+            cancel(connection);
+            return false;
+        default:
+            return false;
+    }
+}
+
+bool Prefetcher::readServe(const uint16_t connHandle, const uint16_t handle, const uint16_t offset)
+{
+    std::unique_lock<std::mutex> lock(prefetchMutex);
+    auto connection = acceptedWait(lock, connHandle);
+
+    if (connection == nullptr || offset != 0)
+    {
+        return false;
+    }
+
+    const auto op = inFlightGet(connection);
+
+    if (op != nullptr && op->type == SD_RPC_PREFETCH_OP_READ && op->handle == handle && !connection->applicationWaiting)
+    {
+        // The response in flight is passed to the application when it arrives
+        connection->applicationWaiting = true;
+        hit(connection->sent, std::chrono::steady_clock::now());
+        record(connection, SD_RPC_PREFETCH_OP_READ, handle, 0);
+        return true;
+    }
+
+    auto it = connection->values.find(handle);
+
+    if (it == connection->values.end() || it->second.served)
+    {
+        miss(connection, SD_RPC_PREFETCH_OP_READ, handle);
+        return false;
+    }
+
+    auto &response = it->second;
+    response.served = true;
+    hit(response.sent, response.received);
+    record(connection, SD_RPC_PREFETCH_OP_READ, handle, 0);
+
+    std::vector<uint8_t> buffer(sizeof(ble_evt_t) + response.data.size());
+    auto event = reinterpret_cast<ble_evt_t *>(buffer.data());
+    event->header.evt_id = BLE_GATTC_EVT_READ_RSP;
+    event->header.evt_len = static_cast<uint16_t>(buffer.size());
+    event->evt.gattc_evt.conn_handle = connHandle;
+    event->evt.gattc_evt.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    event->evt.gattc_evt.error_handle = BLE_GATT_HANDLE_INVALID;
+    event->evt.gattc_evt.params.read_rsp.handle = handle;
+    event->evt.gattc_evt.params.read_rsp.offset = 0;
+    event->evt.gattc_evt.params.read_rsp.len = static_cast<uint16_t>(response.data.size());
+    std::copy(response.data.begin(), response.data.end(), event->evt.gattc_evt.params.read_rsp.data);
+    transport->eventInject(event, static_cast<uint32_t>(buffer.size()));
+
+    return true;
+}
+
+bool Prefetcher::writeServe(const uint16_t connHandle, const ble_gattc_write_params_t *params)
+{
+    if (params == nullptr || params->write_op != BLE_GATT_OP_WRITE_REQ || params->offset != 0
+        || params->len != 2 || params->p_value == nullptr)
+    {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(prefetchMutex);
+    auto connection = acceptedWait(lock, connHandle);
+
+    if (connection == nullptr)
+    {
+        return false;
+    }
+
+    const auto value = static_cast<uint16_t>(params->p_value[0] | (params->p_value[1] << 8));
+    const auto op = inFlightGet(connection);
+
+    if (op != nullptr && op->type == SD_RPC_PREFETCH_OP_CCCD_WRITE && op->handle == params->handle
+        && op->cccd_value == value && !connection->applicationWaiting)
+    {
+        connection->applicationWaiting = true;
+        hit(connection->sent, std::chrono::steady_clock::now());
+        record(connection, SD_RPC_PREFETCH_OP_CCCD_WRITE, params->handle, value);
+        return true;
+    }
+
+    auto it = connection->cccds.find(params->handle);
+
+    if (it == connection->cccds.end() || it->second.served || !std::equal(it->second.data.begin(), it->second.data.end(), params->p_value))
+    {
+        // Other writes are neither prefetched nor misses
+        if (connection->cccdHandles.count(params->handle) > 0)
+        {
+            miss(connection, SD_RPC_PREFETCH_OP_CCCD_WRITE, params->handle);
+        }
+
+        return false;
+    }
+
+    auto &response = it->second;
+    response.served = true;
+    hit(response.sent, response.received);
+    record(connection, SD_RPC_PREFETCH_OP_CCCD_WRITE, params->handle, value);
+
+    std::vector<uint8_t> buffer(sizeof(ble_evt_t) + response.data.size());
+    auto event = reinterpret_cast<ble_evt_t *>(buffer.data());
+    event->header.evt_id = BLE_GATTC_EVT_WRITE_RSP;
+    event->header.evt_len = static_cast<uint16_t>(buffer.size());
+    event->evt.gattc_evt.conn_handle = connHandle;
+    event->evt.gattc_evt.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    event->evt.gattc_evt.error_handle = BLE_GATT_HANDLE_INVALID;
+    event->evt.gattc_evt.params.write_rsp.handle = params->handle;
+    event->evt.gattc_evt.params.write_rsp.write_op = BLE_GATT_OP_WRITE_REQ;
+    event->evt.gattc_evt.params.write_rsp.offset = 0;
+    event->evt.gattc_evt.params.write_rsp.len = static_cast<uint16_t>(response.data.size());
+    std::copy(response.data.begin(), response.data.end(), event->evt.gattc_evt.params.write_rsp.data);
+    transport->eventInject(event, static_cast<uint32_t>(buffer.size()));
+
+    return true;
+}
+
+void Prefetcher::readProcess(const uint16_t connHandle, const uint16_t handle, const uint16_t offset)
+{
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+    auto connection = connectionFind(connHandle);
+
+    if (connection != nullptr && offset == 0)
+    {
+        record(connection, SD_RPC_PREFETCH_OP_READ, handle, 0);
+    }
+}
+
+void Prefetcher::writeProcess(const uint16_t connHandle, const ble_gattc_write_params_t *params)
+{
+    if (params == nullptr || params->write_op != BLE_GATT_OP_WRITE_REQ || params->offset != 0
+        || params->len != 2 || params->p_value == nullptr)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+    auto connection = connectionFind(connHandle);
+
+    // Only writes to known CCCDs are learned, other writes may have side effects on the peer
+    if (connection != nullptr && connection->cccdHandles.count(params->handle) > 0)
+    {
+        record(connection, SD_RPC_PREFETCH_OP_CCCD_WRITE, params->handle,
+            static_cast<uint16_t>(params->p_value[0] | (params->p_value[1] << 8)));
+    }
+}
+
+void Prefetcher::clear()
+{
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+    connections.clear();
+    prefetchWaitCondition.notify_all();
+}
+
+void Prefetcher::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(prefetchMutex);
+        runPrefetchThread = false;
+        prefetchWaitCondition.notify_all();
+    }
+
+    // Stopped from the prefetch thread it is detached, it keeps the prefetcher alive until it has returned
+    prefetchThread.stop();
+}
+
+uint64_t Prefetcher::keyGet(const ble_gap_addr_t &addr)
+{
+    auto key = static_cast<uint64_t>(addr.addr_type) << 48;
+
+    for (auto i = 0; i < BLE_GAP_ADDR_LEN; i++)
+    {
+        key |= static_cast<uint64_t>(addr.addr[i]) << (8 * i);
+    }
+
+    return key;
+}
+
+// Prefetch Thread
+void Prefetcher::prefetchRunner()
+{
+    std::unique_lock<std::mutex> lock(prefetchMutex);
+
+    while (runPrefetchThread && prefetchThread.isCurrent())
+    {
+        auto connection = std::find_if(connections.begin(), connections.end(), [](const Connection &candidate) {
+            return !candidate.inFlight && candidate.next < candidate.ops.size();
+        });
+
+        if (connection == connections.end())
+        {
+            prefetchWaitCondition.wait(lock);
+            continue;
+        }
+
+        const auto connHandle = connection->connHandle;
+        const auto op = connection->ops[connection->next];
+        connection->next++;
+        connection->current = op;
+        connection->inFlight = true;
+        connection->accepted = false;
+        connection->applicationWaiting = false;
+        connection->sent = std::chrono::steady_clock::now();
+        stats.op_count++;
+        lock.unlock();
+
+        const auto errCode = opSend(connHandle, op);
+
+        lock.lock();
+        auto current = connectionFind(connHandle);
+
+        if (current != nullptr && current->inFlight)
+        {
+            current->accepted = errCode == NRF_SUCCESS;
+
+            if (errCode != NRF_SUCCESS)
+            {
+                current->inFlight = false;
+                cancel(current);
+
+                std::stringstream message;
+                message << "Prefetch on connection " << connHandle << " stopped, error code " << errCode;
+                logCallback(SD_RPC_LOG_DEBUG, message.str());
+            }
+        }
+
+        prefetchWaitCondition.notify_all();
+    }
+}
+
+uint32_t Prefetcher::opSend(const uint16_t connHandle, const sd_rpc_prefetch_op_t &op)
+{
+    std::vector<uint8_t> command(SER_HAL_TRANSPORT_MAX_PKT_SIZE);
+    std::vector<uint8_t> response(SER_HAL_TRANSPORT_MAX_PKT_SIZE);
+    auto commandLength = static_cast<uint32_t>(command.size());
+    uint32_t responseLength = 0;
+    uint32_t errCode;
+
+    if (op.type == SD_RPC_PREFETCH_OP_READ)
+    {
+        errCode = ble_gattc_read_req_enc(connHandle, op.handle, 0, command.data(), &commandLength);
+    }
+    else
+    {
+        uint8_t value[] = { static_cast<uint8_t>(op.cccd_value), static_cast<uint8_t>(op.cccd_value >> 8) };
+        ble_gattc_write_params_t params;
+        std::memset(&params, 0, sizeof(params));
+        params.write_op = BLE_GATT_OP_WRITE_REQ;
+        params.handle = op.handle;
+        params.len = sizeof(value);
+        params.p_value = value;
+        errCode = ble_gattc_write_req_enc(connHandle, &params, command.data(), &commandLength);
+    }
+
+    if (errCode != NRF_SUCCESS)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    errCode = transport->send(command.data(), commandLength, response.data(), &responseLength);
+
+    if (errCode != NRF_SUCCESS)
+    {
+        return errCode;
+    }
+
+    uint32_t index = 0;
+    uint32_t resultCode = NRF_ERROR_INTERNAL;
+
+    if (ser_ble_cmd_rsp_result_code_dec(response.data(), &index, responseLength, command[0], &resultCode) != NRF_SUCCESS)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    return resultCode;
+}
+
+void Prefetcher::connected(const ble_evt_t *event)
+{
+    const auto &connected = event->evt.gap_evt.params.connected;
+    const auto peer = keyGet(connected.peer_addr);
+
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+
+    auto policy = policies.find(peer);
+    const auto &ops = policy != policies.end() ? policy->second.ops : defaultPolicy.ops;
+    const auto learning = learnEnabled && (policy == policies.end() || policy->second.learned);
+
+    if (ops.empty() && !learning)
+    {
+        return;
+    }
+
+    Connection connection;
+    connection.connHandle = event->evt.gap_evt.conn_handle;
+    connection.peer = peer;
+    connection.ops = ops;
+    connection.next = 0;
+    connection.inFlight = false;
+    connection.accepted = false;
+    connection.applicationWaiting = false;
+    connection.learning = learning;
+
+    for (const auto &op : ops)
+    {
+        if (op.type == SD_RPC_PREFETCH_OP_CCCD_WRITE)
+        {
+            connection.cccdHandles.insert(op.handle);
+        }
+    }
+
+    connections.remove_if([&connection](const Connection &other) { return other.connHandle == connection.connHandle; });
+    connections.push_back(connection);
+
+    if (ops.empty())
+    {
+        return;
+    }
+
+    stats.connection_count++;
+
+    // Commands can not be sent from the event thread, prefetch from a separate thread
+    if (!prefetchThread.runningGet())
+    {
+        runPrefetchThread = true;
+        prefetchThread.start(shared_from_this(), &Prefetcher::prefetchRunner);
+    }
+
+    prefetchWaitCondition.notify_all();
+}
+
+void Prefetcher::disconnected(const uint16_t connHandle)
+{
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+    auto connection = connectionFind(connHandle);
+
+    if (connection == nullptr)
+    {
+        return;
+    }
+
+    cancel(connection);
+
+    for (const auto &value : connection->values)
+    {
+        stats.unused_count += value.second.served ? 0 : 1;
+    }
+
+    for (const auto &cccd : connection->cccds)
+    {
+        stats.unused_count += cccd.second.served ? 0 : 1;
+    }
+
+    if (connection->learning && !connection->recorded.empty())
+    {
+        auto &policy = policies[connection->peer];
+        policy.ops = connection->recorded;
+        policy.learned = true;
+    }
+
+    connections.remove_if([connection](const Connection &other) { return &other == connection; });
+    prefetchWaitCondition.notify_all();
+}
+
+bool Prefetcher::responseProcess(Connection *connection, const uint16_t gattStatus, const uint8_t *data, const uint16_t length)
+{
+    const auto op = inFlightGet(connection);
+    const auto waiting = connection->applicationWaiting;
+
+    connection->inFlight = false;
+    connection->applicationWaiting = false;
+
+    if (!waiting && gattStatus == BLE_GATT_STATUS_SUCCESS)
+    {
+        Response response;
+        response.data.assign(data, data + length);
+        response.sent = connection->sent;
+        response.received = std::chrono::steady_clock::now();
+        response.served = false;
+
+        auto &responses = op->type == SD_RPC_PREFETCH_OP_READ ? connection->values : connection->cccds;
+        responses[op->handle] = response;
+    }
+
+    prefetchWaitCondition.notify_all();
+
+    // Responses the application asked for while they were in flight are passed on as its own
+    return !waiting;
+}
+
+const sd_rpc_prefetch_op_t *Prefetcher::inFlightGet(const Connection *connection) const
+{
+    return connection->inFlight ? &connection->current : nullptr;
+}
+
+bool Prefetcher::covered(const Connection *connection, const sd_rpc_prefetch_op_type_t type, const uint16_t handle) const
+{
+    return std::any_of(connection->ops.begin(), connection->ops.end(), [type, handle](const sd_rpc_prefetch_op_t &op) {
+        return op.type == type && op.handle == handle;
+    });
+}
+
+void Prefetcher::miss(Connection *connection, const sd_rpc_prefetch_op_type_t type, const uint16_t handle)
+{
+    if (connection->ops.empty() || covered(connection, type, handle))
+    {
+        return;
+    }
+
+    // The application takes another path, do not keep its procedures waiting behind the prefetch
+    stats.miss_count++;
+    cancel(connection);
+}
+
+Prefetcher::Connection *Prefetcher::acceptedWait(std::unique_lock<std::mutex> &lock, const uint16_t connHandle)
+{
+    // An operation being sent may still be rejected, wait for the connectivity chip to accept it
+    prefetchWaitCondition.wait(lock, [this, connHandle] {
+        auto connection = connectionFind(connHandle);
+        return connection == nullptr || !connection->inFlight || connection->accepted;
+    });
+
+    return connectionFind(connHandle);
+}
+
+void Prefetcher::cancel(Connection *connection)
+{
+    stats.cancelled_count += static_cast<uint32_t>(connection->ops.size() - connection->next);
+    connection->next = connection->ops.size();
+}
+
+void Prefetcher::hit(const time_point_t &sent, const time_point_t &answered)
+{
+    stats.hit_count++;
+    totalSavedUs += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(answered - sent).count());
+}
+
+void Prefetcher::record(Connection *connection, const sd_rpc_prefetch_op_type_t type, const uint16_t handle, const uint16_t value)
+{
+    if (!connection->learning || connection->recorded.size() >= learnMaxOps)
+    {
+        return;
+    }
+
+    for (const auto &op : connection->recorded)
+    {
+        if (op.type == type && op.handle == handle)
+        {
+            return;
+        }
+    }
+
+    sd_rpc_prefetch_op_t op;
+    op.type = type;
+    op.handle = handle;
+    op.cccd_value = value;
+    connection->recorded.push_back(op);
+}
+
+Prefetcher::Connection *Prefetcher::connectionFind(const uint16_t connHandle)
+{
+    for (auto &connection : connections)
+    {
+        if (connection.connHandle == connHandle)
+        {
+            return &connection;
+        }
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,491 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "presence_table.h"
+
+#include "nrf_error.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+    const uint64_t KEY_USED = 1ULL << 63;
+    const uint64_t KEY_ID_PEER = 1ULL << 62;
+    const uint32_t CAPACITY_MIN = 64;
+
+    // Slots checked for expired devices per advertising report
+    const size_t EXPIRY_SLOTS_PER_REPORT = 4;
+
+    // Bounds of the interval between sweeps of the whole table, a fraction of the timeout
+    const uint64_t SWEEP_INTERVAL_MIN_MS = 10;
+    const uint64_t SWEEP_INTERVAL_MAX_MS = 1000;
+
+    // Minimum interval between snapshots published for changes of presence
+    const uint64_t PUBLISH_COALESCE_MS = 10;
+
+    // Larger weights leave no effect of a new RSSI value at 1/256 dBm resolution
+    const uint8_t RSSI_SMOOTHING_MAX = 15;
+
+    uint64_t sweepIntervalGet(const uint32_t timeoutMs)
+    {
+        return std::min(std::max(static_cast<uint64_t>(timeoutMs / 8), SWEEP_INTERVAL_MIN_MS), SWEEP_INTERVAL_MAX_MS);
+    }
+
+    uint32_t payloadHashGet(const uint8_t *data, const uint8_t length)
+    {
+        // FNV-1a
+        uint32_t hash = 2166136261u;
+
+        for (uint8_t i = 0; i < length; i++)
+        {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+
+        return hash;
+    }
+}
+
+PresenceTable::PresenceTable()
+    : started(false), presenceAdapter(nullptr), presenceHandler(nullptr), mask(0), size(0),
+    expiryCursor(0), lastSnapshot(0), lastSweep(0), publishPending(false)
+{
+    params = {};
+}
+
+PresenceTable::~PresenceTable()
+{
+    stop();
+}
+
+bool PresenceTable::process(adapter_t *adapter, const ble_evt_t *event)
+{
+    // Event Thread
+    if (event->header.evt_id != BLE_GAP_EVT_ADV_REPORT)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(tableMutex);
+
+    if (!started)
+    {
+        return false;
+    }
+
+    const auto changed = changes.size();
+    const auto now = timeGet();
+    update(event->evt.gap_evt.params.adv_report, now);
+    expire(now, EXPIRY_SLOTS_PER_REPORT);
+
+    // Snapshots and notifications are left to the presence thread
+    if (changes.size() != changed)
+    {
+        publishPending = true;
+        presenceWaitCondition.notify_one();
+    }
+
+    return params.suppress_adv_reports;
+}
+
+uint32_t PresenceTable::start(adapter_t *adapter, const sd_rpc_presence_params_t *_params, sd_rpc_presence_handler_t handler)
+{
+    if (_params == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (_params->timeout_ms == 0 || _params->rssi_smoothing > RSSI_SMOOTHING_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    std::lock_guard<std::mutex> lock(tableMutex);
+    params = *_params;
+    presenceAdapter = adapter;
+    presenceHandler = handler;
+    started = true;
+
+    size_t capacity = CAPACITY_MIN;
+
+    // Keep the load factor at or below 3/4 for the initial number of devices
+    while (capacity * 3 < static_cast<size_t>(params.initial_capacity) * 4)
+    {
+        capacity <<= 1;
+    }
+
+    slots.assign(capacity, Slot());
+    mask = capacity - 1;
+    size = 0;
+    expiryCursor = 0;
+    changes.clear();
+    publishPending = false;
+    lastSweep = timeGet();
+    publish(lastSweep);
+
+    if (!presenceThread.runningGet())
+    {
+        presenceThread.start(shared_from_this(), &PresenceTable::presenceRunner);
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t PresenceTable::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(tableMutex);
+        started = false;
+        presenceAdapter = nullptr;
+        presenceHandler = nullptr;
+        slots.clear();
+        slots.shrink_to_fit();
+        size = 0;
+        changes.clear();
+        std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>());
+        presenceWaitCondition.notify_all();
+    }
+
+    // Stopped from the presence handler the thread is detached, it keeps the table alive until it has returned
+    presenceThread.stop();
+    return NRF_SUCCESS;
+}
+
+uint32_t PresenceTable::snapshotGet(sd_rpc_presence_entry_t *entries, uint32_t *count, uint64_t *time) const
+{
+    if (entries == nullptr || count == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    const auto current = std::atomic_load(&snapshot);
+
+    if (!current)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    const auto available = static_cast<uint32_t>(current->entries.size());
+
+    if (available > *count)
+    {
+        *count = available;
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    std::copy(current->entries.begin(), current->entries.end(), entries);
+    *count = available;
+
+    if (time != nullptr)
+    {
+        *time = current->time;
+    }
+
+    return NRF_SUCCESS;
+}
+
+// Presence Thread
+void PresenceTable::presenceRunner()
+{
+    std::unique_lock<std::mutex> lock(tableMutex);
+
+    while (started && presenceThread.isCurrent())
+    {
+        const auto now = timeGet();
+
+        if (changes.empty())
+        {
+            const auto waitTime = waitTimeGet(now);
+
+            if (waitTime > 0)
+            {
+                presenceWaitCondition.wait_for(lock, std::chrono::milliseconds(waitTime));
+                continue;
+            }
+        }
+
+        // Devices leave after the timeout even if no advertising reports are received
+        if (now >= lastSweep + sweepIntervalGet(params.timeout_ms))
+        {
+            const auto changed = changes.size();
+            expire(now, slots.size());
+            lastSweep = now;
+            publishPending = publishPending || changes.size() != changed;
+        }
+
+        if (params.snapshot_interval_ms == 0
+            ? publishPending && now >= lastSnapshot + PUBLISH_COALESCE_MS
+            : now >= lastSnapshot + params.snapshot_interval_ms)
+        {
+            publish(now);
+            publishPending = false;
+        }
+
+        std::vector<Change> notified;
+        notified.swap(changes);
+        const auto adapter = presenceAdapter;
+        const auto handler = presenceHandler;
+
+        if (notified.empty() || handler == nullptr)
+        {
+            continue;
+        }
+
+        // Notify without holding the table lock, the handler may read a snapshot or stop the table
+        lock.unlock();
+
+        for (const auto &change : notified)
+        {
+            handler(adapter, &change.entry, change.present);
+        }
+
+        lock.lock();
+    }
+}
+
+uint64_t PresenceTable::waitTimeGet(const uint64_t now) const
+{
+    auto wakeup = lastSweep + sweepIntervalGet(params.timeout_ms);
+
+    if (params.snapshot_interval_ms > 0)
+    {
+        wakeup = std::min(wakeup, lastSnapshot + params.snapshot_interval_ms);
+    }
+    else if (publishPending)
+    {
+        wakeup = std::min(wakeup, lastSnapshot + PUBLISH_COALESCE_MS);
+    }
+
+    return wakeup > now ? wakeup - now : 0;
+}
+
+uint64_t PresenceTable::keyGet(const ble_gap_addr_t &addr)
+{
+    auto key = KEY_USED | (static_cast<uint64_t>(addr.addr_type) << 48);
+
+#if NRF_SD_BLE_API_VERSION >= 5
+    if (addr.addr_id_peer)
+    {
+        key |= KEY_ID_PEER;
+    }
+#endif
+
+    for (auto i = 0; i < BLE_GAP_ADDR_LEN; i++)
+    {
+        key |= static_cast<uint64_t>(addr.addr[i]) << (8 * i);
+    }
+
+    return key;
+}
+
+uint64_t PresenceTable::timeGet()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+sd_rpc_presence_entry_t PresenceTable::entryGet(const Slot &slot)
+{
+    sd_rpc_presence_entry_t entry = {};
+
+#if NRF_SD_BLE_API_VERSION >= 5
+    entry.peer_addr.addr_id_peer = (slot.key & KEY_ID_PEER) != 0 ? 1 : 0;
+#endif
+    entry.peer_addr.addr_type = static_cast<uint8_t>((slot.key >> 48) & 0x7F);
+
+    for (auto i = 0; i < BLE_GAP_ADDR_LEN; i++)
+    {
+        entry.peer_addr.addr[i] = static_cast<uint8_t>(slot.key >> (8 * i));
+    }
+
+    entry.rssi = static_cast<int8_t>(std::lround(slot.rssi / 256.0));
+    entry.last_seen_ms = slot.lastSeen;
+    entry.report_count = slot.reportCount;
+    entry.payload_hash = slot.payloadHash;
+    return entry;
+}
+
+size_t PresenceTable::home(const uint64_t key) const
+{
+    // splitmix64 finalizer, addresses often share their upper bytes
+    auto hash = key + 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    return static_cast<size_t>(hash ^ (hash >> 31)) & mask;
+}
+
+void PresenceTable::update(const ble_gap_evt_adv_report_t &report, const uint64_t now)
+{
+    if ((size + 1) * 4 > slots.size() * 3)
+    {
+        resize(slots.size() * 2);
+    }
+
+    const auto key = keyGet(report.peer_addr);
+    auto index = home(key);
+
+    while (slots[index].key != 0 && slots[index].key != key)
+    {
+        index = (index + 1) & mask;
+    }
+
+    auto &slot = slots[index];
+    const auto rssi = static_cast<int32_t>(report.rssi) * 256;
+    const auto entered = slot.key == 0;
+
+    if (entered)
+    {
+        slot.key = key;
+        slot.rssi = rssi;
+        slot.reportCount = 0;
+        slot.payloadHash = 0;
+        size++;
+    }
+    else
+    {
+        slot.rssi += (rssi - slot.rssi) / (1 << params.rssi_smoothing);
+    }
+
+    slot.lastSeen = now;
+    slot.reportCount++;
+
+    if (!report.scan_rsp)
+    {
+        slot.payloadHash = payloadHashGet(report.data, report.dlen);
+    }
+
+    if (entered)
+    {
+        changes.push_back({ entryGet(slot), true });
+    }
+}
+
+void PresenceTable::remove(size_t index)
+{
+    size--;
+
+    // Shift following entries of the probe sequence back, so that lookups stop at the first free slot
+    auto next = index;
+
+    while (true)
+    {
+        next = (next + 1) & mask;
+
+        if (slots[next].key == 0)
+        {
+            break;
+        }
+
+        const auto nextHome = home(slots[next].key);
+        const auto inPlace = index <= next
+            ? (index < nextHome && nextHome <= next)
+            : (index < nextHome || nextHome <= next);
+
+        if (!inPlace)
+        {
+            slots[index] = slots[next];
+            index = next;
+        }
+    }
+
+    slots[index].key = 0;
+}
+
+void PresenceTable::expire(const uint64_t now, size_t slotCount)
+{
+    while (slotCount > 0 && size > 0)
+    {
+        const auto &slot = slots[expiryCursor];
+
+        if (slot.key != 0 && slot.lastSeen + params.timeout_ms <= now)
+        {
+            changes.push_back({ entryGet(slot), false });
+
+            // Another entry may have been shifted into the slot, check it again
+            remove(expiryCursor);
+            continue;
+        }
+
+        expiryCursor = (expiryCursor + 1) & mask;
+        slotCount--;
+    }
+}
+
+void PresenceTable::resize(const size_t capacity)
+{
+    std::vector<Slot> previous(capacity, Slot());
+    previous.swap(slots);
+    mask = capacity - 1;
+    expiryCursor = 0;
+
+    for (const auto &slot : previous)
+    {
+        if (slot.key == 0)
+        {
+            continue;
+        }
+
+        auto index = home(slot.key);
+
+        while (slots[index].key != 0)
+        {
+            index = (index + 1) & mask;
+        }
+
+        slots[index] = slot;
+    }
+}
+
+void PresenceTable::publish(const uint64_t now)
+{
+    expire(now, slots.size());
+
+    auto next = std::make_shared<Snapshot>();
+    next->time = now;
+    next->entries.reserve(size);
+
+    for (const auto &slot : slots)
+    {
+        if (slot.key != 0)
+        {
+            next->entries.push_back(entryGet(slot));
+        }
+    }
+
+    lastSnapshot = now;
+    std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>(next));
+}
@@ -0,0 +1,816 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "provisioner.h"
+
+#include "adapter_internal.h"
+
+#include "ble_gap.h"
+#include "ble_gattc.h"
+#include "ble_hci.h"
+#include "nrf_error.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    const uint16_t HANDLE_MAX = 0xFFFF;
+
+    uint32_t elapsedMs(const std::chrono::steady_clock::time_point &since)
+    {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - since).count());
+    }
+}
+
+Provisioner::Provisioner(provisioner_t *_handle, adapter_t *adapters[], const uint8_t adapterCount,
+                         const sd_rpc_provision_params_t *_params, sd_rpc_provision_result_handler_t _resultHandler)
+    : handle(_handle), params(*_params), resultHandler(_resultHandler),
+    runWorkerThread(false), completedCount(0), failedCount(0)
+{
+    if (params.max_connections == 0)
+    {
+        params.max_connections = 1;
+    }
+
+    for (uint8_t i = 0; i < adapterCount; i++)
+    {
+        Lane lane;
+        lane.adapter = adapters[i];
+        lane.adapterInternal = static_cast<AdapterInternal *>(adapters[i]->internal);
+        lane.scanning = false;
+        lane.connecting = nullptr;
+        lane.activeCount = 0;
+        lanes.push_back(lane);
+    }
+
+    for (auto stage = 0; stage < SD_RPC_PROVISION_STAGE_COUNT; stage++)
+    {
+        stageTotalMs[stage] = 0;
+        stageCount[stage] = 0;
+        stageMaxMs[stage] = 0;
+    }
+}
+
+Provisioner::~Provisioner()
+{
+    stop();
+}
+
+uint32_t Provisioner::jobAdd(const sd_rpc_provision_job_t *job)
+{
+    if (job == nullptr || (job->write_count > 0 && job->p_writes == nullptr))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    Job newJob;
+    newJob.peerAddr = job->peer_addr;
+    newJob.verify = job->verify != 0;
+    newJob.context = job->p_context;
+    newJob.queued = std::chrono::steady_clock::now();
+
+    for (uint8_t i = 0; i < job->write_count; i++)
+    {
+        const auto &write = job->p_writes[i];
+
+        if (write.len > SD_RPC_PROVISION_VALUE_MAX_LEN)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+
+        if (write.len > 0 && write.p_value == nullptr)
+        {
+            return NRF_ERROR_NULL;
+        }
+
+        Write newWrite;
+        newWrite.uuid = write.uuid;
+        newWrite.value.assign(write.p_value, write.p_value + write.len);
+        newWrite.handle = BLE_GATT_HANDLE_INVALID;
+        newJob.writes.push_back(newWrite);
+    }
+
+    std::lock_guard<std::mutex> lock(provisionerMutex);
+    pendingJobs.push_back(newJob);
+    workerWaitCondition.notify_all();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t Provisioner::start()
+{
+    std::lock_guard<std::mutex> lock(provisionerMutex);
+
+    if (workerThread.runningGet())
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    startTime = std::chrono::steady_clock::now();
+    runWorkerThread = true;
+    workerThread.start(shared_from_this(), &Provisioner::workerRunner);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t Provisioner::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(provisionerMutex);
+
+        if (!workerThread.runningGet())
+        {
+            return NRF_SUCCESS;
+        }
+
+        runWorkerThread = false;
+        workerWaitCondition.notify_all();
+    }
+
+    // Stopped from the result handler the thread is detached, it keeps the provisioner alive until
+    // it has returned. The device reported is already removed, so the adapters are released here too.
+    workerThread.stop();
+    release();
+
+    return NRF_SUCCESS;
+}
+
+void Provisioner::release()
+{
+    // Release the adapters, devices found but not provisioned are provisioned again when started
+    for (auto &lane : lanes)
+    {
+        if (lane.scanning)
+        {
+            sd_ble_gap_scan_stop(lane.adapter);
+            lane.scanning = false;
+        }
+
+        if (lane.connecting != nullptr)
+        {
+            sd_ble_gap_connect_cancel(lane.adapter);
+            lane.connecting = nullptr;
+        }
+
+        lane.activeCount = 0;
+    }
+
+    std::lock_guard<std::mutex> lock(provisionerMutex);
+
+    for (auto &device : devices)
+    {
+        if (device.connected)
+        {
+            sd_ble_gap_disconnect(lanes[device.lane].adapter, device.connHandle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+        }
+
+        for (auto &write : device.job.writes)
+        {
+            write.handle = BLE_GATT_HANDLE_INVALID;
+        }
+
+        pendingJobs.push_front(device.job);
+    }
+
+    devices.clear();
+
+    std::queue<Event> empty;
+    std::swap(eventQueue, empty);
+}
+
+uint32_t Provisioner::statsGet(sd_rpc_provision_stats_t *stats) const
+{
+    if (stats == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(provisionerMutex);
+
+    stats->jobs_pending = static_cast<uint32_t>(pendingJobs.size());
+    stats->jobs_active = static_cast<uint32_t>(devices.size());
+    stats->devices_completed = completedCount;
+    stats->devices_failed = failedCount;
+    stats->devices_per_hour = 0;
+
+    if (workerThread.runningGet())
+    {
+        const auto elapsed = elapsedMs(startTime);
+
+        if (elapsed > 0)
+        {
+            stats->devices_per_hour = static_cast<uint32_t>(uint64_t(completedCount) * 3600000 / elapsed);
+        }
+    }
+
+    for (auto stage = 0; stage < SD_RPC_PROVISION_STAGE_COUNT; stage++)
+    {
+        stats->stages[stage].count = stageCount[stage];
+        stats->stages[stage].average_ms = stageCount[stage] > 0 ? static_cast<uint32_t>(stageTotalMs[stage] / stageCount[stage]) : 0;
+        stats->stages[stage].max_ms = stageMaxMs[stage];
+    }
+
+    return NRF_SUCCESS;
+}
+
+// Event Thread
+void Provisioner::eventProcess(AdapterInternal *adapter, const ble_evt_t *event)
+{
+    Event copy;
+    copy.lane = lanes.size();
+
+    for (size_t i = 0; i < lanes.size(); i++)
+    {
+        if (lanes[i].adapterInternal == adapter)
+        {
+            copy.lane = i;
+        }
+    }
+
+    if (copy.lane == lanes.size())
+    {
+        return;
+    }
+
+    copy.id = event->header.evt_id;
+    copy.connHandle = BLE_CONN_HANDLE_INVALID;
+    copy.role = 0;
+    copy.timeoutSource = 0;
+    copy.gattStatus = BLE_GATT_STATUS_SUCCESS;
+    std::memset(&copy.address, 0, sizeof(copy.address));
+
+    std::lock_guard<std::mutex> lock(provisionerMutex);
+
+    if (!runWorkerThread)
+    {
+        return;
+    }
+
+    switch (event->header.evt_id)
+    {
+        case BLE_GAP_EVT_ADV_REPORT:
+        {
+            // Only reports from devices to provision are passed on to keep the queue short
+            copy.address = event->evt.gap_evt.params.adv_report.peer_addr;
+            auto job = std::find_if(pendingJobs.begin(), pendingJobs.end(), [&copy](const Job &pending) {
+                return addressEqual(pending.peerAddr, copy.address);
+            });
+
+            if (job == pendingJobs.end())
+            {
+                return;
+            }
+
+            break;
+        }
+        case BLE_GAP_EVT_CONNECTED:
+            copy.connHandle = event->evt.gap_evt.conn_handle;
+            copy.address = event->evt.gap_evt.params.connected.peer_addr;
+            copy.role = event->evt.gap_evt.params.connected.role;
+            break;
+        case BLE_GAP_EVT_DISCONNECTED:
+            copy.connHandle = event->evt.gap_evt.conn_handle;
+            break;
+        case BLE_GAP_EVT_TIMEOUT:
+            copy.timeoutSource = event->evt.gap_evt.params.timeout.src;
+            break;
+        case BLE_GATTC_EVT_CHAR_DISC_RSP:
+        {
+            const auto &rsp = event->evt.gattc_evt.params.char_disc_rsp;
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+            copy.gattStatus = event->evt.gattc_evt.gatt_status;
+            copy.chars.assign(rsp.chars, rsp.chars + rsp.count);
+            break;
+        }
+        case BLE_GATTC_EVT_WRITE_RSP:
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+            copy.gattStatus = event->evt.gattc_evt.gatt_status;
+            break;
+        case BLE_GATTC_EVT_READ_RSP:
+        {
+            const auto &rsp = event->evt.gattc_evt.params.read_rsp;
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+            copy.gattStatus = event->evt.gattc_evt.gatt_status;
+            copy.data.assign(rsp.data, rsp.data + rsp.len);
+            break;
+        }
+        case BLE_GATTC_EVT_TIMEOUT:
+            copy.connHandle = event->evt.gattc_evt.conn_handle;
+            copy.gattStatus = event->evt.gattc_evt.gatt_status;
+            break;
+        default:
+            return;
+    }
+
+    eventQueue.push(copy);
+    workerWaitCondition.notify_all();
+}
+
+std::vector<AdapterInternal *> Provisioner::adaptersGet() const
+{
+    std::vector<AdapterInternal *> adapters;
+
+    for (const auto &lane : lanes)
+    {
+        adapters.push_back(lane.adapterInternal);
+    }
+
+    return adapters;
+}
+
+// Worker Thread
+void Provisioner::workerRunner()
+{
+    std::unique_lock<std::mutex> lock(provisionerMutex);
+
+    while (runWorkerThread && workerThread.isCurrent())
+    {
+        if (!eventQueue.empty())
+        {
+            const auto event = eventQueue.front();
+            eventQueue.pop();
+            lock.unlock();
+
+            eventHandle(event);
+
+            lock.lock();
+            continue;
+        }
+
+        lock.unlock();
+        schedule();
+        lock.lock();
+
+        if (runWorkerThread && eventQueue.empty())
+        {
+            workerWaitCondition.wait(lock);
+        }
+    }
+}
+
+void Provisioner::eventHandle(const Event &event)
+{
+    auto &lane = lanes[event.lane];
+
+    switch (event.id)
+    {
+        case BLE_GAP_EVT_ADV_REPORT:
+            advReportHandle(event);
+            return;
+        case BLE_GAP_EVT_CONNECTED:
+            connectedHandle(event);
+            return;
+        case BLE_GAP_EVT_TIMEOUT:
+            if (event.timeoutSource == BLE_GAP_TIMEOUT_SRC_SCAN)
+            {
+                lane.scanning = false;
+            }
+            else if (event.timeoutSource == BLE_GAP_TIMEOUT_SRC_CONN && lane.connecting != nullptr)
+            {
+                auto device = lane.connecting;
+                lane.connecting = nullptr;
+                device->result = NRF_ERROR_TIMEOUT;
+                finish(device);
+            }
+            return;
+        default:
+            break;
+    }
+
+    auto device = deviceFind(event.lane, event.connHandle);
+
+    if (device == nullptr)
+    {
+        return;
+    }
+
+    switch (event.id)
+    {
+        case BLE_GAP_EVT_DISCONNECTED:
+            device->connected = false;
+            lane.activeCount--;
+
+            if (device->stage != SD_RPC_PROVISION_STAGE_DISCONNECT && device->result == NRF_SUCCESS)
+            {
+                // Disconnected by the device or the link was lost
+                device->result = NRF_ERROR_INVALID_STATE;
+            }
+
+            finish(device);
+            break;
+        case BLE_GATTC_EVT_CHAR_DISC_RSP:
+            charDiscRspHandle(device, event);
+            break;
+        case BLE_GATTC_EVT_WRITE_RSP:
+            writeRspHandle(device, event);
+            break;
+        case BLE_GATTC_EVT_READ_RSP:
+            readRspHandle(device, event);
+            break;
+        case BLE_GATTC_EVT_TIMEOUT:
+            fail(device, NRF_ERROR_TIMEOUT, event.gattStatus);
+            break;
+        default:
+            break;
+    }
+}
+
+void Provisioner::schedule()
+{
+    bool jobsPending;
+
+    {
+        std::lock_guard<std::mutex> lock(provisionerMutex);
+        jobsPending = !pendingJobs.empty();
+    }
+
+    // Scan for the next device on each adapter with room for another connection
+    for (auto &lane : lanes)
+    {
+        if (!jobsPending || lane.scanning || lane.connecting != nullptr || lane.activeCount >= params.max_connections)
+        {
+            continue;
+        }
+
+        if (sd_ble_gap_scan_start(lane.adapter, &params.scan_params) == NRF_SUCCESS)
+        {
+            lane.scanning = true;
+            lane.scanStart = std::chrono::steady_clock::now();
+        }
+    }
+}
+
+void Provisioner::advReportHandle(const Event &event)
+{
+    auto &lane = lanes[event.lane];
+
+    if (!lane.scanning || lane.connecting != nullptr)
+    {
+        return;
+    }
+
+    Device *device;
+
+    {
+        std::lock_guard<std::mutex> lock(provisionerMutex);
+
+        auto job = std::find_if(pendingJobs.begin(), pendingJobs.end(), [&event](const Job &pending) {
+            return addressEqual(pending.peerAddr, event.address);
+        });
+
+        if (job == pendingJobs.end())
+        {
+            // Found by another adapter
+            return;
+        }
+
+        devices.push_back(Device());
+        device = &devices.back();
+        device->job = *job;
+        pendingJobs.erase(job);
+    }
+
+    device->lane = event.lane;
+    device->connHandle = BLE_CONN_HANDLE_INVALID;
+    device->connected = false;
+    device->index = 0;
+    device->result = NRF_SUCCESS;
+    device->gattStatus = BLE_GATT_STATUS_SUCCESS;
+    std::memset(device->stageTime, 0, sizeof(device->stageTime));
+
+    // The scan stage starts when the device is queued or the adapter starts scanning, whichever is later
+    device->stage = SD_RPC_PROVISION_STAGE_SCAN;
+    device->failedStage = SD_RPC_PROVISION_STAGE_COUNT;
+    device->stageStart = std::max(lane.scanStart, device->job.queued);
+
+    // Connecting stops scanning
+    sd_ble_gap_scan_stop(lane.adapter);
+    lane.scanning = false;
+
+    stageEnter(device, SD_RPC_PROVISION_STAGE_CONNECT);
+
+    auto errCode = sd_ble_gap_connect(lane.adapter, &device->job.peerAddr, &params.scan_params, &params.conn_params
+#if NRF_SD_BLE_API_VERSION >= 4
+        , BLE_CONN_CFG_TAG_DEFAULT
+#endif
+        );
+
+    if (errCode != NRF_SUCCESS)
+    {
+        device->result = errCode;
+        finish(device);
+        return;
+    }
+
+    lane.connecting = device;
+}
+
+void Provisioner::connectedHandle(const Event &event)
+{
+    auto &lane = lanes[event.lane];
+    auto device = lane.connecting;
+
+    if (event.role != BLE_GAP_ROLE_CENTRAL || device == nullptr || !addressEqual(device->job.peerAddr, event.address))
+    {
+        return;
+    }
+
+    lane.connecting = nullptr;
+    lane.activeCount++;
+    device->connHandle = event.connHandle;
+    device->connected = true;
+
+    stageEnter(device, SD_RPC_PROVISION_STAGE_DISCOVER);
+    discover(device, 1);
+}
+
+void Provisioner::charDiscRspHandle(Device *device, const Event &event)
+{
+    if (device->stage != SD_RPC_PROVISION_STAGE_DISCOVER)
+    {
+        return;
+    }
+
+    uint16_t lastHandle = HANDLE_MAX;
+
+    if (event.gattStatus == BLE_GATT_STATUS_SUCCESS)
+    {
+        for (const auto &characteristic : event.chars)
+        {
+            for (auto &write : device->job.writes)
+            {
+                if (write.handle == BLE_GATT_HANDLE_INVALID
+                    && write.uuid.type == characteristic.uuid.type
+                    && write.uuid.uuid == characteristic.uuid.uuid)
+                {
+                    write.handle = characteristic.handle_value;
+                }
+            }
+
+            lastHandle = characteristic.handle_value;
+        }
+    }
+    else if (event.gattStatus != BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND)
+    {
+        fail(device, NRF_ERROR_INTERNAL, event.gattStatus);
+        return;
+    }
+
+    const auto missing = std::count_if(device->job.writes.begin(), device->job.writes.end(), [](const Write &write) {
+        return write.handle == BLE_GATT_HANDLE_INVALID;
+    });
+
+    if (missing == 0)
+    {
+        stageEnter(device, SD_RPC_PROVISION_STAGE_WRITE);
+        write(device);
+    }
+    else if (event.gattStatus == BLE_GATT_STATUS_SUCCESS && !event.chars.empty() && lastHandle < HANDLE_MAX)
+    {
+        discover(device, lastHandle + 1);
+    }
+    else
+    {
+        fail(device, NRF_ERROR_NOT_FOUND);
+    }
+}
+
+void Provisioner::writeRspHandle(Device *device, const Event &event)
+{
+    if (device->stage != SD_RPC_PROVISION_STAGE_WRITE)
+    {
+        return;
+    }
+
+    if (event.gattStatus != BLE_GATT_STATUS_SUCCESS)
+    {
+        fail(device, NRF_ERROR_INTERNAL, event.gattStatus);
+        return;
+    }
+
+    device->index++;
+    write(device);
+}
+
+void Provisioner::readRspHandle(Device *device, const Event &event)
+{
+    if (device->stage != SD_RPC_PROVISION_STAGE_VERIFY)
+    {
+        return;
+    }
+
+    if (event.gattStatus != BLE_GATT_STATUS_SUCCESS)
+    {
+        fail(device, NRF_ERROR_INTERNAL, event.gattStatus);
+        return;
+    }
+
+    if (event.data != device->job.writes[device->index].value)
+    {
+        fail(device, NRF_ERROR_INVALID_DATA);
+        return;
+    }
+
+    device->index++;
+    read(device);
+}
+
+void Provisioner::stageEnter(Device *device, const sd_rpc_provision_stage_t stage)
+{
+    const auto now = std::chrono::steady_clock::now();
+    device->stageTime[device->stage] = static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - device->stageStart).count());
+    device->stage = stage;
+    device->stageStart = now;
+    device->index = 0;
+}
+
+void Provisioner::discover(Device *device, const uint16_t startHandle)
+{
+    ble_gattc_handle_range_t range;
+    range.start_handle = startHandle;
+    range.end_handle = HANDLE_MAX;
+
+    auto errCode = sd_ble_gattc_characteristics_discover(lanes[device->lane].adapter, device->connHandle, &range);
+
+    if (errCode != NRF_SUCCESS)
+    {
+        fail(device, errCode);
+    }
+}
+
+void Provisioner::write(Device *device)
+{
+    if (device->index >= device->job.writes.size())
+    {
+        if (device->job.verify && !device->job.writes.empty())
+        {
+            stageEnter(device, SD_RPC_PROVISION_STAGE_VERIFY);
+            read(device);
+        }
+        else
+        {
+            disconnect(device);
+        }
+
+        return;
+    }
+
+    auto &write = device->job.writes[device->index];
+
+    ble_gattc_write_params_t writeParams;
+    std::memset(&writeParams, 0, sizeof(writeParams));
+    writeParams.write_op = BLE_GATT_OP_WRITE_REQ;
+    writeParams.handle = write.handle;
+    writeParams.offset = 0;
+    writeParams.len = static_cast<uint16_t>(write.value.size());
+    writeParams.p_value = write.value.data();
+
+    auto errCode = sd_ble_gattc_write(lanes[device->lane].adapter, device->connHandle, &writeParams);
+
+    if (errCode != NRF_SUCCESS)
+    {
+        fail(device, errCode);
+    }
+}
+
+void Provisioner::read(Device *device)
+{
+    if (device->index >= device->job.writes.size())
+    {
+        disconnect(device);
+        return;
+    }
+
+    auto errCode = sd_ble_gattc_read(lanes[device->lane].adapter, device->connHandle, device->job.writes[device->index].handle, 0);
+
+    if (errCode != NRF_SUCCESS)
+    {
+        fail(device, errCode);
+    }
+}
+
+void Provisioner::fail(Device *device, const uint32_t result, const uint16_t gattStatus)
+{
+    device->failedStage = device->stage;
+    device->result = result;
+    device->gattStatus = gattStatus;
+    disconnect(device);
+}
+
+void Provisioner::disconnect(Device *device)
+{
+    stageEnter(device, SD_RPC_PROVISION_STAGE_DISCONNECT);
+
+    auto errCode = sd_ble_gap_disconnect(lanes[device->lane].adapter, device->connHandle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+
+    if (errCode != NRF_SUCCESS)
+    {
+        // Already disconnected, the disconnected event finishes the device
+        if (device->result == NRF_SUCCESS)
+        {
+            device->result = errCode;
+        }
+    }
+}
+
+void Provisioner::finish(Device *device)
+{
+    stageEnter(device, device->stage);
+
+    // Report the stage that failed, or the stage the device was in when the link was lost
+    if (device->result != NRF_SUCCESS && device->failedStage == SD_RPC_PROVISION_STAGE_COUNT)
+    {
+        device->failedStage = device->stage;
+    }
+
+    sd_rpc_provision_result_t result;
+    result.peer_addr = device->job.peerAddr;
+    result.p_context = device->job.context;
+    result.result = device->result;
+    result.gatt_status = device->gattStatus;
+    result.stage = device->result == NRF_SUCCESS ? device->stage : device->failedStage;
+    std::memcpy(result.stage_time_ms, device->stageTime, sizeof(result.stage_time_ms));
+
+    auto adapter = lanes[device->lane].adapter;
+
+    {
+        std::lock_guard<std::mutex> lock(provisionerMutex);
+
+        if (device->result == NRF_SUCCESS)
+        {
+            completedCount++;
+
+            for (auto stage = 0; stage < SD_RPC_PROVISION_STAGE_COUNT; stage++)
+            {
+                stageTotalMs[stage] += device->stageTime[stage];
+                stageCount[stage]++;
+                stageMaxMs[stage] = std::max(stageMaxMs[stage], device->stageTime[stage]);
+            }
+        }
+        else
+        {
+            failedCount++;
+        }
+
+        devices.remove_if([device](const Device &other) { return &other == device; });
+    }
+
+    if (resultHandler != nullptr)
+    {
+        resultHandler(handle, adapter, &result);
+    }
+}
+
+Provisioner::Device *Provisioner::deviceFind(const size_t lane, const uint16_t connHandle)
+{
+    for (auto &device : devices)
+    {
+        if (device.lane == lane && device.connected && device.connHandle == connHandle)
+        {
+            return &device;
+        }
+    }
+
+    return nullptr;
+}
+
+bool Provisioner::addressEqual(const ble_gap_addr_t &a, const ble_gap_addr_t &b)
+{
+    return a.addr_type == b.addr_type && std::memcmp(a.addr, b.addr, BLE_GAP_ADDR_LEN) == 0;
+}
@@ -45,8 +45,12 @@
 #include "serial_port_enum.h"
 #include "conn_systemreset_app.h"
 #include "ble_common.h"
+#include "dfu_engine.h"
+#include "gatt_cache.h"
+#include "provisioner.h"
 
 #include <stdlib.h>
+#include <vector>
 
 #ifndef _WIN32
 #define strcpy_s(a,b,c) strcpy(a,c)
@@ -118,6 +122,10 @@ physical_layer_t *sd_rpc_physical_layer_create_uart(const char * port_name, uint
     {
         uartSettings.flowControl = UartFlowControlHardware;
     }
+    else if (flow_control == SD_RPC_FLOW_CONTROL_SOFTWARE)
+    {
+        uartSettings.flowControl = UartFlowControlSoftware;
+    }
 
     if (parity == SD_RPC_PARITY_NONE)
     {
@@ -136,6 +144,42 @@ physical_layer_t *sd_rpc_physical_layer_create_uart(const char * port_name, uint
     return physicalLayer;
 }
 
+uint32_t sd_rpc_physical_layer_low_latency_enable(physical_layer_t *physical_layer, bool enable)
+{
+    auto uart = static_cast<UartBoost *>(physical_layer->internal);
+    return uart->lowLatencySet(enable);
+}
+
+uint32_t sd_rpc_physical_layer_latency_info_get(physical_layer_t *physical_layer, sd_rpc_serial_latency_info_t *p_info)
+{
+    if (p_info == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    auto uart = static_cast<UartBoost *>(physical_layer->internal);
+    *p_info = uart->latencyInfoGet();
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_rpc_physical_layer_busy_poll_enable(physical_layer_t *physical_layer, const sd_rpc_busy_poll_params_t *p_params)
+{
+    auto uart = static_cast<UartBoost *>(physical_layer->internal);
+    return uart->busyPollSet(p_params);
+}
+
+uint32_t sd_rpc_physical_layer_busy_poll_stats_get(physical_layer_t *physical_layer, sd_rpc_busy_poll_stats_t *p_stats)
+{
+    if (p_stats == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    auto uart = static_cast<UartBoost *>(physical_layer->internal);
+    *p_stats = uart->busyPollStatsGet();
+    return NRF_SUCCESS;
+}
+
 data_link_layer_t *sd_rpc_data_link_layer_create_bt_three_wire(physical_layer_t *physical_layer, uint32_t retransmission_interval)
 {
     auto dataLinkLayer = static_cast<data_link_layer_t *>(malloc(sizeof(data_link_layer_t)));
@@ -145,6 +189,30 @@ data_link_layer_t *sd_rpc_data_link_layer_create_bt_three_wire(physical_layer_t
     return dataLinkLayer;
 }
 
+uint32_t sd_rpc_data_link_layer_unreliable_lane_enable(data_link_layer_t *data_link_layer, bool enable)
+{
+    auto h5 = static_cast<H5Transport *>(data_link_layer->internal);
+    return h5->unreliableLaneEnable(enable);
+}
+
+uint32_t sd_rpc_data_link_layer_unreliable_lane_info_get(data_link_layer_t *data_link_layer, sd_rpc_unreliable_lane_info_t *p_info)
+{
+    auto h5 = static_cast<H5Transport *>(data_link_layer->internal);
+    return h5->unreliableLaneInfoGet(p_info);
+}
+
+uint32_t sd_rpc_data_link_layer_baud_rate_detect_enable(data_link_layer_t *data_link_layer, bool enable, const uint32_t *p_baud_rates, uint8_t baud_rate_count)
+{
+    auto h5 = static_cast<H5Transport *>(data_link_layer->internal);
+    return h5->baudRateDetectEnable(enable, p_baud_rates, baud_rate_count);
+}
+
+uint32_t sd_rpc_data_link_layer_baud_rate_detect_info_get(data_link_layer_t *data_link_layer, sd_rpc_baud_rate_detect_info_t *p_info)
+{
+    auto h5 = static_cast<H5Transport *>(data_link_layer->internal);
+    return h5->baudRateDetectInfoGet(p_info);
+}
+
 transport_layer_t *sd_rpc_transport_layer_create(data_link_layer_t *data_link_layer, uint32_t response_timeout)
 {
     auto transportLayer = static_cast<transport_layer_t *>(malloc(sizeof(transport_layer_t)));
@@ -195,3 +263,432 @@ uint32_t sd_rpc_conn_reset(adapter_t *adapter)
 
     return encode_decode(adapter, encode_function, nullptr);
 }
+
+uint32_t sd_rpc_conn_state_get(adapter_t *adapter, uint16_t conn_handle, sd_rpc_conn_state_t *p_conn_state)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->connStateTracker.get(conn_handle, p_conn_state);
+}
+
+uint32_t sd_rpc_conn_state_list(adapter_t *adapter, sd_rpc_conn_state_t conn_states[], uint32_t *size)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->connStateTracker.list(conn_states, size);
+}
+
+uint32_t sd_rpc_state_replay_enable(adapter_t *adapter, bool enable)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->stateReplayEnable(enable);
+}
+
+uint32_t sd_rpc_state_replay_info_get(adapter_t *adapter, sd_rpc_state_replay_info_t *p_info)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->stateJournal->infoGet(p_info);
+}
+
+uint32_t sd_rpc_adv_restart_enable(adapter_t *adapter, bool enable)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->advRestarter->enable(enable);
+}
+
+uint32_t sd_rpc_adv_restart_info_get(adapter_t *adapter, sd_rpc_adv_restart_info_t *p_info)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->advRestarter->infoGet(p_info);
+}
+
+uint32_t sd_rpc_failover_standby_set(adapter_t *adapter, adapter_t *standby)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    auto standbyLayer = standby != nullptr ? static_cast<AdapterInternal*>(standby->internal) : nullptr;
+    return adapterLayer->failoverStandbySet(standbyLayer);
+}
+
+uint32_t sd_rpc_failover_info_get(adapter_t *adapter, sd_rpc_failover_info_t *p_info)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->failoverInfoGet(p_info);
+}
+
+uint32_t sd_rpc_notification_sink_add(adapter_t *adapter, const sd_rpc_notification_sink_params_t *p_params)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->notificationSink.add(p_params);
+}
+
+uint32_t sd_rpc_notification_sink_remove(adapter_t *adapter, uint16_t conn_handle, uint16_t value_handle)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->notificationSink.remove(conn_handle, value_handle);
+}
+
+uint32_t sd_rpc_notification_sink_swap(adapter_t *adapter, uint16_t conn_handle, uint16_t value_handle, sd_rpc_notification_chunk_t *p_chunks, uint32_t *p_count, uint32_t *p_dropped)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->notificationSink.swap(conn_handle, value_handle, p_chunks, p_count, p_dropped);
+}
+
+uint32_t sd_rpc_notification_sink_release(adapter_t *adapter, sd_rpc_notification_chunk_t *p_chunks, uint32_t count)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->notificationSink.release(p_chunks, count);
+}
+
+provisioner_t *sd_rpc_provisioner_create(adapter_t *adapters[], uint8_t adapter_count, const sd_rpc_provision_params_t *p_params, sd_rpc_provision_result_handler_t result_handler)
+{
+    if (adapters == nullptr || adapter_count == 0 || p_params == nullptr)
+    {
+        return nullptr;
+    }
+
+    auto provisionerLayer = static_cast<provisioner_t *>(malloc(sizeof(provisioner_t)));
+    auto provisioner = std::make_shared<Provisioner>(provisionerLayer, adapters, adapter_count, p_params, result_handler);
+
+    for (auto adapterLayer : provisioner->adaptersGet())
+    {
+        adapterLayer->observerAdd(provisioner);
+    }
+
+    provisionerLayer->internal = static_cast<void *>(new std::shared_ptr<Provisioner>(provisioner));
+    return provisionerLayer;
+}
+
+void sd_rpc_provisioner_delete(provisioner_t *provisioner)
+{
+    auto provisionerLayer = static_cast<std::shared_ptr<Provisioner>*>(provisioner->internal);
+    (*provisionerLayer)->stop();
+
+    for (auto adapterLayer : (*provisionerLayer)->adaptersGet())
+    {
+        adapterLayer->observerRemove(provisionerLayer->get());
+    }
+
+    delete provisionerLayer;
+    free(provisioner);
+}
+
+uint32_t sd_rpc_provisioner_job_add(provisioner_t *provisioner, const sd_rpc_provision_job_t *p_job)
+{
+    auto provisionerLayer = static_cast<std::shared_ptr<Provisioner>*>(provisioner->internal);
+    return (*provisionerLayer)->jobAdd(p_job);
+}
+
+uint32_t sd_rpc_provisioner_start(provisioner_t *provisioner)
+{
+    auto provisionerLayer = static_cast<std::shared_ptr<Provisioner>*>(provisioner->internal);
+    return (*provisionerLayer)->start();
+}
+
+uint32_t sd_rpc_provisioner_stop(provisioner_t *provisioner)
+{
+    auto provisionerLayer = static_cast<std::shared_ptr<Provisioner>*>(provisioner->internal);
+    return (*provisionerLayer)->stop();
+}
+
+uint32_t sd_rpc_provisioner_stats_get(provisioner_t *provisioner, sd_rpc_provision_stats_t *p_stats)
+{
+    auto provisionerLayer = static_cast<std::shared_ptr<Provisioner>*>(provisioner->internal);
+    return (*provisionerLayer)->statsGet(p_stats);
+}
+
+dfu_engine_t *sd_rpc_dfu_engine_create(adapter_t *adapters[], uint8_t adapter_count, sd_rpc_dfu_result_handler_t result_handler)
+{
+    if (adapters == nullptr || adapter_count == 0)
+    {
+        return nullptr;
+    }
+
+    auto engineLayer = static_cast<dfu_engine_t *>(malloc(sizeof(dfu_engine_t)));
+    auto engine = std::make_shared<DfuEngine>(engineLayer, adapters, adapter_count, result_handler);
+
+    if (engine->open() != NRF_SUCCESS)
+    {
+        free(engineLayer);
+        return nullptr;
+    }
+
+    for (auto adapterLayer : engine->adaptersGet())
+    {
+        adapterLayer->observerAdd(engine);
+    }
+
+    engineLayer->internal = static_cast<void *>(new std::shared_ptr<DfuEngine>(engine));
+    return engineLayer;
+}
+
+void sd_rpc_dfu_engine_delete(dfu_engine_t *engine)
+{
+    auto engineLayer = static_cast<std::shared_ptr<DfuEngine>*>(engine->internal);
+    (*engineLayer)->close();
+
+    for (auto adapterLayer : (*engineLayer)->adaptersGet())
+    {
+        adapterLayer->observerRemove(engineLayer->get());
+    }
+
+    delete engineLayer;
+    free(engine);
+}
+
+uint32_t sd_rpc_dfu_start(dfu_engine_t *engine, adapter_t *adapter, uint16_t conn_handle, const sd_rpc_dfu_image_t *p_image, void *p_context)
+{
+    auto engineLayer = static_cast<std::shared_ptr<DfuEngine>*>(engine->internal);
+    return (*engineLayer)->start(adapter, conn_handle, p_image, p_context);
+}
+
+uint32_t sd_rpc_dfu_abort(dfu_engine_t *engine, adapter_t *adapter, uint16_t conn_handle)
+{
+    auto engineLayer = static_cast<std::shared_ptr<DfuEngine>*>(engine->internal);
+    return (*engineLayer)->abort(adapter, conn_handle);
+}
+
+uint32_t sd_rpc_dfu_progress_get(dfu_engine_t *engine, adapter_t *adapter, uint16_t conn_handle, sd_rpc_dfu_progress_t *p_progress)
+{
+    auto engineLayer = static_cast<std::shared_ptr<DfuEngine>*>(engine->internal);
+    return (*engineLayer)->progressGet(adapter, conn_handle, p_progress);
+}
+
+uint32_t sd_rpc_dfu_stats_get(dfu_engine_t *engine, sd_rpc_dfu_stats_t *p_stats)
+{
+    auto engineLayer = static_cast<std::shared_ptr<DfuEngine>*>(engine->internal);
+    return (*engineLayer)->statsGet(p_stats);
+}
+
+gatt_cache_t *sd_rpc_gatt_cache_create(adapter_t *adapters[], uint8_t adapter_count, const sd_rpc_gatt_cache_params_t *p_params, sd_rpc_gatt_table_handler_t table_handler)
+{
+    if (adapters == nullptr || adapter_count == 0)
+    {
+        return nullptr;
+    }
+
+    auto cacheLayer = static_cast<gatt_cache_t *>(malloc(sizeof(gatt_cache_t)));
+    auto cache = std::make_shared<GattCache>(cacheLayer, adapters, adapter_count, p_params, table_handler);
+
+    if (cache->open() != NRF_SUCCESS)
+    {
+        free(cacheLayer);
+        return nullptr;
+    }
+
+    for (auto adapterLayer : cache->adaptersGet())
+    {
+        adapterLayer->observerAdd(cache);
+    }
+
+    cacheLayer->internal = static_cast<void *>(new std::shared_ptr<GattCache>(cache));
+    return cacheLayer;
+}
+
+void sd_rpc_gatt_cache_delete(gatt_cache_t *cache)
+{
+    auto cacheLayer = static_cast<std::shared_ptr<GattCache>*>(cache->internal);
+    (*cacheLayer)->close();
+
+    for (auto adapterLayer : (*cacheLayer)->adaptersGet())
+    {
+        adapterLayer->observerRemove(cacheLayer->get());
+    }
+
+    delete cacheLayer;
+    free(cache);
+}
+
+uint32_t sd_rpc_gatt_cache_table_get(gatt_cache_t *cache, adapter_t *adapter, uint16_t conn_handle, const sd_rpc_gatt_table_t **pp_table)
+{
+    auto cacheLayer = static_cast<std::shared_ptr<GattCache>*>(cache->internal);
+    return (*cacheLayer)->tableGet(adapter, conn_handle, pp_table);
+}
+
+uint32_t sd_rpc_gatt_cache_table_release(gatt_cache_t *cache, const sd_rpc_gatt_table_t *p_table)
+{
+    auto cacheLayer = static_cast<std::shared_ptr<GattCache>*>(cache->internal);
+    return (*cacheLayer)->tableRelease(p_table);
+}
+
+uint32_t sd_rpc_gatt_cache_stats_get(gatt_cache_t *cache, sd_rpc_gatt_cache_stats_t *p_stats)
+{
+    auto cacheLayer = static_cast<std::shared_ptr<GattCache>*>(cache->internal);
+    return (*cacheLayer)->statsGet(p_stats);
+}
+
+uint32_t sd_rpc_prefetch_policy_set(adapter_t *adapter, const ble_gap_addr_t *p_peer_addr, const sd_rpc_prefetch_op_t *p_ops, uint8_t op_count)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->prefetcher->policySet(p_peer_addr, p_ops, op_count);
+}
+
+uint32_t sd_rpc_prefetch_learn_enable(adapter_t *adapter, bool enable, uint8_t max_ops)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->prefetcher->learnEnable(enable, max_ops);
+}
+
+uint32_t sd_rpc_prefetch_value_get(adapter_t *adapter, uint16_t conn_handle, uint16_t handle, uint8_t *p_value, uint16_t *p_len)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->prefetcher->valueGet(conn_handle, handle, p_value, p_len);
+}
+
+uint32_t sd_rpc_prefetch_stats_get(adapter_t *adapter, sd_rpc_prefetch_stats_t *p_stats)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->prefetcher->statsGet(p_stats);
+}
+
+uint32_t sd_rpc_device_counter_start(adapter_t *adapter, const sd_rpc_device_counter_params_t *p_params)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->deviceCounter.start(p_params);
+}
+
+uint32_t sd_rpc_device_counter_stop(adapter_t *adapter)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->deviceCounter.stop();
+}
+
+uint32_t sd_rpc_device_count_get(adapter_t *adapters[], uint8_t adapter_count, uint32_t window, sd_rpc_device_count_t *p_count)
+{
+    if (adapters == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::vector<DeviceCounter *> counters;
+
+    for (uint8_t i = 0; i < adapter_count; i++)
+    {
+        if (adapters[i] == nullptr)
+        {
+            return NRF_ERROR_NULL;
+        }
+
+        auto adapterLayer = static_cast<AdapterInternal*>(adapters[i]->internal);
+        counters.push_back(&adapterLayer->deviceCounter);
+    }
+
+    return DeviceCounter::countGet(counters, window, p_count);
+}
+
+uint32_t sd_rpc_presence_table_start(adapter_t *adapter, const sd_rpc_presence_params_t *p_params, sd_rpc_presence_handler_t presence_handler)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->presenceTable->start(adapter, p_params, presence_handler);
+}
+
+uint32_t sd_rpc_presence_table_stop(adapter_t *adapter)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->presenceTable->stop();
+}
+
+uint32_t sd_rpc_presence_table_snapshot(adapter_t *adapter, sd_rpc_presence_entry_t *p_entries, uint32_t *p_count, uint64_t *p_time_ms)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->presenceTable->snapshotGet(p_entries, p_count, p_time_ms);
+}
+
+uint32_t sd_rpc_gatts_hvx_broadcast(adapter_t *adapter, const sd_rpc_hvx_broadcast_params_t *p_params, sd_rpc_hvx_delivery_t *p_deliveries, uint32_t *p_count)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->subscriptionTracker.broadcast(adapter, p_params, p_deliveries, p_count);
+}
+
+uint32_t sd_rpc_peer_stats_open(adapter_t *adapter, const sd_rpc_peer_stats_params_t *p_params)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->peerStats.open(p_params);
+}
+
+uint32_t sd_rpc_peer_stats_close(adapter_t *adapter)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->peerStats.close();
+}
+
+uint32_t sd_rpc_peer_stats_get(adapter_t *adapter, const ble_gap_addr_t *p_peer_addr, sd_rpc_peer_stats_t *p_stats)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->peerStats.get(p_peer_addr, p_stats);
+}
+
+uint32_t sd_rpc_peer_stats_list(adapter_t *adapter, sd_rpc_peer_stats_t *p_stats, uint32_t *p_count)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->peerStats.list(p_stats, p_count);
+}
+
+uint32_t sd_rpc_conn_timeline_start(adapter_t *adapter, const sd_rpc_conn_timeline_params_t *p_params)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->connTimeline.start(p_params);
+}
+
+uint32_t sd_rpc_conn_timeline_stop(adapter_t *adapter)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->connTimeline.stop();
+}
+
+uint32_t sd_rpc_conn_timeline_get(adapter_t *adapter, uint16_t conn_handle, sd_rpc_conn_timeline_t *p_timeline)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->connTimeline.get(conn_handle, p_timeline);
+}
+
+uint32_t sd_rpc_conn_timeline_list(adapter_t *adapter, sd_rpc_conn_timeline_t *p_timelines, uint32_t *p_count)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->connTimeline.list(p_timelines, p_count);
+}
+
+uint32_t sd_rpc_conn_timeline_stats_get(adapter_t *adapter, sd_rpc_conn_timeline_stats_t *p_stats)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->connTimeline.statsGet(p_stats);
+}
+
+uint32_t sd_rpc_user_mem_pool_open(adapter_t *adapter, const sd_rpc_user_mem_pool_params_t *p_params)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->userMemPool->open(p_params);
+}
+
+uint32_t sd_rpc_user_mem_pool_close(adapter_t *adapter)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->userMemPool->close();
+}
+
+uint32_t sd_rpc_user_mem_pool_stats_get(adapter_t *adapter, sd_rpc_user_mem_pool_stats_t *p_stats)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->userMemPool->statsGet(p_stats);
+}
+
+uint32_t sd_rpc_user_mem_pool_block_get(adapter_t *adapter, uint16_t conn_handle, uint8_t *p_data, uint16_t *p_len)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->userMemPool->leasedBlockGet(conn_handle, p_data, p_len);
+}
+
+uint32_t sd_rpc_event_bridge_start(adapter_t *adapter, const sd_rpc_event_bridge_params_t *p_params)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->eventBridge.start(p_params);
+}
+
+uint32_t sd_rpc_event_bridge_stop(adapter_t *adapter)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->eventBridge.stop();
+}
+
+uint32_t sd_rpc_event_bridge_info_get(adapter_t *adapter, sd_rpc_event_bridge_info_t *p_info)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->eventBridge.infoGet(p_info);
+}
@@ -0,0 +1,417 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "state_journal.h"
+
+#include "serialization_transport.h"
+
+#include "ble_serialization.h"
+#include "nrf_error.h"
+#include "ser_config.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+    // Journal keys combine the op code with an identifier for commands that are recorded per identifier
+    uint64_t keyGet(const uint8_t opcode, const uint32_t id = 0)
+    {
+        return (static_cast<uint64_t>(opcode) << 32) | id;
+    }
+
+    uint32_t uint32Get(const uint8_t *data)
+    {
+        return static_cast<uint32_t>(data[0])
+            | (static_cast<uint32_t>(data[1]) << 8)
+            | (static_cast<uint32_t>(data[2]) << 16)
+            | (static_cast<uint32_t>(data[3]) << 24);
+    }
+}
+
+StateJournal::StateJournal(SerializationTransport *_transport, status_cb_t status_callback)
+    : transport(_transport), statusCallback(status_callback),
+    replayEnabled(false), replayPending(false),
+    resetPending(false), runReplayThread(false), resetGeneration(0)
+{
+    info.command_count = 0;
+    info.replay_count = 0;
+    info.last_command_count = 0;
+    info.last_failed_count = 0;
+    info.last_recovery_time_ms = 0;
+    info.last_error = NRF_SUCCESS;
+}
+
+StateJournal::~StateJournal()
+{
+    stop();
+}
+
+bool StateJournal::record(const uint8_t *command, const uint32_t length)
+{
+    if (command == nullptr || length == 0)
+    {
+        return false;
+    }
+
+    const auto opcode = command[0];
+    auto replace = true;
+    uint64_t key = keyGet(opcode);
+
+    switch (opcode)
+    {
+        case SD_BLE_ENABLE:
+        {
+            // The application is configuring a freshly reset chip, start a new journal
+            std::lock_guard<std::mutex> lock(journalMutex);
+            entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Entry &entry) {
+#if NRF_SD_BLE_API_VERSION >= 5
+                return (entry.key >> 32) != SD_BLE_CFG_SET;
+#else
+                (void)entry;
+                return true;
+#endif
+            }), entries.end());
+            break;
+        }
+#if NRF_SD_BLE_API_VERSION >= 5
+        case SD_BLE_CFG_SET:
+#endif
+        case SD_BLE_OPT_SET:
+            if (length < 5)
+            {
+                return false;
+            }
+
+            key = keyGet(opcode, uint32Get(&command[1]));
+            break;
+        case SD_BLE_UUID_VS_ADD:
+        case SD_BLE_GATTS_SERVICE_ADD:
+        case SD_BLE_GATTS_INCLUDE_ADD:
+        case SD_BLE_GATTS_CHARACTERISTIC_ADD:
+        case SD_BLE_GATTS_DESCRIPTOR_ADD:
+            // Handles are assigned in order, replaying in the same order gives the same handles
+            replace = false;
+            break;
+#if NRF_SD_BLE_API_VERSION >= 5
+        case SD_BLE_GAP_ADDR_SET:
+        case SD_BLE_GAP_WHITELIST_SET:
+        case SD_BLE_GAP_DEVICE_IDENTITIES_SET:
+        case SD_BLE_GAP_PRIVACY_SET:
+#else
+        case SD_BLE_GAP_ADDRESS_SET:
+#endif
+        case SD_BLE_GAP_ADV_DATA_SET:
+        case SD_BLE_GAP_TX_POWER_SET:
+        case SD_BLE_GAP_APPEARANCE_SET:
+        case SD_BLE_GAP_PPCP_SET:
+        case SD_BLE_GAP_DEVICE_NAME_SET:
+        case SD_BLE_GAP_SCAN_START:
+            break;
+        case SD_BLE_GAP_SCAN_STOP:
+        case SD_BLE_GAP_CONNECT:
+            // Connecting stops an ongoing scan
+            scanEntryRemove();
+            return false;
+        default:
+            return false;
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.replace = replace;
+    entry.command.assign(command, command + length);
+
+    std::lock_guard<std::mutex> lock(journalMutex);
+
+    if (replace)
+    {
+        auto existing = std::find_if(entries.begin(), entries.end(), [key](const Entry &other) {
+            return other.replace && other.key == key;
+        });
+
+        if (existing != entries.end())
+        {
+            *existing = entry;
+            return true;
+        }
+    }
+
+    entries.push_back(entry);
+    return true;
+}
+
+std::vector<std::vector<uint8_t>> StateJournal::commandsGet() const
+{
+    std::lock_guard<std::mutex> lock(journalMutex);
+    std::vector<std::vector<uint8_t>> commands;
+
+    for (const auto &entry : entries)
+    {
+        commands.push_back(entry.command);
+    }
+
+    return commands;
+}
+
+void StateJournal::process(const ble_evt_t *event)
+{
+    if (event->header.evt_id == BLE_GAP_EVT_TIMEOUT
+        && event->evt.gap_evt.params.timeout.src == BLE_GAP_TIMEOUT_SRC_SCAN)
+    {
+        scanEntryRemove();
+    }
+}
+
+void StateJournal::statusProcess(sd_rpc_app_status_t code)
+{
+    std::lock_guard<std::mutex> lock(journalMutex);
+
+    if (code == RESET_PERFORMED)
+    {
+        if (!replayEnabled)
+        {
+            // The application configures the chip again itself
+            entries.clear();
+            return;
+        }
+
+        if (!resetPending)
+        {
+            resetPending = true;
+            resetTime = std::chrono::steady_clock::now();
+        }
+
+        resetGeneration++;
+        replayPending = false;
+    }
+    else if (code == CONNECTION_ACTIVE && resetPending)
+    {
+        if (entries.empty())
+        {
+            resetPending = false;
+            return;
+        }
+
+        // Commands can not be sent from the transport threads, replay from a separate thread
+        if (!replayThread.runningGet())
+        {
+            runReplayThread = true;
+            replayThread.start(shared_from_this(), &StateJournal::replayRunner);
+        }
+
+        replayPending = true;
+        replayWaitCondition.notify_one();
+    }
+}
+
+void StateJournal::clear()
+{
+    std::lock_guard<std::mutex> lock(journalMutex);
+    entries.clear();
+    resetPending = false;
+    replayPending = false;
+    resetGeneration++;
+}
+
+void StateJournal::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(journalMutex);
+        runReplayThread = false;
+        resetGeneration++;
+        replayWaitCondition.notify_one();
+    }
+
+    // Stopped from a status callback issued by the replay thread itself the thread is detached,
+    // it keeps the journal alive until it has returned
+    replayThread.stop();
+}
+
+bool StateJournal::restorePendingGet() const
+{
+    std::lock_guard<std::mutex> lock(journalMutex);
+    return resetPending;
+}
+
+uint32_t StateJournal::replayEnable(const bool enable)
+{
+    std::lock_guard<std::mutex> lock(journalMutex);
+    replayEnabled = enable;
+    return NRF_SUCCESS;
+}
+
+bool StateJournal::replayEnabledGet() const
+{
+    std::lock_guard<std::mutex> lock(journalMutex);
+    return replayEnabled;
+}
+
+uint32_t StateJournal::infoGet(sd_rpc_state_replay_info_t *_info) const
+{
+    if (_info == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(journalMutex);
+    *_info = info;
+    _info->command_count = static_cast<uint32_t>(entries.size());
+    return NRF_SUCCESS;
+}
+
+// Replay Thread
+void StateJournal::replayRunner()
+{
+    std::unique_lock<std::mutex> lock(journalMutex);
+
+    while (runReplayThread && replayThread.isCurrent())
+    {
+        if (!replayPending)
+        {
+            replayWaitCondition.wait(lock);
+            continue;
+        }
+
+        replayPending = false;
+
+        const auto journal = entries;
+        const auto generation = resetGeneration;
+        lock.unlock();
+
+        uint32_t failedCount = 0;
+        const auto errCode = replay(journal, generation, &failedCount);
+
+        lock.lock();
+
+        if (generation != resetGeneration)
+        {
+            // Reset again during replay, the journal is replayed when the link is active again
+            continue;
+        }
+
+        resetPending = false;
+        info.replay_count++;
+        info.last_command_count = static_cast<uint32_t>(journal.size());
+        info.last_failed_count = failedCount;
+        info.last_error = errCode;
+        info.last_recovery_time_ms = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - resetTime).count());
+
+        std::stringstream message;
+        auto code = STATE_REPLAY_COMPLETED;
+
+        if (errCode == NRF_SUCCESS)
+        {
+            message << "State restored, " << journal.size() << " commands replayed in "
+                << info.last_recovery_time_ms << " ms after reset";
+        }
+        else
+        {
+            code = STATE_REPLAY_FAILED;
+            message << "State replay failed, " << failedCount << " of " << journal.size()
+                << " commands not restored, error code " << errCode;
+        }
+
+        lock.unlock();
+        statusCallback(code, message.str().c_str());
+        lock.lock();
+    }
+}
+
+uint32_t StateJournal::replay(const std::vector<Entry> &journal, const uint32_t generation, uint32_t *failedCount)
+{
+    std::vector<uint8_t> command;
+    std::vector<uint8_t> response(SER_HAL_TRANSPORT_MAX_PKT_SIZE);
+    uint32_t firstError = NRF_SUCCESS;
+
+    // Commands are sent back to back, without waiting for the application in between
+    for (size_t i = 0; i < journal.size(); i++)
+    {
+        {
+            std::lock_guard<std::mutex> lock(journalMutex);
+
+            if (!runReplayThread || generation != resetGeneration)
+            {
+                *failedCount += static_cast<uint32_t>(journal.size() - i);
+                return NRF_ERROR_INVALID_STATE;
+            }
+        }
+
+        command = journal[i].command;
+        uint32_t responseLength = 0;
+
+        auto errCode = transport->send(command.data(), static_cast<uint32_t>(command.size()), response.data(), &responseLength);
+
+        if (errCode != NRF_SUCCESS)
+        {
+            // The link is down, remaining commands can not be restored
+            *failedCount += static_cast<uint32_t>(journal.size() - i);
+            return NRF_ERROR_INTERNAL;
+        }
+
+        uint32_t index = 0;
+        uint32_t resultCode = NRF_SUCCESS;
+        errCode = ser_ble_cmd_rsp_result_code_dec(response.data(), &index, responseLength, command[0], &resultCode);
+
+        if (errCode != NRF_SUCCESS)
+        {
+            resultCode = NRF_ERROR_INTERNAL;
+        }
+
+        if (resultCode != NRF_SUCCESS)
+        {
+            (*failedCount)++;
+
+            if (firstError == NRF_SUCCESS)
+            {
+                firstError = resultCode;
+            }
+        }
+    }
+
+    return firstError;
+}
+
+void StateJournal::scanEntryRemove()
+{
+    std::lock_guard<std::mutex> lock(journalMutex);
+    const auto key = keyGet(SD_BLE_GAP_SCAN_START);
+
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [key](const Entry &entry) {
+        return entry.key == key;
+    }), entries.end());
+}
@@ -0,0 +1,471 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "subscription_tracker.h"
+
+#include "user_mem_pool.h"
+
+#include "nrf_error.h"
+
+#include <algorithm>
+
+namespace {
+    const uint16_t CCCD_NOTIFY = 0x0001;
+    const uint16_t CCCD_INDICATE = 0x0002;
+
+    // Error code of sd_ble_gatts_hvx when the TX queue of the connection is full
+#if NRF_SD_BLE_API_VERSION >= 5
+    const uint32_t HVX_QUEUE_FULL = NRF_ERROR_RESOURCES;
+#else
+    const uint32_t HVX_QUEUE_FULL = BLE_ERROR_NO_TX_PACKETS;
+#endif
+
+    // Size of the handle, offset and length preceding each queued write in a user memory block
+    const uint16_t QUEUED_WRITE_HEADER_SIZE = 6;
+
+    uint16_t uint16Get(const uint8_t *data)
+    {
+        return static_cast<uint16_t>(data[0] | (data[1] << 8));
+    }
+}
+
+SubscriptionTracker::SubscriptionTracker()
+{}
+
+void SubscriptionTracker::process(const ble_evt_t *event, UserMemPool &userMemPool)
+{
+    switch (event->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+        {
+            std::lock_guard<std::mutex> lock(trackerMutex);
+            auto &connection = connections[event->evt.gap_evt.conn_handle];
+            connection.cccds.clear();
+            connection.queued = 0;
+            connection.queueSize = 0;
+            break;
+        }
+        case BLE_GAP_EVT_DISCONNECTED:
+        {
+            std::lock_guard<std::mutex> lock(trackerMutex);
+            connections.erase(event->evt.gap_evt.conn_handle);
+            break;
+        }
+        case BLE_GATTS_EVT_WRITE:
+        {
+            const auto &write = event->evt.gatts_evt.params.write;
+
+            if (write.op == BLE_GATTS_OP_WRITE_REQ && write.offset == 0 && write.len >= 2)
+            {
+                cccdWrite(event->evt.gatts_evt.conn_handle, write.handle, uint16Get(write.data));
+            }
+            else if (write.op == BLE_GATTS_OP_EXEC_WRITE_REQ_NOW)
+            {
+                execute(event->evt.gatts_evt.conn_handle, userMemPool);
+            }
+            else if (write.op == BLE_GATTS_OP_EXEC_WRITE_REQ_CANCEL)
+            {
+                cancel(event->evt.gatts_evt.conn_handle);
+            }
+
+            break;
+        }
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+        {
+            const auto &request = event->evt.gatts_evt.params.authorize_request;
+
+            if (request.type == BLE_GATTS_AUTHORIZE_TYPE_WRITE)
+            {
+                authorizeRequest(event->evt.gatts_evt.conn_handle, request.request.write);
+            }
+
+            break;
+        }
+#if NRF_SD_BLE_API_VERSION >= 5
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+            txComplete(event->evt.gatts_evt.conn_handle, event->evt.gatts_evt.params.hvn_tx_complete.count);
+            break;
+#else
+        case BLE_EVT_TX_COMPLETE:
+            txComplete(event->evt.common_evt.conn_handle, event->evt.common_evt.params.tx_complete.count);
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+void SubscriptionTracker::characteristicAdd(const uint16_t valueHandle, const uint16_t cccdHandle)
+{
+    if (cccdHandle == BLE_GATT_HANDLE_INVALID)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    valueHandles[cccdHandle] = valueHandle;
+}
+
+void SubscriptionTracker::sysAttrSet(const uint16_t connHandle, const uint8_t *data, const uint16_t length, const uint32_t flags)
+{
+    if (flags == BLE_GATTS_SYS_ATTR_FLAG_SYS_SRVCS)
+    {
+        // Only the attributes of the GATT service are changed
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(trackerMutex);
+        connections[connHandle].cccds.clear();
+    }
+
+    if (data == nullptr)
+    {
+        return;
+    }
+
+    // Each attribute is stored as handle, length and value, followed by a CRC of all attributes
+    uint16_t index = 0;
+
+    while (length >= 4 && index <= length - 4)
+    {
+        const auto handle = uint16Get(&data[index]);
+        const auto valueLength = uint16Get(&data[index + 2]);
+        index += 4;
+
+        if (valueLength > length - index)
+        {
+            break;
+        }
+
+        if (valueLength >= 2)
+        {
+            cccdWrite(connHandle, handle, uint16Get(&data[index]));
+        }
+
+        index += valueLength;
+    }
+}
+
+void SubscriptionTracker::authorizeReplyProcess(const uint16_t connHandle, const ble_gatts_rw_authorize_reply_params_t *params,
+                                                const uint32_t errCode, UserMemPool &userMemPool)
+{
+    if (errCode != NRF_SUCCESS || params == nullptr || params->type != BLE_GATTS_AUTHORIZE_TYPE_WRITE)
+    {
+        return;
+    }
+
+    const auto &reply = params->params.write;
+    uint8_t op;
+    uint16_t cccdHandle = BLE_GATT_HANDLE_INVALID;
+    uint16_t value = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(trackerMutex);
+        auto connection = connections.find(connHandle);
+
+        if (connection == connections.end() || connection->second.authorizeOp == BLE_GATTS_OP_INVALID)
+        {
+            return;
+        }
+
+        auto &pending = connection->second;
+        op = pending.authorizeOp;
+        pending.authorizeOp = BLE_GATTS_OP_INVALID;
+
+        if (reply.gatt_status != BLE_GATT_STATUS_SUCCESS)
+        {
+            // A refused execution discards the prepared writes
+            if (op == BLE_GATTS_OP_EXEC_WRITE_REQ_NOW)
+            {
+                pending.prepared.clear();
+            }
+
+            return;
+        }
+
+        // The value stored is the one the application supplies with the reply
+        const auto data = reply.update && reply.p_data != nullptr ? reply.p_data : pending.authorizeData.data();
+        const auto offset = reply.update && reply.p_data != nullptr ? reply.offset : pending.authorizeOffset;
+        const auto length = reply.update && reply.p_data != nullptr ? reply.len : static_cast<uint16_t>(pending.authorizeData.size());
+
+        if (op == BLE_GATTS_OP_WRITE_REQ && offset == 0 && length >= 2)
+        {
+            cccdHandle = pending.authorizeHandle;
+            value = uint16Get(data);
+        }
+        else if (op == BLE_GATTS_OP_PREP_WRITE_REQ)
+        {
+            prepare(pending, pending.authorizeHandle, offset, data, length);
+        }
+    }
+
+    if (cccdHandle != BLE_GATT_HANDLE_INVALID)
+    {
+        cccdWrite(connHandle, cccdHandle, value);
+    }
+    else if (op == BLE_GATTS_OP_EXEC_WRITE_REQ_NOW)
+    {
+        execute(connHandle, userMemPool);
+    }
+    else if (op == BLE_GATTS_OP_EXEC_WRITE_REQ_CANCEL)
+    {
+        cancel(connHandle);
+    }
+}
+
+void SubscriptionTracker::hvxProcess(const uint16_t connHandle, const uint8_t type, const uint32_t errCode)
+{
+    if (type != BLE_GATT_HVX_NOTIFICATION)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    auto connection = connections.find(connHandle);
+
+    if (connection == connections.end())
+    {
+        return;
+    }
+
+    if (errCode == NRF_SUCCESS)
+    {
+        connection->second.queued++;
+    }
+    else if (errCode == HVX_QUEUE_FULL && connection->second.queued > 0)
+    {
+        connection->second.queueSize = connection->second.queued;
+    }
+}
+
+void SubscriptionTracker::clear()
+{
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    connections.clear();
+}
+
+uint32_t SubscriptionTracker::broadcast(adapter_t *adapter, const sd_rpc_hvx_broadcast_params_t *params, sd_rpc_hvx_delivery_t *deliveries, uint32_t *count)
+{
+    if (params == nullptr || deliveries == nullptr || count == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (params->type != BLE_GATT_HVX_NOTIFICATION && params->type != BLE_GATT_HVX_INDICATION)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    const auto enabled = params->type == BLE_GATT_HVX_NOTIFICATION ? CCCD_NOTIFY : CCCD_INDICATE;
+    std::vector<sd_rpc_hvx_delivery_t> subscribers;
+
+    {
+        std::lock_guard<std::mutex> lock(trackerMutex);
+
+        for (const auto &connection : connections)
+        {
+            const auto cccd = connection.second.cccds.find(params->handle);
+
+            if (cccd == connection.second.cccds.end() || (cccd->second & enabled) == 0)
+            {
+                continue;
+            }
+
+            sd_rpc_hvx_delivery_t delivery;
+            delivery.conn_handle = connection.first;
+            delivery.err_code = NRF_SUCCESS;
+
+            if (params->type == BLE_GATT_HVX_NOTIFICATION
+                && connection.second.queueSize > 0
+                && connection.second.queued >= connection.second.queueSize)
+            {
+                // No room in the TX queue, do not spend a round trip on a command that is rejected
+                delivery.err_code = HVX_QUEUE_FULL;
+            }
+
+            subscribers.push_back(delivery);
+        }
+    }
+
+    if (subscribers.size() > *count)
+    {
+        *count = static_cast<uint32_t>(subscribers.size());
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    for (auto &delivery : subscribers)
+    {
+        if (delivery.err_code != NRF_SUCCESS)
+        {
+            continue;
+        }
+
+        auto len = params->len;
+        ble_gatts_hvx_params_t hvx = {};
+        hvx.handle = params->handle;
+        hvx.type = params->type;
+        hvx.p_len = &len;
+        // p_data is not const in SoftDevice API version 2, the value is only read
+        hvx.p_data = const_cast<uint8_t *>(params->p_data);
+
+        delivery.err_code = sd_ble_gatts_hvx(adapter, delivery.conn_handle, &hvx);
+    }
+
+    std::copy(subscribers.begin(), subscribers.end(), deliveries);
+    *count = static_cast<uint32_t>(subscribers.size());
+    return NRF_SUCCESS;
+}
+
+void SubscriptionTracker::cccdWrite(const uint16_t connHandle, const uint16_t cccdHandle, const uint16_t value)
+{
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    const auto valueHandle = valueHandles.find(cccdHandle);
+
+    if (valueHandle == valueHandles.end())
+    {
+        return;
+    }
+
+    auto &cccds = connections[connHandle].cccds;
+
+    if (value == 0)
+    {
+        cccds.erase(valueHandle->second);
+    }
+    else
+    {
+        cccds[valueHandle->second] = value;
+    }
+}
+
+void SubscriptionTracker::authorizeRequest(const uint16_t connHandle, const ble_gatts_evt_write_t &write)
+{
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    auto &connection = connections[connHandle];
+
+    // Only writes to CCCDs are kept until the reply, other writes are left to the application
+    const auto cccd = valueHandles.find(write.handle) != valueHandles.end();
+    const auto queue = write.op == BLE_GATTS_OP_EXEC_WRITE_REQ_NOW || write.op == BLE_GATTS_OP_EXEC_WRITE_REQ_CANCEL;
+
+    connection.authorizeOp = cccd || queue ? write.op : BLE_GATTS_OP_INVALID;
+    connection.authorizeHandle = write.handle;
+    connection.authorizeOffset = write.offset;
+    connection.authorizeData.assign(write.data, write.data + (queue ? 0 : write.len));
+}
+
+void SubscriptionTracker::prepare(Connection &connection, const uint16_t handle, const uint16_t offset, const uint8_t *data, const uint16_t length)
+{
+    // The CCCD value is two bytes, any part of it may be written by a prepared write
+    if (valueHandles.find(handle) == valueHandles.end() || offset >= 2)
+    {
+        return;
+    }
+
+    auto &value = connection.prepared[handle];
+    value.resize(std::max<size_t>(value.size(), offset + length));
+    std::copy(data, data + length, value.begin() + offset);
+}
+
+void SubscriptionTracker::execute(const uint16_t connHandle, UserMemPool &userMemPool)
+{
+    std::map<uint16_t, std::vector<uint8_t>> executed;
+
+    {
+        std::lock_guard<std::mutex> lock(trackerMutex);
+        auto &connection = connections[connHandle];
+
+        // Queued writes the SoftDevice stored in user memory, as handle, offset, length and value, until an invalid handle
+        std::vector<uint8_t> block;
+
+        if (userMemPool.queuedWritesGet(connHandle, block))
+        {
+            size_t index = 0;
+
+            while (index + QUEUED_WRITE_HEADER_SIZE <= block.size())
+            {
+                const auto handle = uint16Get(&block[index]);
+                const auto offset = uint16Get(&block[index + 2]);
+                const auto length = uint16Get(&block[index + 4]);
+                index += QUEUED_WRITE_HEADER_SIZE;
+
+                if (handle == BLE_GATT_HANDLE_INVALID || length > block.size() - index)
+                {
+                    break;
+                }
+
+                prepare(connection, handle, offset, &block[index], length);
+                index += length;
+            }
+        }
+
+        executed.swap(connection.prepared);
+    }
+
+    for (const auto &write : executed)
+    {
+        if (write.second.size() >= 2)
+        {
+            cccdWrite(connHandle, write.first, uint16Get(write.second.data()));
+        }
+    }
+}
+
+void SubscriptionTracker::cancel(const uint16_t connHandle)
+{
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    auto connection = connections.find(connHandle);
+
+    if (connection != connections.end())
+    {
+        connection->second.prepared.clear();
+    }
+}
+
+void SubscriptionTracker::txComplete(const uint16_t connHandle, const uint32_t count)
+{
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    auto connection = connections.find(connHandle);
+
+    if (connection == connections.end())
+    {
+        return;
+    }
+
+    // Transmitted packets may include write commands on SoftDevice API version 2
+    connection->second.queued = count < connection->second.queued ? connection->second.queued - count : 0;
+}
@@ -53,7 +53,7 @@ const uint16_t payloadLengthFirstNibbleMask = 0x000F;
 const uint16_t payloadLengthSecondNibbleMask = 0x0FF0;
 const uint8_t payloadLengthOffset = 4;
 
-uint8_t calculate_header_checksum(std::vector<uint8_t> &header)
+uint8_t calculate_header_checksum(const uint8_t *header)
 {
     uint16_t checksum;
 
@@ -66,7 +66,12 @@ uint8_t calculate_header_checksum(std::vector<uint8_t> &header)
     return static_cast<uint8_t>(checksum);
 }
 
-uint16_t calculate_crc16_checksum(std::vector<uint8_t>::iterator start, std::vector<uint8_t>::iterator end)
+uint8_t calculate_header_checksum(std::vector<uint8_t> &header)
+{
+    return calculate_header_checksum(header.data());
+}
+
+uint16_t calculate_crc16_checksum(const uint8_t *start, const uint8_t *end)
 {
     uint16_t crc = 0xFFFF;
 
@@ -81,6 +86,36 @@ uint16_t calculate_crc16_checksum(std::vector<uint8_t>::iterator start, std::vec
     return crc;
 }
 
+uint16_t calculate_crc16_checksum(std::vector<uint8_t>::iterator start, std::vector<uint8_t>::iterator end)
+{
+    if (start == end)
+    {
+        return 0xFFFF;
+    }
+
+    return calculate_crc16_checksum(&*start, &*start + (end - start));
+}
+
+void write_h5_header(uint8_t *header,
+                     uint8_t seq_num,
+                     uint8_t ack_num,
+                     bool crc_present,
+                     bool reliable_packet,
+                     uint8_t packet_type,
+                     uint16_t payload_length)
+{
+    header[0] = (seq_num & seqNumMask)
+        | ((ack_num & ackNumMask) << ackNumPos)
+        | ((crc_present & crcPresentMask) << crcPresentPos)
+        | ((reliable_packet & reliablePacketMask) << reliablePacketPos);
+
+    header[1] = (packet_type & packetTypeMask)
+        | ((payload_length & payloadLengthFirstNibbleMask) << payloadLengthOffset);
+
+    header[2] = (payload_length & payloadLengthSecondNibbleMask) >> payloadLengthOffset;
+    header[3] = calculate_header_checksum(header);
+}
+
 void add_h5_header(std::vector<uint8_t> &out_packet,
                  uint8_t seq_num,
                  uint8_t ack_num,
@@ -89,18 +124,10 @@ void add_h5_header(std::vector<uint8_t> &out_packet,
                  uint8_t packet_type,
                  uint16_t payload_length)
 {
-    out_packet.push_back(
-        (seq_num & seqNumMask)
-        | ((ack_num & ackNumMask) << ackNumPos)
-        | ((crc_present & crcPresentMask) << crcPresentPos)
-        | ((reliable_packet & reliablePacketMask) << reliablePacketPos));
+    const auto headerPosition = out_packet.size();
+    out_packet.resize(headerPosition + H5_HEADER_LENGTH);
 
-    out_packet.push_back(
-        (packet_type & packetTypeMask)
-        | ((payload_length & payloadLengthFirstNibbleMask) << payloadLengthOffset));
-
-    out_packet.push_back((payload_length & payloadLengthSecondNibbleMask) >> payloadLengthOffset);
-    out_packet.push_back(calculate_header_checksum(out_packet));
+    write_h5_header(&out_packet[headerPosition], seq_num, ack_num, crc_present, reliable_packet, packet_type, payload_length);
 }
 
 void add_crc16(std::vector<uint8_t> &out_packet)
@@ -136,6 +163,26 @@ void h5_encode(std::vector<uint8_t> &in_packet,
     }
 }
 
+void h5_encode(TxFrame &frame,
+               uint8_t seq_num,
+               uint8_t ack_num,
+               bool crc_present,
+               bool reliable_packet,
+               h5_pkt_type_t packet_type)
+{
+    const auto payload_length = static_cast<uint16_t>(frame.size());
+
+    write_h5_header(frame.prepend(H5_HEADER_LENGTH), seq_num, ack_num, crc_present, reliable_packet, packet_type, payload_length);
+
+    if (crc_present)
+    {
+        const auto crc16 = calculate_crc16_checksum(frame.data(), frame.data() + frame.size());
+        auto crc = frame.append(H5_CRC_LENGTH);
+        crc[0] = crc16 & 0xFF;
+        crc[1] = (crc16 >> 8) & 0xFF;
+    }
+}
+
 uint32_t h5_decode(std::vector<uint8_t> &slipPayload,
                    std::vector<uint8_t> &h5Payload,
                    uint8_t *seq_num,
@@ -73,16 +73,24 @@ const uint8_t PACKET_RETRANSMISSIONS = 6;                              // Number
 
 // Other constants
 const auto OPEN_WAIT_TIMEOUT = std::chrono::milliseconds(2000);   // Duration to wait for state ACTIVE after open is called
+const auto BAUD_RATE_PROBE_TIMEOUT = std::chrono::milliseconds(50); // Duration to wait for the response to SYNC at a probed baud rate
+const uint8_t BAUD_RATE_PROBE_ATTEMPTS = 2;                           // Number of times SYNC is sent at a probed baud rate
 const auto RESET_WAIT_DURATION = std::chrono::milliseconds(300);  // Duration to wait before continuing UART communication after reset is sent to target
 
 #pragma region Public methods
 H5Transport::H5Transport(Transport *_nextTransportLayer, uint32_t retransmission_interval)
     : Transport(),
-    seqNum(0), ackNum(0), c0Found(false),
-    unprocessedData(), incomingPacketCount(0), outgoingPacketCount(0),
+    lastFrame(nullptr), seqNum(0), ackNum(0), c0Found(false), outOfFrameFlowControl(false),
+    unprocessedData(), unreliableLaneRequested(false), unreliableLane(false),
+    unreliableReceived(0), unreliableDropped(0), unreliableSeqNum(0), unreliableSeqNumValid(false),
+    detectBaudRates(), baudRateProbing(false), baudRateProbeAnswered(false), baudRateDetectInfo(),
+    syncTimer(TimerWheel::TIMER_ID_INVALID),
+    retransmissionTimer(TimerWheel::TIMER_ID_INVALID), remainingRetransmissions(0),
+    retransmissionAborted(false), incomingPacketCount(0), outgoingPacketCount(0),
     errorPacketCount(0), currentState(STATE_START), stateMachineThread(nullptr)
 {
     this->nextTransportLayer = _nextTransportLayer;
+    timerWheel = nextTransportLayer->timerWheelGet();
     retransmissionInterval = std::chrono::milliseconds(retransmission_interval);
 
     setupStateMachine();
@@ -134,14 +142,23 @@ uint32_t H5Transport::open(status_cb_t status_callback, data_cb_t data_callback,
         return NRF_ERROR_INTERNAL;
     }
 
-    startStateMachine();
+    if (timerWheel == nullptr)
+    {
+        log("Not able to open, next transport layer does not provide timers");
+        return NRF_ERROR_INTERNAL;
+    }
+
+    // Reset before the state machine runs, it may only start waiting after the port is opened
     auto _exitCriterias = dynamic_cast<StartExitCriterias*>(exitCriterias[STATE_START]);
+    _exitCriterias->reset();
+    startStateMachine();
 
     auto errorCode = Transport::open(status_callback, data_callback, log_callback);
-    lastPacket.clear();
+    lastFrame = nullptr;
 
     if (errorCode != NRF_SUCCESS)
     {
+        std::lock_guard<std::mutex> syncGuard(syncMutex);
         _exitCriterias->ioResourceError = true;
         syncWaitCondition.notify_all();
         return errorCode;
@@ -153,13 +170,27 @@ uint32_t H5Transport::open(status_cb_t status_callback, data_cb_t data_callback,
 
     if (errorCode != NRF_SUCCESS)
     {
+        std::lock_guard<std::mutex> syncGuard(syncMutex);
         _exitCriterias->ioResourceError = true;
         syncWaitCondition.notify_all();
         return NRF_ERROR_INTERNAL;
     }
 
-    _exitCriterias->isOpened = true;
-    syncWaitCondition.notify_all();
+    if (!detectBaudRates.empty())
+    {
+        baudRateDetect();
+    }
+    else
+    {
+        baudRateDetectInfo = sd_rpc_baud_rate_detect_info_t();
+        baudRateDetectInfo.baud_rate = nextTransportLayer->baudRateGet();
+    }
+
+    {
+        std::lock_guard<std::mutex> syncGuard(syncMutex);
+        _exitCriterias->isOpened = true;
+        syncWaitCondition.notify_all();
+    }
 
     if (waitForState(STATE_ACTIVE, OPEN_WAIT_TIMEOUT))
     {
@@ -196,58 +227,81 @@ uint32_t H5Transport::close()
 }
 
 uint32_t H5Transport::send(std::vector<uint8_t> &data)
+{
+    TxFrame frame(data.size());
+    std::copy(data.begin(), data.end(), frame.payload());
+    frame.reset(data.size());
+
+    return send(frame);
+}
+
+uint32_t H5Transport::send(TxFrame &frame)
 {
     if (currentState != STATE_ACTIVE) {
         return NRF_ERROR_INVALID_STATE;
     }
 
-    // max theoretical length of encoded packet, aditional 6 bytes h5 encoding and all bytes escaped + 2 packet encapsuling
-    std::vector<uint8_t> h5EncodedPacket;
-
-    h5_encode(data,
-              h5EncodedPacket,
+    // The header and CRC are added around the payload in the frame, which is kept for retransmissions
+    h5_encode(frame,
               seqNum,
               ackNum,
               true,
               true,
               VENDOR_SPECIFIC_PACKET);
 
-    std::vector<uint8_t> encodedPacket;
-    slip_encode(h5EncodedPacket, encodedPacket);
+    std::unique_lock<std::mutex> ackGuard(ackMutex);
 
-    auto remainingRetransmissions = PACKET_RETRANSMISSIONS;
+    lastFrame = &frame;
 
-    lastPacket.clear();
-    lastPacket = encodedPacket;
+    const uint8_t seqNumBefore = seqNum;
+    remainingRetransmissions = PACKET_RETRANSMISSIONS;
 
-    std::unique_lock<std::mutex> ackGuard(ackMutex);
+    logPacket(true, frame.data(), frame.size());
+    sendSlip(frame.data(), frame.size());
 
-    while (remainingRetransmissions--)
-    {
-        logPacket(true, h5EncodedPacket);
-        nextTransportLayer->send(lastPacket);
+    // Retransmissions are sent from the timer wheel until the packet is acknowledged or given up
+    // Capturing this only, the callback fits in std::function without allocating
+    retransmissionTimer = timerWheel->arm(retransmissionInterval, [this](timer_id_t id) { retransmissionTimeout(id); });
+    retransmissionAborted = (retransmissionTimer == TimerWheel::TIMER_ID_INVALID);
 
-        const uint8_t seqNumBefore = seqNum;
+    // Checking against spurious wakeup by making sure the sequence number has actually increased.
+    // If the sequence number has not increased, we have not received an ACK packet.
+    ackWaitCondition.wait(ackGuard, [&] { return seqNum != seqNumBefore || retransmissionTimer == TimerWheel::TIMER_ID_INVALID; });
 
-        auto status = ackWaitCondition.wait_for(ackGuard, std::chrono::milliseconds(retransmissionInterval));
+    timerWheel->cancel(retransmissionTimer);
+    retransmissionTimer = TimerWheel::TIMER_ID_INVALID;
+    lastFrame = nullptr;
 
-        // Checking for timeout. Also checking against spurios wakeup by making sure the sequence
-        // number has  actually increased. If the sequence number has not increased, we have not
-        // received an ACK packet, and should not exit the loop (unless timeout).
-        // Ref. spurious wakeup:
-        // http://en.cppreference.com/w/cpp/thread/condition_variable
-        // https://en.wikipedia.org/wiki/Spurious_wakeup
-        if (status == std::cv_status::no_timeout && seqNum != seqNumBefore)
-        {
-            lastPacket.clear();
-            return NRF_SUCCESS;
-        }
+    // The frame holds the payload only again, it may be sent once more by the layer above
+    frame.trimFront(H5_HEADER_LENGTH);
+    frame.trimBack(H5_CRC_LENGTH);
+
+    if (seqNum != seqNumBefore)
+    {
+        return NRF_SUCCESS;
     }
 
-    lastPacket.clear();
+    if (retransmissionAborted)
+    {
+        log("Link not active anymore while waiting for acknowledgement, giving up");
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    statusHandler(PKT_SEND_MAX_RETRIES_REACHED, "No acknowledgement received for packet, giving up");
 
     return NRF_ERROR_TIMEOUT;
 }
+
+TimerWheel *H5Transport::timerWheelGet()
+{
+    return timerWheel;
+}
+
+void H5Transport::logSeverityFilterSet(sd_rpc_log_severity_t severity_filter)
+{
+    Transport::logSeverityFilterSet(severity_filter);
+    nextTransportLayer->logSeverityFilterSet(severity_filter);
+}
 #pragma endregion Public methods
 
 #pragma region Processing incoming data from UART
@@ -267,7 +321,7 @@ void H5Transport::processPacket(std::vector<uint8_t> &packet)
         return;
     }
 
-    logPacket(false, slipPayload);
+    logPacket(false, slipPayload.data(), slipPayload.size());
 
     std::vector<uint8_t> h5Payload;
 
@@ -302,7 +356,16 @@ void H5Transport::processPacket(std::vector<uint8_t> &packet)
         auto isSyncConfigPacket = h5Payload[0] == syncConfigFirstByte && h5Payload[1] == syncConfigSecondByte;
         auto isSyncConfigResponsePacket = h5Payload[0] == syncConfigRspFirstByte && h5Payload[1] == syncConfigRspSecondByte;
 
-        if (currentState == STATE_UNINITIALIZED)
+        if (currentState == STATE_START)
+        {
+            // Any SYNC or SYNC RESPONSE received intact while probing tells that the baud rate matches
+            if (baudRateProbing && (isSyncResponsePacket || isSyncPacket))
+            {
+                baudRateProbeAnswered = true;
+                syncWaitCondition.notify_all();
+            }
+        }
+        else if (currentState == STATE_UNINITIALIZED)
         {
             if (isSyncResponsePacket) {
                 dynamic_cast<UninitializedExitCriterias*>(exitCriterias[currentState])->syncRspReceived = true;
@@ -318,6 +381,8 @@ void H5Transport::processPacket(std::vector<uint8_t> &packet)
             auto exit = dynamic_cast<InitializedExitCriterias*>(exitCriterias[currentState]);
 
             if (isSyncConfigResponsePacket) {
+                outOfFrameFlowControlNegotiate(h5Payload);
+                unreliableLaneNegotiate(h5Payload);
                 exit->syncConfigRspReceived = true;
                 syncWaitCondition.notify_all();
             }
@@ -367,6 +432,10 @@ void H5Transport::processPacket(std::vector<uint8_t> &packet)
                     sendControlPacket(CONTROL_PKT_ACK);
                 }
             }
+            else
+            {
+                unreliablePacketProcess(seq_num, h5Payload);
+            }
         }
     }
     else if (packet_type == ACK_PACKET)
@@ -420,6 +489,13 @@ void H5Transport::dataHandler(uint8_t *data, size_t length)
 
     for (size_t i = 0; i < length; i++)
     {
+        // With out-of-frame flow control XON and XOFF are escaped inside packets. Any left
+        // unhandled by the physical layer are flow control characters and not packet data.
+        if (outOfFrameFlowControl && (data[i] == xonCharacter || data[i] == xoffCharacter))
+        {
+            continue;
+        }
+
         packet.push_back(data[i]);
 
         if (data[i] == 0xC0)
@@ -475,12 +551,85 @@ void H5Transport::incrementAckNum()
 
 #pragma endregion Processing of incoming packets from UART
 
+#pragma region Timers
+// I/O Thread
+void H5Transport::retransmissionTimeout(timer_id_t id)
+{
+    std::lock_guard<std::mutex> ackGuard(ackMutex);
+
+    // The packet has been acknowledged since the timer expired
+    if (id != retransmissionTimer)
+    {
+        return;
+    }
+
+    retransmissionTimer = TimerWheel::TIMER_ID_INVALID;
+
+    if (--remainingRetransmissions > 0)
+    {
+        retransmissionTimer = timerWheel->arm(retransmissionInterval, [this](timer_id_t id) { retransmissionTimeout(id); });
+
+        if (retransmissionTimer != TimerWheel::TIMER_ID_INVALID)
+        {
+            logPacket(true, lastFrame->data(), lastFrame->size());
+            sendSlip(lastFrame->data(), lastFrame->size());
+            return;
+        }
+
+        retransmissionAborted = true;
+    }
+
+    ackWaitCondition.notify_all();
+}
+
+void H5Transport::retransmissionAbort()
+{
+    std::lock_guard<std::mutex> ackGuard(ackMutex);
+
+    if (retransmissionTimer == TimerWheel::TIMER_ID_INVALID)
+    {
+        return;
+    }
+
+    timerWheel->cancel(retransmissionTimer);
+    retransmissionTimer = TimerWheel::TIMER_ID_INVALID;
+    retransmissionAborted = true;
+    ackWaitCondition.notify_all();
+}
+
+void H5Transport::syncWait(std::unique_lock<std::mutex> &syncGuard, std::chrono::milliseconds timeout)
+{
+    syncTimer = timerWheel->arm(timeout, std::bind(&H5Transport::syncTimeout, this, std::placeholders::_1));
+
+    // Timers are not advanced when the next transport layer is closed, there is nothing to wait for
+    if (syncTimer == TimerWheel::TIMER_ID_INVALID)
+    {
+        return;
+    }
+
+    syncWaitCondition.wait(syncGuard);
+
+    timerWheel->cancel(syncTimer);
+    syncTimer = TimerWheel::TIMER_ID_INVALID;
+}
+
+// I/O Thread
+void H5Transport::syncTimeout(timer_id_t id)
+{
+    std::lock_guard<std::mutex> syncGuard(syncMutex);
+
+    if (id == syncTimer)
+    {
+        syncWaitCondition.notify_all();
+    }
+}
+#pragma endregion Timers
+
 #pragma region  State machine
 void H5Transport::setupStateMachine()
 {
     stateActions[STATE_START] = [&]() -> h5_state_t {
         auto exit = dynamic_cast<StartExitCriterias*>(exitCriterias[STATE_START]);
-        exit->reset();
 
         std::unique_lock<std::mutex> syncGuard(syncMutex);
 
@@ -507,6 +656,10 @@ void H5Transport::setupStateMachine()
         auto exit = dynamic_cast<ResetExitCriterias*>(exitCriterias[STATE_RESET]);
         exit->reset();
 
+        // Flow control and the unreliable lane are negotiated again when the link is established
+        outOfFrameFlowControlStop();
+        unreliableLane = false;
+
         std::unique_lock<std::mutex> syncGuard(syncMutex);
 
         while (!exit->isFullfilled())
@@ -514,7 +667,11 @@ void H5Transport::setupStateMachine()
             sendControlPacket(CONTROL_PKT_RESET);
             statusCallback(RESET_PERFORMED, "Target Reset performed");
             exit->resetSent = true;
-            syncWaitCondition.wait_for(syncGuard, RESET_WAIT_DURATION);
+
+            // A packet sent before the reset is never acknowledged, do not wait for the retransmissions
+            retransmissionAbort();
+
+            syncWait(syncGuard, RESET_WAIT_DURATION);
         }
 
         if (!exit->isFullfilled())
@@ -539,7 +696,7 @@ void H5Transport::setupStateMachine()
         {
             sendControlPacket(CONTROL_PKT_SYNC);
             exit->syncSent = true;
-            syncWaitCondition.wait_for(syncGuard, NON_ACTIVE_STATE_TIMEOUT);
+            syncWait(syncGuard, NON_ACTIVE_STATE_TIMEOUT);
             syncRetransmission--;
         }
 
@@ -567,12 +724,15 @@ void H5Transport::setupStateMachine()
         {
             sendControlPacket(CONTROL_PKT_SYNC_CONFIG);
             exit->syncConfigSent = true;
-            syncWaitCondition.wait_for(syncGuard, NON_ACTIVE_STATE_TIMEOUT);
+            syncWait(syncGuard, NON_ACTIVE_STATE_TIMEOUT);
             syncRetransmission--;
         }
 
         if (exit->syncConfigSent && exit->syncConfigRspReceived)
         {
+            // Reset before STATE_ACTIVE is entered, open() returns and packets are sent from then on
+            seqNum = 0;
+            ackNum = 0;
             return STATE_ACTIVE;
         }
         else
@@ -583,9 +743,6 @@ void H5Transport::setupStateMachine()
 
     stateActions[STATE_ACTIVE] = [&]() -> h5_state_t
     {
-        seqNum = 0;
-        ackNum = 0;
-
         std::unique_lock<std::mutex> syncGuard(syncMutex);
         auto exit = dynamic_cast<ActiveExitCriterias*>(exitCriterias[STATE_ACTIVE]);
         exit->reset();
@@ -599,9 +756,13 @@ void H5Transport::setupStateMachine()
 
         if (exit->syncReceived || exit->irrecoverableSyncError)
         {
+            // Packets in flight are failed in STATE_RESET, after the reset is reported
             return STATE_RESET;
         }
-        else if (exit->close)
+
+        retransmissionAbort();
+
+        if (exit->close)
         {
             return STATE_START;
         }
@@ -670,10 +831,18 @@ void H5Transport::stateMachineWorker()
         nextState = stateActions[currentState]();
         logStateTransition(currentState, nextState);
 
-        currentState = nextState;
+        {
+            // Inform interested parties that new state is about to be entered
+            std::lock_guard<std::mutex> stateGuard(stateMutex);
+            currentState = nextState;
+            stateWaitCondition.notify_all();
+        }
 
-        // Inform interested parties that new state is about to be entered
-        stateWaitCondition.notify_all();
+        if (currentState == STATE_FAILED)
+        {
+            // The state machine ends here, the link stays down until the transport is opened again
+            statusCallback(LINK_FAILED, "Link failed, not able to establish it again");
+        }
     }
 }
 
@@ -721,6 +890,17 @@ void H5Transport::sendControlPacket(control_pkt_type type)
     auto payload = pkt_pattern[type];
     std::vector<uint8_t> h5Packet;
 
+    if (type == CONTROL_PKT_SYNC_CONFIG || type == CONTROL_PKT_SYNC_CONFIG_RESPONSE)
+    {
+        payload[2] = syncConfigFieldOwn();
+    }
+
+    // The unreliable lane is offered by the host, a peer that does not know it ignores the extra byte
+    if (type == CONTROL_PKT_SYNC_CONFIG && unreliableLaneRequested)
+    {
+        payload.push_back(static_cast<uint8_t>(syncConfigCapabilityUnreliable));
+    }
+
     h5_encode(payload,
         h5Packet,
         0,
@@ -729,16 +909,227 @@ void H5Transport::sendControlPacket(control_pkt_type type)
         false,
         h5_packet);
 
-    std::vector<uint8_t> slipPacket;
-    slip_encode(h5Packet, slipPacket);
+    logPacket(true, h5Packet.data(), h5Packet.size());
+    sendSlip(h5Packet.data(), h5Packet.size());
+}
 
-    logPacket(true, h5Packet);
+void H5Transport::sendSlip(const uint8_t *packet, const size_t length)
+{
+    const bool escapeFlowControl = outOfFrameFlowControl;
+    const auto encoder = [packet, length, escapeFlowControl](uint8_t *out) {
+        return slip_encode(packet, length, out, escapeFlowControl);
+    };
 
-    nextTransportLayer->send(slipPacket);
+    // Passed by reference, the encoder does not fit in std::function without allocating
+    nextTransportLayer->sendEncoded(slip_encoded_length_max(length), std::cref(encoder));
 }
 
 #pragma endregion Methods related to sending packet types defined in the Three Wire Standard
 
+#pragma region Out-of-frame software flow control
+
+uint8_t H5Transport::syncConfigFieldOwn() const
+{
+    if (nextTransportLayer->softwareFlowControlSupported())
+    {
+        return syncConfigField | syncConfigFieldOutOfFrame;
+    }
+
+    return syncConfigField;
+}
+
+void H5Transport::outOfFrameFlowControlNegotiate(const std::vector<uint8_t> &syncConfigResponse)
+{
+    if (!nextTransportLayer->softwareFlowControlSupported())
+    {
+        return;
+    }
+
+    // The peer responds with the configuration it supports
+    if (syncConfigResponse.size() < 3 || !(syncConfigResponse[2] & syncConfigFieldOutOfFrame))
+    {
+        log("Out-of-frame software flow control not supported by peer, continuing without flow control");
+        return;
+    }
+
+    if (nextTransportLayer->softwareFlowControlSet(true) == NRF_SUCCESS)
+    {
+        outOfFrameFlowControl = true;
+        log("Out-of-frame software flow control enabled");
+    }
+}
+
+void H5Transport::outOfFrameFlowControlStop()
+{
+    if (outOfFrameFlowControl.exchange(false))
+    {
+        nextTransportLayer->softwareFlowControlSet(false);
+    }
+}
+
+#pragma endregion Out-of-frame software flow control
+
+#pragma region Unreliable lane
+
+uint32_t H5Transport::unreliableLaneEnable(const bool enable)
+{
+    unreliableLaneRequested = enable;
+    return NRF_SUCCESS;
+}
+
+uint32_t H5Transport::unreliableLaneInfoGet(sd_rpc_unreliable_lane_info_t *info) const
+{
+    if (info == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    info->active = unreliableLane;
+    info->received_count = unreliableReceived;
+    info->dropped_count = unreliableDropped;
+    return NRF_SUCCESS;
+}
+
+void H5Transport::unreliableLaneNegotiate(const std::vector<uint8_t> &syncConfigResponse)
+{
+    if (!unreliableLaneRequested)
+    {
+        return;
+    }
+
+    // The peer echoes the capabilities it supports after the configuration field
+    if (syncConfigResponse.size() < 4 || !(syncConfigResponse[3] & syncConfigCapabilityUnreliable))
+    {
+        log("Unreliable lane not supported by peer, all packets are sent reliably");
+        return;
+    }
+
+    unreliableSeqNumValid = false;
+    unreliableLane = true;
+    log("Unreliable lane enabled");
+}
+
+void H5Transport::unreliablePacketProcess(const uint8_t seq_num, std::vector<uint8_t> &payload)
+{
+    if (!unreliableLane)
+    {
+        unreliableDropped++;
+        return;
+    }
+
+    // Unreliable packets are not acknowledged, the sequence number only reveals lost packets
+    if (unreliableSeqNumValid && seq_num != unreliableSeqNum)
+    {
+        unreliableDropped += (seq_num - unreliableSeqNum) & 0x07;
+    }
+
+    unreliableSeqNum = (seq_num + 1) & 0x07;
+    unreliableSeqNumValid = true;
+    unreliableReceived++;
+
+    dataCallback(payload.data(), payload.size());
+}
+
+#pragma endregion Unreliable lane
+
+#pragma region Baud rate detection
+
+uint32_t H5Transport::baudRateDetectEnable(const bool enable, const uint32_t *baudRates, const uint8_t baudRateCount)
+{
+    if (!enable)
+    {
+        detectBaudRates.clear();
+        return NRF_SUCCESS;
+    }
+
+    if (baudRates == nullptr)
+    {
+        // The connectivity firmware is built for these baud rates
+        detectBaudRates = { 1000000, 115200 };
+        return NRF_SUCCESS;
+    }
+
+    if (baudRateCount == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    detectBaudRates.assign(baudRates, baudRates + baudRateCount);
+    std::sort(detectBaudRates.begin(), detectBaudRates.end(), std::greater<uint32_t>());
+    detectBaudRates.erase(std::unique(detectBaudRates.begin(), detectBaudRates.end()), detectBaudRates.end());
+    return NRF_SUCCESS;
+}
+
+uint32_t H5Transport::baudRateDetectInfoGet(sd_rpc_baud_rate_detect_info_t *info) const
+{
+    if (info == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    *info = baudRateDetectInfo;
+    return NRF_SUCCESS;
+}
+
+void H5Transport::baudRateDetect()
+{
+    const auto configuredBaudRate = nextTransportLayer->baudRateGet();
+    const auto started = std::chrono::steady_clock::now();
+
+    baudRateDetectInfo = sd_rpc_baud_rate_detect_info_t();
+    baudRateProbing = true;
+
+    {
+        std::unique_lock<std::mutex> syncGuard(syncMutex);
+
+        for (const auto baudRate : detectBaudRates)
+        {
+            if (nextTransportLayer->baudRateSet(baudRate) != NRF_SUCCESS)
+            {
+                continue;
+            }
+
+            baudRateDetectInfo.probed_count++;
+            baudRateProbeAnswered = false;
+
+            for (uint8_t attempt = 0; attempt < BAUD_RATE_PROBE_ATTEMPTS && !baudRateProbeAnswered; attempt++)
+            {
+                sendControlPacket(CONTROL_PKT_SYNC);
+                syncWaitCondition.wait_for(syncGuard, BAUD_RATE_PROBE_TIMEOUT, [&] { return baudRateProbeAnswered.load(); });
+            }
+
+            if (baudRateProbeAnswered)
+            {
+                baudRateDetectInfo.detected = true;
+                baudRateDetectInfo.baud_rate = baudRate;
+                break;
+            }
+        }
+    }
+
+    baudRateProbing = false;
+    baudRateDetectInfo.detect_time_ms = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count());
+
+    std::stringstream logLine;
+
+    if (baudRateDetectInfo.detected)
+    {
+        logLine << "Baud rate " << baudRateDetectInfo.baud_rate << " detected in " << baudRateDetectInfo.detect_time_ms << " ms";
+    }
+    else
+    {
+        // The link is established at the configured baud rate as if nothing was probed
+        nextTransportLayer->baudRateSet(configuredBaudRate);
+        baudRateDetectInfo.baud_rate = configuredBaudRate;
+        logLine << "No response at any probed baud rate, keeping baud rate " << configuredBaudRate;
+    }
+
+    auto line = logLine.str();
+    log(line);
+}
+
+#pragma endregion Baud rate detection
+
 #pragma region Debugging
 std::string H5Transport::stateToString(h5_state_t state)
 {
@@ -770,8 +1161,8 @@ std::string H5Transport::hciPacketLinkControlToString(std::vector<uint8_t> paylo
         std::stringstream info;
         info << " sliding-window-size:" << (config & 0x07);
         info << " out-of-frame:" << ((config & 0x08) ? "1" : "0");
-        info << " data-integrity-check-type:" << ((config & 0x0f) ? "1" : "0");
-        info << " version-number:" << ((config & 0x0e) >> 5) << " ";
+        info << " data-integrity-check-type:" << ((config & 0x10) ? "1" : "0");
+        info << " version-number:" << ((config & 0xe0) >> 5) << " ";
         return info.str();
     };
 
@@ -782,7 +1173,7 @@ std::string H5Transport::hciPacketLinkControlToString(std::vector<uint8_t> paylo
         if (payload[0] == syncFirstByte && payload[1] == syncSecondByte) retval << "SYNC";
         if (payload[0] == syncRspFirstByte && payload[1] == syncRspSecondByte) retval << "SYNC_RESP";
 
-        if (payload[0] == syncConfigFirstByte && payload[1] == syncConfigSecondByte && payload.size() == 3)
+        if (payload[0] == syncConfigFirstByte && payload[1] == syncConfigSecondByte && payload.size() >= 3)
         {
             retval << "CONFIG [" << configToString(payload[2]) << "]";
         }
@@ -801,8 +1192,9 @@ std::string H5Transport::hciPacketLinkControlToString(std::vector<uint8_t> paylo
     return retval.str();
 }
 
-std::string H5Transport::h5PktToString(bool out, std::vector<uint8_t> &h5Packet) const
+std::string H5Transport::h5PktToString(bool out, const uint8_t *packet, const size_t length) const
 {
+    std::vector<uint8_t> h5Packet(packet, packet + length);
     std::vector<uint8_t> payload;
 
     uint8_t seq_num;
@@ -860,7 +1252,7 @@ std::string H5Transport::h5PktToString(bool out, std::vector<uint8_t> &h5Packet)
     return retval.str();
 }
 
-void H5Transport::logPacket(bool outgoing, std::vector<uint8_t> &packet)
+void H5Transport::logPacket(bool outgoing, const uint8_t *packet, const size_t length)
 {
     if (outgoing)
     {
@@ -871,7 +1263,13 @@ void H5Transport::logPacket(bool outgoing, std::vector<uint8_t> &packet)
         incomingPacketCount++;
     }
 
-    std::string logLine = h5PktToString(outgoing, packet).c_str();
+    // Packets are sent and received on every command, they are only formatted when the line is logged
+    if (!logEnabled(SD_RPC_LOG_DEBUG))
+    {
+        return;
+    }
+
+    std::string logLine = h5PktToString(outgoing, packet, length);
 
     if (this->logCallback != nullptr)
     {
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "serial_port_poller.h"
+#include "serial_port_latency.h"
+
+#include "nrf_error.h"
+
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+SerialPortPoller::SerialPortPoller(boost::asio::serial_port::native_handle_type _handle, const sd_rpc_busy_poll_params_t &_params,
+    const std::string &_portName, data_cb_t _dataCallback, status_cb_t _statusCallback, log_cb_t _logCallback)
+    : handle(_handle), params(_params), portName(_portName), dataCallback(_dataCallback),
+    statusCallback(_statusCallback), logCallback(_logCallback), readBuffer(), runPollThread(false),
+    active(false), pinned(false), pollCount(0), readCount(0), byteCount(0), sleepCount(0)
+{}
+
+SerialPortPoller::~SerialPortPoller()
+{
+    stop();
+}
+
+void SerialPortPoller::start()
+{
+    active = true;
+    runPollThread = true;
+    pollThread.start(shared_from_this(), &SerialPortPoller::pollRunner);
+}
+
+void SerialPortPoller::stop()
+{
+    runPollThread = false;
+
+    // The port is closed from the status callback of the poll thread when the read fails
+    pollThread.stop();
+}
+
+sd_rpc_busy_poll_stats_t SerialPortPoller::statsGet() const
+{
+    sd_rpc_busy_poll_stats_t stats;
+    stats.active = active;
+    stats.pinned = pinned;
+    stats.poll_count = pollCount.load(std::memory_order_relaxed);
+    stats.read_count = readCount.load(std::memory_order_relaxed);
+    stats.byte_count = byteCount.load(std::memory_order_relaxed);
+    stats.sleep_count = sleepCount.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// Poll Thread
+void SerialPortPoller::pollRunner()
+{
+    if (params.cpu >= 0)
+    {
+        pinned = ThreadCpuPin(params.cpu) == NRF_SUCCESS;
+
+        if (!pinned)
+        {
+            std::stringstream message;
+            message << "Poll thread of UART port " << portName << " can not be pinned to CPU " << params.cpu << ".";
+            logCallback(SD_RPC_LOG_WARNING, message.str());
+        }
+    }
+
+    const auto spinTime = std::chrono::microseconds(params.spin_us);
+    const auto sleepTime = std::chrono::microseconds(params.sleep_us);
+    auto lastReceived = std::chrono::steady_clock::now();
+
+    // Counted locally, the published counters are only written and never read by this thread
+    uint64_t polls = 0;
+    uint64_t reads = 0;
+    uint64_t bytes = 0;
+    uint64_t sleeps = 0;
+
+    // The callbacks may close the port and delete the UartBoost, nothing of it is used once stopped
+    while (runPollThread && pollThread.isCurrent())
+    {
+        size_t length = 0;
+        const auto errCode = SerialPortPollRead(handle, readBuffer.data(), BUFFER_SIZE, &length);
+        pollCount.store(++polls, std::memory_order_relaxed);
+
+        if (errCode != NRF_SUCCESS)
+        {
+            active = false;
+
+            std::stringstream message;
+            message << "UART implementation failed while polling bytes from UART port " << portName << ".";
+            statusCallback(IO_RESOURCES_UNAVAILABLE, message.str().c_str());
+            return;
+        }
+
+        if (length > 0)
+        {
+            readCount.store(++reads, std::memory_order_relaxed);
+            byteCount.store(bytes += length, std::memory_order_relaxed);
+
+            dataCallback(readBuffer.data(), length);
+            lastReceived = std::chrono::steady_clock::now();
+            continue;
+        }
+
+        // Spin while a response is likely to follow, then back off so an idle link does not hold the CPU
+        if (std::chrono::steady_clock::now() - lastReceived < spinTime)
+        {
+            continue;
+        }
+
+        sleepCount.store(++sleeps, std::memory_order_relaxed);
+
+        if (sleepTime.count() > 0)
+        {
+            std::this_thread::sleep_for(sleepTime);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    active = false;
+}
@@ -42,41 +42,69 @@
 #include "nrf_error.h"
 
 #include "ble_common.h"
+#include "ser_config.h"
+
+#if NRF_SD_BLE_API_VERSION < 4
+#include "app_ble_user_mem.h"
+#endif
 
 #include <memory>
 #include <iostream>
 #include <sstream>
 #include <cstring> // Do not remove! Required by gcc.
 
+// Frames kept for reuse, one per thread sending commands at the same time is enough
+const size_t TX_FRAME_POOL_SIZE = 4;
+
 SerializationTransport::SerializationTransport(Transport *dataLinkLayer, uint32_t response_timeout)
     : statusCallback(nullptr), eventCallback(nullptr),
-    logCallback(nullptr), rspReceived(false),
+    logCallback(nullptr), eventPeekCallback(nullptr), rspReceived(false), linkResetCount(0),
     responseBuffer(nullptr), responseLength(nullptr),
+    framePool(SER_HAL_TRANSPORT_MAX_PKT_SIZE, TX_FRAME_POOL_SIZE),
     runEventThread(false)
 {
     eventThread = nullptr;
     nextTransportLayer = dataLinkLayer;
+    timerWheel = nextTransportLayer->timerWheelGet();
     responseTimeout = response_timeout;
+    responseTimer = TimerWheel::TIMER_ID_INVALID;
 }
 
 
-SerializationTransport::SerializationTransport(): nextTransportLayer(nullptr), responseTimeout(0), rspReceived(false), responseBuffer(nullptr), responseLength(nullptr), runEventThread(false), eventThread(nullptr)
+SerializationTransport::SerializationTransport(): nextTransportLayer(nullptr), timerWheel(nullptr), responseTimeout(0), responseTimer(TimerWheel::TIMER_ID_INVALID), rspReceived(false), linkResetCount(0), responseBuffer(nullptr), responseLength(nullptr), framePool(SER_HAL_TRANSPORT_MAX_PKT_SIZE, TX_FRAME_POOL_SIZE), runEventThread(false), eventThread(nullptr)
 {}
 
 SerializationTransport::~SerializationTransport()
 {
+#if NRF_SD_BLE_API_VERSION < 4
+    {
+        // Keysets, user memory and the connection count are kept per transport
+        BLESecurityContext context(this);
+        app_ble_gap_sec_context_root_destroy();
+        app_ble_user_mem_context_root_destroy();
+    }
+#endif
+
     delete nextTransportLayer;
 }
 
-uint32_t SerializationTransport::open(status_cb_t status_callback, evt_cb_t event_callback, log_cb_t log_callback)
+uint32_t SerializationTransport::open(status_cb_t status_callback, evt_cb_t event_callback, log_cb_t log_callback, evt_peek_cb_t event_peek_callback)
 {
     statusCallback = status_callback;
     eventCallback = event_callback;
     logCallback = log_callback;
+    eventPeekCallback = event_peek_callback;
+
+    if (timerWheel == nullptr)
+    {
+        logCallback(SD_RPC_LOG_ERROR, "Data link layer does not provide timers");
+        return NRF_ERROR_INTERNAL;
+    }
 
+    status_cb_t linkStatusCallback = std::bind(&SerializationTransport::statusHandler, this, std::placeholders::_1, std::placeholders::_2);
     data_cb_t dataCallback = std::bind(&SerializationTransport::readHandler, this, std::placeholders::_1, std::placeholders::_2);
 
-    uint32_t errorCode = nextTransportLayer->open(status_callback, dataCallback, log_callback);
+    uint32_t errorCode = nextTransportLayer->open(linkStatusCallback, dataCallback, log_callback);
 
     if (errorCode != NRF_SUCCESS)
     {
@@ -118,18 +146,44 @@ uint32_t SerializationTransport::close()
 }
 
 uint32_t SerializationTransport::send(uint8_t *cmdBuffer, uint32_t cmdLength, uint8_t *rspBuffer, uint32_t *rspLength)
+{
+    auto frame = frameAcquire();
+
+    if (cmdLength > frame->payloadCapacity())
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    memcpy(frame->payload(), cmdBuffer, cmdLength * sizeof(uint8_t));
+    frame->reset(cmdLength);
+
+    return send(*frame, rspBuffer, rspLength);
+}
+
+tx_frame_ptr_t SerializationTransport::frameAcquire()
+{
+    return framePool.acquire();
+}
+
+uint32_t SerializationTransport::send(TxFrame &frame, uint8_t *rspBuffer, uint32_t *rspLength)
 {
     // Mutex to avoid multiple threads sending commands at the same time.
     std::unique_lock<std::mutex> sendGuard(sendMutex);
-    rspReceived = false;
+    uint32_t resetCountBefore;
+
+    {
+        std::lock_guard<std::mutex> responseGuard(responseMutex);
+        rspReceived = false;
+        resetCountBefore = linkResetCount;
+    }
+
     responseBuffer = rspBuffer;
     responseLength = rspLength;
 
-    std::vector<uint8_t> commandBuffer(cmdLength + 1);
-    commandBuffer[0] = SERIALIZATION_COMMAND;
-    memcpy(&commandBuffer[1], cmdBuffer, cmdLength * sizeof(uint8_t));
-
-    auto errCode = nextTransportLayer->send(commandBuffer);
+    // The packet type goes in front of the command, which stays where it was encoded
+    *frame.prepend(1) = SERIALIZATION_COMMAND;
+    auto errCode = nextTransportLayer->send(frame);
+    frame.trimFront(1);
 
     if (errCode != NRF_SUCCESS) {
         return errCode;
@@ -143,11 +197,21 @@ uint32_t SerializationTransport::send(uint8_t *cmdBuffer, uint32_t cmdLength, ui
 
     if (!rspReceived)
     {
-        std::chrono::milliseconds timeout(responseTimeout);
-        std::chrono::system_clock::time_point wakeupTime = std::chrono::system_clock::now() + timeout;
-        std::cv_status status = responseWaitCondition.wait_until(responseGuard, wakeupTime);
+        // The response deadline is cleared when it expires, or right away if timers are not advanced
+        responseTimer = timerWheel->arm(std::chrono::milliseconds(responseTimeout), std::bind(&SerializationTransport::responseTimeoutHandler, this, std::placeholders::_1));
+        responseWaitCondition.wait(responseGuard, [&] { return rspReceived || responseTimer == TimerWheel::TIMER_ID_INVALID || linkResetCount != resetCountBefore; });
+
+        timerWheel->cancel(responseTimer);
+        responseTimer = TimerWheel::TIMER_ID_INVALID;
+
+        if (!rspReceived && linkResetCount != resetCountBefore)
+        {
+            // The connectivity chip has been reset, the response will never come
+            logCallback(SD_RPC_LOG_WARNING, "Link reset while waiting for response for command");
+            return NRF_ERROR_INTERNAL;
+        }
 
-        if (status == std::cv_status::timeout)
+        if (!rspReceived)
         {
             logCallback(SD_RPC_LOG_WARNING, "Failed to receive response for command");
             return NRF_ERROR_INTERNAL;
@@ -170,14 +234,29 @@ void SerializationTransport::eventHandlingRunner()
             eventQueue.pop();
             eventLock.unlock();
 
-            // Allocate memory to store decoded event including an unknown quantity of padding
-
-            // Set security context
-            BLESecurityContext context(this);
+            if (eventData.decoded)
+            {
+                if (eventCallback != nullptr)
+                {
+                    eventCallback(reinterpret_cast<ble_evt_t *>(eventData.data));
+                }
+
+                free(eventData.data);
+                eventLock.lock();
+                continue;
+            }
 
+            // Allocate memory to store decoded event including an unknown quantity of padding
             uint32_t possibleEventLength = 700;
             std::unique_ptr<ble_evt_t> event(static_cast<ble_evt_t*>(std::malloc(possibleEventLength)));
-            uint32_t errCode = ble_event_dec(eventData.data, eventData.dataLength, event.get(), &possibleEventLength);
+            uint32_t errCode;
+
+            {
+                // Set security context only while decoding, the event callback may issue
+                // security related commands that set it again
+                BLESecurityContext context(this);
+                errCode = ble_event_dec(eventData.data, eventData.dataLength, event.get(), &possibleEventLength);
+            }
 
             if (eventCallback != nullptr && errCode == NRF_SUCCESS)
             {
@@ -198,6 +277,49 @@ void SerializationTransport::eventHandlingRunner()
     }
 }
 
+void SerializationTransport::logSeverityFilterSet(sd_rpc_log_severity_t severity_filter)
+{
+    nextTransportLayer->logSeverityFilterSet(severity_filter);
+}
+
+void SerializationTransport::eventInject(const ble_evt_t *event, const uint32_t length)
+{
+    eventData_t eventData;
+    eventData.data = static_cast<uint8_t *>(malloc(length));
+    memcpy(eventData.data, event, length);
+    eventData.dataLength = length;
+    eventData.decoded = true;
+
+    std::lock_guard<std::mutex> eventLock(eventMutex);
+    eventQueue.push(eventData);
+    eventWaitCondition.notify_one();
+}
+
+// I/O Thread
+void SerializationTransport::responseTimeoutHandler(timer_id_t id)
+{
+    std::lock_guard<std::mutex> responseGuard(responseMutex);
+
+    if (id == responseTimer)
+    {
+        responseTimer = TimerWheel::TIMER_ID_INVALID;
+        responseWaitCondition.notify_one();
+    }
+}
+
+void SerializationTransport::statusHandler(sd_rpc_app_status_t code, const char *message)
+{
+    // Upper layers learn about the reset before the command waiting for a response is failed
+    statusCallback(code, message);
+
+    if (code == RESET_PERFORMED)
+    {
+        std::lock_guard<std::mutex> responseGuard(responseMutex);
+        linkResetCount++;
+        responseWaitCondition.notify_one();
+    }
+}
+
 // Read Thread
 void SerializationTransport::readHandler(uint8_t *data, size_t length)
 {
@@ -215,10 +337,17 @@ void SerializationTransport::readHandler(uint8_t *data, size_t length)
     }
     else if (eventType == SERIALIZATION_EVENT)
     {
+        // Let time critical handling see the encoded event before it waits in the queue for decoding
+        if (eventPeekCallback != nullptr)
+        {
+            eventPeekCallback(data, static_cast<uint32_t>(length));
+        }
+
         eventData_t eventData;
         eventData.data = static_cast<uint8_t *>(malloc(length));
         memcpy(eventData.data, data, length);
         eventData.dataLength = (uint32_t) length;
+        eventData.decoded = false;
 
         std::lock_guard<std::mutex> eventLock(eventMutex);
         eventQueue.push(eventData);
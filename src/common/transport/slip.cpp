@@ -44,30 +44,64 @@
 #define SLIP_ESC 0xDB
 #define SLIP_ESC_END 0xDC
 #define SLIP_ESC_ESC 0xDD
+#define SLIP_XON 0x11
+#define SLIP_XOFF 0x13
+#define SLIP_ESC_XON 0xDE
+#define SLIP_ESC_XOFF 0xDF
 
-void slip_encode(std::vector<uint8_t> &in_packet, std::vector<uint8_t> &out_packet)
+// XON and XOFF are only escaped when out-of-frame software flow control is in use
+void slip_encode(std::vector<uint8_t> &in_packet, std::vector<uint8_t> &out_packet, bool escape_flow_control)
 {
-    out_packet.push_back(SLIP_END);
+    const auto outPosition = out_packet.size();
+    out_packet.resize(outPosition + slip_encoded_length_max(in_packet.size()));
 
-    for (size_t i = 0; i < in_packet.size(); i++)
+    const auto encodedLength = slip_encode(in_packet.data(), in_packet.size(), &out_packet[outPosition], escape_flow_control);
+    out_packet.resize(outPosition + encodedLength);
+}
+
+size_t slip_encode(const uint8_t *in_packet, const size_t length, uint8_t *out_packet, bool escape_flow_control)
+{
+    auto out = out_packet;
+
+    *out++ = SLIP_END;
+
+    for (size_t i = 0; i < length; i++)
     {
         if (in_packet[i] == SLIP_END)
         {
-            out_packet.push_back(SLIP_ESC);
-            out_packet.push_back(SLIP_ESC_END);
+            *out++ = SLIP_ESC;
+            *out++ = SLIP_ESC_END;
         }
         else if (in_packet[i] == SLIP_ESC)
         {
-            out_packet.push_back(SLIP_ESC);
-            out_packet.push_back(SLIP_ESC_ESC);
+            *out++ = SLIP_ESC;
+            *out++ = SLIP_ESC_ESC;
+        }
+        else if (escape_flow_control && in_packet[i] == SLIP_XON)
+        {
+            *out++ = SLIP_ESC;
+            *out++ = SLIP_ESC_XON;
+        }
+        else if (escape_flow_control && in_packet[i] == SLIP_XOFF)
+        {
+            *out++ = SLIP_ESC;
+            *out++ = SLIP_ESC_XOFF;
         }
         else
         {
-            out_packet.push_back(in_packet[i]);
+            *out++ = in_packet[i];
         }
     }
 
-    out_packet.push_back(SLIP_END);
+    *out++ = SLIP_END;
+
+    return static_cast<size_t>(out - out_packet);
+}
+
+size_t slip_encoded_length_max(const size_t length)
+{
+    // All bytes escaped and the packet enclosed in two SLIP_END
+    return 2 * length + 2;
 }
 
 uint32_t slip_decode(std::vector<uint8_t> &packet, std::vector<uint8_t> &out_packet)
@@ -88,6 +122,14 @@ uint32_t slip_decode(std::vector<uint8_t> &packet, std::vector<uint8_t> &out_pac
             {
                 out_packet.push_back(SLIP_ESC);
             }
+            else if (packet[i] == SLIP_ESC_XON)
+            {
+                out_packet.push_back(SLIP_XON);
+            }
+            else if (packet[i] == SLIP_ESC_XOFF)
+            {
+                out_packet.push_back(SLIP_XOFF);
+            }
             else
             {
                 return NRF_ERROR_INVALID_DATA;
@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "timer_wheel.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+const timer_id_t TimerWheel::TIMER_ID_INVALID;
+
+TimerWheel::TimerWheel()
+    : epoch(std::chrono::steady_clock::now()), currentTick(0), scheduledTick(0),
+    nextId(1), running(false), wakeupCallback(nullptr)
+{
+    levelSizes.fill(0);
+}
+
+TimerWheel::~TimerWheel()
+{
+    stop();
+}
+
+void TimerWheel::start(timer_wakeup_cb_t wakeup_callback)
+{
+    std::lock_guard<std::mutex> lock(wheelMutex);
+    wakeupCallback = wakeup_callback;
+    currentTick = tickGet(std::chrono::steady_clock::now());
+    scheduledTick = 0;
+    running = true;
+}
+
+void TimerWheel::stop()
+{
+    std::vector<std::pair<timer_id_t, timer_cb_t>> expired;
+
+    {
+        std::lock_guard<std::mutex> lock(wheelMutex);
+        running = false;
+        wakeupCallback = nullptr;
+        scheduledTick = 0;
+
+        for (auto &level : levels)
+        {
+            for (auto &slot : level)
+            {
+                for (auto &timer : slot)
+                {
+                    expired.push_back(std::make_pair(timer.id, std::move(timer.callback)));
+                }
+
+                slot.clear();
+            }
+        }
+
+        levelSizes.fill(0);
+        timers.clear();
+    }
+
+    for (auto &timer : expired)
+    {
+        timer.second(timer.first);
+    }
+}
+
+timer_id_t TimerWheel::arm(std::chrono::milliseconds timeout, timer_cb_t callback)
+{
+    timer_wakeup_cb_t wakeup;
+    timer_id_t id;
+
+    {
+        std::lock_guard<std::mutex> lock(wheelMutex);
+
+        if (!running)
+        {
+            return TIMER_ID_INVALID;
+        }
+
+        // The current tick is partly elapsed, round up so that a timer never expires early
+        const auto ticks = static_cast<uint64_t>(std::max<std::chrono::milliseconds::rep>(0, timeout.count()));
+        const auto expiry = std::max(tickGet(std::chrono::steady_clock::now()), currentTick) + ticks + 1;
+
+        id = nextId++;
+
+        slot_t pending;
+        pending.push_back({ id, expiry, 0, 0, callback });
+        timers[id] = pending.begin();
+        insert(pending, pending.begin());
+
+        if (scheduledTick == 0 || expiry < scheduledTick)
+        {
+            scheduledTick = expiry;
+            wakeup = wakeupCallback;
+        }
+    }
+
+    if (wakeup)
+    {
+        wakeup();
+    }
+
+    return id;
+}
+
+bool TimerWheel::cancel(timer_id_t id)
+{
+    std::lock_guard<std::mutex> lock(wheelMutex);
+
+    auto found = timers.find(id);
+
+    if (found == timers.end())
+    {
+        return false;
+    }
+
+    auto timer = found->second;
+    levelSizes[timer->level]--;
+    levels[timer->level][timer->slot].erase(timer);
+    timers.erase(found);
+
+    return true;
+}
+
+void TimerWheel::advance()
+{
+    std::vector<std::pair<timer_id_t, timer_cb_t>> expired;
+
+    {
+        std::lock_guard<std::mutex> lock(wheelMutex);
+
+        if (!running)
+        {
+            return;
+        }
+
+        const auto nowTick = tickGet(std::chrono::steady_clock::now());
+
+        while (currentTick < nowTick)
+        {
+            if (timers.empty())
+            {
+                currentTick = nowTick;
+                break;
+            }
+
+            if (levelSizes[0] == 0)
+            {
+                // Nothing expires before the next cascade
+                const auto boundary = (currentTick | (LEVEL_SLOTS - 1)) + 1;
+
+                if (boundary > nowTick)
+                {
+                    currentTick = nowTick;
+                    break;
+                }
+
+                currentTick = boundary - 1;
+            }
+
+            currentTick++;
+
+            for (uint32_t level = 1; level < LEVEL_COUNT; level++)
+            {
+                if ((currentTick & ((uint64_t(1) << (LEVEL_BITS * level)) - 1)) != 0)
+                {
+                    break;
+                }
+
+                cascade(level);
+            }
+
+            auto &slot = levels[0][currentTick & (LEVEL_SLOTS - 1)];
+
+            for (auto &timer : slot)
+            {
+                timers.erase(timer.id);
+                expired.push_back(std::make_pair(timer.id, std::move(timer.callback)));
+            }
+
+            levelSizes[0] -= slot.size();
+            slot.clear();
+        }
+
+        scheduledTick = 0;
+    }
+
+    for (auto &timer : expired)
+    {
+        timer.second(timer.first);
+    }
+}
+
+bool TimerWheel::nextExpiryGet(std::chrono::steady_clock::time_point &expiry)
+{
+    std::lock_guard<std::mutex> lock(wheelMutex);
+
+    if (!running || timers.empty())
+    {
+        scheduledTick = 0;
+        return false;
+    }
+
+    // The earliest non-empty slot of each level, higher levels are due when they are cascaded
+    auto next = std::numeric_limits<uint64_t>::max();
+
+    for (uint32_t level = 0; level < LEVEL_COUNT; level++)
+    {
+        if (levelSizes[level] == 0)
+        {
+            continue;
+        }
+
+        const auto shift = LEVEL_BITS * level;
+        const auto block = currentTick >> shift;
+
+        for (uint64_t i = 1; i <= LEVEL_SLOTS; i++)
+        {
+            if (!levels[level][(block + i) & (LEVEL_SLOTS - 1)].empty())
+            {
+                next = std::min(next, (block + i) << shift);
+                break;
+            }
+        }
+    }
+
+    scheduledTick = next;
+    expiry = epoch + std::chrono::milliseconds(next);
+
+    return true;
+}
+
+size_t TimerWheel::size() const
+{
+    std::lock_guard<std::mutex> lock(wheelMutex);
+    return timers.size();
+}
+
+uint64_t TimerWheel::tickGet(const std::chrono::steady_clock::time_point &time) const
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(time - epoch).count());
+}
+
+void TimerWheel::insert(slot_t &from, slot_t::iterator timer)
+{
+    const auto expiry = std::max(timer->expiry, currentTick);
+    const auto delta = expiry - currentTick;
+    const auto range = uint64_t(1) << (LEVEL_BITS * LEVEL_COUNT);
+
+    uint32_t level = 0;
+
+    while (level < LEVEL_COUNT - 1 && delta >= (uint64_t(1) << (LEVEL_BITS * (level + 1))))
+    {
+        level++;
+    }
+
+    // Timers beyond the range of the wheel are parked in the last slot and inserted again when cascaded
+    const auto position = (delta < range) ? expiry : currentTick + range - 1;
+
+    timer->level = level;
+    timer->slot = static_cast<uint32_t>((position >> (LEVEL_BITS * level)) & (LEVEL_SLOTS - 1));
+
+    auto &slot = levels[level][timer->slot];
+    slot.splice(slot.end(), from, timer);
+    levelSizes[level]++;
+}
+
+void TimerWheel::cascade(const uint32_t level)
+{
+    auto &slot = levels[level][(currentTick >> (LEVEL_BITS * level)) & (LEVEL_SLOTS - 1)];
+
+    slot_t cascading;
+    cascading.splice(cascading.end(), slot);
+    levelSizes[level] -= cascading.size();
+
+    while (!cascading.empty())
+    {
+        insert(cascading, cascading.begin());
+    }
+}
@@ -44,6 +44,7 @@
 using namespace std;
 
 Transport::Transport()
+    : logSeverityFilter(SD_RPC_LOG_TRACE)
 {
     /* Intentional empty */
 }
@@ -66,3 +67,51 @@ uint32_t Transport::close()
 {
     return NRF_SUCCESS;
 }
+
+uint32_t Transport::send(TxFrame &frame)
+{
+    std::vector<uint8_t> data(frame.data(), frame.data() + frame.size());
+    return send(data);
+}
+
+uint32_t Transport::sendEncoded(const size_t maxLength, const tx_encoder_t &encoder)
+{
+    std::vector<uint8_t> data(maxLength);
+    data.resize(encoder(data.data()));
+    return send(data);
+}
+
+bool Transport::softwareFlowControlSupported() const
+{
+    return false;
+}
+
+uint32_t Transport::softwareFlowControlSet(bool enable)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t Transport::baudRateSet(const uint32_t baudRate)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t Transport::baudRateGet() const
+{
+    return 0;
+}
+
+TimerWheel *Transport::timerWheelGet()
+{
+    return nullptr;
+}
+
+void Transport::logSeverityFilterSet(sd_rpc_log_severity_t severity_filter)
+{
+    logSeverityFilter = severity_filter;
+}
+
+bool Transport::logEnabled(sd_rpc_log_severity_t severity) const
+{
+    return static_cast<uint32_t>(severity) >= static_cast<uint32_t>(logSeverityFilter.load());
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tx_frame.h"
+
+TxFrame::TxFrame(const size_t payloadCapacity)
+    : buffer(HEADROOM + payloadCapacity + TAILROOM), begin(HEADROOM), end(HEADROOM)
+{}
+
+uint8_t *TxFrame::data()
+{
+    return buffer.data() + begin;
+}
+
+const uint8_t *TxFrame::data() const
+{
+    return buffer.data() + begin;
+}
+
+size_t TxFrame::size() const
+{
+    return end - begin;
+}
+
+uint8_t *TxFrame::payload()
+{
+    return buffer.data() + HEADROOM;
+}
+
+size_t TxFrame::payloadCapacity() const
+{
+    return buffer.size() - HEADROOM - TAILROOM;
+}
+
+void TxFrame::reset(const size_t length)
+{
+    begin = HEADROOM;
+    end = HEADROOM + length;
+}
+
+uint8_t *TxFrame::prepend(const size_t length)
+{
+    begin -= length;
+    return buffer.data() + begin;
+}
+
+uint8_t *TxFrame::append(const size_t length)
+{
+    const auto added = end;
+    end += length;
+    return buffer.data() + added;
+}
+
+void TxFrame::trimFront(const size_t length)
+{
+    begin += length;
+}
+
+void TxFrame::trimBack(const size_t length)
+{
+    end -= length;
+}
+
+void TxFrameRelease::operator()(TxFrame *frame) const
+{
+    pool->release(frame);
+}
+
+TxFramePool::TxFramePool(const size_t _payloadCapacity, const size_t _maxFree)
+    : payloadCapacity(_payloadCapacity), maxFree(_maxFree)
+{}
+
+tx_frame_ptr_t TxFramePool::acquire()
+{
+    std::unique_ptr<TxFrame> frame;
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+
+        if (!freeFrames.empty())
+        {
+            frame = std::move(freeFrames.back());
+            freeFrames.pop_back();
+        }
+    }
+
+    if (!frame)
+    {
+        frame.reset(new TxFrame(payloadCapacity));
+    }
+
+    frame->reset(0);
+
+    TxFrameRelease release;
+    release.pool = this;
+    return tx_frame_ptr_t(frame.release(), release);
+}
+
+void TxFramePool::release(TxFrame *frame)
+{
+    std::unique_ptr<TxFrame> released(frame);
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    if (freeFrames.size() < maxFree)
+    {
+        freeFrames.push_back(std::move(released));
+    }
+}
@@ -42,8 +42,10 @@
 #include <boost/bind.hpp>
 #include <boost/asio.hpp>
 
+#include <chrono>
 #include <sstream>
 #include <mutex>
+#include <utility>
 
 UartBoost::UartBoost(const UartCommunicationParameters &communicationParameters)
     : Transport(),
@@ -58,7 +60,17 @@ UartBoost::UartBoost(const UartCommunicationParameters &communicationParameters)
       callbackReadHandle(),
       callbackWriteHandle(),
       asyncWriteInProgress(false),
-      uartSettingsBoost(communicationParameters)
+      timerWheel(),
+      timerWheelTimer(ioService),
+      uartSettingsBoost(communicationParameters),
+      currentBaudRate(communicationParameters.baudRate),
+      lowLatencyRequested(false),
+      lowLatencyPrevious(false),
+      latencyInfo(),
+      sysfsRoot(SERIAL_PORT_SYSFS_ROOT),
+      busyPollRequested(false),
+      busyPollParams(),
+      poller()
 {
 }
 
@@ -89,17 +101,31 @@ uint32_t UartBoost::open(status_cb_t status_callback, data_cb_t data_callback, l
     }
 
     const auto baudRate = uartSettingsBoost.getBoostBaudRate();
-    const auto flowControl = uartSettingsBoost.getBoostFlowControl();
+    auto flowControl = uartSettingsBoost.getBoostFlowControl();
+
+    // Software flow control is negotiated by the data link layer. Until then XON and XOFF
+    // may be part of the frames and must not be handled by the serial port driver.
+    if (uartSettingsBoost.getFlowControl() == UartFlowControlSoftware)
+    {
+        flowControl = boost::asio::serial_port::flow_control(boost::asio::serial_port::flow_control::none);
+    }
+
     const auto stopBits = uartSettingsBoost.getBoostStopBits();
     const auto parity = uartSettingsBoost.getBoostParity();
     const auto characterSize = uartSettingsBoost.getBoostCharacterSize();
 
     serialPort.set_option(baudRate);
+    currentBaudRate = uartSettingsBoost.getBaudRate();
     serialPort.set_option(flowControl);
     serialPort.set_option(stopBits);
     serialPort.set_option(parity);
     serialPort.set_option(characterSize);
 
+    if (lowLatencyRequested)
+    {
+        latencyApply();
+    }
+
     try
     {
         // boost::bind not compatible with std::bind
@@ -111,6 +137,11 @@ uint32_t UartBoost::open(status_cb_t status_callback, data_cb_t data_callback, l
                                    boost::asio::placeholders::error,
                                    boost::asio::placeholders::bytes_transferred);
 
+        // Timers of the upper layers are advanced by the IO service thread
+        timerWheel.start([this]() {
+            ioService.post(std::bind(&UartBoost::timerWheelSchedule, this));
+        });
+
         // run the IO service as a separate thread, so the main thread can block on standard input
         boost::function<std::size_t()> ioServiceRun = boost::bind(&boost::asio::io_service::run, &ioService);
         ioWorkThread = boost::thread(ioServiceRun);
@@ -123,7 +154,24 @@ uint32_t UartBoost::open(status_cb_t status_callback, data_cb_t data_callback, l
         return NRF_ERROR_INTERNAL;
     }
 
-    startRead();
+    if (busyPollRequested && SerialPortPollPrepare(serialPort.native_handle()) == NRF_SUCCESS)
+    {
+        auto newPoller = std::make_shared<SerialPortPoller>(serialPort.native_handle(), busyPollParams, portName,
+            dataCallback, statusCallback, logCallback);
+        std::atomic_store(&poller, newPoller);
+        newPoller->start();
+    }
+    else
+    {
+        if (busyPollRequested)
+        {
+            std::stringstream message;
+            message << "UART port " << uartSettingsBoost.getPortName().c_str() << " can not be polled, it is read by the IO service thread.";
+            logCallback(SD_RPC_LOG_WARNING, message.str());
+        }
+
+        startRead();
+    }
 
     std::stringstream flow_control_string;
     std::stringstream parity_string;
@@ -174,6 +222,14 @@ uint32_t UartBoost::close()
 {
     try
     {
+        if (serialPort.is_open())
+        {
+            latencyRestore();
+        }
+
+        // The poll thread reads the port without the IO service, it is stopped before the port is closed
+        busyPollStop();
+
         serialPort.close();
         ioService.stop();
         ioWorkThread.join();
@@ -190,6 +246,9 @@ uint32_t UartBoost::close()
         logCallback(SD_RPC_LOG_ERROR, message.str());
     }
 
+    // Pending timers expire so that nobody waits for a timer that is not advanced anymore
+    timerWheel.stop();
+
     asyncWriteInProgress = false;
 
     Transport::close();
@@ -210,6 +269,219 @@ uint32_t UartBoost::send(std::vector<uint8_t> &data)
     return NRF_SUCCESS;
 }
 
+uint32_t UartBoost::sendEncoded(const size_t maxLength, const tx_encoder_t &encoder)
+{
+    queueMutex.lock();
+    const auto queued = writeQueue.size();
+    writeQueue.resize(queued + maxLength);
+    writeQueue.resize(queued + encoder(&writeQueue[queued]));
+    queueMutex.unlock();
+
+    if (!asyncWriteInProgress)
+    {
+        asyncWrite();
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t UartBoost::lowLatencySet(const bool enable)
+{
+#ifdef __linux__
+    lowLatencyRequested = enable;
+    return NRF_SUCCESS;
+#else
+    return enable ? NRF_ERROR_NOT_SUPPORTED : NRF_SUCCESS;
+#endif
+}
+
+sd_rpc_serial_latency_info_t UartBoost::latencyInfoGet() const
+{
+    return latencyInfo;
+}
+
+void UartBoost::sysfsRootSet(const std::string &root)
+{
+    sysfsRoot = root;
+}
+
+uint32_t UartBoost::busyPollSet(const sd_rpc_busy_poll_params_t *params)
+{
+#ifdef _WIN32
+    return params != nullptr ? NRF_ERROR_NOT_SUPPORTED : NRF_SUCCESS;
+#else
+    busyPollRequested = params != nullptr;
+
+    if (params != nullptr)
+    {
+        busyPollParams = *params;
+    }
+
+    return NRF_SUCCESS;
+#endif
+}
+
+sd_rpc_busy_poll_stats_t UartBoost::busyPollStatsGet() const
+{
+    const auto currentPoller = std::atomic_load(&poller);
+
+    if (!currentPoller)
+    {
+        sd_rpc_busy_poll_stats_t stats = {};
+        return stats;
+    }
+
+    return currentPoller->statsGet();
+}
+
+void UartBoost::busyPollStop()
+{
+    const auto currentPoller = std::atomic_load(&poller);
+
+    // The statistics of the last poll stay readable after the port is closed
+    if (currentPoller)
+    {
+        currentPoller->stop();
+    }
+}
+
+void UartBoost::latencyApply()
+{
+    const auto portName = uartSettingsBoost.getPortName();
+    std::stringstream message;
+
+    latencyInfo = sd_rpc_serial_latency_info_t();
+    SerialPortBridgeGet(portName, sysfsRoot, &latencyInfo.bridge);
+
+    // The FTDI driver holds back received bytes for up to 16 ms by default, which delays every response
+    if (latencyInfo.bridge == SD_RPC_USB_BRIDGE_FTDI
+        && SerialPortLatencyTimerGet(portName, sysfsRoot, &latencyInfo.previous_latency_timer_ms) == NRF_SUCCESS)
+    {
+        latencyInfo.latency_timer_ms = latencyInfo.previous_latency_timer_ms;
+
+        if (latencyInfo.previous_latency_timer_ms != 1)
+        {
+            if (SerialPortLatencyTimerSet(portName, sysfsRoot, 1) == NRF_SUCCESS)
+            {
+                latencyInfo.latency_timer_ms = 1;
+            }
+            else
+            {
+                message << "Not permitted to set the latency timer of UART port " << portName << ", it is kept at "
+                        << static_cast<unsigned int>(latencyInfo.previous_latency_timer_ms) << " ms. ";
+            }
+        }
+    }
+
+    const auto handle = serialPort.native_handle();
+
+    if (SerialPortLowLatencyGet(handle, &lowLatencyPrevious) == NRF_SUCCESS)
+    {
+        latencyInfo.low_latency = lowLatencyPrevious
+            || SerialPortLowLatencySet(handle, true) == NRF_SUCCESS;
+    }
+
+    message << "Latency of UART port " << portName << " tuned, bridge: ";
+
+    switch (latencyInfo.bridge)
+    {
+        case SD_RPC_USB_BRIDGE_FTDI:
+            message << "FTDI";
+            break;
+        case SD_RPC_USB_BRIDGE_CP210X:
+            message << "CP210x";
+            break;
+        case SD_RPC_USB_BRIDGE_CDC_ACM:
+            message << "CDC ACM";
+            break;
+        default:
+            message << "unknown";
+            break;
+    }
+
+    message << ", latency timer: " << static_cast<unsigned int>(latencyInfo.latency_timer_ms) << " ms"
+            << ", low latency: " << (latencyInfo.low_latency ? "on" : "off") << ".";
+    logCallback(SD_RPC_LOG_INFO, message.str());
+}
+
+void UartBoost::latencyRestore()
+{
+    const auto portName = uartSettingsBoost.getPortName();
+
+    if (latencyInfo.latency_timer_ms != latencyInfo.previous_latency_timer_ms)
+    {
+        SerialPortLatencyTimerSet(portName, sysfsRoot, latencyInfo.previous_latency_timer_ms);
+        latencyInfo.latency_timer_ms = latencyInfo.previous_latency_timer_ms;
+    }
+
+    if (latencyInfo.low_latency && !lowLatencyPrevious)
+    {
+        SerialPortLowLatencySet(serialPort.native_handle(), false);
+        latencyInfo.low_latency = false;
+    }
+}
+
+uint32_t UartBoost::baudRateSet(const uint32_t baudRate)
+{
+    try
+    {
+        serialPort.set_option(boost::asio::serial_port::baud_rate(baudRate));
+    }
+    catch (std::exception& ex)
+    {
+        std::stringstream message;
+        message << "Exception thrown on " << ex.what() << " when setting baud rate " << baudRate << " on UART port " << uartSettingsBoost.getPortName().c_str() << ".";
+        logCallback(SD_RPC_LOG_ERROR, message.str());
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    currentBaudRate = baudRate;
+    return NRF_SUCCESS;
+}
+
+uint32_t UartBoost::baudRateGet() const
+{
+    return currentBaudRate;
+}
+
+bool UartBoost::softwareFlowControlSupported() const
+{
+    return uartSettingsBoost.getFlowControl() == UartFlowControlSoftware;
+}
+
+uint32_t UartBoost::softwareFlowControlSet(bool enable)
+{
+    if (!softwareFlowControlSupported())
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+
+    const auto flowControl = enable ? boost::asio::serial_port::flow_control::software : boost::asio::serial_port::flow_control::none;
+
+    try
+    {
+        serialPort.set_option(boost::asio::serial_port::flow_control(flowControl));
+    }
+    catch (std::exception& ex)
+    {
+        std::stringstream message;
+        message << "Exception thrown on " << ex.what() << " when setting flow control on UART port " << uartSettingsBoost.getPortName().c_str() << ".";
+        logCallback(SD_RPC_LOG_ERROR, message.str());
+        return NRF_ERROR_INTERNAL;
+    }
+
+    std::stringstream message;
+    message << "Software flow control " << (enable ? "enabled" : "disabled") << " on UART port " << uartSettingsBoost.getPortName().c_str() << ".";
+    logCallback(SD_RPC_LOG_DEBUG, message.str());
+
+    return NRF_SUCCESS;
+}
+
+TimerWheel *UartBoost::timerWheelGet()
+{
+    return &timerWheel;
+}
+
 void UartBoost::readHandler(const boost::system::error_code& errorCode, const size_t bytesTransferred)
 {
     if (!errorCode)
@@ -278,13 +550,35 @@ void UartBoost::asyncWrite()
         }
 
         asyncWriteInProgress = true;
-        writeBufferVector.clear();
 
-        /* Write all available bytes at once */
-        writeBufferVector.insert(writeBufferVector.begin(), writeQueue.begin(), writeQueue.end());
-        writeQueue.clear();
+        /* Write all available bytes at once, the buffers keep their capacity for the following writes */
+        writeBufferVector.clear();
+        std::swap(writeBufferVector, writeQueue);
     }
 
     boost::asio::mutable_buffers_1 mutableWriteBuffer = boost::asio::buffer(writeBufferVector, writeBufferVector.size());
     boost::asio::async_write(serialPort, mutableWriteBuffer, callbackWriteHandle);
 }
+
+void UartBoost::timerWheelSchedule()
+{
+    std::chrono::steady_clock::time_point expiry;
+
+    if (!timerWheel.nextExpiryGet(expiry))
+    {
+        timerWheelTimer.cancel();
+        return;
+    }
+
+    timerWheelTimer.expires_at(expiry);
+    timerWheelTimer.async_wait([this](const boost::system::error_code &errorCode) {
+        // Aborted when the wakeup is moved, a new wait is started by then
+        if (errorCode == boost::asio::error::operation_aborted)
+        {
+            return;
+        }
+
+        timerWheel.advance();
+        timerWheelSchedule();
+    });
+}
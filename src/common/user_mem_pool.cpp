@@ -0,0 +1,505 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "user_mem_pool.h"
+
+#include "ble_common.h"
+#include "serialization_transport.h"
+
+#include "app_ble_user_mem.h"
+#include "ble_app.h"
+#include "ble_serialization.h"
+#include "nrf_error.h"
+#include "ser_config.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+UserMemPool::UserMemPool(SerializationTransport *_transport, log_cb_t log_callback)
+    : transport(_transport), logCallback(log_callback), opened(false), blockSize(0), blockCount(0),
+    runReplyThread(false), totalReplyUs(0)
+{
+    std::memset(&stats, 0, sizeof(stats));
+}
+
+UserMemPool::~UserMemPool()
+{
+    stop();
+}
+
+void UserMemPool::eventPeek(const uint8_t *event, const uint32_t length)
+{
+    // Read Thread
+    if (length < SER_EVT_HEADER_SIZE + 3)
+    {
+        return;
+    }
+
+    const auto eventId = static_cast<uint16_t>(event[SER_EVT_ID_POS] | (event[SER_EVT_ID_POS + 1] << 8));
+
+    if (eventId != BLE_EVT_USER_MEM_REQUEST)
+    {
+        return;
+    }
+
+    const auto connHandle = static_cast<uint16_t>(event[SER_EVT_HEADER_SIZE] | (event[SER_EVT_HEADER_SIZE + 1] << 8));
+    const auto type = event[SER_EVT_HEADER_SIZE + 2];
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    if (!opened || type != BLE_USER_MEM_TYPE_GATTS_QUEUED_WRITES)
+    {
+        return;
+    }
+
+    stats.request_count++;
+
+    // A connection that still holds a block asks again, the request is left to the application
+    if (leases.find(connHandle) != leases.end())
+    {
+        return;
+    }
+
+    if (freeBlocks.empty())
+    {
+        stats.exhausted_count++;
+        return;
+    }
+
+    Lease lease;
+    lease.block = freeBlocks.back();
+    lease.state = LEASE_PENDING;
+    lease.dispatched = false;
+    lease.requested = std::chrono::steady_clock::now();
+    freeBlocks.pop_back();
+    leases[connHandle] = lease;
+
+    stats.in_use_count++;
+    stats.peak_in_use_count = std::max(stats.peak_in_use_count, stats.in_use_count);
+
+    // Commands can not be sent from the transport threads, reply from a separate thread
+    if (!replyThread.runningGet())
+    {
+        runReplyThread = true;
+        replyThread.start(shared_from_this(), &UserMemPool::replyRunner);
+    }
+
+    replyQueue.push_back(connHandle);
+    replyCondition.notify_all();
+}
+
+bool UserMemPool::process(const ble_evt_t *event)
+{
+    const auto connHandle = event->evt.common_evt.conn_handle;
+
+    switch (event->header.evt_id)
+    {
+        case BLE_EVT_USER_MEM_REQUEST:
+        {
+            std::unique_lock<std::mutex> lock(poolMutex);
+            auto lease = leases.find(connHandle);
+
+            if (lease == leases.end() || lease->second.dispatched)
+            {
+                return false;
+            }
+
+            // The reply is usually sent before the event is dispatched, wait for it otherwise
+            replyCondition.wait(lock, [this, connHandle] {
+                const auto pending = leases.find(connHandle);
+                return pending == leases.end() || pending->second.state != LEASE_PENDING;
+            });
+
+            lease = leases.find(connHandle);
+
+            if (lease == leases.end())
+            {
+                return false;
+            }
+
+            if (lease->second.state == LEASE_FAILED)
+            {
+                blockFree(lease->second.block);
+                leases.erase(lease);
+                return false;
+            }
+
+            lease->second.dispatched = true;
+            return true;
+        }
+        case BLE_EVT_USER_MEM_RELEASE:
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            const auto lease = leases.find(connHandle);
+
+            if (lease == leases.end() || lease->second.state != LEASE_ANSWERED
+                || event->evt.common_evt.params.user_mem_release.mem_block.p_mem != blockGet(lease->second.block))
+            {
+                return false;
+            }
+
+            blockFree(lease->second.block);
+            leases.erase(lease);
+            stats.release_count++;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+bool UserMemPool::queuedWritesGet(const uint16_t connHandle, std::vector<uint8_t> &data)
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    const auto lease = leases.find(connHandle);
+
+    if (lease == leases.end() || lease->second.state != LEASE_ANSWERED)
+    {
+        return false;
+    }
+
+    const auto block = blockGet(lease->second.block);
+    data.assign(block, block + blockSize);
+    return true;
+}
+
+void UserMemPool::clear()
+{
+    std::vector<uint16_t> connHandles;
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+
+        for (const auto &lease : leases)
+        {
+            if (lease.second.state == LEASE_ANSWERED)
+            {
+                connHandles.push_back(lease.first);
+            }
+
+            blockFree(lease.second.block);
+        }
+
+        leases.clear();
+        replyQueue.clear();
+        replyCondition.notify_all();
+    }
+
+    // The codecs would fill the blocks from events of the connections, they are gone
+    for (const auto connHandle : connHandles)
+    {
+        contextDestroy(connHandle);
+    }
+}
+
+void UserMemPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        runReplyThread = false;
+        replyCondition.notify_all();
+    }
+
+    // Stopped from the reply thread it is detached, it keeps the pool alive until it has returned
+    replyThread.stop();
+
+    // Replies not sent are left to the application
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    for (auto &lease : leases)
+    {
+        if (lease.second.state == LEASE_PENDING)
+        {
+            lease.second.state = LEASE_FAILED;
+        }
+    }
+
+    replyQueue.clear();
+    replyCondition.notify_all();
+}
+
+uint32_t UserMemPool::open(const sd_rpc_user_mem_pool_params_t *params)
+{
+    if (params == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (params->block_size == 0 || params->block_count == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    if (opened)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    // The memory of a closed pool is kept until the SoftDevice has released all its blocks
+    if (!leases.empty())
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    blockSize = params->block_size;
+    blockCount = params->block_count;
+    storage.assign(static_cast<size_t>(blockSize) * blockCount, 0);
+    freeBlocks.clear();
+
+    for (uint16_t block = blockCount; block > 0; block--)
+    {
+        freeBlocks.push_back(static_cast<uint16_t>(block - 1));
+    }
+
+    std::memset(&stats, 0, sizeof(stats));
+    stats.block_size = blockSize;
+    stats.block_count = blockCount;
+    totalReplyUs = 0;
+    opened = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t UserMemPool::close()
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    opened = false;
+
+    if (leases.empty())
+    {
+        std::vector<uint8_t>().swap(storage);
+        freeBlocks.clear();
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t UserMemPool::statsGet(sd_rpc_user_mem_pool_stats_t *_stats) const
+{
+    if (_stats == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    *_stats = stats;
+    return NRF_SUCCESS;
+}
+
+uint32_t UserMemPool::leasedBlockGet(const uint16_t connHandle, uint8_t *data, uint16_t *length)
+{
+    if (data == nullptr || length == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    const auto lease = leases.find(connHandle);
+
+    if (lease == leases.end() || lease->second.state != LEASE_ANSWERED)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    const auto bufferLength = *length;
+    *length = blockSize;
+
+    if (bufferLength < blockSize)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    std::memcpy(data, blockGet(lease->second.block), blockSize);
+    return NRF_SUCCESS;
+}
+
+// Reply Thread
+void UserMemPool::replyRunner()
+{
+    std::unique_lock<std::mutex> lock(poolMutex);
+
+    while (runReplyThread && replyThread.isCurrent())
+    {
+        if (replyQueue.empty())
+        {
+            replyCondition.wait(lock);
+            continue;
+        }
+
+        const auto connHandle = replyQueue.front();
+        replyQueue.pop_front();
+
+        auto lease = leases.find(connHandle);
+
+        if (lease == leases.end() || lease->second.state != LEASE_PENDING)
+        {
+            continue;
+        }
+
+        ble_user_mem_block_t block;
+        block.p_mem = blockGet(lease->second.block);
+        block.len = blockSize;
+        const auto requested = lease->second.requested;
+        lock.unlock();
+
+        const auto resultCode = reply(connHandle, block);
+        const auto replied = std::chrono::steady_clock::now();
+
+        lock.lock();
+        lease = leases.find(connHandle);
+
+        // The block has been taken back by a reset while the reply was sent
+        if (lease == leases.end() || lease->second.state != LEASE_PENDING || lease->second.requested != requested)
+        {
+            continue;
+        }
+
+        if (resultCode == NRF_SUCCESS)
+        {
+            lease->second.state = LEASE_ANSWERED;
+            stats.answered_count++;
+            totalReplyUs += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(replied - requested).count());
+            stats.mean_reply_us = static_cast<uint32_t>(totalReplyUs / stats.answered_count);
+        }
+        else
+        {
+            lease->second.state = LEASE_FAILED;
+            stats.failed_count++;
+        }
+
+        replyCondition.notify_all();
+
+        if (resultCode != NRF_SUCCESS)
+        {
+            lock.unlock();
+
+            std::stringstream message;
+            message << "User memory request of connection " << connHandle << " left to the application, reply failed with error code " << resultCode;
+            logCallback(SD_RPC_LOG_WARNING, message.str());
+
+            lock.lock();
+        }
+    }
+}
+
+uint32_t UserMemPool::reply(const uint16_t connHandle, const ble_user_mem_block_t &block)
+{
+    // The codecs copy the queued writes to the block when they decode the events of the connection
+    {
+        BLESecurityContext context(transport);
+
+#if NRF_SD_BLE_API_VERSION >= 5
+        uint32_t index;
+
+        if (app_ble_user_mem_context_create(connHandle, &index) != NRF_SUCCESS)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+
+        app_ble_user_mem_context_block_set(index, &block);
+#else
+        ser_ble_user_mem_t *userMem;
+
+        if (app_ble_user_mem_context_create(connHandle, &userMem) != NRF_SUCCESS)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+
+        userMem->mem_block = block;
+#endif
+    }
+
+    std::vector<uint8_t> command(SER_HAL_TRANSPORT_MAX_PKT_SIZE);
+    std::vector<uint8_t> response(SER_HAL_TRANSPORT_MAX_PKT_SIZE);
+    auto commandLength = static_cast<uint32_t>(command.size());
+    uint32_t responseLength = 0;
+    uint32_t resultCode = NRF_ERROR_INTERNAL;
+
+    auto errCode = ble_user_mem_reply_req_enc(connHandle, &block, command.data(), &commandLength);
+
+    if (errCode == NRF_SUCCESS)
+    {
+        errCode = transport->send(command.data(), commandLength, response.data(), &responseLength);
+    }
+
+    if (errCode == NRF_SUCCESS)
+    {
+        uint32_t index = 0;
+
+        if (ser_ble_cmd_rsp_result_code_dec(response.data(), &index, responseLength, command[0], &resultCode) != NRF_SUCCESS)
+        {
+            resultCode = NRF_ERROR_INTERNAL;
+        }
+    }
+    else
+    {
+        resultCode = errCode;
+    }
+
+    if (resultCode != NRF_SUCCESS)
+    {
+        contextDestroy(connHandle);
+    }
+
+    return resultCode;
+}
+
+void UserMemPool::contextDestroy(const uint16_t connHandle)
+{
+    BLESecurityContext context(transport);
+    app_ble_user_mem_context_destroy(connHandle);
+}
+
+void UserMemPool::blockFree(const uint16_t block)
+{
+    freeBlocks.push_back(block);
+    stats.in_use_count--;
+
+    // The memory of a closed pool is released with its last block
+    if (!opened && stats.in_use_count == 0)
+    {
+        std::vector<uint8_t>().swap(storage);
+        freeBlocks.clear();
+    }
+}
+
+uint8_t *UserMemPool::blockGet(const uint16_t block)
+{
+    return storage.data() + static_cast<size_t>(block) * blockSize;
+}
@@ -35,65 +35,49 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include "app_ble_user_mem.h"
-#include "ser_config.h"
-#include "nrf_error.h"
-#include <stddef.h>
+#include "worker_thread.h"
 
-ser_ble_user_mem_t m_app_user_mem_table[SER_MAX_CONNECTIONS];
+WorkerThread::WorkerThread()
+{}
 
-uint32_t app_ble_user_mem_context_create(uint16_t conn_handle, uint32_t *p_index)
+WorkerThread::~WorkerThread()
 {
-  uint32_t err_code = NRF_ERROR_NO_MEM;
-  uint32_t i;
-
-  for (i=0; i<SER_MAX_CONNECTIONS; i++ )
-  {
-    if ( ! m_app_user_mem_table[i].conn_active )
-    {
-        m_app_user_mem_table[i].conn_active = 1;
-        m_app_user_mem_table[i].conn_handle = conn_handle;
-        *p_index = i;
-        err_code = NRF_SUCCESS;
-        break;
-    }
-  }
-
-  return err_code;
+    // The owner is destroyed on the thread itself when the thread held the last reference
+    stop();
 }
 
-uint32_t app_ble_user_mem_context_destroy(uint16_t conn_handle)
+void WorkerThread::stop()
 {
-  uint32_t err_code = NRF_ERROR_NOT_FOUND;
-  uint32_t i;
+    std::thread stopped;
 
-  for (i=0; i<SER_MAX_CONNECTIONS; i++ )
-  {
-    if (  m_app_user_mem_table[i].conn_handle == conn_handle )
     {
-        m_app_user_mem_table[i].conn_active = 0;
-        err_code = NRF_SUCCESS;
-        break;
+        std::lock_guard<std::mutex> lock(threadMutex);
+        stopped.swap(thread);
     }
-  }
 
-  return err_code;
-}
-
-uint32_t app_ble_user_mem_context_find(uint16_t conn_handle, uint32_t *p_index)
-{
-  uint32_t err_code = NRF_ERROR_NOT_FOUND;
-  uint32_t i;
+    if (!stopped.joinable())
+    {
+        return;
+    }
 
-  for (i=0; i<SER_MAX_CONNECTIONS; i++ )
-  {
-    if ( (m_app_user_mem_table[i].conn_handle == conn_handle) && (m_app_user_mem_table[i].conn_active == 1) )
+    if (stopped.get_id() == std::this_thread::get_id())
+    {
+        stopped.detach();
+    }
+    else
     {
-        *p_index = i;
-        err_code = NRF_SUCCESS;
-        break;
+        stopped.join();
     }
-  }
+}
 
-  return err_code;
+bool WorkerThread::runningGet() const
+{
+    std::lock_guard<std::mutex> lock(threadMutex);
+    return thread.joinable();
+}
+
+bool WorkerThread::isCurrent() const
+{
+    std::lock_guard<std::mutex> lock(threadMutex);
+    return thread.get_id() == std::this_thread::get_id();
 }
@@ -87,6 +87,29 @@ void app_ble_gap_sec_context_root_set(void *context);
 void app_ble_gap_sec_context_root_release();
 
 
+/**@brief Sets the number of concurrent connections the SoftDevice in the current root context is enabled for
+*
+* @note  Keysets and user memory instances are limited to this number of connections per root context.
+*        Until set, SER_MAX_CONNECTIONS is used.
+*
+* @param[in]     conn_count          number of concurrent connections
+*/
+void app_ble_gap_sec_context_conn_count_set(uint8_t conn_count);
+
+
+/**@brief Returns the number of concurrent connections the current root context has instances for
+*
+*/
+uint8_t app_ble_gap_sec_context_conn_count_get();
+
+
+/**@brief Releases all keysets and the connection count of the current root context
+*
+* @note  Called when the root context goes away, a new root context at the same address starts out empty.
+*/
+void app_ble_gap_sec_context_root_destroy();
+
+
 /**@brief allocates instance for storage of encryption keys.
  *
  * @param[in]     adapter             adapter
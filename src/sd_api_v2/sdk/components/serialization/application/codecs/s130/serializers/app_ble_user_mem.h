@@ -66,7 +66,7 @@ extern "C" {
 
 /**@brief Connection - user memory mapping structure.
  *
- * @note  This structure is used to map user memory to connection instances, and will be stored in a static table.
+ * @note  This structure is used to map user memory to connection instances, and will be stored per root context.
  */
 //lint -esym(452,ser_ble_user_mem_t) 
 typedef struct
@@ -76,15 +76,15 @@ typedef struct
   ble_user_mem_block_t   mem_block;      /**< User memory block structure, see @ref ble_user_mem_block_t.*/
 } ser_ble_user_mem_t;
 
-/**@brief allocates instance in m_user_mem_table[] for storage.
+/**@brief allocates instance for storage of user memory in the current root context.
  *
  * @param[in]     conn_handle         conn_handle
- * @param[out]    p_index             pointer to the index of allocated instance
+ * @param[out]    **pp_user_mem       Pointer to the user memory instance allocated for the given conn_handle
  *
  * @retval NRF_SUCCESS                Context allocated.
  * @retval NRF_ERROR_NO_MEM           No free instance available.
  */
-uint32_t app_ble_user_mem_context_create(uint16_t conn_handle, uint32_t *p_index);
+uint32_t app_ble_user_mem_context_create(uint16_t conn_handle, ser_ble_user_mem_t **pp_user_mem);
 
 /**@brief release instance identified by a connection handle.
  *
@@ -95,16 +95,20 @@ uint32_t app_ble_user_mem_context_create(uint16_t conn_handle, uint32_t *p_index
  */
 uint32_t app_ble_user_mem_context_destroy(uint16_t conn_handle);
 
-/**@brief finds index of instance identified by a connection handle in m_user_mem_table[].
+/**@brief releases all user memory instances of the current root context.
+ */
+void app_ble_user_mem_context_root_destroy();
+
+/**@brief finds instance identified by a connection handle in the current root context.
  *
  * @param[in]     conn_handle         conn_handle
  *
- * @param[out]    p_index             Pointer to the index of the entry in the context table corresponding to the given conn_handle
+ * @param[out]    **pp_user_mem       Pointer to the user memory instance corresponding to the given conn_handle
  *
  * @retval NRF_SUCCESS                Context found
  * @retval NRF_ERROR_NOT_FOUND        instance with conn_handle not found
  */
-uint32_t app_ble_user_mem_context_find(uint16_t conn_handle, uint32_t *p_index);
+uint32_t app_ble_user_mem_context_find(uint16_t conn_handle, ser_ble_user_mem_t **pp_user_mem);
 /** @} */
 
 #ifdef __cplusplus
@@ -38,6 +38,7 @@
 #include "ble_gap_evt_app.h"
 #include "ble_serialization.h"
 #include "app_util.h"
+#include "app_ble_gap_sec_keys.h"
 
 
 uint32_t ble_gap_evt_disconnected_dec(uint8_t const * const p_buf,
@@ -69,5 +70,8 @@ uint32_t ble_gap_evt_disconnected_dec(uint8_t const * const p_buf,
     SER_ASSERT_LENGTH_EQ(index, packet_len);
     *p_event_len = event_len;
 
+    // Keys that did not arrive with an AUTH_STATUS event are not coming anymore, free the instance
+    (void) app_ble_gap_sec_context_destroy(p_event->evt.gap_evt.conn_handle);
+
     return NRF_SUCCESS;
 }
@@ -48,6 +48,7 @@
 */
 
 #include "app_ble_gap_sec_keys.h"
+#include "ser_config.h"
 #include "nrf_error.h"
 #include <stddef.h>
 
@@ -65,6 +66,9 @@ typedef std::map<uint16_t, ser_ble_gap_app_keyset_t*> connhandle_keyset_t;
 
 // Map with context, each with a set of conn_handle and each conn_handle a ser_ble_gap_app_keyset_t*
 std::map<void*, connhandle_keyset_t*> m_app_keys_table;
+
+// Map with context, each with the number of concurrent connections the SoftDevice is enabled for
+std::map<void*, uint8_t> m_app_conn_count_table;
 void *current_context = nullptr;
 std::mutex current_context_mutex;
 
@@ -80,6 +84,39 @@ void app_ble_gap_sec_context_root_release()
     current_context_mutex.unlock();
 }
 
+void app_ble_gap_sec_context_conn_count_set(uint8_t conn_count)
+{
+    if (current_context == nullptr) return;
+    m_app_conn_count_table[current_context] = conn_count;
+}
+
+uint8_t app_ble_gap_sec_context_conn_count_get()
+{
+    auto connCount = m_app_conn_count_table.find(current_context);
+    if (connCount == m_app_conn_count_table.end()) return SER_MAX_CONNECTIONS;
+    return connCount->second;
+}
+
+void app_ble_gap_sec_context_root_destroy()
+{
+    if (current_context == nullptr) return;
+
+    auto tempRootContext = m_app_keys_table.find(current_context);
+
+    if (tempRootContext != m_app_keys_table.end())
+    {
+        for (auto &connHandle : *tempRootContext->second)
+        {
+            delete connHandle.second;
+        }
+
+        delete tempRootContext->second;
+        m_app_keys_table.erase(tempRootContext);
+    }
+
+    m_app_conn_count_table.erase(current_context);
+}
+
 uint32_t app_ble_gap_sec_context_create(uint16_t conn_handle, ser_ble_gap_app_keyset_t **pp_gap_app_keyset)
 {
     if (current_context == nullptr) return NRF_ERROR_INVALID_DATA;
@@ -109,6 +146,11 @@ uint32_t app_ble_gap_sec_context_create(uint16_t conn_handle, ser_ble_gap_app_ke
             delete connHandle->second;
             connHandleMap->erase(conn_handle);
         }
+        else if (connHandleMap->size() >= app_ble_gap_sec_context_conn_count_get())
+        {
+            delete keyset;
+            return NRF_ERROR_NO_MEM;
+        }
 
         connHandleMap->insert(std::make_pair(conn_handle, keyset));
     }
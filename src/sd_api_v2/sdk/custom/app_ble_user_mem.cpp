@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "app_ble_user_mem.h"
+#include "app_ble_gap_sec_keys.h"
+#include "nrf_error.h"
+#include <stddef.h>
+
+// C++ code
+#include <map>
+
+typedef std::map<uint16_t, ser_ble_user_mem_t*> connhandle_user_mem_t;
+
+// Map with context, each with a set of conn_handle and each conn_handle a ser_ble_user_mem_t*
+std::map<void*, connhandle_user_mem_t*> m_app_user_mem_table;
+
+// Root context is shared with the security keys, see app_ble_gap_sec_context_root_set
+extern void *current_context;
+
+uint32_t app_ble_user_mem_context_create(uint16_t conn_handle, ser_ble_user_mem_t **pp_user_mem)
+{
+    if (current_context == nullptr) return NRF_ERROR_INVALID_DATA;
+
+    auto tempRootContext = m_app_user_mem_table.find(current_context);
+
+    if (tempRootContext == m_app_user_mem_table.end())
+    {
+        tempRootContext = m_app_user_mem_table.insert(std::make_pair(current_context, new connhandle_user_mem_t())).first;
+    }
+
+    auto connHandleMap = tempRootContext->second;
+    auto connHandle = connHandleMap->find(conn_handle);
+
+    if (connHandle != connHandleMap->end())
+    {
+        delete connHandle->second;
+        connHandleMap->erase(conn_handle);
+    }
+    else if (connHandleMap->size() >= app_ble_gap_sec_context_conn_count_get())
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    auto userMem = new ser_ble_user_mem_t();
+    userMem->conn_handle = conn_handle;
+    userMem->conn_active = 1;
+    connHandleMap->insert(std::make_pair(conn_handle, userMem));
+
+    *pp_user_mem = userMem;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_ble_user_mem_context_destroy(uint16_t conn_handle)
+{
+    auto tempAdapter = m_app_user_mem_table.find(current_context);
+    if (tempAdapter == m_app_user_mem_table.end()) return NRF_ERROR_NOT_FOUND;
+
+    auto connHandleMap = tempAdapter->second;
+    auto connHandle = connHandleMap->find(conn_handle);
+
+    if (connHandle == connHandleMap->end()) return NRF_ERROR_NOT_FOUND;
+    delete connHandle->second; // Delete the ser_ble_user_mem_t
+    connHandleMap->erase(conn_handle);
+
+    return NRF_SUCCESS;
+}
+
+void app_ble_user_mem_context_root_destroy()
+{
+    auto tempAdapter = m_app_user_mem_table.find(current_context);
+    if (tempAdapter == m_app_user_mem_table.end()) return;
+
+    for (auto &connHandle : *tempAdapter->second)
+    {
+        delete connHandle.second;
+    }
+
+    delete tempAdapter->second;
+    m_app_user_mem_table.erase(tempAdapter);
+}
+
+uint32_t app_ble_user_mem_context_find(uint16_t conn_handle, ser_ble_user_mem_t **pp_user_mem)
+{
+    auto tempAdapter = m_app_user_mem_table.find(current_context);
+    if (tempAdapter == m_app_user_mem_table.end()) return NRF_ERROR_NOT_FOUND;
+
+    auto connHandleMap = tempAdapter->second;
+    auto connHandle = connHandleMap->find(conn_handle);
+
+    if (connHandle == connHandleMap->end()) return NRF_ERROR_NOT_FOUND;
+    *pp_user_mem = connHandle->second;
+    return NRF_SUCCESS;
+}
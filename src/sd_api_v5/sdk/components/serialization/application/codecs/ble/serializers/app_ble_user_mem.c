@@ -64,6 +64,22 @@ uint32_t app_ble_user_mem_context_create(uint16_t conn_handle, uint32_t *p_index
   return err_code;
 }
 
+uint32_t app_ble_user_mem_context_block_set(uint32_t index, ble_user_mem_block_t const * p_mem_block)
+{
+  if (p_mem_block == NULL)
+  {
+    return NRF_ERROR_NULL;
+  }
+
+  if (index >= SER_MAX_CONNECTIONS)
+  {
+    return NRF_ERROR_INVALID_PARAM;
+  }
+
+  m_app_user_mem_table[index].mem_block = *p_mem_block;
+  return NRF_SUCCESS;
+}
+
 uint32_t app_ble_user_mem_context_destroy(uint16_t conn_handle)
 {
   uint32_t err_code = NRF_ERROR_NOT_FOUND;
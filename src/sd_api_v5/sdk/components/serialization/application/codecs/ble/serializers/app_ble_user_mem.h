@@ -80,6 +80,17 @@ typedef struct
  */
 uint32_t app_ble_user_mem_context_create(uint16_t conn_handle, uint32_t *p_index);
 
+/**@brief Sets the user memory block of an instance allocated in m_user_mem_table[].
+ *
+ * @param[in]     index               Index of the instance, as returned by @ref app_ble_user_mem_context_create.
+ * @param[in]     p_mem_block         User memory block, copied to the instance.
+ *
+ * @retval NRF_SUCCESS                Block set.
+ * @retval NRF_ERROR_NULL             p_mem_block is NULL.
+ * @retval NRF_ERROR_INVALID_PARAM    Index out of range.
+ */
+uint32_t app_ble_user_mem_context_block_set(uint32_t index, ble_user_mem_block_t const * p_mem_block);
+
 /**@brief Release instance identified by a connection handle.
  *
  * @param[in]     conn_handle         conn_handle
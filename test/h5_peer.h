@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef H5_PEER_H
+#define H5_PEER_H
+
+#include "h5.h"
+#include "slip.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+/**
+ * @brief Stand-in for the connectivity firmware on the far end of a pseudo terminal. It answers the
+ * link establishment of the three wire protocol, acknowledges reliable packets and keeps their payloads.
+ * The host opens the port returned by portNameGet() like a serial port.
+ */
+class H5Peer
+{
+public:
+    static const uint8_t xonCharacter = 0x11;
+    static const uint8_t xoffCharacter = 0x13;
+
+    H5Peer() : outOfFrameFlowControlSupported(false), unreliableLaneSupported(false), baudRate(0),
+        master(-1), running(false), flowControlActive(false), seqNum(0), ackNum(0),
+        resetCount(0), flowControlCharacterCount(0)
+    {}
+
+    ~H5Peer()
+    {
+        close();
+    }
+
+    // Capabilities echoed in the SYNC CONFIG RESPONSE, set before the host opens the port
+    bool outOfFrameFlowControlSupported;
+    bool unreliableLaneSupported;
+
+    // Baud rate the stand-in listens at, i.e. B115200, frames sent at another rate are not understood.
+    // The host rate is read from the terminal settings of the pseudo terminal. 0 listens at any rate.
+    speed_t baudRate;
+
+    bool open()
+    {
+        master = posix_openpt(O_RDWR | O_NOCTTY);
+
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+        {
+            return false;
+        }
+
+        portName = ptsname(master);
+
+        struct termios settings;
+        tcgetattr(master, &settings);
+        cfmakeraw(&settings);
+        tcsetattr(master, TCSANOW, &settings);
+
+        running = true;
+        reader = std::thread([this] { readRunner(); });
+        return true;
+    }
+
+    void close()
+    {
+        running = false;
+
+        if (reader.joinable())
+        {
+            reader.join();
+        }
+
+        if (master >= 0)
+        {
+            ::close(master);
+            master = -1;
+        }
+    }
+
+    std::string portNameGet() const
+    {
+        return portName;
+    }
+
+    /**@brief Returns the terminal settings of the host side of the pseudo terminal. */
+    struct termios hostSettingsGet() const
+    {
+        struct termios settings;
+        tcgetattr(master, &settings);
+        return settings;
+    }
+
+    /**@brief Returns the baud rate the host has set on its side of the pseudo terminal, i.e. B115200. */
+    speed_t hostBaudRateGet() const
+    {
+        const auto settings = hostSettingsGet();
+        return cfgetospeed(&settings);
+    }
+
+    /**@brief Writes bytes to the host as they are, XON and XOFF included. */
+    void rawWrite(const std::vector<uint8_t> &data)
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        (void) ::write(master, data.data(), data.size());
+    }
+
+    /**@brief Sends a reliable vendor specific packet, without waiting for the acknowledgement. */
+    void reliableSend(std::vector<uint8_t> payload)
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        packetSend(payload, seqNum, ackNum, true, true, VENDOR_SPECIFIC_PACKET);
+        seqNum = (seqNum + 1) & 0x07;
+    }
+
+    /**@brief Sends an unreliable vendor specific packet with the given sequence number. */
+    void unreliableSend(std::vector<uint8_t> payload, uint8_t seq)
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        packetSend(payload, seq, ackNum, true, false, VENDOR_SPECIFIC_PACKET);
+    }
+
+    /**@brief Waits until count reliable packets from the host have been received. */
+    bool receivedWait(size_t count, std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        return receivedCondition.wait_for(lock, timeout, [&] { return received.size() >= count; });
+    }
+
+    std::vector<std::vector<uint8_t>> receivedGet()
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        return received;
+    }
+
+    uint32_t resetCountGet() const
+    {
+        return resetCount;
+    }
+
+    /**@brief Returns the number of XON and XOFF characters the host has sent unescaped since flow control was enabled. */
+    uint32_t flowControlCharacterCountGet() const
+    {
+        return flowControlCharacterCount;
+    }
+
+private:
+    void readRunner()
+    {
+        std::vector<uint8_t> frame;
+        uint8_t buffer[256];
+
+        while (running)
+        {
+            struct pollfd pfd = { master, POLLIN, 0 };
+
+            if (poll(&pfd, 1, 20) <= 0)
+            {
+                continue;
+            }
+
+            auto length = ::read(master, buffer, sizeof(buffer));
+
+            if (length <= 0)
+            {
+                continue;
+            }
+
+            for (ssize_t i = 0; i < length; i++)
+            {
+                if (flowControlActive && (buffer[i] == xonCharacter || buffer[i] == xoffCharacter))
+                {
+                    flowControlCharacterCount++;
+                }
+
+                if (buffer[i] != 0xC0)
+                {
+                    if (!frame.empty())
+                    {
+                        frame.push_back(buffer[i]);
+                    }
+
+                    continue;
+                }
+
+                if (frame.size() > 1)
+                {
+                    frame.push_back(buffer[i]);
+                    frameProcess(frame);
+                    frame.clear();
+                }
+                else
+                {
+                    frame.assign(1, 0xC0);
+                }
+            }
+        }
+    }
+
+    void frameProcess(std::vector<uint8_t> &frame)
+    {
+        std::vector<uint8_t> packet;
+        std::vector<uint8_t> payload;
+        uint8_t seq;
+        uint8_t ack;
+        bool reliable;
+        h5_pkt_type_t type;
+
+        if (baudRate != 0 && hostBaudRateGet() != baudRate)
+        {
+            return;
+        }
+
+        if (slip_decode(frame, packet) != 0 ||
+            h5_decode(packet, payload, &seq, &ack, nullptr, nullptr, nullptr, &reliable, &type) != 0)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(stateMutex);
+
+        if (type == RESET_PACKET)
+        {
+            resetCount++;
+            seqNum = 0;
+            ackNum = 0;
+            flowControlActive = false;
+        }
+        else if (type == LINK_CONTROL_PACKET && payload.size() >= 2)
+        {
+            if (payload[0] == 0x01 && payload[1] == 0x7E)
+            {
+                packetSend({ 0x02, 0x7D }, 0, 0, false, false, LINK_CONTROL_PACKET);
+            }
+            else if (payload[0] == 0x03 && payload[1] == 0xFC && payload.size() >= 3)
+            {
+                // Only what both sides support is echoed, extra bytes are ignored unless the lane is known
+                std::vector<uint8_t> response = { 0x04, 0x7B, 0x11 };
+                const bool outOfFrame = outOfFrameFlowControlSupported && (payload[2] & 0x08);
+
+                if (outOfFrame)
+                {
+                    response[2] |= 0x08;
+                }
+
+                if (unreliableLaneSupported && payload.size() >= 4 && (payload[3] & 0x01))
+                {
+                    response.push_back(0x01);
+                }
+
+                packetSend(response, 0, 0, false, false, LINK_CONTROL_PACKET);
+                flowControlActive = outOfFrame;
+            }
+        }
+        else if (type == VENDOR_SPECIFIC_PACKET && reliable)
+        {
+            if (seq == ackNum)
+            {
+                ackNum = (ackNum + 1) & 0x07;
+                received.push_back(payload);
+                receivedCondition.notify_all();
+            }
+
+            packetSend({}, 0, ackNum, false, false, ACK_PACKET);
+        }
+    }
+
+    void packetSend(std::vector<uint8_t> payload, uint8_t seq, uint8_t ack, bool crc, bool reliable, h5_pkt_type_t type)
+    {
+        std::vector<uint8_t> packet;
+        std::vector<uint8_t> frame;
+
+        h5_encode(payload, packet, seq, ack, crc, reliable, type);
+        slip_encode(packet, frame, flowControlActive);
+        rawWrite(frame);
+    }
+
+    int master;
+    std::string portName;
+    std::thread reader;
+    std::atomic<bool> running;
+
+    std::mutex writeMutex;
+    std::mutex stateMutex;
+    std::condition_variable receivedCondition;
+    std::atomic<bool> flowControlActive;
+    uint8_t seqNum;
+    uint8_t ackNum;
+    std::vector<std::vector<uint8_t>> received;
+
+    std::atomic<uint32_t> resetCount;
+    std::atomic<uint32_t> flowControlCharacterCount;
+};
+
+#endif // H5_PEER_H
@@ -0,0 +1,492 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Subscribes to the event bridge over loopback sockets and checks the batches, filters, credit and
+// drop accounting against the events queued.
+
+#include "event_bridge.h"
+
+#include "nrf_error.h"
+
+#include <boost/asio.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if BOOST_VERSION >= 106600
+typedef boost::asio::io_context test_io_context;
+#else
+typedef boost::asio::io_service test_io_context;
+#endif
+
+using boost::asio::ip::tcp;
+
+namespace
+{
+    uint32_t failureCount = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            failureCount++;
+        }
+    }
+
+    const uint8_t MESSAGE_HELLO = 0x00;
+    const uint8_t MESSAGE_SUBSCRIBE = 0x01;
+    const uint8_t MESSAGE_CREDIT = 0x02;
+    const uint8_t MESSAGE_BATCH = 0x10;
+    const uint8_t MESSAGE_BATCH_COMPRESSED = 0x11;
+
+    const uint8_t CONTENT_FRAME = 0x01;
+    const uint8_t CONTENT_DECODED = 0x02;
+
+    // Content, event id, time and length preceding each event of a batch
+    const size_t ENTRY_HEADER_SIZE = 13;
+
+    // Sequence number, dropped events and event count following the message type of a batch
+    const size_t BATCH_HEADER_SIZE = 11;
+
+    uint16_t uint16Get(const uint8_t *data)
+    {
+        return static_cast<uint16_t>(data[0] | (data[1] << 8));
+    }
+
+    uint32_t uint32Get(const uint8_t *data)
+    {
+        return static_cast<uint32_t>(data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24));
+    }
+
+    void uint16Put(std::vector<uint8_t> &data, const uint16_t value)
+    {
+        data.push_back(static_cast<uint8_t>(value));
+        data.push_back(static_cast<uint8_t>(value >> 8));
+    }
+
+    void uint32Put(std::vector<uint8_t> &data, const uint32_t value)
+    {
+        for (auto shift = 0; shift < 32; shift += 8)
+        {
+            data.push_back(static_cast<uint8_t>(value >> shift));
+        }
+    }
+
+    struct Event
+    {
+        uint8_t content;
+        uint16_t eventId;
+        std::vector<uint8_t> data;
+    };
+
+    struct Batch
+    {
+        uint8_t type;
+        uint32_t sequence;
+        uint32_t dropped;
+        std::vector<Event> events;
+    };
+
+    /**@brief Reads exactly length bytes, false if they have not arrived within two seconds. */
+    template<typename Socket>
+    bool readWait(Socket &socket, uint8_t *data, const size_t length)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+
+        while (socket.available() < length)
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        boost::asio::read(socket, boost::asio::buffer(data, length));
+        return true;
+    }
+
+    /**@brief Reads a message without its length, empty if none arrived. */
+    template<typename Socket>
+    std::vector<uint8_t> messageRead(Socket &socket)
+    {
+        uint8_t length[4];
+
+        if (!readWait(socket, length, sizeof(length)))
+        {
+            return std::vector<uint8_t>();
+        }
+
+        std::vector<uint8_t> message(uint32Get(length));
+
+        if (!readWait(socket, message.data(), message.size()))
+        {
+            return std::vector<uint8_t>();
+        }
+
+        return message;
+    }
+
+    template<typename Socket>
+    void messageWrite(Socket &socket, const std::vector<uint8_t> &message)
+    {
+        std::vector<uint8_t> data;
+        uint32Put(data, static_cast<uint32_t>(message.size()));
+        data.insert(data.end(), message.begin(), message.end());
+        boost::asio::write(socket, boost::asio::buffer(data));
+    }
+
+    template<typename Socket>
+    void subscribe(Socket &socket, const uint8_t content, const uint32_t credit, const std::vector<std::pair<uint16_t, uint16_t>> &filters)
+    {
+        std::vector<uint8_t> message = { MESSAGE_SUBSCRIBE, content, 0 };
+        uint32Put(message, credit);
+        uint16Put(message, static_cast<uint16_t>(filters.size()));
+
+        for (const auto &filter : filters)
+        {
+            uint16Put(message, filter.first);
+            uint16Put(message, filter.second);
+        }
+
+        messageWrite(socket, message);
+    }
+
+    template<typename Socket>
+    void creditGrant(Socket &socket, const uint32_t credit)
+    {
+        std::vector<uint8_t> message = { MESSAGE_CREDIT };
+        uint32Put(message, credit);
+        messageWrite(socket, message);
+    }
+
+    template<typename Socket>
+    bool batchRead(Socket &socket, Batch &batch)
+    {
+        const auto message = messageRead(socket);
+
+        if (message.size() < BATCH_HEADER_SIZE || message[0] != MESSAGE_BATCH)
+        {
+            return false;
+        }
+
+        batch.type = message[0];
+        batch.sequence = uint32Get(&message[1]);
+        batch.dropped = uint32Get(&message[5]);
+        batch.events.clear();
+
+        const auto count = uint16Get(&message[9]);
+        size_t index = BATCH_HEADER_SIZE;
+
+        for (uint16_t i = 0; i < count; i++)
+        {
+            if (index + ENTRY_HEADER_SIZE > message.size())
+            {
+                return false;
+            }
+
+            Event event;
+            event.content = message[index];
+            event.eventId = uint16Get(&message[index + 1]);
+            const auto length = uint16Get(&message[index + 11]);
+            index += ENTRY_HEADER_SIZE;
+
+            if (index + length > message.size())
+            {
+                return false;
+            }
+
+            event.data.assign(message.begin() + index, message.begin() + index + length);
+            batch.events.push_back(event);
+            index += length;
+        }
+
+        return index == message.size();
+    }
+
+    /**@brief Queues a decoded event with the index of the event as its payload. */
+    void eventProcess(EventBridge &bridge, const uint16_t eventId, const uint32_t index)
+    {
+        std::vector<uint8_t> buffer(sizeof(ble_evt_t));
+        auto event = reinterpret_cast<ble_evt_t *>(buffer.data());
+        event->header.evt_id = eventId;
+        event->header.evt_len = sizeof(index);
+        std::memcpy(buffer.data() + sizeof(ble_evt_hdr_t), &index, sizeof(index));
+        bridge.process(event);
+    }
+
+    uint32_t eventIndexGet(const Event &event)
+    {
+        uint32_t index = 0;
+
+        if (event.data.size() == sizeof(ble_evt_hdr_t) + sizeof(index))
+        {
+            std::memcpy(&index, event.data.data() + sizeof(ble_evt_hdr_t), sizeof(index));
+        }
+
+        return index;
+    }
+
+    // Time for the IO service thread of the bridge to handle a message of a subscriber
+    void settle()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    void tcpRun()
+    {
+        EventBridge bridge;
+        sd_rpc_event_bridge_params_t params = { SD_RPC_EVENT_BRIDGE_TCP, "127.0.0.1", 0, 4, 10, 20, 4 };
+        check(bridge.start(&params) == NRF_SUCCESS, "bridge started on TCP");
+
+        sd_rpc_event_bridge_info_t info;
+        check(bridge.infoGet(&info) == NRF_SUCCESS && info.port != 0, "listening port picked");
+
+        test_io_context service;
+        tcp::socket all(service);
+        tcp::socket filtered(service);
+        const tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), info.port);
+        all.connect(endpoint);
+        filtered.connect(endpoint);
+
+        auto hello = messageRead(all);
+        check(hello.size() == 3 && hello[0] == MESSAGE_HELLO && hello[1] == 1, "HELLO received");
+        check(messageRead(filtered).size() == 3, "HELLO received by the second subscriber");
+
+        // Nothing is sent before a subscriber has subscribed
+        eventProcess(bridge, 0x10, 0);
+        settle();
+        check(all.available() == 0, "no batch before SUBSCRIBE");
+
+        subscribe(all, CONTENT_FRAME | CONTENT_DECODED, 1000, {});
+        subscribe(filtered, CONTENT_DECODED, 1, { { 0x10, 0x10 } });
+        settle();
+
+        bridge.infoGet(&info);
+        check(info.subscriber_count == 2, "two subscribers counted");
+
+        // Frames from the read path and decoded events alternate between two event ids
+        const uint32_t eventCount = 100;
+        const std::vector<uint8_t> frame = { 0x11, 0x00, 0xAA, 0xBB };
+        bridge.framePeek(frame.data(), static_cast<uint32_t>(frame.size()));
+
+        for (uint32_t i = 0; i < eventCount; i++)
+        {
+            eventProcess(bridge, (i % 2) == 0 ? 0x10 : 0x11, i);
+
+            // Paced so that the queue of a subscriber with credit never fills up while a batch is written
+            if ((i + 1) % params.batch_size == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }
+
+        std::vector<Event> received;
+        Batch batch;
+        uint32_t sequence = 0;
+        bool ordered = true;
+
+        while (received.size() < eventCount + 1 && batchRead(all, batch))
+        {
+            ordered = ordered && (sequence == 0 || batch.sequence > sequence) && batch.events.size() <= params.batch_size;
+            sequence = batch.sequence;
+            check(batch.dropped == 0, "nothing dropped with enough credit");
+            received.insert(received.end(), batch.events.begin(), batch.events.end());
+        }
+
+        check(received.size() == eventCount + 1, "all events received");
+        check(ordered, "batches in sequence and within the batch size");
+
+        if (received.size() == eventCount + 1)
+        {
+            check(received[0].content == CONTENT_FRAME && received[0].eventId == 0x0011 && received[0].data == frame,
+                  "frame passed on as read");
+
+            bool intact = true;
+
+            for (uint32_t i = 0; i < eventCount; i++)
+            {
+                const auto &event = received[i + 1];
+                intact = intact && event.content == CONTENT_DECODED && eventIndexGet(event) == i
+                    && event.eventId == ((i % 2) == 0 ? 0x10 : 0x11);
+            }
+
+            check(intact, "decoded events passed on in order");
+        }
+
+        // The filtered subscriber only gets event 0x10, one batch for its single credit
+        check(batchRead(filtered, batch), "filtered subscriber receives a batch");
+        bool matching = !batch.events.empty();
+
+        for (const auto &event : batch.events)
+        {
+            matching = matching && event.eventId == 0x10;
+        }
+
+        check(matching, "filter applied");
+        const auto firstBatchCount = batch.events.size();
+
+        settle();
+        check(filtered.available() == 0, "no batch without credit");
+
+        // Batches queued without credit beyond the queue size are dropped and reported in the next batch
+        creditGrant(filtered, 100);
+        uint32_t delivered = static_cast<uint32_t>(firstBatchCount);
+        uint32_t dropped = 0;
+
+        while (delivered + dropped < eventCount / 2 && batchRead(filtered, batch))
+        {
+            delivered += static_cast<uint32_t>(batch.events.size());
+            dropped += batch.dropped;
+        }
+
+        check(dropped > 0, "events dropped while the queue was full");
+        check(delivered + dropped == eventCount / 2, "dropped events accounted for");
+
+        bridge.infoGet(&info);
+        check(info.events_dropped == dropped, "drops counted in the statistics");
+        check(info.events_sent == eventCount + 1 + delivered, "events sent counted per subscriber");
+
+        all.close();
+        settle();
+        bridge.infoGet(&info);
+        check(info.subscriber_count == 1, "closed subscriber removed");
+
+        check(bridge.stop() == NRF_SUCCESS, "bridge stopped");
+    }
+
+    void compressedRun()
+    {
+        EventBridge bridge;
+        sd_rpc_event_bridge_params_t params = { SD_RPC_EVENT_BRIDGE_TCP, "127.0.0.1", 0, 1, 4, 20, 2 };
+        check(bridge.start(&params) == NRF_SUCCESS, "bridge started for compression");
+
+        sd_rpc_event_bridge_info_t info;
+        bridge.infoGet(&info);
+
+        test_io_context service;
+        tcp::socket socket(service);
+        socket.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), info.port));
+
+        const auto hello = messageRead(socket);
+        const bool compression = hello.size() == 3 && (hello[2] & 0x01) != 0;
+
+        std::vector<uint8_t> message = { MESSAGE_SUBSCRIBE, CONTENT_DECODED, 0x01 };
+        uint32Put(message, 10);
+        uint16Put(message, 0);
+        messageWrite(socket, message);
+        settle();
+
+        for (uint32_t i = 0; i < params.batch_size; i++)
+        {
+            eventProcess(bridge, 0x10, i);
+        }
+
+        // Without zlib the bridge falls back to plain batches
+        const auto batch = messageRead(socket);
+        const auto expectedLength = params.batch_size * (ENTRY_HEADER_SIZE + sizeof(ble_evt_hdr_t) + sizeof(uint32_t));
+
+        if (compression)
+        {
+            check(batch.size() > BATCH_HEADER_SIZE + 4 && batch[0] == MESSAGE_BATCH_COMPRESSED, "compressed batch received");
+            check(batch.size() > BATCH_HEADER_SIZE + 4 && uint32Get(&batch[BATCH_HEADER_SIZE]) == expectedLength,
+                  "uncompressed length of the batch");
+        }
+        else
+        {
+            check(batch.size() == BATCH_HEADER_SIZE + expectedLength && batch[0] == MESSAGE_BATCH,
+                  "plain batch received without compression");
+        }
+
+        check(bridge.stop() == NRF_SUCCESS, "bridge stopped");
+    }
+
+#ifndef _WIN32
+    void unixRun()
+    {
+        const std::string path = "/tmp/test_event_bridge_" + std::to_string(getpid()) + ".sock";
+
+        EventBridge bridge;
+        sd_rpc_event_bridge_params_t params = { SD_RPC_EVENT_BRIDGE_UNIX, path.c_str(), 0, 1, 4, 20, 2 };
+        check(bridge.start(&params) == NRF_SUCCESS, "bridge started on a Unix domain socket");
+
+        test_io_context service;
+        boost::asio::local::stream_protocol::socket socket(service);
+        socket.connect(boost::asio::local::stream_protocol::endpoint(path));
+
+        const auto hello = messageRead(socket);
+        check(hello.size() == 3 && hello[0] == MESSAGE_HELLO, "HELLO received on the Unix domain socket");
+
+        subscribe(socket, CONTENT_DECODED, 1, {});
+        settle();
+        eventProcess(bridge, 0x10, 7);
+
+        // A partial batch is sent once the batch delay has passed
+        Batch batch;
+        check(batchRead(socket, batch) && batch.events.size() == 1 && eventIndexGet(batch.events[0]) == 7,
+              "event sent after the batch delay");
+
+        // The bridge can not be started twice
+        check(bridge.start(&params) == NRF_ERROR_INVALID_STATE, "second start refused");
+        check(bridge.stop() == NRF_SUCCESS, "bridge stopped");
+    }
+#endif
+}
+
+int main()
+{
+    tcpRun();
+    compressedRun();
+#ifndef _WIN32
+    unixRun();
+#endif
+
+    if (failureCount != 0)
+    {
+        std::cerr << failureCount << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Event bridge passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Detects the baud rate of a firmware stand-in on a pseudo terminal that only answers at its own rate.
+
+#include "h5_peer.h"
+
+#include "h5_transport.h"
+#include "uart_boost.h"
+#include "nrf_error.h"
+
+#include <iostream>
+
+namespace
+{
+    uint32_t failureCount = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            failureCount++;
+        }
+    }
+
+    const uint32_t configuredBaudRate = 1000000;
+
+    H5Transport *hostCreate(H5Peer &peer, const uint32_t *baudRates, const uint8_t baudRateCount)
+    {
+        UartCommunicationParameters parameters;
+        auto portName = peer.portNameGet();
+        parameters.portName = portName.c_str();
+        parameters.baudRate = configuredBaudRate;
+        parameters.flowControl = UartFlowControlNone;
+        parameters.parity = UartParityNone;
+        parameters.stopBits = UartStopBitsOne;
+        parameters.dataBits = UartDataBitsEight;
+
+        auto host = new H5Transport(new UartBoost(parameters), 250);
+        check(host->baudRateDetectEnable(true, baudRates, baudRateCount) == NRF_SUCCESS, "baud rate detection enabled");
+        return host;
+    }
+
+    uint32_t hostOpen(H5Transport *host)
+    {
+        return host->open(
+            [](sd_rpc_app_status_t, const char *) {},
+            [](uint8_t *, size_t) {},
+            [](sd_rpc_log_severity_t, std::string) {});
+    }
+
+    sd_rpc_baud_rate_detect_info_t infoGet(H5Transport *host)
+    {
+        sd_rpc_baud_rate_detect_info_t info = {};
+        check(host->baudRateDetectInfoGet(&info) == NRF_SUCCESS, "detection info read");
+        return info;
+    }
+
+    void slowerPeerRun()
+    {
+        // The peer listens at a lower rate than configured, it is found after two rates without an answer
+        H5Peer peer;
+        peer.baudRate = B115200;
+        check(peer.open(), "pseudo terminal opened");
+
+        const uint32_t baudRates[] = { 1000000, 460800, 115200, 9600 };
+        auto host = hostCreate(peer, baudRates, 4);
+        check(hostOpen(host) == NRF_SUCCESS, "link established at the detected rate");
+
+        const auto info = infoGet(host);
+        check(info.detected, "baud rate detected");
+        check(info.baud_rate == 115200, "peer rate kept");
+        check(info.probed_count == 3, "rates probed until the peer answered");
+        check(peer.hostBaudRateGet() == B115200, "host port left at the peer rate");
+
+        // The link works at the detected rate
+        std::vector<uint8_t> data = { 0x01, 0x02 };
+        check(host->send(data) == NRF_SUCCESS, "send at the detected rate");
+        check(peer.receivedWait(1, std::chrono::seconds(1)), "peer receives at the detected rate");
+
+        host->close();
+        delete host;
+    }
+
+    void configuredPeerRun()
+    {
+        // The default list starts with the fastest rate, a peer at the configured rate answers at once
+        H5Peer peer;
+        peer.baudRate = B1000000;
+        check(peer.open(), "pseudo terminal opened");
+
+        auto host = hostCreate(peer, nullptr, 0);
+        check(hostOpen(host) == NRF_SUCCESS, "link established at the configured rate");
+
+        const auto info = infoGet(host);
+        check(info.detected && info.baud_rate == configuredBaudRate, "configured rate detected");
+        check(info.probed_count == 1, "one rate probed");
+
+        host->close();
+        delete host;
+    }
+
+    void silentPeerRun()
+    {
+        // Nothing answers at the rates probed, the configured rate is restored before the link is reset
+        H5Peer peer;
+        peer.baudRate = B9600;
+        check(peer.open(), "pseudo terminal opened");
+
+        const uint32_t baudRates[] = { 460800, 115200 };
+        auto host = hostCreate(peer, baudRates, 2);
+        check(hostOpen(host) != NRF_SUCCESS, "no link without a rate the peer answers at");
+
+        const auto info = infoGet(host);
+        check(!info.detected, "no rate detected");
+        check(info.baud_rate == configuredBaudRate, "configured rate reported");
+        check(info.probed_count == 2, "all rates probed");
+        check(peer.hostBaudRateGet() == B1000000, "host port back at the configured rate");
+
+        host->close();
+        delete host;
+    }
+}
+
+int main()
+{
+    slowerPeerRun();
+    configuredPeerRun();
+    silentPeerRun();
+
+    if (failureCount != 0)
+    {
+        std::cerr << failureCount << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Baud rate detection passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Runs the H5 link with out-of-frame software flow control against a firmware stand-in on a pseudo
+// terminal. The stand-in plays a slow reader that holds the host back with XOFF.
+
+#include "h5_peer.h"
+
+#include "h5_transport.h"
+#include "uart_boost.h"
+#include "nrf_error.h"
+
+#include <future>
+#include <iostream>
+
+namespace
+{
+    uint32_t failureCount = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            failureCount++;
+        }
+    }
+
+    std::mutex hostMutex;
+    std::condition_variable hostCondition;
+    std::vector<std::vector<uint8_t>> hostReceived;
+
+    bool hostReceivedWait(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(hostMutex);
+        return hostCondition.wait_for(lock, std::chrono::seconds(2), [&] { return hostReceived.size() >= count; });
+    }
+
+    H5Transport *hostOpen(H5Peer &peer)
+    {
+        UartCommunicationParameters parameters;
+        auto portName = peer.portNameGet();
+        parameters.portName = portName.c_str();
+        parameters.baudRate = 1000000;
+        parameters.flowControl = UartFlowControlSoftware;
+        parameters.parity = UartParityNone;
+        parameters.stopBits = UartStopBitsOne;
+        parameters.dataBits = UartDataBitsEight;
+
+        auto host = new H5Transport(new UartBoost(parameters), 250);
+
+        {
+            std::lock_guard<std::mutex> lock(hostMutex);
+            hostReceived.clear();
+        }
+
+        auto errCode = host->open(
+            [](sd_rpc_app_status_t, const char *) {},
+            [](uint8_t *data, size_t length) {
+                std::lock_guard<std::mutex> lock(hostMutex);
+                hostReceived.emplace_back(data, data + length);
+                hostCondition.notify_all();
+            },
+            [](sd_rpc_log_severity_t, std::string) {});
+
+        check(errCode == NRF_SUCCESS, "link established");
+        return host;
+    }
+
+    // Payload with the flow control characters and the SLIP special characters in it
+    const std::vector<uint8_t> payload = { 0x11, 0x13, 0xC0, 0xDB, 0x11, 0x42, 0x13 };
+
+    void flowControlRun()
+    {
+        H5Peer peer;
+        peer.outOfFrameFlowControlSupported = true;
+        check(peer.open(), "pseudo terminal opened");
+
+        auto host = hostOpen(peer);
+        check((peer.hostSettingsGet().c_iflag & IXON) != 0, "serial port handles XON/XOFF after negotiation");
+
+        // Flow control characters in packets are escaped in both directions
+        auto data = payload;
+        check(host->send(data) == NRF_SUCCESS, "send with flow control characters");
+        check(peer.receivedWait(1, std::chrono::seconds(1)) && peer.receivedGet()[0] == payload, "peer receives payload intact");
+
+        peer.reliableSend(payload);
+        check(hostReceivedWait(1) && hostReceived[0] == payload, "host receives payload intact");
+
+        // The slow reader asks the host to hold back, nothing is written until it is ready again
+        peer.rawWrite({ H5Peer::xoffCharacter });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        auto sent = std::async(std::launch::async, [host] {
+            auto held = payload;
+            return host->send(held);
+        });
+
+        check(sent.wait_for(std::chrono::milliseconds(600)) == std::future_status::timeout, "send is held back by XOFF");
+        check(peer.receivedGet().size() == 1, "nothing written while held back");
+
+        peer.rawWrite({ H5Peer::xonCharacter });
+        check(sent.get() == NRF_SUCCESS, "send completes after XON");
+        check(peer.receivedWait(2, std::chrono::seconds(1)) && peer.receivedGet().size() == 2 && peer.receivedGet()[1] == payload,
+              "held back packet delivered once");
+
+        check(peer.flowControlCharacterCountGet() == 0, "no unescaped XON/XOFF written by the host");
+
+        host->close();
+        delete host;
+    }
+
+    void noFlowControlRun()
+    {
+        // A peer without out-of-frame flow control gets the flow control characters unescaped
+        H5Peer peer;
+        check(peer.open(), "pseudo terminal opened");
+
+        auto host = hostOpen(peer);
+        check((peer.hostSettingsGet().c_iflag & IXON) == 0, "serial port leaves XON/XOFF alone without negotiation");
+
+        auto data = payload;
+        check(host->send(data) == NRF_SUCCESS, "send without flow control");
+        check(peer.receivedWait(1, std::chrono::seconds(1)) && peer.receivedGet()[0] == payload, "peer receives payload intact");
+
+        peer.reliableSend(payload);
+        check(hostReceivedWait(1) && hostReceived[0] == payload, "host receives payload intact");
+
+        host->close();
+        delete host;
+    }
+}
+
+int main()
+{
+    flowControlRun();
+    noFlowControlRun();
+
+    if (failureCount != 0)
+    {
+        std::cerr << failureCount << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Out-of-frame flow control passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Negotiates the unreliable lane of the H5 link with a firmware stand-in on a pseudo terminal, and
+// counts the unreliable packets it loses.
+
+#include "h5_peer.h"
+
+#include "h5_transport.h"
+#include "uart_boost.h"
+#include "nrf_error.h"
+
+#include <iostream>
+
+namespace
+{
+    uint32_t failureCount = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            failureCount++;
+        }
+    }
+
+    std::mutex hostMutex;
+    std::condition_variable hostCondition;
+    std::vector<std::vector<uint8_t>> hostReceived;
+
+    bool hostReceivedWait(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(hostMutex);
+        return hostCondition.wait_for(lock, std::chrono::seconds(2), [&] { return hostReceived.size() >= count; });
+    }
+
+    size_t hostReceivedCount()
+    {
+        std::lock_guard<std::mutex> lock(hostMutex);
+        return hostReceived.size();
+    }
+
+    H5Transport *hostOpen(H5Peer &peer)
+    {
+        UartCommunicationParameters parameters;
+        auto portName = peer.portNameGet();
+        parameters.portName = portName.c_str();
+        parameters.baudRate = 1000000;
+        parameters.flowControl = UartFlowControlNone;
+        parameters.parity = UartParityNone;
+        parameters.stopBits = UartStopBitsOne;
+        parameters.dataBits = UartDataBitsEight;
+
+        auto host = new H5Transport(new UartBoost(parameters), 250);
+        check(host->unreliableLaneEnable(true) == NRF_SUCCESS, "unreliable lane requested");
+
+        {
+            std::lock_guard<std::mutex> lock(hostMutex);
+            hostReceived.clear();
+        }
+
+        auto errCode = host->open(
+            [](sd_rpc_app_status_t, const char *) {},
+            [](uint8_t *data, size_t length) {
+                std::lock_guard<std::mutex> lock(hostMutex);
+                hostReceived.emplace_back(data, data + length);
+                hostCondition.notify_all();
+            },
+            [](sd_rpc_log_severity_t, std::string) {});
+
+        check(errCode == NRF_SUCCESS, "link established");
+        return host;
+    }
+
+    sd_rpc_unreliable_lane_info_t infoGet(H5Transport *host)
+    {
+        sd_rpc_unreliable_lane_info_t info = {};
+        check(host->unreliableLaneInfoGet(&info) == NRF_SUCCESS, "unreliable lane info read");
+        return info;
+    }
+
+    void legacyPeerRun()
+    {
+        // A peer that does not know the lane ignores the capability byte of the SYNC CONFIG
+        H5Peer peer;
+        check(peer.open(), "pseudo terminal opened");
+
+        auto host = hostOpen(peer);
+        check(!infoGet(host).active, "lane not agreed with a legacy peer");
+
+        std::vector<uint8_t> data = { 0x01, 0x02, 0x03 };
+        check(host->send(data) == NRF_SUCCESS, "reliable send to a legacy peer");
+        check(peer.receivedWait(1, std::chrono::seconds(1)), "legacy peer receives reliable packet");
+
+        peer.reliableSend({ 0x04 });
+        check(hostReceivedWait(1), "host receives reliable packet from a legacy peer");
+
+        // Unreliable packets are not expected from a peer that has not agreed to the lane
+        peer.unreliableSend({ 0x05 }, 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        check(hostReceivedCount() == 1, "unreliable packet without the lane is not passed on");
+        check(infoGet(host).dropped_count == 1, "unreliable packet without the lane is counted as dropped");
+
+        host->close();
+        delete host;
+    }
+
+    void sequenceGapRun()
+    {
+        H5Peer peer;
+        peer.unreliableLaneSupported = true;
+        check(peer.open(), "pseudo terminal opened");
+
+        auto host = hostOpen(peer);
+        check(infoGet(host).active, "lane agreed with a peer that supports it");
+
+        // Packets 2 and 3 are lost on the way
+        peer.unreliableSend({ 0x10 }, 0);
+        peer.unreliableSend({ 0x11 }, 1);
+        peer.unreliableSend({ 0x14 }, 4);
+        peer.unreliableSend({ 0x15 }, 5);
+        check(hostReceivedWait(4), "host receives the unreliable packets sent");
+
+        {
+            std::lock_guard<std::mutex> lock(hostMutex);
+            check(hostReceived.size() == 4 && hostReceived[2] == std::vector<uint8_t>({ 0x14 }), "unreliable packets passed on in order");
+        }
+
+        auto info = infoGet(host);
+        check(info.received_count == 4, "unreliable packets counted as received");
+        check(info.dropped_count == 2, "sequence gap counted as dropped packets");
+
+        // The sequence number wraps without a gap
+        peer.unreliableSend({ 0x16 }, 6);
+        peer.unreliableSend({ 0x17 }, 7);
+        peer.unreliableSend({ 0x18 }, 0);
+        check(hostReceivedWait(7), "host receives the packets around the wrap");
+        check(infoGet(host).dropped_count == 2, "no drop counted on the sequence number wrap");
+
+        // Unreliable packets are not acknowledged, reliable traffic carries on alongside them
+        std::vector<uint8_t> data = { 0x20 };
+        check(host->send(data) == NRF_SUCCESS, "reliable send alongside the lane");
+        check(peer.receivedWait(1, std::chrono::seconds(1)), "peer receives reliable packet");
+
+        host->close();
+        delete host;
+    }
+}
+
+int main()
+{
+    legacyPeerRun();
+    sequenceGapRun();
+
+    if (failureCount != 0)
+    {
+        std::cerr << failureCount << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Unreliable lane passed" << std::endl;
+    return 0;
+}
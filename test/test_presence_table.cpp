@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Fills the presence table with advertising reports and checks that the devices leave after the
+// timeout without further reports, and that the table can be stopped from its presence handler.
+
+#include "presence_table.h"
+
+#include "nrf_error.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const uint32_t DEVICE_COUNT = 2000;
+    const uint32_t TIMEOUT_MS = 200;
+
+    std::shared_ptr<PresenceTable> table;
+    std::mutex presenceMutex;
+    std::condition_variable presenceCondition;
+    uint32_t enteredCount = 0;
+    uint32_t leftCount = 0;
+    bool stopOnLeave = false;
+    uint32_t failureCount = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            failureCount++;
+        }
+    }
+
+    void presenceHandler(adapter_t *, const sd_rpc_presence_entry_t *, bool present)
+    {
+        if (!present && stopOnLeave)
+        {
+            table->stop();
+        }
+
+        std::lock_guard<std::mutex> lock(presenceMutex);
+        (present ? enteredCount : leftCount)++;
+        presenceCondition.notify_all();
+    }
+
+    bool countsWait(const uint32_t entered, const uint32_t left, const std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(presenceMutex);
+        return presenceCondition.wait_for(lock, timeout, [&] { return enteredCount >= entered && leftCount >= left; });
+    }
+
+    void reportSend(const uint32_t device)
+    {
+        ble_evt_t event;
+        std::memset(&event, 0, sizeof(event));
+        event.header.evt_id = BLE_GAP_EVT_ADV_REPORT;
+
+        auto &report = event.evt.gap_evt.params.adv_report;
+        report.peer_addr.addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC;
+        std::memcpy(report.peer_addr.addr, &device, sizeof(device));
+        report.rssi = -60;
+        report.dlen = 3;
+
+        adapter_t adapter;
+        adapter.internal = nullptr;
+        table->process(&adapter, &event);
+    }
+
+    uint32_t snapshotSizeGet()
+    {
+        std::vector<sd_rpc_presence_entry_t> entries(DEVICE_COUNT);
+        auto count = static_cast<uint32_t>(entries.size());
+        return table->snapshotGet(entries.data(), &count, nullptr) == NRF_SUCCESS ? count : UINT32_MAX;
+    }
+}
+
+int main()
+{
+    table = std::make_shared<PresenceTable>();
+
+    sd_rpc_presence_params_t params = {};
+    params.timeout_ms = TIMEOUT_MS;
+    params.snapshot_interval_ms = 0;
+    params.initial_capacity = 16;
+    params.rssi_smoothing = 31;
+
+    check(table->start(nullptr, &params, presenceHandler) == NRF_ERROR_INVALID_PARAM, "RSSI smoothing beyond 15 is refused");
+
+    params.rssi_smoothing = 15;
+    check(table->start(nullptr, &params, presenceHandler) == NRF_SUCCESS, "start");
+
+    for (uint32_t device = 0; device < DEVICE_COUNT; device++)
+    {
+        reportSend(device);
+        reportSend(device);
+    }
+
+    check(countsWait(DEVICE_COUNT, 0, std::chrono::seconds(5)), "all devices entered");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    check(snapshotSizeGet() == DEVICE_COUNT, "snapshot published for the entered devices");
+
+    // No reports are received any more, the devices leave on the sweeps of the presence thread
+    check(countsWait(DEVICE_COUNT, DEVICE_COUNT, std::chrono::milliseconds(TIMEOUT_MS * 10)), "all devices left without reports");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    check(snapshotSizeGet() == 0, "snapshot published for the left devices");
+
+    // Stopping from the handler, and dropping the table while the handler returns, is safe
+    stopOnLeave = true;
+    check(table->start(nullptr, &params, presenceHandler) == NRF_SUCCESS, "start again");
+    reportSend(0);
+    check(countsWait(DEVICE_COUNT + 1, DEVICE_COUNT + 1, std::chrono::milliseconds(TIMEOUT_MS * 10)), "device left after start again");
+    table.reset();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    if (failureCount > 0)
+    {
+        std::cerr << failureCount << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Presence table expiry passed" << std::endl;
+    return 0;
+}
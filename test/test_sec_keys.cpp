@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Runs security procedures on several links of two adapters at the same time against a simulated
+// connectivity chip, and checks that the keys of each link end up in the keyset of that link.
+
+#include "sd_rpc.h"
+#include "serialization_transport.h"
+#include "ble_common.h"
+
+#include "app_ble_gap_sec_keys.h"
+#include "ble_gap_struct_serialization.h"
+#include "ble_serialization.h"
+#include "app_util.h"
+#include "ser_config.h"
+#include "ble_hci.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Answers every command with NRF_SUCCESS and sends the events asked for, like the connectivity chip would
+    class SimulatedConnectivity : public Transport
+    {
+    public:
+        SimulatedConnectivity()
+        {
+            timerWheel.start([] {});
+        }
+
+        ~SimulatedConnectivity()
+        {
+            timerWheel.stop();
+        }
+
+        uint32_t send(std::vector<uint8_t> &data) override
+        {
+            std::vector<uint8_t> response = { SERIALIZATION_RESPONSE, data[1], 0, 0, 0, 0 };
+
+            if (data[1] == SD_BLE_GAP_SEC_PARAMS_REPLY)
+            {
+                // No keyset is sent back to the application
+                response.push_back(SER_FIELD_NOT_PRESENT);
+            }
+
+            std::lock_guard<std::mutex> lock(readMutex);
+            dataCallback(response.data(), response.size());
+            return NRF_SUCCESS;
+        }
+
+        void eventSend(const std::vector<uint8_t> &event)
+        {
+            std::vector<uint8_t> packet = { SERIALIZATION_EVENT };
+            packet.insert(packet.end(), event.begin(), event.end());
+
+            // Received data is handled on one thread in the real transports
+            std::lock_guard<std::mutex> lock(readMutex);
+            dataCallback(packet.data(), packet.size());
+        }
+
+        TimerWheel *timerWheelGet() override
+        {
+            return &timerWheel;
+        }
+
+    private:
+        std::mutex readMutex;
+        TimerWheel timerWheel;
+    };
+
+    struct Link
+    {
+        uint16_t connHandle;
+        ble_gap_enc_key_t peerEncKey;
+        ble_gap_sec_keyset_t keyset;
+    };
+
+    struct Device
+    {
+        SimulatedConnectivity *connectivity;
+        SerializationTransport *transport;
+        adapter_t *adapter;
+        std::vector<Link> links;
+    };
+
+    std::mutex eventMutex;
+    std::condition_variable eventCondition;
+    uint32_t authStatusCount = 0;
+    uint32_t disconnectedCount = 0;
+    uint32_t failureCount = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            failureCount++;
+        }
+    }
+
+    void statusHandler(adapter_t *, sd_rpc_app_status_t, const char *) {}
+
+    void logHandler(adapter_t *, sd_rpc_log_severity_t severity, const char *message)
+    {
+        if (severity >= SD_RPC_LOG_ERROR)
+        {
+            std::cerr << "log: " << message << std::endl;
+        }
+    }
+
+    void eventHandler(adapter_t *, ble_evt_t *event)
+    {
+        std::lock_guard<std::mutex> lock(eventMutex);
+
+        if (event->header.evt_id == BLE_GAP_EVT_AUTH_STATUS)
+        {
+            authStatusCount++;
+        }
+        else if (event->header.evt_id == BLE_GAP_EVT_DISCONNECTED)
+        {
+            disconnectedCount++;
+        }
+
+        eventCondition.notify_all();
+    }
+
+    bool eventsWait(uint32_t authStatusExpected, uint32_t disconnectedExpected)
+    {
+        std::unique_lock<std::mutex> lock(eventMutex);
+        return eventCondition.wait_for(lock, std::chrono::seconds(5), [&] {
+            return authStatusCount == authStatusExpected && disconnectedCount == disconnectedExpected;
+        });
+    }
+
+    std::vector<uint8_t> authStatusEventGet(uint16_t connHandle, uint8_t ltkSeed)
+    {
+        std::vector<uint8_t> event(256);
+        uint32_t index = 0;
+
+        index += uint16_encode(BLE_GAP_EVT_AUTH_STATUS, &event[index]);
+        index += uint16_encode(connHandle, &event[index]);
+
+        ble_gap_evt_auth_status_t authStatus;
+        std::memset(&authStatus, 0, sizeof(authStatus));
+        authStatus.auth_status = BLE_GAP_SEC_STATUS_SUCCESS;
+        authStatus.bonded = 1;
+        authStatus.kdist_peer.enc = 1;
+
+        ble_gap_enc_key_t encKey;
+        std::memset(&encKey, 0, sizeof(encKey));
+        std::memset(encKey.enc_info.ltk, ltkSeed, sizeof(encKey.enc_info.ltk));
+        encKey.enc_info.ltk_len = sizeof(encKey.enc_info.ltk);
+        encKey.master_id.ediv = connHandle;
+
+        ble_gap_sec_keyset_t keyset;
+        std::memset(&keyset, 0, sizeof(keyset));
+        keyset.keys_peer.p_enc_key = &encKey;
+
+        ble_gap_evt_auth_status_t_enc(&authStatus, event.data(), static_cast<uint32_t>(event.size()), &index);
+        ble_gap_sec_keyset_t_enc(&keyset, event.data(), static_cast<uint32_t>(event.size()), &index);
+
+        event.resize(index);
+        return event;
+    }
+
+    std::vector<uint8_t> disconnectedEventGet(uint16_t connHandle)
+    {
+        std::vector<uint8_t> event(5);
+        uint16_encode(BLE_GAP_EVT_DISCONNECTED, &event[0]);
+        uint16_encode(connHandle, &event[2]);
+        event[4] = BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION;
+        return event;
+    }
+
+    void deviceOpen(Device &device, uint8_t linkCount)
+    {
+        device.connectivity = new SimulatedConnectivity();
+        device.transport = new SerializationTransport(device.connectivity, 1000);
+
+        transport_layer_t transportLayer;
+        transportLayer.internal = device.transport;
+        device.adapter = sd_rpc_adapter_create(&transportLayer);
+
+        check(sd_rpc_open(device.adapter, statusHandler, eventHandler, logHandler) == NRF_SUCCESS, "open adapter");
+
+        device.links.resize(linkCount);
+
+        for (uint8_t i = 0; i < linkCount; i++)
+        {
+            auto &link = device.links[i];
+            link.connHandle = i;
+            std::memset(&link.peerEncKey, 0, sizeof(link.peerEncKey));
+            std::memset(&link.keyset, 0, sizeof(link.keyset));
+            link.keyset.keys_peer.p_enc_key = &link.peerEncKey;
+        }
+    }
+
+    uint32_t secParamsReply(Device &device, Link &link)
+    {
+        return sd_ble_gap_sec_params_reply(device.adapter, link.connHandle, BLE_GAP_SEC_STATUS_SUCCESS, nullptr, &link.keyset);
+    }
+
+    void keysCheck(const Device &device, const std::string &name)
+    {
+        for (auto &link : device.links)
+        {
+            auto ltk = link.peerEncKey.enc_info.ltk;
+            auto expected = static_cast<uint8_t>(link.connHandle + 1);
+            check(ltk[0] == expected && ltk[sizeof(link.peerEncKey.enc_info.ltk) - 1] == expected && link.peerEncKey.master_id.ediv == link.connHandle,
+                  name + " link " + std::to_string(link.connHandle) + " got the keys of another link");
+        }
+    }
+}
+
+int main()
+{
+    Device limited;
+    Device unlimited;
+
+    deviceOpen(limited, 4);
+    deviceOpen(unlimited, 8);
+
+    // The first adapter is enabled for three links, the second keeps the default of SER_MAX_CONNECTIONS
+    ble_enable_params_t enableParams;
+    std::memset(&enableParams, 0, sizeof(enableParams));
+    enableParams.gap_enable_params.periph_conn_count = 2;
+    enableParams.gap_enable_params.central_conn_count = 1;
+    check(sd_ble_enable(limited.adapter, &enableParams, nullptr) == NRF_SUCCESS, "enable");
+
+    // Start the security procedures of the links of both adapters at the same time
+    std::vector<std::thread> procedures;
+
+    for (size_t i = 0; i < unlimited.links.size(); i++)
+    {
+        procedures.emplace_back([&unlimited, i] {
+            auto &link = unlimited.links[i];
+            check(secParamsReply(unlimited, link) == NRF_SUCCESS, "reply on link " + std::to_string(i));
+            unlimited.connectivity->eventSend(authStatusEventGet(link.connHandle, static_cast<uint8_t>(link.connHandle + 1)));
+        });
+    }
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        procedures.emplace_back([&limited, i] {
+            check(secParamsReply(limited, limited.links[i]) == NRF_SUCCESS, "reply on limited link " + std::to_string(i));
+        });
+    }
+
+    for (auto &procedure : procedures)
+    {
+        procedure.join();
+    }
+
+    check(eventsWait(8, 0), "keys of all links of the second adapter delivered");
+    keysCheck(unlimited, "second adapter");
+
+    // All three instances of the first adapter are taken until a link goes away
+    check(secParamsReply(limited, limited.links[3]) == NRF_ERROR_NO_MEM, "fourth link of the first adapter is refused");
+
+    limited.connectivity->eventSend(disconnectedEventGet(0));
+    check(eventsWait(8, 1), "disconnect delivered");
+    check(secParamsReply(limited, limited.links[3]) == NRF_SUCCESS, "disconnect frees the instance");
+
+    for (size_t i = 1; i < limited.links.size(); i++)
+    {
+        limited.connectivity->eventSend(authStatusEventGet(limited.links[i].connHandle, static_cast<uint8_t>(limited.links[i].connHandle + 1)));
+    }
+
+    check(eventsWait(11, 1), "keys of the first adapter delivered");
+    check(limited.links[0].peerEncKey.enc_info.ltk[0] == 0, "disconnected link got no keys");
+    limited.links.erase(limited.links.begin());
+    keysCheck(limited, "first adapter");
+
+    // A keyset left behind and the connection count go away with the adapter
+    check(secParamsReply(limited, limited.links[0]) == NRF_SUCCESS, "reply before delete");
+
+    sd_rpc_close(limited.adapter);
+    sd_rpc_adapter_delete(limited.adapter);
+    free(limited.adapter);
+
+    {
+        ser_ble_gap_app_keyset_t *keyset;
+        BLESecurityContext context(limited.transport);
+        check(app_ble_gap_sec_context_find(limited.links[0].connHandle, &keyset) == NRF_ERROR_NOT_FOUND, "keysets released with the adapter");
+        check(app_ble_gap_sec_context_conn_count_get() == SER_MAX_CONNECTIONS, "connection count released with the adapter");
+    }
+
+    sd_rpc_close(unlimited.adapter);
+    sd_rpc_adapter_delete(unlimited.adapter);
+    free(unlimited.adapter);
+
+    if (failureCount != 0)
+    {
+        std::cerr << failureCount << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Security procedures on concurrent links passed" << std::endl;
+    return 0;
+}
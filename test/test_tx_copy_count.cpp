@@ -0,0 +1,522 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Counts the bytes copied and allocated to take a command from the encoder to the write buffer of the
+// UART, on the vector based path the transports used before and through H5Transport as it is now.
+
+#include "h5.h"
+#include "h5_transport.h"
+#include "slip.h"
+#include "timer_wheel.h"
+#include "transport.h"
+#include "tx_frame.h"
+
+#include "nrf_error.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Only allocations made by the sending thread are counted, not those of the stand-in for the firmware
+    thread_local bool allocationCounting = false;
+    thread_local uint64_t allocatedBytes = 0;
+}
+
+void *operator new(size_t size)
+{
+    if (allocationCounting)
+    {
+        allocatedBytes += size;
+    }
+
+    auto memory = std::malloc(size == 0 ? 1 : size);
+
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace
+{
+    uint32_t failureCount = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            failureCount++;
+        }
+    }
+
+    const uint8_t SERIALIZATION_COMMAND = 0x02;
+    const size_t COMMAND_LENGTH_MAX = 600;
+    const size_t COMMAND_COUNT = 1000;
+
+    // Long enough for no packet to be retransmitted while the stand-in acknowledges it
+    const uint32_t RETRANSMISSION_INTERVAL = 1000;
+
+    /**
+     * @brief Stand-in for the UART. Bytes sent are queued and the queue is taken as the write buffer,
+     * copied on the vector path as UartBoost did before and swapped on the encoded path as it does now.
+     * Once opened it also stands in for the firmware: it answers the link establishment and acknowledges
+     * reliable packets from a thread of its own, and drives the timer wheel of the transports above it.
+     */
+    class CountingUart : public Transport
+    {
+    public:
+        CountingUart() : copiedBytes(0), running(false), ackNum(0) {}
+
+        ~CountingUart()
+        {
+            close();
+        }
+
+        uint32_t open(status_cb_t status_callback, data_cb_t data_callback, log_cb_t log_callback) override
+        {
+            Transport::open(status_callback, data_callback, log_callback);
+
+            running = true;
+            timerWheel.start([] {});
+            timerThread = std::thread([this] { timerRunner(); });
+            peerThread = std::thread([this] { peerRunner(); });
+            return NRF_SUCCESS;
+        }
+
+        uint32_t close() override
+        {
+            {
+                std::lock_guard<std::mutex> lock(peerMutex);
+                running = false;
+                peerCondition.notify_all();
+            }
+
+            if (timerThread.joinable())
+            {
+                timerThread.join();
+            }
+
+            if (peerThread.joinable())
+            {
+                peerThread.join();
+            }
+
+            timerWheel.stop();
+            return NRF_SUCCESS;
+        }
+
+        uint32_t send(std::vector<uint8_t> &data) override
+        {
+            writeQueue.insert(writeQueue.end(), data.begin(), data.end());
+            copiedBytes += data.size();
+
+            writeBuffer.clear();
+            writeBuffer.insert(writeBuffer.begin(), writeQueue.begin(), writeQueue.end());
+            copiedBytes += writeQueue.size();
+            writeQueue.clear();
+            return 0;
+        }
+
+        uint32_t sendEncoded(const size_t maxLength, const tx_encoder_t &encoder) override
+        {
+            const auto queued = writeQueue.size();
+            writeQueue.resize(queued + maxLength);
+            const auto length = encoder(&writeQueue[queued]);
+            writeQueue.resize(queued + length);
+            copiedBytes += length;
+
+            writeBuffer.clear();
+            writeBuffer.swap(writeQueue);
+
+            if (running)
+            {
+                // Received by the stand-in for the firmware, not part of the path of the command
+                const auto counting = allocationCounting;
+                allocationCounting = false;
+
+                std::lock_guard<std::mutex> lock(peerMutex);
+                written.push_back(writeBuffer);
+                received.push_back(writeBuffer);
+                peerCondition.notify_all();
+
+                allocationCounting = counting;
+            }
+
+            return 0;
+        }
+
+        TimerWheel *timerWheelGet() override
+        {
+            return &timerWheel;
+        }
+
+        std::vector<std::vector<uint8_t>> writtenTake()
+        {
+            std::lock_guard<std::mutex> lock(peerMutex);
+            std::vector<std::vector<uint8_t>> frames;
+            frames.swap(written);
+            return frames;
+        }
+
+        uint64_t copiedBytes;
+        std::vector<uint8_t> writeQueue;
+        std::vector<uint8_t> writeBuffer;
+
+    private:
+        void timerRunner()
+        {
+            while (running)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                timerWheel.advance();
+            }
+        }
+
+        void peerRunner()
+        {
+            std::unique_lock<std::mutex> lock(peerMutex);
+
+            while (running)
+            {
+                if (received.empty())
+                {
+                    peerCondition.wait(lock);
+                    continue;
+                }
+
+                auto frame = received.front();
+                received.pop_front();
+
+                lock.unlock();
+                frameProcess(frame);
+                lock.lock();
+            }
+        }
+
+        void frameProcess(std::vector<uint8_t> &frame)
+        {
+            std::vector<uint8_t> packet;
+            std::vector<uint8_t> payload;
+            uint8_t seq;
+            uint8_t ack;
+            bool reliable;
+            h5_pkt_type_t type;
+
+            if (slip_decode(frame, packet) != 0 ||
+                h5_decode(packet, payload, &seq, &ack, nullptr, nullptr, nullptr, &reliable, &type) != 0)
+            {
+                return;
+            }
+
+            if (type == LINK_CONTROL_PACKET && payload.size() >= 2)
+            {
+                if (payload[0] == 0x01 && payload[1] == 0x7E)
+                {
+                    packetSend({ 0x02, 0x7D }, 0, LINK_CONTROL_PACKET);
+                }
+                else if (payload[0] == 0x03 && payload[1] == 0xFC)
+                {
+                    packetSend({ 0x04, 0x7B, 0x11 }, 0, LINK_CONTROL_PACKET);
+                }
+            }
+            else if (type == VENDOR_SPECIFIC_PACKET && reliable)
+            {
+                if (seq == ackNum)
+                {
+                    ackNum = (ackNum + 1) & 0x07;
+                }
+
+                packetSend({}, ackNum, ACK_PACKET);
+            }
+        }
+
+        void packetSend(std::vector<uint8_t> payload, uint8_t ack, h5_pkt_type_t type)
+        {
+            std::vector<uint8_t> packet;
+            std::vector<uint8_t> frame;
+
+            h5_encode(payload, packet, 0, ack, false, false, type);
+            slip_encode(packet, frame, false);
+            dataCallback(frame.data(), frame.size());
+        }
+
+        TimerWheel timerWheel;
+        std::thread timerThread;
+        std::thread peerThread;
+        std::atomic<bool> running;
+
+        std::mutex peerMutex;
+        std::condition_variable peerCondition;
+        std::deque<std::vector<uint8_t>> received;
+        std::vector<std::vector<uint8_t>> written;
+        uint8_t ackNum;
+    };
+
+    // Command with a share of SLIP special characters, encoded by the codecs in the command buffer
+    size_t commandEncode(const size_t index, uint8_t *buffer)
+    {
+        const auto length = 1 + (index * 37) % (COMMAND_LENGTH_MAX - 1);
+
+        for (size_t i = 0; i < length; i++)
+        {
+            buffer[i] = (i % 16) == 0 ? 0xC0 : static_cast<uint8_t>(index + i);
+        }
+
+        return length;
+    }
+
+    struct PathCount
+    {
+        uint64_t commandBytes;
+        uint64_t copiedBytes;
+        uint64_t allocatedBytes;
+        std::vector<uint64_t> allocatedPerCommand;
+        std::vector<std::vector<uint8_t>> written;
+    };
+
+    /**@brief The path of a command before TxFrame, each layer copying it into a buffer of its own. */
+    PathCount vectorPathRun()
+    {
+        PathCount count = {};
+        CountingUart uart;
+        std::vector<uint8_t> cmdBuffer(COMMAND_LENGTH_MAX);
+        std::vector<uint8_t> lastPacket;
+        std::vector<uint8_t> lastH5Packet;
+
+        for (size_t i = 0; i < COMMAND_COUNT; i++)
+        {
+            const auto cmdLength = commandEncode(i, cmdBuffer.data());
+            count.commandBytes += cmdLength;
+
+            allocatedBytes = 0;
+            allocationCounting = true;
+            uint64_t copied = 0;
+
+            // SerializationTransport put the packet type in front of a copy of the command
+            std::vector<uint8_t> commandBuffer(cmdLength + 1);
+            commandBuffer[0] = SERIALIZATION_COMMAND;
+            std::memcpy(&commandBuffer[1], cmdBuffer.data(), cmdLength);
+            copied += cmdLength;
+
+            // H5Transport encoded the packet and its SLIP frame, and kept both for retransmissions.
+            // The firmware sends no reliable packets, the acknowledgement number stays 0.
+            std::vector<uint8_t> h5EncodedPacket;
+            h5_encode(commandBuffer, h5EncodedPacket, i & 0x07, 0, true, true, VENDOR_SPECIFIC_PACKET);
+            copied += commandBuffer.size();
+
+            std::vector<uint8_t> encodedPacket;
+            slip_encode(h5EncodedPacket, encodedPacket, false);
+            copied += h5EncodedPacket.size();
+
+            lastPacket = encodedPacket;
+            lastH5Packet = h5EncodedPacket;
+            copied += encodedPacket.size() + h5EncodedPacket.size();
+
+            uart.copiedBytes = 0;
+            uart.send(encodedPacket);
+            copied += uart.copiedBytes;
+
+            allocationCounting = false;
+            count.allocatedBytes += allocatedBytes;
+            count.allocatedPerCommand.push_back(allocatedBytes);
+            count.copiedBytes += copied;
+            count.written.push_back(uart.writeBuffer);
+        }
+
+        return count;
+    }
+
+    /**@brief The path of a command now, encoded in a pooled frame and sent through H5Transport. */
+    PathCount h5PathRun(const sd_rpc_log_severity_t severityFilter)
+    {
+        PathCount count = {};
+        auto uart = new CountingUart();
+
+        // The transport deletes the UART
+        H5Transport h5(uart, RETRANSMISSION_INTERVAL);
+        h5.logSeverityFilterSet(severityFilter);
+
+        const auto errCode = h5.open(
+            [](sd_rpc_app_status_t, const char *) {},
+            [](uint8_t *, size_t) {},
+            [](sd_rpc_log_severity_t, std::string) {});
+
+        check(errCode == NRF_SUCCESS, "link established with the stand-in for the firmware");
+
+        if (errCode != NRF_SUCCESS)
+        {
+            return count;
+        }
+
+        TxFramePool framePool(COMMAND_LENGTH_MAX, 4);
+
+        // The pool and the queue of the UART reach their size with the first command
+        uart->writeQueue.reserve(slip_encoded_length_max(COMMAND_LENGTH_MAX + TxFrame::HEADROOM + TxFrame::TAILROOM));
+        uart->writeBuffer.reserve(uart->writeQueue.capacity());
+        framePool.acquire();
+        uart->writtenTake();
+
+        for (size_t i = 0; i < COMMAND_COUNT; i++)
+        {
+            auto frame = framePool.acquire();
+            const auto cmdLength = commandEncode(i, frame->payload());
+            count.commandBytes += cmdLength;
+
+            // As SerializationTransport::send() puts the packet type in front of the command
+            frame->reset(cmdLength);
+            *frame->prepend(1) = SERIALIZATION_COMMAND;
+
+            uart->copiedBytes = 0;
+            allocatedBytes = 0;
+            allocationCounting = true;
+
+            const auto sendErrCode = h5.send(*frame);
+
+            allocationCounting = false;
+            count.allocatedBytes += allocatedBytes;
+            count.allocatedPerCommand.push_back(allocatedBytes);
+            count.copiedBytes += uart->copiedBytes;
+
+            if (sendErrCode != NRF_SUCCESS)
+            {
+                check(false, "command acknowledged");
+                break;
+            }
+        }
+
+        count.written = uart->writtenTake();
+        h5.close();
+        return count;
+    }
+
+    /**@brief Bytes allocated to arm and cancel the retransmission timer of a packet. */
+    uint64_t timerAllocatedBytesGet()
+    {
+        TimerWheel timerWheel;
+        timerWheel.start([] {});
+
+        // The callback captures the transport only, as H5Transport arms it
+        auto transport = &timerWheel;
+        auto armCancel = [&] {
+            timerWheel.cancel(timerWheel.arm(std::chrono::milliseconds(RETRANSMISSION_INTERVAL), [transport](timer_id_t) { (void) transport; }));
+        };
+
+        armCancel();
+
+        allocatedBytes = 0;
+        allocationCounting = true;
+        armCancel();
+        allocationCounting = false;
+
+        timerWheel.stop();
+        return allocatedBytes;
+    }
+}
+
+int main()
+{
+    const auto before = vectorPathRun();
+    const auto after = h5PathRun(SD_RPC_LOG_INFO);
+    const auto logged = h5PathRun(SD_RPC_LOG_DEBUG);
+    const auto timerAllocated = timerAllocatedBytesGet();
+
+    std::cout << "Bytes per command byte, before: copied " << static_cast<double>(before.copiedBytes) / before.commandBytes
+              << ", allocated " << static_cast<double>(before.allocatedBytes) / before.commandBytes << std::endl;
+    std::cout << "Bytes per command byte, after: copied " << static_cast<double>(after.copiedBytes) / after.commandBytes
+              << ", allocated " << static_cast<double>(after.allocatedBytes) / after.commandBytes << std::endl;
+    std::cout << "Bytes allocated per command, after: " << (after.allocatedPerCommand.empty() ? 0 : after.allocatedPerCommand.back())
+              << ", with packets logged " << (logged.allocatedPerCommand.empty() ? 0 : logged.allocatedPerCommand.back())
+              << ", to arm the retransmission timer " << timerAllocated << std::endl;
+
+    check(after.written.size() == COMMAND_COUNT, "each command written once");
+    check(before.written == after.written, "same bytes written to the UART on both paths");
+
+    // The SLIP encoder writes each command once, with the H5 header and CRC and the escapes
+    uint64_t writtenBytes = 0;
+
+    for (const auto &written : after.written)
+    {
+        writtenBytes += written.size();
+    }
+
+    check(after.copiedBytes == writtenBytes, "command copied once, by the SLIP encoder");
+
+    // What is left is the entry of the retransmission timer in the timer wheel, of the same size for every
+    // command. The first command is not counted, the timer wheel reaches its size with it.
+    const auto allocatedOther = std::find_if(after.allocatedPerCommand.begin() + 1, after.allocatedPerCommand.end(),
+        [timerAllocated](uint64_t allocated) { return allocated != timerAllocated; });
+    check(after.allocatedPerCommand.size() == COMMAND_COUNT && allocatedOther == after.allocatedPerCommand.end(),
+        "nothing but the retransmission timer allocated per command");
+
+    check(logged.allocatedBytes > after.allocatedBytes, "packets only formatted when they are logged");
+    check(before.copiedBytes >= 7 * before.commandBytes, "command copied seven times on the vector path");
+
+    if (failureCount != 0)
+    {
+        std::cerr << failureCount << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "TX copy count passed" << std::endl;
+    return 0;
+}
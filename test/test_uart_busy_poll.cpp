@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Measures round trips to an echoing peer on a pseudo terminal with the port read by the IO service
+// thread and with it read by the busy polling thread, and closes a polled port from its own callback.
+
+#include "uart_boost.h"
+#include "nrf_error.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace
+{
+    uint32_t failureCount = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            failureCount++;
+        }
+    }
+
+    const size_t ROUND_TRIP_COUNT = 500;
+    const size_t ROUND_TRIP_LENGTH = 16;
+
+    /**
+     * @brief Peer on the far end of a pseudo terminal that writes back what it reads.
+     */
+    class EchoPeer
+    {
+    public:
+        EchoPeer() : master(-1), running(false) {}
+
+        ~EchoPeer()
+        {
+            close();
+        }
+
+        bool open()
+        {
+            master = posix_openpt(O_RDWR | O_NOCTTY);
+
+            if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+            {
+                return false;
+            }
+
+            portName = ptsname(master);
+
+            struct termios settings;
+            tcgetattr(master, &settings);
+            cfmakeraw(&settings);
+            tcsetattr(master, TCSANOW, &settings);
+
+            running = true;
+            echo = std::thread([this] { echoRunner(); });
+            return true;
+        }
+
+        void close()
+        {
+            running = false;
+
+            if (echo.joinable())
+            {
+                echo.join();
+            }
+
+            if (master >= 0)
+            {
+                ::close(master);
+                master = -1;
+            }
+        }
+
+        /**@brief Writes bytes to the host without waiting for them to be echoed. */
+        void rawWrite(const std::vector<uint8_t> &data)
+        {
+            (void) ::write(master, data.data(), data.size());
+        }
+
+        std::string portNameGet() const
+        {
+            return portName;
+        }
+
+    private:
+        void echoRunner()
+        {
+            uint8_t buffer[256];
+
+            while (running)
+            {
+                struct pollfd pfd = { master, POLLIN, 0 };
+
+                if (poll(&pfd, 1, 20) <= 0)
+                {
+                    continue;
+                }
+
+                const auto length = ::read(master, buffer, sizeof(buffer));
+
+                if (length > 0)
+                {
+                    (void) ::write(master, buffer, length);
+                }
+            }
+        }
+
+        int master;
+        std::string portName;
+        std::thread echo;
+        std::atomic<bool> running;
+    };
+
+    UartBoost *portCreate(const EchoPeer &peer, const sd_rpc_busy_poll_params_t *busyPollParams)
+    {
+        UartCommunicationParameters parameters;
+        const auto portName = peer.portNameGet();
+        parameters.portName = portName.c_str();
+        parameters.baudRate = 1000000;
+        parameters.flowControl = UartFlowControlNone;
+        parameters.parity = UartParityNone;
+        parameters.stopBits = UartStopBitsOne;
+        parameters.dataBits = UartDataBitsEight;
+
+        auto port = new UartBoost(parameters);
+        check(port->busyPollSet(busyPollParams) == NRF_SUCCESS, "read mode set");
+        return port;
+    }
+
+    struct RoundTrips
+    {
+        double p50Us;
+        double p99Us;
+        bool intact;
+    };
+
+    RoundTrips roundTripsRun(const sd_rpc_busy_poll_params_t *busyPollParams, sd_rpc_busy_poll_stats_t *stats)
+    {
+        EchoPeer peer;
+        check(peer.open(), "pseudo terminal opened");
+
+        auto port = portCreate(peer, busyPollParams);
+
+        std::mutex receivedMutex;
+        std::vector<uint8_t> received;
+        std::atomic<size_t> receivedLength(0);
+
+        const auto errCode = port->open(
+            [](sd_rpc_app_status_t, const char *) {},
+            [&](uint8_t *data, size_t length) {
+                std::lock_guard<std::mutex> lock(receivedMutex);
+                received.insert(received.end(), data, data + length);
+                receivedLength = received.size();
+            },
+            [](sd_rpc_log_severity_t, std::string) {});
+
+        check(errCode == NRF_SUCCESS, "port opened");
+
+        RoundTrips roundTrips = { 0, 0, true };
+        std::vector<double> times;
+        std::vector<uint8_t> sent;
+
+        for (size_t i = 0; i < ROUND_TRIP_COUNT && errCode == NRF_SUCCESS; i++)
+        {
+            std::vector<uint8_t> data(ROUND_TRIP_LENGTH);
+
+            for (size_t j = 0; j < data.size(); j++)
+            {
+                data[j] = static_cast<uint8_t>(i + j);
+            }
+
+            sent.insert(sent.end(), data.begin(), data.end());
+
+            const auto started = std::chrono::steady_clock::now();
+            const auto deadline = started + std::chrono::seconds(1);
+            port->send(data);
+
+            while (receivedLength < sent.size() && std::chrono::steady_clock::now() < deadline)
+            {
+                std::this_thread::yield();
+            }
+
+            if (receivedLength < sent.size())
+            {
+                roundTrips.intact = false;
+                break;
+            }
+
+            times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count());
+        }
+
+        if (stats != nullptr)
+        {
+            *stats = port->busyPollStatsGet();
+        }
+
+        port->close();
+        delete port;
+
+        {
+            std::lock_guard<std::mutex> lock(receivedMutex);
+            roundTrips.intact = roundTrips.intact && received == sent;
+        }
+
+        if (!times.empty())
+        {
+            std::sort(times.begin(), times.end());
+            roundTrips.p50Us = times[times.size() / 2];
+            roundTrips.p99Us = times[times.size() * 99 / 100];
+        }
+
+        return roundTrips;
+    }
+
+    void closedFromCallbackRun()
+    {
+        // The port is closed and deleted from the data callback on the polling thread
+        EchoPeer peer;
+        check(peer.open(), "pseudo terminal opened");
+
+        sd_rpc_busy_poll_params_t busyPollParams = { -1, 1000, 100 };
+        auto port = portCreate(peer, &busyPollParams);
+
+        std::atomic<uint32_t> callbackCount(0);
+        std::atomic<bool> deleted(false);
+
+        const auto errCode = port->open(
+            [](sd_rpc_app_status_t, const char *) {},
+            [&](uint8_t *, size_t) {
+                callbackCount++;
+
+                if (!deleted.exchange(true))
+                {
+                    port->close();
+                    delete port;
+                }
+            },
+            [](sd_rpc_log_severity_t, std::string) {});
+
+        check(errCode == NRF_SUCCESS, "port opened");
+
+        peer.rawWrite({ 0x01 });
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+        while (!deleted && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        check(deleted, "port deleted from its callback");
+
+        // Nothing is read for the deleted port any more
+        peer.rawWrite({ 0x02 });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        check(callbackCount == 1, "no callback after the port was deleted");
+    }
+}
+
+int main()
+{
+    sd_rpc_busy_poll_stats_t stats = {};
+    const auto defaultMode = roundTripsRun(nullptr, &stats);
+    check(defaultMode.intact, "bytes echoed intact when read by the IO service thread");
+    check(!stats.active && stats.poll_count == 0, "no polling when read by the IO service thread");
+
+    sd_rpc_busy_poll_params_t busyPollParams = { -1, 1000, 0 };
+    const auto busyPoll = roundTripsRun(&busyPollParams, &stats);
+    check(busyPoll.intact, "bytes echoed intact when polled");
+    check(stats.active, "polling while the port is open");
+    check(stats.byte_count == ROUND_TRIP_COUNT * ROUND_TRIP_LENGTH, "all bytes read by the polling thread");
+    check(stats.read_count > 0 && stats.poll_count >= stats.read_count, "polls and reads counted");
+
+    std::cout << "Round trip of " << ROUND_TRIP_LENGTH << " bytes, default p50 " << defaultMode.p50Us << " us, p99 "
+              << defaultMode.p99Us << " us, busy poll p50 " << busyPoll.p50Us << " us, p99 " << busyPoll.p99Us << " us" << std::endl;
+
+    closedFromCallbackRun();
+
+    if (failureCount != 0)
+    {
+        std::cerr << failureCount << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Busy poll passed" << std::endl;
+    return 0;
+}
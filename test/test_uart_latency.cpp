@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2016 Nordic Semiconductor ASA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ *   3. Neither the name of Nordic Semiconductor ASA nor the names of other
+ *   contributors to this software may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ *   4. This software must only be used in or with a processor manufactured by Nordic
+ *   Semiconductor ASA, or in or with a processor manufactured by a third party that
+ *   is used in combination with a processor manufactured by Nordic Semiconductor.
+ *
+ *   5. Any software provided in binary or object form under this license must not be
+ *   reverse engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Tunes a pseudo terminal for low latency with the USB bridge looked up in a fake sysfs tree, and
+// checks that the latency timer of an FTDI bridge is lowered while the port is open.
+
+#include "uart_boost.h"
+#include "nrf_error.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    uint32_t failureCount = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            failureCount++;
+        }
+    }
+
+    /**
+     * @brief Sysfs tree in a temporary directory with the tty device of a port bound to a driver.
+     */
+    class FakeSysfs
+    {
+    public:
+        FakeSysfs(const std::string &portName, const std::string &driver)
+        {
+            char path[] = "/tmp/sysfsXXXXXX";
+            root = mkdtemp(path);
+
+            const auto ttyName = portName.substr(portName.find_last_of('/') + 1);
+            directoryAdd("/bus");
+            directoryAdd("/bus/usb-serial");
+            directoryAdd("/bus/usb-serial/drivers");
+            directoryAdd("/bus/usb-serial/drivers/" + driver);
+            directoryAdd("/class");
+            directoryAdd("/class/tty");
+            directoryAdd("/class/tty/" + ttyName);
+            directoryAdd("/class/tty/" + ttyName + "/device");
+
+            deviceDir = root + "/class/tty/" + ttyName + "/device";
+            paths.push_back(deviceDir + "/driver");
+            (void) symlink((root + "/bus/usb-serial/drivers/" + driver).c_str(), paths.back().c_str());
+        }
+
+        ~FakeSysfs()
+        {
+            for (auto path = paths.rbegin(); path != paths.rend(); ++path)
+            {
+                (void) remove(path->c_str());
+            }
+
+            (void) rmdir(root.c_str());
+        }
+
+        void latencyTimerWrite(const unsigned int latencyTimer)
+        {
+            const auto path = deviceDir + "/latency_timer";
+
+            if (std::find(paths.begin(), paths.end(), path) == paths.end())
+            {
+                paths.push_back(path);
+            }
+
+            std::ofstream(path) << latencyTimer << std::endl;
+        }
+
+        unsigned int latencyTimerRead() const
+        {
+            unsigned int latencyTimer = 0;
+            std::ifstream(deviceDir + "/latency_timer") >> latencyTimer;
+            return latencyTimer;
+        }
+
+        std::string root;
+
+    private:
+        void directoryAdd(const std::string &path)
+        {
+            paths.push_back(root + path);
+            (void) mkdir(paths.back().c_str(), 0700);
+        }
+
+        std::string deviceDir;
+        std::vector<std::string> paths;
+    };
+
+    UartBoost *portOpen(const std::string &portName, const std::string &sysfsRoot, uint32_t *errCode)
+    {
+        UartCommunicationParameters parameters;
+        parameters.portName = portName.c_str();
+        parameters.baudRate = 1000000;
+        parameters.flowControl = UartFlowControlNone;
+        parameters.parity = UartParityNone;
+        parameters.stopBits = UartStopBitsOne;
+        parameters.dataBits = UartDataBitsEight;
+
+        auto port = new UartBoost(parameters);
+        port->sysfsRootSet(sysfsRoot);
+        check(port->lowLatencySet(true) == NRF_SUCCESS, "low latency requested");
+
+        *errCode = port->open(
+            [](sd_rpc_app_status_t, const char *) {},
+            [](uint8_t *, size_t) {},
+            [](sd_rpc_log_severity_t, std::string) {});
+
+        return port;
+    }
+
+    void ftdiRun(const std::string &portName)
+    {
+        FakeSysfs sysfs(portName, "ftdi_sio");
+        sysfs.latencyTimerWrite(16);
+
+        uint32_t errCode;
+        auto port = portOpen(portName, sysfs.root, &errCode);
+        check(errCode == NRF_SUCCESS, "FTDI port opened");
+
+        auto info = port->latencyInfoGet();
+        check(info.bridge == SD_RPC_USB_BRIDGE_FTDI, "FTDI bridge identified from the driver link");
+        check(info.previous_latency_timer_ms == 16, "previous latency timer read");
+        check(info.latency_timer_ms == 1, "latency timer lowered");
+        check(sysfs.latencyTimerRead() == 1, "latency timer written to sysfs");
+
+        // A pseudo terminal has no serial driver flags, the low latency flag is left off
+        check(!info.low_latency, "low latency flag not reported without a serial driver");
+
+        port->close();
+        check(sysfs.latencyTimerRead() == 16, "latency timer restored on close");
+        delete port;
+    }
+
+    void ftdiAlreadyLowRun(const std::string &portName)
+    {
+        FakeSysfs sysfs(portName, "ftdi_sio");
+        sysfs.latencyTimerWrite(1);
+
+        uint32_t errCode;
+        auto port = portOpen(portName, sysfs.root, &errCode);
+        check(errCode == NRF_SUCCESS, "FTDI port with a low latency timer opened");
+
+        auto info = port->latencyInfoGet();
+        check(info.latency_timer_ms == 1 && info.previous_latency_timer_ms == 1, "low latency timer kept");
+
+        port->close();
+        check(sysfs.latencyTimerRead() == 1, "low latency timer left as it was");
+        delete port;
+    }
+
+    void otherBridgeRun(const std::string &portName)
+    {
+        FakeSysfs sysfs(portName, "cp210x");
+
+        uint32_t errCode;
+        auto port = portOpen(portName, sysfs.root, &errCode);
+        check(errCode == NRF_SUCCESS, "CP210x port opened");
+
+        auto info = port->latencyInfoGet();
+        check(info.bridge == SD_RPC_USB_BRIDGE_CP210X, "CP210x bridge identified from the driver link");
+        check(info.latency_timer_ms == 0, "no latency timer without an FTDI bridge");
+
+        port->close();
+        delete port;
+    }
+
+    void unknownBridgeRun(const std::string &portName)
+    {
+        // The tty device is not in the tree, i.e. not a USB serial port
+        char path[] = "/tmp/sysfsXXXXXX";
+        const std::string root = mkdtemp(path);
+
+        uint32_t errCode;
+        auto port = portOpen(portName, root, &errCode);
+        check(errCode == NRF_SUCCESS, "port without a bridge opened");
+        check(port->latencyInfoGet().bridge == SD_RPC_USB_BRIDGE_UNKNOWN, "bridge unknown without a tty device");
+
+        port->close();
+        delete port;
+        (void) rmdir(root.c_str());
+    }
+}
+
+int main()
+{
+    const auto master = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        std::cerr << "FAILED: pseudo terminal opened" << std::endl;
+        return 1;
+    }
+
+    const std::string portName = ptsname(master);
+
+    ftdiRun(portName);
+    ftdiAlreadyLowRun(portName);
+    otherBridgeRun(portName);
+    unknownBridgeRun(portName);
+
+    close(master);
+
+    if (failureCount != 0)
+    {
+        std::cerr << failureCount << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Serial port latency passed" << std::endl;
+    return 0;
+}